@@ -49,6 +49,9 @@ void digital_rf_randomize_float32(float *data, int len)
 #define TEST_HDF5
 #define TEST_HDF5_CHECKSUM
 #define TEST_HDF5_CHECKSUM_COMPRESS
+#define TEST_HDF5_CODECS
+#define TEST_HDF5_CHUNK_SHAPES
+#define TEST_HDF5_STAGING
 
 int main (int argc, char *argv[])
 {
@@ -59,6 +62,29 @@ int main (int argc, char *argv[])
   int n_writes;
   clock_t begin, end;
   double time_spent;
+#ifdef TEST_HDF5_CODECS
+  int codecs[4] = {DIGITAL_RF_CODEC_DEFLATE, DIGITAL_RF_CODEC_LZ4, DIGITAL_RF_CODEC_ZSTD, DIGITAL_RF_CODEC_BITSHUFFLE_LZ4};
+  int levels[4] = {1, 0, 1, 0};
+  char * codec_names[4] = {"deflate 1", "lz4", "zstd 1", "bitshuffle+lz4"};
+  int codec_idx;
+  unsigned long long disk_bytes;
+  FILE *du;
+  Digital_rf_read_object *read_object;
+  int16_t *data_read;
+#endif
+#ifdef TEST_HDF5_CHUNK_SHAPES
+  uint64_t chunk_samples[5] = {1024, 16384, 131072, 1000000, DIGITAL_RF_CHUNK_AUTO};
+  char * chunk_names[5] = {"1024", "16384", "131072", "whole file", "auto"};
+  int chunk_idx;
+  int n_short_reads = 200;
+  uint64_t short_start;
+  Digital_rf_read_object *chunk_read_object;
+  int16_t *chunk_read;
+#endif
+#ifdef TEST_HDF5_STAGING
+  Digital_rf_write_object *pack_object;
+  int64_t n_packed;
+#endif
   data_int16 = (int16_t *)malloc(RANDOM_BLOCK_SIZE*sizeof(int16_t));
   vector_length=WRITE_BLOCK_SIZE;
   n_writes = (int)1e8/WRITE_BLOCK_SIZE;
@@ -183,6 +209,153 @@ int main (int argc, char *argv[])
   end = clock();
   time_spent = (double)(end - begin) / CLOCKS_PER_SEC;
   printf("done test %1.2f MB/s\n",((double)n_writes*4.0*NUM_SUBCHANNELS*vector_length)/time_spent/1e6);
+#endif
+#ifdef TEST_HDF5_CODECS
+  printf("Test 3 - codecs, checksum, on complex int16 data - channel 0\n");
+  data_read = (int16_t *)malloc(WRITE_BLOCK_SIZE*4*NUM_SUBCHANNELS);
+  for(codec_idx=0 ; codec_idx<4 ; codec_idx++)
+  {
+    result = system("rm -rf /tmp/hdf5/junk0 ; mkdir /tmp/hdf5/junk0");
+    vector_leading_edge_index=0;
+    data_object = digital_rf_create_write_hdf5("/tmp/hdf5/junk0", H5T_NATIVE_SHORT, SUBDIR_CADENCE, MILLISECS_PER_FILE, global_start_sample, SAMPLE_RATE_NUMERATOR, SAMPLE_RATE_DENOMINATOR,
+		  "FAKE_UUID_0", 0, 1, 1, NUM_SUBCHANNELS, 1, 0);
+    if (!data_object)
+      exit(-1);
+    if (digital_rf_set_codec(data_object, codecs[codec_idx], levels[codec_idx]))
+    {
+      printf("%s not available, skipped\n", codec_names[codec_idx]);
+      digital_rf_close_write_hdf5(data_object);
+      continue;
+    }
+    begin = clock();
+    for(i=0 ; i<n_writes ; i++)
+    {
+      result = digital_rf_write_hdf5(data_object, vector_leading_edge_index, data_int16, vector_length);
+      vector_leading_edge_index+=WRITE_BLOCK_SIZE;
+
+      if (result)
+        exit(-1);
+    }
+    digital_rf_close_write_hdf5(data_object);
+    end = clock();
+    time_spent = (double)(end - begin) / CLOCKS_PER_SEC;
+    printf("%s write %1.2f MB/s\n", codec_names[codec_idx], ((double)n_writes*4.0*NUM_SUBCHANNELS*vector_length)/time_spent/1e6);
+
+    /* ratio of the samples written to the size of their files */
+    disk_bytes = 0;
+    if ((du = popen("du -sb /tmp/hdf5/junk0", "r")) != NULL)
+    {
+      if (fscanf(du, "%llu", &disk_bytes) != 1)
+        disk_bytes = 0;
+      pclose(du);
+    }
+    if (disk_bytes)
+      printf("%s ratio %1.3f\n", codec_names[codec_idx], ((double)n_writes*4.0*NUM_SUBCHANNELS*vector_length)/disk_bytes);
+
+    read_object = digital_rf_create_read_hdf5("/tmp/hdf5", 0);
+    if (!read_object)
+      exit(-1);
+    begin = clock();
+    for(i=0 ; i<n_writes ; i++)
+    {
+      if (read_vector(read_object, global_start_sample + i*WRITE_BLOCK_SIZE, WRITE_BLOCK_SIZE, "junk0", data_read) != WRITE_BLOCK_SIZE)
+        exit(-1);
+    }
+    end = clock();
+    digital_rf_close_read_hdf5(read_object);
+    time_spent = (double)(end - begin) / CLOCKS_PER_SEC;
+    printf("%s read %1.2f MB/s\n", codec_names[codec_idx], ((double)n_writes*4.0*NUM_SUBCHANNELS*vector_length)/time_spent/1e6);
+  }
+  free(data_read);
+#endif
+#ifdef TEST_HDF5_CHUNK_SHAPES
+  printf("Test 4 - chunk shapes, compress, checksum - channel 0\n");
+  chunk_read = (int16_t *)malloc(WRITE_BLOCK_SIZE*4*NUM_SUBCHANNELS);
+  for(chunk_idx=0 ; chunk_idx<5 ; chunk_idx++)
+  {
+    result = system("rm -rf /tmp/hdf5/junk0 ; mkdir /tmp/hdf5/junk0");
+    vector_leading_edge_index=0;
+    data_object = digital_rf_create_write_hdf5("/tmp/hdf5/junk0", H5T_NATIVE_SHORT, SUBDIR_CADENCE, MILLISECS_PER_FILE, global_start_sample, SAMPLE_RATE_NUMERATOR, SAMPLE_RATE_DENOMINATOR,
+		  "FAKE_UUID_0", 1, 1, 1, NUM_SUBCHANNELS, 1, 0);
+    if (!data_object || digital_rf_set_chunk_shape(data_object, chunk_samples[chunk_idx], 0, 0))
+      exit(-1);
+    begin = clock();
+    for(i=0 ; i<n_writes ; i++)
+    {
+      result = digital_rf_write_hdf5(data_object, vector_leading_edge_index, data_int16, vector_length);
+      vector_leading_edge_index+=WRITE_BLOCK_SIZE;
+
+      if (result)
+        exit(-1);
+    }
+    printf("chunk %s is %" PRIu64 " samples\n", chunk_names[chunk_idx], (uint64_t)data_object->chunk_size);
+    digital_rf_close_write_hdf5(data_object);
+    end = clock();
+    time_spent = (double)(end - begin) / CLOCKS_PER_SEC;
+    printf("chunk %s write %1.2f MB/s\n", chunk_names[chunk_idx], ((double)n_writes*4.0*NUM_SUBCHANNELS*vector_length)/time_spent/1e6);
+
+    chunk_read_object = digital_rf_create_read_hdf5("/tmp/hdf5", 0);
+    if (!chunk_read_object)
+      exit(-1);
+    begin = clock();
+    for(i=0 ; i<n_writes ; i++)
+    {
+      if (read_vector(chunk_read_object, global_start_sample + i*WRITE_BLOCK_SIZE, WRITE_BLOCK_SIZE, "junk0", chunk_read) != WRITE_BLOCK_SIZE)
+        exit(-1);
+    }
+    end = clock();
+    time_spent = (double)(end - begin) / CLOCKS_PER_SEC;
+    printf("chunk %s read %1.2f MB/s\n", chunk_names[chunk_idx], ((double)n_writes*4.0*NUM_SUBCHANNELS*vector_length)/time_spent/1e6);
+
+    /* short reads scattered over the channel, where each costs the chunks it touches */
+    begin = clock();
+    for(i=0 ; i<n_short_reads ; i++)
+    {
+      short_start = (i*7919*WRITE_BLOCK_SIZE/13) % ((uint64_t)n_writes*WRITE_BLOCK_SIZE - 1000);
+      if (read_vector(chunk_read_object, global_start_sample + short_start, 1000, "junk0", chunk_read) != 1000)
+        exit(-1);
+    }
+    end = clock();
+    digital_rf_close_read_hdf5(chunk_read_object);
+    time_spent = (double)(end - begin) / CLOCKS_PER_SEC;
+    printf("chunk %s 1000 sample reads %1.0f per second\n", chunk_names[chunk_idx], n_short_reads/time_spent);
+  }
+  free(chunk_read);
+#endif
+#ifdef TEST_HDF5_STAGING
+  printf("Test 5 - capture to raw staging files, then pack them with compress, checksum - channel 0\n");
+  result = system("rm -rf /tmp/hdf5/junk0 ; mkdir /tmp/hdf5/junk0");
+  vector_leading_edge_index=0;
+  data_object = digital_rf_create_write_hdf5("/tmp/hdf5/junk0", H5T_NATIVE_SHORT, SUBDIR_CADENCE, MILLISECS_PER_FILE, global_start_sample, SAMPLE_RATE_NUMERATOR, SAMPLE_RATE_DENOMINATOR,
+		  "FAKE_UUID_0", 0, 0, 1, NUM_SUBCHANNELS, 1, 0);
+  if (!data_object || digital_rf_set_staging(data_object, 1))
+    exit(-1);
+  begin = clock();
+  for(i=0 ; i<n_writes ; i++)
+  {
+    result = digital_rf_write_hdf5(data_object, vector_leading_edge_index, data_int16, vector_length);
+    vector_leading_edge_index+=WRITE_BLOCK_SIZE;
+
+    if (result)
+      exit(-1);
+  }
+  digital_rf_close_write_hdf5(data_object);
+  end = clock();
+  time_spent = (double)(end - begin) / CLOCKS_PER_SEC;
+  printf("staging capture %1.2f MB/s\n",((double)n_writes*4.0*NUM_SUBCHANNELS*vector_length)/time_spent/1e6);
+
+  /* packing would run in idle time, here it runs once capture is done */
+  pack_object = digital_rf_create_write_hdf5("/tmp/hdf5/junk0", H5T_NATIVE_SHORT, SUBDIR_CADENCE, MILLISECS_PER_FILE, global_start_sample, SAMPLE_RATE_NUMERATOR, SAMPLE_RATE_DENOMINATOR,
+		  "FAKE_UUID_0", 1, 1, 1, NUM_SUBCHANNELS, 1, 0);
+  if (!pack_object)
+    exit(-1);
+  begin = clock();
+  n_packed = digital_rf_pack_staging(pack_object);
+  if (n_packed < 0 || digital_rf_close_write_hdf5(pack_object))
+    exit(-1);
+  end = clock();
+  time_spent = (double)(end - begin) / CLOCKS_PER_SEC;
+  printf("packed %" PRIi64 " staging files %1.2f MB/s\n", n_packed, ((double)n_writes*4.0*NUM_SUBCHANNELS*vector_length)/time_spent/1e6);
 #endif
   result = system("rm -rf /tmp/hdf5/junk0");
   free(data_int16);
@@ -63,13 +63,71 @@
 #define MED_HDF5_STR 512
 #define BIG_HDF5_STR 1024
 
+/* default budgets of the reader's LRU of open file handles, see digital_rf_set_handle_cache */
+#define DIGITAL_RF_READ_MAX_HANDLES 32
+#define DIGITAL_RF_READ_MAX_HANDLE_NBYTES (64 * 1024 * 1024)
+
+/* rdcc_nbytes value asking the reader to size each file's chunk cache from its chunks and the read span */
+#define DIGITAL_RF_READ_RDCC_AUTO ((uint64_t)-1)
+
+/* hash slots of a chunk cache of fixed rdcc_nbytes, set before the chunk shape is known: a prime, as Hdf5 recommends */
+#define DIGITAL_RF_READ_RDCC_NSLOTS 10007
+
+/* codecs of digital_rf_set_codec, by the ids of the Hdf5 filters implementing them.  All but deflate are
+ * registered third party filters, loaded by Hdf5 from HDF5_PLUGIN_PATH by writers and readers alike. */
+#define DIGITAL_RF_CODEC_NONE 0
+#define DIGITAL_RF_CODEC_DEFLATE 1              /* H5Z_FILTER_DEFLATE, level 1-9 */
+#define DIGITAL_RF_CODEC_LZ4 32004              /* LZ4, no level */
+#define DIGITAL_RF_CODEC_BITSHUFFLE_LZ4 32008   /* bitshuffle of each sample's bits, then LZ4, no level */
+#define DIGITAL_RF_CODEC_ZSTD 32015             /* Zstandard, level 1-22 */
+
 /* chunk size for rf_data_index */
 #define CHUNK_SIZE_RF_DATA_INDEX 100
 
+/* chunk_samples of digital_rf_set_chunk_shape asking for chunks sized from a target, and the default target */
+#define DIGITAL_RF_CHUNK_AUTO 0
+#define DIGITAL_RF_CHUNK_TARGET_NBYTES (256 * 1024)
+
+/* default alignment of digital_rf_set_direct_io, the page size of most systems */
+#define DIGITAL_RF_DIRECT_IO_ALIGNMENT 4096
+
+/* optional per-channel sidecar index, see digital_rf_set_sidecar_index.  The file starts with the
+ * 8 byte DIGITAL_RF_SIDECAR_MAGIC and a native uint64_t 1 (to detect byte order), followed by rows of
+ * three native uint64_t: global sample, file id (unix milliseconds of the file start, as in its name),
+ * and dataset index into /rf_data.  Each file contributes its rf_data_index rows plus a last row whose
+ * dataset index is the length of /rf_data and whose global sample is one past the last block. */
+#define DIGITAL_RF_SIDECAR_INDEX "drf_index.bin"
+#define DIGITAL_RF_SIDECAR_MAGIC "DRFINDX1"
+
+/* raw staging files of digital_rf_set_staging, in this subdirectory of the channel.  Each holds the samples
+ * of one Hdf5 file period and is named as that file with .raw for .h5, under a tmp. name until finished.
+ * It starts with the 8 byte DIGITAL_RF_STAGING_MAGIC and seven native uint64_t: 1 (to detect byte order),
+ * sample size in bytes, sample_rate_numerator, sample_rate_denominator, file_cadence_millisecs, number of
+ * samples and number of rows.  The samples follow as written, then the rows, each two native uint64_t as in
+ * /rf_data_index: the global sample (since 1970, including global_start_sample) and the sample index in the
+ * file where a contiguous block starts. */
+#define DIGITAL_RF_STAGING_DIR "staging"
+#define DIGITAL_RF_STAGING_MAGIC "DRFSTAG1"
+#define DIGITAL_RF_STAGING_HEADER_NBYTES 64
+
 #define DIGITAL_RF_EPOCH "1970-01-01T00:00:00Z"
 #define DIGITAL_RF_TIME_DESCRIPTION "All times in this format are in number of samples since the epoch in the epoch attribute.  The first sample time will be sample_rate * UTC time at first sample.  Attribute init_utc_timestamp records this init UTC time so that a conversion to any other time is possible given the number of leapseconds difference at init_utc_timestamp.  Leapseconds that occur during data recording are included in the data."
 
 
+/* a file made by digital_rf_prepare_hdf5_file, ready for its first write */
+typedef struct drf_prepared_file {
+	char       subdir[BIG_HDF5_STR];    /* subdirectory of the file */
+	char       basename[SMALL_HDF5_STR];/* tmp. basename of the file */
+	uint64_t   max_samples_this_file;   /* total number of samples the file can hold */
+	int        sequence_num;            /* sequence_num attribute of the file */
+	int        made_subdir;             /* 1 if subdir was created for this file */
+	hid_t      hdf5_file;               /* the open file, 0 if none */
+	hid_t      dataset;                 /* its rf_data dataset */
+	hid_t      dataspace;               /* dataspace rf_data was created with */
+	hid_t      index_dataset;           /* its rf_data_index dataset in SWMR mode, else 0 */
+} drf_prepared_file;
+
+
 typedef struct digital_rf_write_object {
 
     /* this structure encapsulates all information needed to write to a series of Hdf5 files in a directory */
@@ -89,7 +147,11 @@ typedef struct digital_rf_write_object {
 	uint64_t   max_chunk_size;          /* smallest possible value for maximum number of samples in a file = floor((file_cadence_millisecs/1000)*sample_rate) */
 	int        is_continuous;           /* 1 if continuous data being written, 0 if there might be gaps */
 	int        needs_chunking;  		/* 1 if /rf_data needs chunking (either not is_continuous or compression or checksums used) */
-	hsize_t    chunk_size;      		/* With Digital RF 2.0 hard coded to CHUNK_SIZE_RF_DATA */
+	hsize_t    chunk_size;      		/* samples per /rf_data chunk, 0 until set at the first write */
+	int        chunk_shape;             /* 1 if the chunks were chosen by digital_rf_set_chunk_shape, 0 if sized from the first write */
+	uint64_t   chunk_samples;           /* samples per chunk asked for, DIGITAL_RF_CHUNK_AUTO to size them from chunk_target_nbytes */
+	int        chunk_subchannels;       /* subchannels per chunk, 0 until auto mode chooses at the first write */
+	uint64_t   chunk_target_nbytes;     /* largest chunk in bytes wanted in auto mode */
 	hid_t      dtype_id;        		/* individual field data type as defined by hdf5.h */
 	hid_t      complex_dtype_id;        /* complex compound data type if is_complex, with fields r and i */
 	uint64_t   global_index;    		/* index into the next sample that could be written (global) */
@@ -101,15 +163,57 @@ typedef struct digital_rf_write_object {
 	hid_t      dataspace;       		/* Dataspace used (rf_data)            */
 	hid_t      filespace;       		/* filespace object used               */
 	hid_t      memspace;        		/* memspace object used                */
+	uint64_t   memspace_samples;        /* number of samples memspace describes, kept until a write of another size */
+	size_t     sample_size;             /* bytes in one sample of the vector, all subchannels */
 	hid_t      hdf5_file;       		/* Hdf5 file presently opened          */
 	hid_t      dataset_prop;    		/* Hdf5 dataset property               */
 	hid_t      index_dataset;   		/* Hdf5 rf_data_index dataset          */
 	hid_t      index_prop;      		/* Hdf5 rf_data_index property         */
 	int        next_index_avail;		/* the next available row in /rf_data_index */
+	hid_t      index_filespace;         /* filespace of the open /rf_data_index, 0 until first extended */
+	hid_t      index_memspace;          /* memspace of the last /rf_data_index write */
+	int        index_memspace_rows;     /* number of rows index_memspace describes */
+	uint64_t * index_scratch;           /* rows returned by digital_rf_create_rf_data_index, reused between writes */
+	int        index_scratch_rows;      /* number of rows index_scratch can hold */
+	int        deferred_index;          /* 1 if /rf_data_index rows are held until file close, see digital_rf_set_deferred_index */
+	uint64_t   index_flush_secs;        /* if non-zero, held rows are also written once they are this old */
+	uint64_t * pending_index;           /* /rf_data_index rows of the open file not yet written */
+	int        pending_index_rows;      /* number of rows in pending_index */
+	int        pending_index_capacity;  /* number of rows pending_index can hold */
+	uint64_t   last_index_flush;        /* unix time /rf_data_index of the open file was last written */
 	int        marching_dots;           /* non-zero if marching dots desired when writing, 0 if not */
 	uint64_t   init_utc_timestamp;      /* unix time when channel init called - stored as attribute in each file */
 	uint64_t   last_utc_timestamp;      /* unix time when last write called - supports digital_rf_get_last_write_time method */
 	int        has_failure;				/* bool flag to detect a io error has occured, disallows all following writes */
+	int        sidecar_index;           /* 1 if rows are appended to DIGITAL_RF_SIDECAR_INDEX as each file is finalized */
+	uint64_t * sidecar_rows;            /* sidecar rows of the open file, appended when it is renamed */
+	uint64_t   sidecar_num_rows;        /* number of rows in sidecar_rows */
+	uint64_t   sidecar_capacity;        /* number of rows sidecar_rows can hold */
+	uint64_t   sidecar_file_id;         /* file id of the open file - unix milliseconds of its start */
+	int        swmr;                    /* 1 if files are written in Hdf5 SWMR mode, see digital_rf_set_swmr */
+	struct drf_async_writer * async;    /* writer thread and its ring of buffers, NULL if writes are synchronous */
+	struct drf_precreate * precreate;   /* thread preparing the next file, NULL if files are created on rollover */
+	int        file_template;           /* 1 if files are copied from an image, see digital_rf_set_file_template */
+	struct drf_file_template * file_templates; /* images built so far, NULL if none */
+	int        compression_level;       /* gzip level of /rf_data, 0 if not compressed */
+	int        codec;                   /* DIGITAL_RF_CODEC_* compressing /rf_data, see digital_rf_set_codec */
+	int        checksum;                /* 1 if /rf_data has the Fletcher32 filter */
+	struct drf_chunk_pool * chunk_pool; /* threads encoding /rf_data chunks, NULL if Hdf5 filters them */
+	uint64_t   file_alignment;          /* alignment of large objects in each file, 0 for the Hdf5 layout, see digital_rf_set_direct_io */
+	struct drf_direct_io * direct_io;   /* aligned writes of contiguous /rf_data, NULL if Hdf5 writes it */
+	int        memory_files;            /* 1 if each file is built in memory and written out when closed, see digital_rf_set_memory_files */
+	int        memory_preallocate;      /* 1 if the space of each such file is reserved with fallocate first */
+	void *     memory_image;            /* image of the last file written out, reused for the next */
+	size_t     memory_image_capacity;   /* bytes memory_image can hold */
+	int        staging;                 /* 1 if samples go to raw staging files, see digital_rf_set_staging */
+	FILE *     staging_fp;              /* open staging file, NULL if none */
+	char       staging_name[SMALL_HDF5_STR]; /* tmp. basename of the open staging file */
+	uint64_t   staging_end;             /* global index one past the last sample the open staging file can hold */
+	uint64_t   staging_samples;         /* number of samples in the open staging file */
+	uint64_t * staging_rows;            /* rows of the open staging file, written when it is finished */
+	uint64_t   staging_num_rows;        /* number of rows in staging_rows */
+	uint64_t   staging_capacity;        /* number of rows staging_rows can hold */
+	char       packed_staging[SMALL_HDF5_STR]; /* staging file in the open Hdf5 file, see digital_rf_pack_staging */
 
 } Digital_rf_write_object;
 
@@ -123,8 +227,8 @@ typedef struct top_level_dir_properties {
 	uint64_t   sample_rate_numerator;   /* sample rate numerator. Final sample rate is sample_rate_numerator/sample_rate_denominator in Hz */
 	uint64_t   sample_rate_denominator; /* sample rate denominator. Final sample rate is sample_rate_numerator/sample_rate_denominator in Hz */
 	long double sample_rate;            /* calculated sample_rate set to sample_rate_numerator/sample_rate_denominator */
-	char * cachedFilename;
-	hid_t cachedFile; //should this be a pointer?
+	char * cachedFilename;              /* path of the channel's most recently used open file, "" if none */
+	hid_t cachedFile;                   /* that file, 0 if none (see drf_file_handle) */
 	char * 	   min_version;
 	char *	   max_version;
 	char * 	   version;
@@ -135,20 +239,79 @@ typedef struct top_level_dir_properties {
 	int        is_continuous;           /* 1 if continuous data being written, 0 if there might be gaps */
 	int        num_subchannels;
 	uint64_t   subdir_cadence_secs;
+	uint64_t   dtype_class;             /* H5Tget_class of a single sample value (H5T_INTEGER or H5T_FLOAT) */
+	uint64_t   dtype_size;              /* H5Tget_size of a single sample value (real or imaginary part) */
 
 
 
 } top_level_dir_properties;
 
 
+typedef struct drf_bounds {
+	unsigned long long b1;
+	unsigned long long b2;
+} drf_bounds;
+
+
+typedef struct drf_interval_set {
+	uint64_t * ranges;                  /* sorted [start, stop) sample pairs, never overlapping or touching */
+	uint64_t   num_ranges;
+	uint64_t   capacity;                /* number of pairs ranges can hold */
+} drf_interval_set;
+
+
 typedef struct channel_properties {
 
 	char * channel_name;
+	char * channel_dir;                 /* full path to channel directory, without trailing "/" */
 	top_level_dir_properties * top_level_dir_meta;
+	uint64_t   sample_size;             /* bytes in one sample of rf_data across all subchannels */
+	hid_t      mem_dtype_id;            /* native memory type of rf_data, set on first file read (0 until then) */
+	unsigned char fill_value[16];       /* rf_data fill value for one subchannel, valid when mem_dtype_id set */
+	drf_bounds bounds;                  /* cached result of get_bounds, valid while bounds_time non-zero */
+	time_t     bounds_time;             /* wall clock second when bounds were found, 0 if not cached */
+	char       bounds_first_dir[SMALL_HDF5_STR]; /* subdirectory holding the first file */
+	char       bounds_last_dir[SMALL_HDF5_STR];  /* subdirectory holding the last file */
+	char       bounds_last_file[SMALL_HDF5_STR]; /* basename of the last file */
+	time_t     bounds_mtime[4];         /* mtimes of channel dir, first and last subdirectory and last file */
+	drf_interval_set blocks;            /* continuous blocks of data found so far by get_continuous_blocks */
+	drf_interval_set scanned;           /* sample ranges whose files have been indexed into blocks */
+	int        sidecar_fd;              /* open DIGITAL_RF_SIDECAR_INDEX of the channel, -1 if none, -2 if unusable */
+	uint64_t * sidecar_map;             /* read-only mmap of the sidecar index, NULL if not mapped */
+	size_t     sidecar_map_size;        /* number of bytes mapped */
+	uint64_t   sidecar_num_rows;        /* number of complete rows in the mapping */
+	struct drf_file_handle * tail_handle; /* open tmp.rf@ file followed by digital_rf_read_tail, NULL if none */
+	uint64_t   tail_start_sample;       /* first sample of the cadence window of tail_handle */
+	int        tail_notify_fd;          /* inotify descriptor waking digital_rf_read_tail, -1 if none */
+	int        tail_subdir_wd;          /* its watch on the newest subdirectory, -1 if none */
 
 } channel_properties;
 
 
+typedef struct drf_file_handle {
+	char *     path;                    /* full path of the open rf file */
+	channel_properties * channel;       /* channel the file belongs to */
+	hid_t      file;                    /* open Hdf5 file */
+	hid_t      dataset;                 /* its /rf_data */
+	hid_t      dataspace;               /* dataspace of /rf_data, selection reset on every read */
+	hsize_t    dims[2];                 /* extent of /rf_data */
+	hsize_t    chunk_dims[2];           /* chunk shape of /rf_data, 0 if not chunked */
+	uint64_t   chunk_nbytes;            /* bytes of one decompressed chunk, 0 if not chunked */
+	uint64_t   rdcc_nbytes;             /* size of the chunk cache /rf_data was opened with */
+	char *     map;                     /* read-only map of contiguous /rf_data, see digital_rf_read_vector_mapped */
+	size_t     map_size;                /* bytes mapped, 0 if not mapped */
+	char *     map_data;                /* first byte of /rf_data within map */
+	int        num_decode_filters;      /* filters of chunked /rf_data the decode pool can undo, -1 if none can */
+	H5Z_filter_t decode_filters[2];     /* those filters in pipeline order, see digital_rf_set_decode_threads */
+	hid_t      index_dataset;           /* open rf_data_index of a tail handle, refreshed on every read, 0 otherwise */
+	uint64_t * index;                   /* decoded rf_data_index rows (global sample, dataset index) */
+	uint64_t   num_rows;                /* number of rows in index */
+	uint64_t   nbytes;                  /* memory charged to the reader's handle budget */
+	struct drf_file_handle * prev;      /* more recently used handle, NULL if most recent */
+	struct drf_file_handle * next;      /* less recently used handle, NULL if least recent */
+} drf_file_handle;
+
+
 typedef struct digital_rf_read_object {
 
 	// everything here is what im actually using 
@@ -160,7 +323,14 @@ typedef struct digital_rf_read_object {
 	// taken care of by top_lev_dir_props
 	int        num_subchannels;         /* number of subchannels in the data stream.  Must be at least 1. */
 	char * 	   access_mode;
-	uint64_t   rdcc_nbytes;
+	uint64_t   rdcc_nbytes;             /* chunk cache size of each open rf_data, or DIGITAL_RF_READ_RDCC_AUTO */
+	drf_file_handle * handles;          /* open file handles of all channels, most recently used first */
+	drf_file_handle * handles_tail;     /* least recently used open file handle */
+	int        num_handles;             /* number of open file handles */
+	int        max_handles;             /* handle budget, see digital_rf_set_handle_cache */
+	uint64_t   handle_nbytes;           /* memory charged by open file handles */
+	uint64_t   max_handle_nbytes;       /* memory budget of open file handles */
+	struct drf_decode_pool * decode_pool; /* threads decoding raw chunks, NULL to let Hdf5 decode them */
 	
 	
 	
@@ -209,10 +379,11 @@ typedef struct digital_rf_read_object {
 } Digital_rf_read_object;
 
 
-typedef struct drf_bounds {
-	unsigned long long b1;
-	unsigned long long b2;
-} drf_bounds;
+/* streaming cursor over one channel, see digital_rf_open_read_cursor */
+typedef struct digital_rf_read_cursor Digital_rf_read_cursor;
+
+/* I/O threads shared by the writers of many channels, see digital_rf_create_write_hub */
+typedef struct digital_rf_write_hub Digital_rf_write_hub;
 
 
 
@@ -234,10 +405,30 @@ EXPORT int digital_rf_write_blocks_hdf5(
 	extern "C" EXPORT Digital_rf_write_object * digital_rf_create_write_hdf5(
 		char*, hid_t, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, char *, int, int, int, int, int, int);
 	extern "C" EXPORT int digital_rf_write_hdf5(Digital_rf_write_object*, uint64_t, void*,uint64_t);
+	extern "C" EXPORT int digital_rf_set_sidecar_index(Digital_rf_write_object*, int);
+	extern "C" EXPORT int digital_rf_set_swmr(Digital_rf_write_object*, int);
+	extern "C" EXPORT int digital_rf_set_async(Digital_rf_write_object*, int, uint64_t, int);
+	extern "C" EXPORT int digital_rf_flush_async(Digital_rf_write_object*);
+	extern "C" EXPORT int digital_rf_get_async_stats(Digital_rf_write_object*, uint64_t*, uint64_t*, uint64_t*, int*);
+	extern "C" EXPORT int digital_rf_set_precreate(Digital_rf_write_object*, int);
+	extern "C" EXPORT int digital_rf_set_file_template(Digital_rf_write_object*, int);
+	extern "C" EXPORT int digital_rf_set_deferred_index(Digital_rf_write_object*, int, uint64_t);
+	extern "C" EXPORT int digital_rf_set_compress_threads(Digital_rf_write_object*, int);
+	extern "C" EXPORT int digital_rf_set_codec(Digital_rf_write_object*, int, int);
+	extern "C" EXPORT int digital_rf_set_chunk_shape(Digital_rf_write_object*, uint64_t, int, uint64_t);
+	extern "C" EXPORT int digital_rf_set_direct_io(Digital_rf_write_object*, int, uint64_t);
+	extern "C" EXPORT int digital_rf_set_memory_files(Digital_rf_write_object*, int, int);
+	extern "C" EXPORT int digital_rf_set_staging(Digital_rf_write_object*, int);
+	extern "C" EXPORT int64_t digital_rf_pack_staging(Digital_rf_write_object*);
 	extern "C" EXPORT char * digital_rf_get_last_file_written(Digital_rf_write_object *);
 	extern "C" EXPORT char * digital_rf_get_last_dir_written(Digital_rf_write_object *);
 	extern "C" EXPORT uint64_t digital_rf_get_last_write_time(Digital_rf_write_object *);
 	extern "C" EXPORT int digital_rf_close_write_hdf5(Digital_rf_write_object*);
+	extern "C" EXPORT Digital_rf_write_hub * digital_rf_create_write_hub(int, int);
+	extern "C" EXPORT int digital_rf_hub_add_channel(Digital_rf_write_hub*, Digital_rf_write_object*, int, uint64_t, int);
+	extern "C" EXPORT int digital_rf_get_hub_stats(Digital_rf_write_hub*, uint64_t*, double*, int*, int*, uint64_t*,
+		uint64_t*);
+	extern "C" EXPORT int digital_rf_close_write_hub(Digital_rf_write_hub*);
 
 #else
 	EXPORT const char * digital_rf_get_version(void);
@@ -258,18 +449,66 @@ EXPORT int digital_rf_write_blocks_hdf5(
 	EXPORT int digital_rf_write_hdf5(Digital_rf_write_object *hdf5_data_object,
 		uint64_t global_leading_edge_index, void * vector,
 		uint64_t vector_length);
+	EXPORT int digital_rf_set_sidecar_index(Digital_rf_write_object *hdf5_data_object, int enable);
+	EXPORT int digital_rf_set_swmr(Digital_rf_write_object *hdf5_data_object, int enable);
+	EXPORT int digital_rf_set_async(Digital_rf_write_object *hdf5_data_object, int num_buffers,
+		uint64_t buffer_samples, int block);
+	EXPORT int digital_rf_flush_async(Digital_rf_write_object *hdf5_data_object);
+	EXPORT int digital_rf_get_async_stats(Digital_rf_write_object *hdf5_data_object, uint64_t * stalls,
+		uint64_t * overflows, uint64_t * samples_dropped, int * max_queued);
+	EXPORT int digital_rf_set_precreate(Digital_rf_write_object *hdf5_data_object, int enable);
+	EXPORT int digital_rf_set_file_template(Digital_rf_write_object *hdf5_data_object, int enable);
+	EXPORT int digital_rf_set_deferred_index(Digital_rf_write_object *hdf5_data_object, int enable,
+		uint64_t flush_interval_secs);
+	EXPORT int digital_rf_set_compress_threads(Digital_rf_write_object *hdf5_data_object, int num_threads);
+	EXPORT int digital_rf_set_codec(Digital_rf_write_object *hdf5_data_object, int codec, int level);
+	EXPORT int digital_rf_set_chunk_shape(Digital_rf_write_object *hdf5_data_object, uint64_t chunk_samples,
+		int chunk_subchannels, uint64_t target_nbytes);
+	EXPORT int digital_rf_set_direct_io(Digital_rf_write_object *hdf5_data_object, int enable, uint64_t alignment);
+	EXPORT int digital_rf_set_memory_files(Digital_rf_write_object *hdf5_data_object, int enable, int preallocate);
+	EXPORT int digital_rf_set_staging(Digital_rf_write_object *hdf5_data_object, int enable);
+	EXPORT int64_t digital_rf_pack_staging(Digital_rf_write_object *hdf5_data_object);
 	EXPORT char * digital_rf_get_last_file_written(Digital_rf_write_object *hdf5_data_object);
 	EXPORT char * digital_rf_get_last_dir_written(Digital_rf_write_object *hdf5_data_object);
 	EXPORT uint64_t digital_rf_get_last_write_time(Digital_rf_write_object *hdf5_data_object);
 	EXPORT int digital_rf_close_write_hdf5(Digital_rf_write_object *hdf5_data_object);
+	EXPORT Digital_rf_write_hub * digital_rf_create_write_hub(int num_threads, int precreate);
+	EXPORT int digital_rf_hub_add_channel(Digital_rf_write_hub * hub, Digital_rf_write_object *hdf5_data_object,
+		int num_buffers, uint64_t buffer_samples, int block);
+	EXPORT int digital_rf_get_hub_stats(Digital_rf_write_hub * hub, uint64_t * bytes_written, double * bytes_per_sec,
+		int * backlog, int * max_backlog, uint64_t * stalls, uint64_t * overflows);
+	EXPORT int digital_rf_close_write_hub(Digital_rf_write_hub * hub);
 
 	EXPORT Digital_rf_read_object * digital_rf_create_read_hdf5(char * directory, uint64_t rdcc_nbytes);
 	EXPORT char ** get_channels(Digital_rf_read_object * drf_read_obj);
-	EXPORT void get_bounds(Digital_rf_read_object * drf_read_obj, char * channel_name,
+	EXPORT int digital_rf_set_handle_cache(Digital_rf_read_object * drf_read_obj, int max_handles,
+		uint64_t max_nbytes);
+	EXPORT int digital_rf_set_decode_threads(Digital_rf_read_object * drf_read_obj, int num_threads);
+	EXPORT int get_bounds(Digital_rf_read_object * drf_read_obj, char * channel_name,
 		drf_bounds * bounds);
-	EXPORT float ** read_vector(Digital_rf_read_object * drf_read_obj, long long start_sample,
- int num_samples, char * channel_name, char * sub_channel);
-	EXPORT unsigned long long ** get_continuous_blocks(Digital_rf_read_object * drf_read_obj, unsigned long long start_sample, unsigned long long end_sample, char * channel_name);
+	EXPORT uint64_t get_sample_size(Digital_rf_read_object * drf_read_obj, char * channel_name);
+	EXPORT int64_t read_vector(Digital_rf_read_object * drf_read_obj, uint64_t start_sample,
+		uint64_t num_samples, char * channel_name, void * data);
+	EXPORT int64_t digital_rf_read_channels(Digital_rf_read_object * drf_read_obj, uint64_t start_sample,
+		uint64_t num_samples, int num_channels, char ** channel_names, int interleaved, void * data,
+		int64_t * samples_found);
+	EXPORT int64_t digital_rf_read_vectors(Digital_rf_read_object * drf_read_obj, char * channel_name,
+		uint64_t num_ranges, uint64_t * ranges, void ** data, int64_t * samples_found);
+	EXPORT Digital_rf_read_cursor * digital_rf_open_read_cursor(Digital_rf_read_object * drf_read_obj,
+		char * channel_name, uint64_t start_sample, uint64_t block_samples, int depth);
+	EXPORT int64_t digital_rf_read_cursor_next(Digital_rf_read_cursor * cursor, void ** data);
+	EXPORT void digital_rf_close_read_cursor(Digital_rf_read_cursor * cursor);
+	EXPORT int64_t digital_rf_read_tail(Digital_rf_read_object * drf_read_obj, char * channel_name,
+		uint64_t start_sample, uint64_t num_samples, void * data, int timeout_millisecs);
+	EXPORT int64_t digital_rf_read_vector_mapped(Digital_rf_read_object * drf_read_obj,
+		uint64_t start_sample, uint64_t num_samples, char * channel_name, void ** data);
+	EXPORT int digital_rf_locate_sample(Digital_rf_read_object * drf_read_obj, char * channel_name,
+		uint64_t sample, char * path, uint64_t * dataset_index);
+	EXPORT char ** get_file_list(Digital_rf_read_object * drf_read_obj, uint64_t start_sample,
+		uint64_t end_sample, char * channel_name, int * num_files);
+	EXPORT void free_file_list(char ** file_list);
+	EXPORT int64_t get_continuous_blocks(Digital_rf_read_object * drf_read_obj, uint64_t start_sample,
+		uint64_t end_sample, char * channel_name, uint64_t ** blocks);
 	EXPORT void digital_rf_close_read_hdf5(Digital_rf_read_object * drf_read_obj);
 #endif
 
@@ -288,18 +527,80 @@ uint64_t digital_rf_write_samples_to_file(Digital_rf_write_object *hdf5_data_obj
 		uint64_t * data_index_arr, uint64_t index_len, void * vector, uint64_t vector_length);
 int digital_rf_create_hdf5_file(Digital_rf_write_object *hdf5_data_object, char * subdir, char * basename,
 								uint64_t samples_to_write, uint64_t samples_left, uint64_t max_samples_this_file);
+int digital_rf_prepare_hdf5_file(Digital_rf_write_object *hdf5_data_object, drf_prepared_file * file, char * prefix);
+int digital_rf_build_hdf5_file(Digital_rf_write_object *hdf5_data_object, drf_prepared_file * file, char * fullname,
+							   hid_t fapl);
+void * digital_rf_template_malloc(size_t size, H5FD_file_image_op_t file_image_op, void * udata);
+void * digital_rf_template_realloc(void * ptr, size_t size, H5FD_file_image_op_t file_image_op, void * udata);
+herr_t digital_rf_template_free(void * ptr, H5FD_file_image_op_t file_image_op, void * udata);
+void * digital_rf_template_udata_copy(void * udata);
+herr_t digital_rf_template_udata_free(void * udata);
+struct drf_file_template * digital_rf_get_file_template(Digital_rf_write_object *hdf5_data_object,
+														uint64_t max_samples_this_file);
+int digital_rf_stamp_hdf5_file(Digital_rf_write_object *hdf5_data_object, drf_prepared_file * file, char * fullname);
+void digital_rf_discard_prepared_file(Digital_rf_write_object *hdf5_data_object, drf_prepared_file * file, char * prefix);
 int digital_rf_close_hdf5_file(Digital_rf_write_object *hdf5_data_object);
 int digital_rf_create_new_directory(Digital_rf_write_object *hdf5_data_object, char * subdir);
 int digital_rf_set_fill_value(Digital_rf_write_object *hdf5_data_object);
-void digital_rf_write_metadata(Digital_rf_write_object *hdf5_data_object);
+hsize_t digital_rf_choose_chunk_size(Digital_rf_write_object *hdf5_data_object, uint64_t vector_length);
+void digital_rf_set_file_layout(Digital_rf_write_object *hdf5_data_object, hid_t fapl);
+int digital_rf_start_direct_file(Digital_rf_write_object *hdf5_data_object, char * fullname, uint64_t max_samples_this_file);
+int digital_rf_direct_write(Digital_rf_write_object *hdf5_data_object, uint64_t row, const unsigned char * data,
+		uint64_t num_rows);
+int digital_rf_end_direct_file(Digital_rf_write_object *hdf5_data_object);
+int digital_rf_stage_direct(struct drf_direct_io * direct, const unsigned char * data, size_t size);
+int digital_rf_write_direct_stage(struct drf_direct_io * direct);
+void digital_rf_free_direct_io(Digital_rf_write_object *hdf5_data_object);
+int digital_rf_write_memory_file(Digital_rf_write_object *hdf5_data_object);
+int digital_rf_write_staging(Digital_rf_write_object *hdf5_data_object, uint64_t * global_index_arr, uint64_t * data_index_arr,
+		uint64_t index_len, void * vector, uint64_t vector_length);
+int digital_rf_start_staging_file(Digital_rf_write_object *hdf5_data_object, uint64_t global_sample);
+int digital_rf_end_staging_file(Digital_rf_write_object *hdf5_data_object);
+int digital_rf_write_staging_header(FILE * fp, Digital_rf_write_object *hdf5_data_object, uint64_t num_samples,
+		uint64_t num_rows);
+int digital_rf_pack_staging_file(Digital_rf_write_object *hdf5_data_object, char * fullname, void ** buffer,
+		size_t * buffer_size);
+int digital_rf_unlink_packed_staging(Digital_rf_write_object *hdf5_data_object);
+int digital_rf_compare_staging_names(const void * a, const void * b);
+void digital_rf_write_metadata(Digital_rf_write_object *hdf5_data_object, hid_t dataset, int sequence_num);
 uint64_t * digital_rf_create_rf_data_index(Digital_rf_write_object *hdf5_data_object, uint64_t samples_written, uint64_t samples_left,
 		uint64_t max_samples_this_file, uint64_t * global_index_arr, uint64_t * data_index_arr, uint64_t index_len, uint64_t vector_len,
 		uint64_t next_global_sample, int * rows_to_write, uint64_t * samples_to_write, int file_exists);
 int digital_rf_write_rf_data_index(Digital_rf_write_object * hdf5_data_object, uint64_t * rf_data_index_arr, int block_index_len);
+int digital_rf_put_rf_data_index(Digital_rf_write_object * hdf5_data_object, uint64_t * rf_data_index_arr, int block_index_len);
+int digital_rf_flush_rf_data_index(Digital_rf_write_object * hdf5_data_object);
 uint64_t digital_rf_get_global_sample(uint64_t samples_written, uint64_t * global_index_arr, uint64_t * data_index_arr,
 		                              uint64_t index_len);
 int digital_rf_extend_dataset(Digital_rf_write_object * hdf5_data_object, uint64_t samples_to_write);
 int digital_rf_handle_metadata(Digital_rf_write_object * hdf5_data_object);
+uint64_t digital_rf_get_file_id(char * basename);
+int digital_rf_add_sidecar_rows(Digital_rf_write_object * hdf5_data_object, uint64_t * rf_data_index_arr, int block_index_len);
+int digital_rf_end_sidecar_file(Digital_rf_write_object * hdf5_data_object);
+int digital_rf_append_sidecar_index(Digital_rf_write_object * hdf5_data_object);
+int digital_rf_queue_async_write(Digital_rf_write_object *hdf5_data_object, uint64_t * global_index_arr, uint64_t * data_index_arr,
+		uint64_t index_len, void * vector, uint64_t vector_length);
+struct drf_async_writer * digital_rf_alloc_async(Digital_rf_write_object *hdf5_data_object, int num_buffers,
+		uint64_t buffer_samples, int block);
+int digital_rf_is_async_writer(Digital_rf_write_object *hdf5_data_object);
+void * digital_rf_async_writer_thread(void * arg);
+int digital_rf_end_async(Digital_rf_write_object *hdf5_data_object);
+void digital_rf_free_async(struct drf_async_writer * async);
+void digital_rf_request_precreate(Digital_rf_write_object *hdf5_data_object, uint64_t global_sample);
+int digital_rf_take_prepared_file(Digital_rf_write_object *hdf5_data_object, char * subdir, char * basename,
+		uint64_t max_samples_this_file, drf_prepared_file * file);
+void * digital_rf_precreate_thread(void * arg);
+void digital_rf_end_precreate(Digital_rf_write_object *hdf5_data_object);
+int digital_rf_run_precreate(Digital_rf_write_object *hdf5_data_object);
+void * digital_rf_hub_thread(void * arg);
+void digital_rf_hub_drain(Digital_rf_write_hub * hub, Digital_rf_write_object *hdf5_data_object, int num_buffers);
+void digital_rf_hub_remove_channel(Digital_rf_write_object *hdf5_data_object);
+int digital_rf_stage_chunks(Digital_rf_write_object *hdf5_data_object, char * vector, uint64_t samples);
+int digital_rf_queue_chunk(Digital_rf_write_object *hdf5_data_object);
+int digital_rf_commit_chunk(Digital_rf_write_object *hdf5_data_object);
+int digital_rf_finish_chunks(Digital_rf_write_object *hdf5_data_object);
+void * digital_rf_chunk_thread(void * arg);
+void digital_rf_end_chunk_pool(Digital_rf_write_object *hdf5_data_object);
+uint32_t digital_rf_fletcher32(const unsigned char * data, size_t len);
 int digital_rf_is_little_endian(void);
 
 
@@ -33,6 +33,8 @@ get it working first, make it pretty and add documentation later!
 #  include <unistd.h>
 #  include <glob.h>
 #  include <regex.h>
+#  include <fcntl.h>
+#  include <sys/mman.h>
 #endif
 
 #include <stdio.h>
@@ -50,6 +52,35 @@ get it working first, make it pretty and add documentation later!
 #include "digital_rf.h"
 #include "hdf5.h"
 
+// raw chunks are decoded on reader threads when zlib and direct chunk reads are available,
+// and cursors prefetch on a thread of their own
+#ifndef _WIN32
+#  include <pthread.h>
+#endif
+#if !defined(_WIN32) && defined(DIGITAL_RF_HAVE_ZLIB) && H5_VERSION_GE(1, 10, 3)
+#  define DRF_DECODE_THREADS
+#  include <zlib.h>
+#endif
+
+// digital_rf_read_tail follows files still being written with SWMR reads,
+// and sleeps on inotify events where there are any
+#if H5_VERSION_GE(1, 10, 0)
+#  define DRF_SWMR_READ
+#endif
+#ifdef __linux__
+#  include <sys/inotify.h>
+#  include <poll.h>
+#endif
+
+// defined with the file handle cache below
+void _close_handle(Digital_rf_read_object * drf_read_obj, drf_file_handle * handle);
+#ifdef DRF_DECODE_THREADS
+// defined with the decode pool below
+void _free_decode_pool(struct drf_decode_pool * pool);
+#endif
+// defined with digital_rf_read_tail below
+void _close_tail_handle(channel_properties * channel);
+
 
 // helper function(s)
 int check_file_exists(const char *directory, const char *pattern) 
@@ -137,11 +168,6 @@ https://stackoverflow.com/questions/15057010/comparing-version-numbers-in-c
     return 0;
 }
 
-static int cmpstringp(const void *p1, const void *p2) 
-/* pulled from https://www.man7.org/linux/man-pages/man3/qsort.3.html */
-{
-  return strcmp(*(const char **) p1, *(const char **) p2);
-}
 
 
 
@@ -168,11 +194,13 @@ docs here
     char attr_name[SMALL_HDF5_STR];
     hsize_t size;
     herr_t status;
+#if H5_VERSION_GE(1, 12, 0)
+    H5O_info2_t info;
+#else
     H5O_info_t info;
+#endif
     unsigned mode;
     hsize_t n;
-    H5O_info_t ainfo;
-    hid_t lapl_id;
     hid_t attr_dtype;
     uint64_t num, den, sps;
     int old = 0;
@@ -217,7 +245,11 @@ docs here
     }
 
     // get group info and total number of attributes
-    if (H5Oget_info_by_name(prop_file, ".", &info, H5O_INFO_ALL, H5P_DEFAULT) < 0) {
+#if H5_VERSION_GE(1, 12, 0)
+    if (H5Oget_info_by_name3(prop_file, ".", &info, H5O_INFO_NUM_ATTRS, H5P_DEFAULT) < 0) {
+#else
+    if (H5Oget_info_by_name2(prop_file, ".", &info, H5O_INFO_NUM_ATTRS, H5P_DEFAULT) < 0) {
+#endif
       fprintf(stderr, "Unable to get root group info\n");
       exit(-11);
     }
@@ -318,6 +350,16 @@ docs here
           fprintf(stderr, "Problem reading attribute %s\n", attr_name);
           exit(-13);
         }
+      } else if (strcmp(attr_name, "H5Tget_class") == 0) {
+        if ((status = H5Aread(attr_id, H5T_NATIVE_UINT64, &dir_props->dtype_class)) < 0) {
+          fprintf(stderr, "Problem reading attribute %s\n", attr_name);
+          exit(-13);
+        }
+      } else if (strcmp(attr_name, "H5Tget_size") == 0) {
+        if ((status = H5Aread(attr_id, H5T_NATIVE_UINT64, &dir_props->dtype_size)) < 0) {
+          fprintf(stderr, "Problem reading attribute %s\n", attr_name);
+          exit(-13);
+        }
       }
       H5Tclose(attr_dtype);
       H5Aclose(attr_id);
@@ -390,7 +432,15 @@ docs here
   strcpy(dir_props->channel_name, chan_name);
 
   dir_props->rdcc_nbytes = rdcc_nbytes;
-  dir_props->cachedFilename = NULL;
+  dir_props->cachedFilename = malloc(BIG_HDF5_STR * sizeof(char));
+  if (!dir_props->cachedFilename) {
+    fprintf(stderr, "Malloc failure\n");
+    exit(-25);
+  }
+  dir_props->cachedFilename[0] = '\0';
+  dir_props->cachedFile = 0;
+  dir_props->dtype_class = 0;
+  dir_props->dtype_size = 0;
 
   dir_props->min_version = malloc(4 * sizeof(char));
   if (!dir_props->min_version) {
@@ -405,7 +455,6 @@ docs here
     exit(-27);
   }
   strcpy(dir_props->max_version, DIGITAL_RF_VERSION);
-  //dir_props->cachedFile = NULL;
 
   _read_properties(dir_props, chan_path);
 
@@ -422,8 +471,30 @@ docs here
     exit(-7);
   }
   strcpy(channel->channel_name, chan_name);
+  channel->channel_dir = malloc((strlen(chan_path) + 1) * sizeof(char));
+  if (!channel->channel_dir) {
+    fprintf(stderr, "Malloc failure\n");
+    exit(-7);
+  }
+  strcpy(channel->channel_dir, chan_path);
   channel->top_level_dir_meta = dir_props;
 
+  // one sample is a row of rf_data: every subchannel, both parts if complex
+  channel->sample_size = dir_props->dtype_size * (dir_props->is_complex ? 2 : 1) * dir_props->num_subchannels;
+  channel->mem_dtype_id = 0;
+  memset(channel->fill_value, 0, sizeof(channel->fill_value));
+  channel->bounds_time = 0;
+  memset(&channel->blocks, 0, sizeof(drf_interval_set));
+  memset(&channel->scanned, 0, sizeof(drf_interval_set));
+  channel->sidecar_fd = -1;
+  channel->sidecar_map = NULL;
+  channel->sidecar_map_size = 0;
+  channel->sidecar_num_rows = 0;
+  channel->tail_handle = NULL;
+  channel->tail_start_sample = 0;
+  channel->tail_notify_fd = -1;
+  channel->tail_subdir_wd = -1;
+
   return(channel);
 
 }
@@ -540,8 +611,12 @@ need to account for channels AND SUBCHANNELS!!!!!
 
 Digital_rf_read_object * digital_rf_create_read_hdf5(char * directory, uint64_t rdcc_nbytes)
 /* 
-documentation goes here 
 just init the read object from top level dir
+
+rdcc_nbytes is the size of the Hdf5 chunk cache rf_data of each open rf file
+is read through, or DIGITAL_RF_READ_RDCC_AUTO to size it per file from its
+chunk shape and the span being read, within the memory budget of
+digital_rf_set_handle_cache
 */
 {
   // double check that directory is valid
@@ -604,6 +679,13 @@ just init the read object from top level dir
   }
   strcpy(read_obj->access_mode, access_mode);
   read_obj->rdcc_nbytes = rdcc_nbytes;
+  read_obj->handles = NULL;
+  read_obj->handles_tail = NULL;
+  read_obj->num_handles = 0;
+  read_obj->max_handles = DIGITAL_RF_READ_MAX_HANDLES;
+  read_obj->handle_nbytes = 0;
+  read_obj->max_handle_nbytes = DIGITAL_RF_READ_MAX_HANDLE_NBYTES;
+  read_obj->decode_pool = NULL;
   _get_channels_in_dir(read_obj); // works locally only
 
   return(read_obj);
@@ -635,6 +717,17 @@ docs here, FIX ME
       free(drf_read_obj->access_mode);
     }
 
+#ifdef DRF_DECODE_THREADS
+    if (drf_read_obj->decode_pool != NULL) {
+      _free_decode_pool(drf_read_obj->decode_pool);
+    }
+#endif
+
+    // handles refer to their channels, so close them first
+    while (drf_read_obj->handles != NULL) {
+      _close_handle(drf_read_obj, drf_read_obj->handles);
+    }
+
     if (drf_read_obj->num_channels > 0) {
       for (int i = 0; i < drf_read_obj->num_channels; i++) {
         
@@ -652,11 +745,30 @@ docs here, FIX ME
         //printf("freed epoch\n");
         fflush(stdout);
         free(drf_read_obj->channels[i]->top_level_dir_meta->drf_time_desc);
+        free(drf_read_obj->channels[i]->top_level_dir_meta->cachedFilename);
 
         //printf("freed time desc\n");
         free(drf_read_obj->channel_names[i]);
 
         free(drf_read_obj->channels[i]->channel_name);
+        free(drf_read_obj->channels[i]->channel_dir);
+        free(drf_read_obj->channels[i]->blocks.ranges);
+        free(drf_read_obj->channels[i]->scanned.ranges);
+        _close_tail_handle(drf_read_obj->channels[i]);
+#ifndef _WIN32
+        if (drf_read_obj->channels[i]->tail_notify_fd >= 0) {
+          close(drf_read_obj->channels[i]->tail_notify_fd);
+        }
+        if (drf_read_obj->channels[i]->sidecar_map != NULL) {
+          munmap(drf_read_obj->channels[i]->sidecar_map, drf_read_obj->channels[i]->sidecar_map_size);
+        }
+        if (drf_read_obj->channels[i]->sidecar_fd >= 0) {
+          close(drf_read_obj->channels[i]->sidecar_fd);
+        }
+#endif
+        if (drf_read_obj->channels[i]->mem_dtype_id > 0) {
+          H5Tclose(drf_read_obj->channels[i]->mem_dtype_id);
+        }
         free(drf_read_obj->channels[i]->top_level_dir_meta);
         //printf("freed top lev prop obj\n");
         free(drf_read_obj->channels[i]);
@@ -674,385 +786,2987 @@ docs here, FIX ME
 }
 
 
-char ** _ilsdrf(Digital_rf_read_object * drf_read_obj, char * chan_name)
+channel_properties * _find_channel(Digital_rf_read_object * drf_read_obj, char * channel_name)
 /*
-docs here
-path is assumed to be a channel path (absolute)
+returns the channel_properties for channel_name, or NULL if no such channel
 */
 {
-  char ** fnames = NULL;
-  int chan_idx = -1;
-  char channel_dir[MED_HDF5_STR];
-  bool drf, dmd;
-  regex_t re_subdir;
-  DIR * dir;
-  DIR * subdir;
-  struct dirent * ent;
-  struct dirent * subent;
-  char current_dir[MED_HDF5_STR];
-  char current_file[MED_HDF5_STR]; // using med str because this is supposed to contain abspath
-  char sentinel[SMALL_HDF5_STR];
-  //char ** dirnames;
-  //int numdirs = 0;
-  int numfiles = 0;
-
   for (int i = 0; i < drf_read_obj->num_channels; i++) {
-    // this could definitely be optimized but lets get it working first!
-    if (strcmp(drf_read_obj->channel_names[i], chan_name) == 0) {
-      chan_idx = i;
+    if (strcmp(drf_read_obj->channel_names[i], channel_name) == 0) {
+      return(drf_read_obj->channels[i]);
     }
   }
+  return(NULL);
+}
 
-  if (chan_idx < 0) {
-    fprintf(stderr, "No channel found named %s\n", chan_name);
-    exit(-16);
-  }
 
-  channel_dir[0] = '\0';
-  strcpy(channel_dir, drf_read_obj->channels[chan_idx]->top_level_dir_meta->top_level_dir);
-  strcat(channel_dir, "/");
-  strcat(channel_dir, chan_name);
+int _get_file_path(channel_properties * channel, uint64_t file_millisec, char * path)
+/*
+sets path (BIG_HDF5_STR chars) to the full path of the file starting at unix
+millisecond file_millisec; files never straddle subdirectories, so the file
+start sets both names
 
-  drf = (check_file_exists(channel_dir, "drf_properties.h5") || check_file_exists(channel_dir, "drf_metadata.h5"));
-  dmd = (check_file_exists(channel_dir, "dmd_properties.h5") || check_file_exists(channel_dir, "dmd_metadata.h5"));
-  
-  if (regcomp(&re_subdir, "[0-9][0-9][0-9][0-9]-[0-9][0-9]-[0-9][0-9]T[0-9][0-9]-[0-9][0-9]-[0-9][0-9]", 0) != 0) {
-    fprintf(stderr, "Problem compiling regex\n");
-    exit(-20);
+returns 0 if success, -1 if failure
+*/
+{
+  int year, month, day, hour, minute, second;
+  uint64_t dir_sec;
+
+  dir_sec = ((file_millisec / 1000) / channel->top_level_dir_meta->subdir_cadence_secs)
+    * channel->top_level_dir_meta->subdir_cadence_secs;
+  if (digital_rf_get_time_parts((time_t)dir_sec, &year, &month, &day, &hour, &minute, &second)) {
+    return(-1);
   }
+  snprintf(path, BIG_HDF5_STR, "%s/%04i-%02i-%02iT%02i-%02i-%02i/rf@%" PRIu64 ".%03" PRIu64 ".h5",
+    channel->channel_dir, year, month, day, hour, minute, second,
+    file_millisec / 1000, file_millisec % 1000);
+  return(0);
+}
 
-  if (drf || dmd) {
-    // there must exist some property file for this 
-    // to be a valid channel directory
 
-    dir = opendir(channel_dir);
-    if (!dir) {
-      fprintf(stderr, "Problem opening directory %s\n", channel_dir);
-      exit(-21);
-    }
+int _get_file_window(channel_properties * channel, uint64_t sample, char * path,
+  uint64_t * file_start_sample, uint64_t * next_file_start_sample)
+/*
+derives the name of the file that would hold sample, using the same rational
+arithmetic as digital_rf_get_subdir_file in the writer
 
-    while ((ent = readdir(dir)) != NULL) {
-      if ((strcmp(ent->d_name, ".") == 0) || (strcmp(ent->d_name, "..") == 0)) {
-        continue;
-      }
+path must hold BIG_HDF5_STR chars and is set to the full file path; the file
+may or may not exist. file_start_sample and next_file_start_sample are set to
+the first sample the file can hold and the first sample of the following file.
 
-      if (regexec(&re_subdir, ent->d_name, 0, NULL, 0) == 0) {
-        // found matching subdir
-        //printf("matched dir %s\n", ent->d_name);
-        current_dir[0] = '\0';
-        strcpy(current_dir, channel_dir);
-        strcat(current_dir, "/");
-        strcat(current_dir, ent->d_name);
-
-        // now we have to find the filenames IN ORDER
-        // well,,, first just get fnames, THEN sort
-        subdir = opendir(current_dir);
-        if (!subdir) {
-          fprintf(stderr, "Unable to open directory %s\n", current_dir);
-          exit(-23);
-        }
+returns 0 if success, -1 if failure
+*/
+{
+  top_level_dir_properties * props = channel->top_level_dir_meta;
+  uint64_t sample_sec, picosecond, sample_millisec;
+  uint64_t file_millisec, next_file_millisec;
 
-        while ((subent = readdir(subdir)) != NULL) {
-          // get filenames from this subdir
-          if ((strstr(subent->d_name, "rf@") != NULL) && (strstr(subent->d_name, ".h5") != NULL)) {
-            // valid filename
-            if (numfiles == 0) {
-              fnames = (char**)malloc((1 + numfiles) * sizeof(char*));
-            } else {
-              fnames = realloc(fnames, (1 + numfiles) * sizeof(char*));
-            }
-            
-            if (!fnames) {
-              fprintf(stderr, "Realloc failure\n");
-              exit(-22);
-            }
-
-            //printf("found file %s\n", subent->d_name);
-
-            current_file[0] = '\0';
-            strcpy(current_file, current_dir);
-            strcat(current_file, "/");
-            strcat(current_file, subent->d_name);
-
-            fnames[numfiles] = malloc((strlen(current_file) + 1) * sizeof(char));
-            strcpy(fnames[numfiles], current_file);
-            numfiles++;
-          }
-        }
-        closedir(subdir);
-      }
-    }
-    qsort(fnames, numfiles, sizeof(char*), cmpstringp);
-    regfree(&re_subdir);
-    closedir(dir);
+  if (digital_rf_get_timestamp_floor(sample, props->sample_rate_numerator,
+      props->sample_rate_denominator, &sample_sec, &picosecond)) {
+    return(-1);
   }
+  sample_millisec = sample_sec * 1000 + picosecond / 1000000000;
 
-  // lets try using a sentinel value
-  fnames = realloc(fnames, (1 + numfiles) * sizeof(char*));
-  if (!fnames) {
-    fprintf(stderr, "Realloc failure\n");
-    exit(-22);
+  file_millisec = (sample_millisec / props->file_cadence_millisecs) * props->file_cadence_millisecs;
+  next_file_millisec = file_millisec + props->file_cadence_millisecs;
+  if (_get_file_path(channel, file_millisec, path)) {
+    return(-1);
   }
 
-  strcpy(sentinel, "sentinel");
-  fnames[numfiles] = malloc((strlen(sentinel) + 1) * sizeof(char));
-  strcpy(fnames[numfiles], sentinel);
-
-  //printf("total files found: %d\n", numfiles);
-  return(fnames);
+  // ceil so that the window matches the samples the writer puts in the file
+  if (digital_rf_get_sample_ceil(file_millisec / 1000, (file_millisec % 1000) * 1000000000,
+      props->sample_rate_numerator, props->sample_rate_denominator, file_start_sample)) {
+    return(-1);
+  }
+  if (digital_rf_get_sample_ceil(next_file_millisec / 1000, (next_file_millisec % 1000) * 1000000000,
+      props->sample_rate_numerator, props->sample_rate_denominator, next_file_start_sample)) {
+    return(-1);
+  }
+  return(0);
 }
 
 
-void get_bounds(Digital_rf_read_object * drf_read_obj, char * channel_name,
-  drf_bounds * bounds)
+char ** _get_file_list(channel_properties * channel, uint64_t sample0, uint64_t sample1,
+  int * num_files)
 /*
-more docs here
-return a pair of ints
-*/
-{
-  //unsigned long long bounds[2];
-  //unsigned long long * bounds = NULL;
-  unsigned long long s_bound, e_bound;
-  unsigned long long tmp_bounds[2];
-  char ** pathlist = NULL;
-  bool firstpath = true;
-  unsigned long long total_samples;
-  int pthidx = 0;
-  hid_t prop_file, fapl, dset, dshape, space;
-  hsize_t size;
-  herr_t status;
-  H5O_info_t info;
-  hid_t dsettype;
-  int rank;
-  char datapath[MED_HDF5_STR];
-  unsigned mode;
+C counterpart of DigitalRFReader._get_file_list: returns the full paths of
+all files that could hold samples in [sample0, sample1], in time order, derived
+from the cadences and rational sample rate alone. No directories are scanned,
+so the cost is O(files in range) whatever the size of the channel; the files
+may or may not exist.
 
-  if (strcmp(drf_read_obj->access_mode, "local") != 0) {
-    fprintf(stderr, "Access mode %s not implemented\n", drf_read_obj->access_mode);
-    exit(-15);
-  }
+The list is NULL terminated and must be released with free_file_list.
+num_files is set to the number of paths.
 
-  pathlist = _ilsdrf(drf_read_obj, channel_name);
+returns the list, or NULL if failure
+*/
+{
+  char path[BIG_HDF5_STR];
+  char ** file_list;
+  uint64_t sample, file_start_sample, next_file_start_sample;
+  int n = 0;
+
+  if (sample1 < sample0) {
+    fprintf(stderr, "End sample %" PRIu64 " before start sample %" PRIu64 "\n", sample1, sample0);
+    return(NULL);
+  }
+  if (sample1 - sample0 > 1000000000000ULL) {
+    fprintf(stderr, "Requested read size, %" PRIu64 " samples, is very large\n", sample1 - sample0);
+  }
 
-  while (pathlist[pthidx] != NULL) {
+  // count first so the list is allocated once
+  for (sample = sample0; sample <= sample1; sample = next_file_start_sample) {
+    if (_get_file_window(channel, sample, path, &file_start_sample, &next_file_start_sample)) {
+      fprintf(stderr, "Unable to get file name for sample %" PRIu64 "\n", sample);
+      return(NULL);
+    }
+    n++;
+    if (next_file_start_sample == 0) {
+      break; // wrapped past the last representable sample
+    }
+  }
 
-    if (strstr(pathlist[pthidx], "sentinel") != NULL) {
-      pthidx++;
-      break;
+  if ((file_list = (char **)malloc((n + 1) * sizeof(char *))) == NULL) {
+    fprintf(stderr, "malloc failure - unrecoverable\n");
+    exit(-1);
+  }
+  sample = sample0;
+  for (int i = 0; i < n; i++) {
+    if (_get_file_window(channel, sample, path, &file_start_sample, &next_file_start_sample)) {
+      fprintf(stderr, "Unable to get file name for sample %" PRIu64 "\n", sample);
+      file_list[i] = NULL;
+      free_file_list(file_list);
+      return(NULL);
+    }
+    if ((file_list[i] = strdup(path)) == NULL) {
+      fprintf(stderr, "malloc failure - unrecoverable\n");
+      exit(-1);
     }
+    sample = next_file_start_sample;
+  }
+  file_list[n] = NULL;
 
-    strcpy(datapath, pathlist[pthidx]);
+  *num_files = n;
+  return(file_list);
+}
 
-    // ignore properties file
-    if (strstr(datapath, "drf_properties.h5") != NULL) {
-      pthidx++;
-      continue;
+int _map_sidecar(channel_properties * channel)
+/*
+maps the channel's sidecar index (see DIGITAL_RF_SIDECAR_INDEX), remapping
+it whenever the writer has appended to it since the last call. A trailing
+partial row is ignored. The searches of the rows need both their global
+samples and their file ids in time order, so rows appended out of order (a
+writer restarted on earlier data, or a file rewritten) drop the sidecar
+index, and the files' rf_data_index is used instead.
+
+returns 1 if sidecar rows are available, 0 if not
+*/
+{
+#ifdef _WIN32
+  return(0);
+#else
+  char path[BIG_HDF5_STR];
+  struct stat st;
+  void * map;
+  uint64_t byte_order;
+  uint64_t * rows;
+  uint64_t num_rows, checked_rows = 0;
+
+  if (channel->sidecar_fd == -2) {
+    return(0);
+  }
+  if (channel->sidecar_fd < 0) {
+    snprintf(path, BIG_HDF5_STR, "%s/%s", channel->channel_dir, DIGITAL_RF_SIDECAR_INDEX);
+    if ((channel->sidecar_fd = open(path, O_RDONLY)) < 0) {
+      channel->sidecar_fd = -1;
+      return(0);
     }
+  }
+  if (fstat(channel->sidecar_fd, &st) || st.st_size < 16) {
+    return(0);
+  }
+  if ((size_t)st.st_size == channel->sidecar_map_size) {
+    return(channel->sidecar_num_rows > 0);
+  }
 
-    if ((fapl = H5Pcreate(H5P_FILE_ACCESS)) == H5I_INVALID_HID) {
-      fprintf(stderr, "Problem opening file %s\n", datapath);
-      exit(-8);
+  if (channel->sidecar_map != NULL) {
+    // rows already checked only need checking again if the index was rewritten shorter
+    if ((size_t)st.st_size > channel->sidecar_map_size) {
+      checked_rows = channel->sidecar_num_rows;
     }
-
-    mode = H5F_ACC_RDONLY;
-    if ((prop_file = H5Fopen(datapath, mode, fapl)) == H5I_INVALID_HID) {
-      fprintf(stderr, "Problem opening file %s\n", datapath);
-      exit(-9);
+    munmap(channel->sidecar_map, channel->sidecar_map_size);
+    channel->sidecar_map = NULL;
+    channel->sidecar_map_size = 0;
+    channel->sidecar_num_rows = 0;
+  }
+  if ((map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, channel->sidecar_fd, 0)) == MAP_FAILED) {
+    return(0);
+  }
+  memcpy(&byte_order, (char *)map + 8, sizeof(uint64_t));
+  if (memcmp(map, DIGITAL_RF_SIDECAR_MAGIC, 8) != 0 || byte_order != 1) {
+    fprintf(stderr, "Ignoring sidecar index of %s with bad header or byte order\n", channel->channel_dir);
+    munmap(map, (size_t)st.st_size);
+    close(channel->sidecar_fd);
+    channel->sidecar_fd = -2;
+    return(0);
+  }
+  rows = (uint64_t *)map + 2;
+  num_rows = ((size_t)st.st_size - 16) / (3 * sizeof(uint64_t));
+  for (uint64_t i = (checked_rows > 0) ? checked_rows : 1; i < num_rows; i++) {
+    if (rows[3 * i] < rows[3 * (i - 1)] || rows[3 * i + 1] < rows[3 * (i - 1) + 1]) {
+      fprintf(stderr, "Ignoring sidecar index of %s with rows out of order\n", channel->channel_dir);
+      munmap(map, (size_t)st.st_size);
+      close(channel->sidecar_fd);
+      channel->sidecar_fd = -2;
+      return(0);
     }
+  }
+  channel->sidecar_map = (uint64_t *)map;
+  channel->sidecar_map_size = (size_t)st.st_size;
+  channel->sidecar_num_rows = num_rows;
+  return(channel->sidecar_num_rows > 0);
+#endif
+}
 
-    H5Fget_filesize(prop_file, &size);
-    if (size <= 0) {
-      fprintf(stderr, "No data found in file %s\n", datapath);
-      exit(-10);
-    }
 
-    if ((dset = H5Dopen2(prop_file, "./rf_data_index", H5P_DEFAULT)) == H5I_INVALID_HID) {
-      fprintf(stderr, "Unable to get rf_data_index\n");
-      exit(-10);
-    }
+int64_t _sidecar_search(channel_properties * channel, uint64_t sample)
+/*
+binary search of the mapped sidecar rows, which _map_sidecar has checked are
+in time order
 
-    dsettype = H5Dget_type(dset);
+returns the index of the last row whose global sample is <= sample, or -1
+*/
+{
+  uint64_t * rows = channel->sidecar_map + 2;
+  uint64_t lo = 0, hi = channel->sidecar_num_rows, mid;
 
-    if (H5Dread(dset, dsettype, H5S_ALL, H5S_ALL, H5P_DEFAULT, tmp_bounds) < 0) {
-      fprintf(stderr, "Unable to get rf_data_index\n");
-      exit(-10);
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (rows[3 * mid] <= sample) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
     }
+  }
+  return((int64_t)lo - 1);
+}
+
+
+uint64_t _sidecar_file_rows(channel_properties * channel, uint64_t file_id, uint64_t * first_row)
+/*
+finds the sidecar rows of the file with file_id (see DIGITAL_RF_SIDECAR_INDEX),
+which are adjacent since _map_sidecar has checked the file ids only increase
+
+first_row is set to the index of the first of them.
 
-    H5Tclose(dsettype);
-    H5Dclose(dset);
-    if (firstpath) {
-      // set start bound if first path in list
-      s_bound = tmp_bounds[0];
-      firstpath = false;
+returns the number of rows including the end row, 0 if the sidecar index has
+none for the file
+*/
+{
+  uint64_t * rows;
+  uint64_t lo = 0, hi, mid, stop;
+
+  // mapping may move when the index has grown
+  if (!_map_sidecar(channel)) {
+    return(0);
+  }
+  rows = channel->sidecar_map + 2;
+  hi = channel->sidecar_num_rows;
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (rows[3 * mid + 1] < file_id) {
+      lo = mid + 1;
     } else {
-      // keep resetting last index until you break out of the while loop
-      // optimize this later
-      if ((dshape = H5Dopen2(prop_file, "./rf_data", H5P_DEFAULT)) == H5I_INVALID_HID) {
-        fprintf(stderr, "Unable to get rf_data\n");
-        exit(-10);
-      }
-      space = H5Dget_space(dshape);
-      rank = H5Sget_simple_extent_ndims(space);
-      if (rank >= 0) {
-        hsize_t dims[rank];
-        H5Sget_simple_extent_dims(space, dims, NULL);
-        total_samples = dims[0];
-
-          /* printf("Dimensions: ");
-          for (int i = 0; i < rank; i++) {
-            printf("%lld ", dims[i]);
-          }
-          printf("\n"); */
-      } else {
-        fprintf(stderr, "Unable to read rf_data shape\n");
-        exit(-18);
-      }
-      H5Sclose(space);
-      H5Dclose(dshape);
-      
+      hi = mid;
     }
-    
-    H5Fclose(prop_file);
-    H5Pclose(fapl);
-    pthidx++;
   }
+  for (stop = lo; stop < channel->sidecar_num_rows && rows[3 * stop + 1] == file_id; stop++);
+  *first_row = lo;
+  return(stop - lo);
+}
+
+
+void _fill_samples(channel_properties * channel, char * dest, uint64_t num_samples)
+/*
+writes the rf_data fill value into num_samples samples starting at dest
+*/
+{
+  size_t value_size = channel->sample_size / channel->top_level_dir_meta->num_subchannels;
+  uint64_t num_values = num_samples * channel->top_level_dir_meta->num_subchannels;
+
+  for (uint64_t i = 0; i < num_values; i++) {
+    memcpy(dest + i * value_size, channel->fill_value, value_size);
+  }
+}
 
-  for (int i = 0; i < pthidx; i++) {
-    free(pathlist[i]);
+
+void _fill_strided(channel_properties * channel, char * dest, uint64_t num_samples, uint64_t stride)
+/*
+writes the rf_data fill value into num_samples samples starting at dest,
+where consecutive samples are stride bytes apart
+*/
+{
+  if (stride == channel->sample_size) {
+    _fill_samples(channel, dest, num_samples);
+    return;
   }
-  free(pathlist);
+  for (uint64_t i = 0; i < num_samples; i++) {
+    _fill_samples(channel, dest + i * stride, 1);
+  }
+}
 
-  // last_start_sample = tmp_bounds[0]
-  // last_index = tmp_bounds[1]
-  e_bound = (tmp_bounds[0] + (total_samples - (tmp_bounds[1] + 1)));
 
-  
-  bounds->b1 = s_bound;
-  bounds->b2 = e_bound;
+int _set_mem_dtype(channel_properties * channel, hid_t dset)
+/*
+sets the channel's native memory type and fill value from an open rf_data
+dataset the first time any file of the channel is read
 
-  //printf("sb is %llu at %p\n", s_bound, &s_bound);
-  //printf("eb is %llu at %p\n", e_bound, &e_bound);
-  printf("bounds are %llu and %llu at %p and %p\n", bounds->b1, bounds->b2, &bounds->b1, &bounds->b2);
-  //printf("bounds is at %p\n", bounds);
-  fflush(stdout);
-  
-  return;
+returns 0 if success, -1 if failure
+*/
+{
+  hid_t file_dtype, dcpl;
+  H5D_fill_value_t fill_status;
+  size_t value_size;
+
+  if (channel->mem_dtype_id > 0) {
+    return(0);
+  }
+
+  file_dtype = H5Dget_type(dset);
+  channel->mem_dtype_id = H5Tget_native_type(file_dtype, H5T_DIR_ASCEND);
+  H5Tclose(file_dtype);
+  if (channel->mem_dtype_id < 0) {
+    channel->mem_dtype_id = 0;
+    return(-1);
+  }
+
+  value_size = H5Tget_size(channel->mem_dtype_id);
+  if (value_size * channel->top_level_dir_meta->num_subchannels != channel->sample_size
+      || value_size > sizeof(channel->fill_value)) {
+    fprintf(stderr, "rf_data type size %zu does not match properties of channel %s\n",
+      value_size, channel->channel_name);
+    H5Tclose(channel->mem_dtype_id);
+    channel->mem_dtype_id = 0;
+    return(-1);
+  }
+
+  dcpl = H5Dget_create_plist(dset);
+  memset(channel->fill_value, 0, sizeof(channel->fill_value));
+  if (H5Pfill_value_defined(dcpl, &fill_status) >= 0 && fill_status != H5D_FILL_VALUE_UNDEFINED) {
+    H5Pget_fill_value(dcpl, channel->mem_dtype_id, channel->fill_value);
+  }
+  H5Pclose(dcpl);
+  return(0);
 }
 
 
-// void _read(top_level_dir_properties * dir_props, long start_sample, long long end_sample, char ** paths,
-//  long long ** data_dict, bool len_only, int sub_chan_idx)
-// /*
-// docs here
-// */
-// {
-//   if (strcmp(dir_props->access_mode, "local") != 0) {
-//     fprintf(stderr, "Access mode %s not implemented\n", dir_props->access_mode);
-//     exit(-20);
-//   }
+int _read_handle_index(drf_file_handle * handle)
+/*
+sets the index of a newly opened handle from the channel's sidecar index if
+it holds the file, else from the file's rf_data_index. Sidecar rows are only
+trusted if their end row matches the length of rf_data, which a group cut
+short by a crash would not.
+
+returns 0 if success, -1 if failure
+*/
+{
+  channel_properties * channel = handle->channel;
+  uint64_t * rows = NULL;
+  uint64_t first = 0, num_rows;
+  char * basename = strrchr(handle->path, '/');
+  hid_t index_dset, fspace;
+  hsize_t index_dims[2];
+
+  num_rows = _sidecar_file_rows(channel, digital_rf_get_file_id(basename ? basename + 1 : handle->path), &first);
+  if (num_rows > 1) {
+    rows = channel->sidecar_map + 2 + 3 * first;
+    if (rows[3 * (num_rows - 1) + 2] != handle->dims[0]) {
+      num_rows = 0;
+    }
+  }
+  if (num_rows > 1) {
+    num_rows--;
+    if ((handle->index = (uint64_t *)malloc(num_rows * 2 * sizeof(uint64_t))) == NULL) {
+      fprintf(stderr, "malloc failure - unrecoverable\n");
+      exit(-1);
+    }
+    for (uint64_t i = 0; i < num_rows; i++) {
+      handle->index[2 * i] = rows[3 * i];
+      handle->index[2 * i + 1] = rows[3 * i + 2];
+    }
+    handle->num_rows = num_rows;
+    return(0);
+  }
 
-//   bool ignore_subchan = (sub_chan_idx > 0) ? true : false;
+  if ((index_dset = H5Dopen2(handle->file, "rf_data_index", H5P_DEFAULT)) < 0) {
+    fprintf(stderr, "Unable to get rf_data_index in %s\n", handle->path);
+    return(-1);
+  }
+  fspace = H5Dget_space(index_dset);
+  H5Sget_simple_extent_dims(fspace, index_dims, NULL);
+  H5Sclose(fspace);
+  if ((handle->index = (uint64_t *)malloc((index_dims[0] + 1) * 2 * sizeof(uint64_t))) == NULL) {
+    fprintf(stderr, "malloc failure - unrecoverable\n");
+    exit(-1);
+  }
+  if (H5Dread(index_dset, H5T_NATIVE_UINT64, H5S_ALL, H5S_ALL, H5P_DEFAULT, handle->index) < 0) {
+    fprintf(stderr, "Unable to read rf_data_index in %s\n", handle->path);
+    H5Dclose(index_dset);
+    return(-1);
+  }
+  H5Dclose(index_dset);
+  handle->num_rows = index_dims[0];
+  return(0);
+}
 
 
+void _close_handle(Digital_rf_read_object * drf_read_obj, drf_file_handle * handle)
+/*
+unlinks handle from the reader's handle list, closes its Hdf5 objects and
+frees it
+*/
+{
+  top_level_dir_properties * props = handle->channel->top_level_dir_meta;
 
+  if (handle->prev != NULL) {
+    handle->prev->next = handle->next;
+  } else {
+    drf_read_obj->handles = handle->next;
+  }
+  if (handle->next != NULL) {
+    handle->next->prev = handle->prev;
+  } else {
+    drf_read_obj->handles_tail = handle->prev;
+  }
+  drf_read_obj->num_handles--;
+  drf_read_obj->handle_nbytes -= handle->nbytes;
 
+  if (props->cachedFile == handle->file) {
+    props->cachedFile = 0;
+    props->cachedFilename[0] = '\0';
+  }
+#ifndef _WIN32
+  if (handle->map != NULL) {
+    munmap(handle->map, handle->map_size);
+  }
+#endif
+  if (handle->dataspace > 0) {
+    H5Sclose(handle->dataspace);
+  }
+  if (handle->dataset > 0) {
+    H5Dclose(handle->dataset);
+  }
+  if (handle->file > 0) {
+    H5Fclose(handle->file);
+  }
+  free(handle->index);
+  free(handle->path);
+  free(handle);
+}
 
 
-// }
+void _trim_handles(Digital_rf_read_object * drf_read_obj)
+/*
+closes least recently used handles until the reader is within its handle
+and memory budgets, always keeping the most recently used one
+*/
+{
+  while (drf_read_obj->handles_tail != drf_read_obj->handles
+      && (drf_read_obj->num_handles > drf_read_obj->max_handles
+      || drf_read_obj->handle_nbytes > drf_read_obj->max_handle_nbytes)) {
+    _close_handle(drf_read_obj, drf_read_obj->handles_tail);
+  }
+}
 
 
-// char ** _get_file_list(unsigned long long s0, unsigned long long s1, long double sps, unsigned long long scs, unsigned long long fcm)
-// /*
-// docs here
-// */
-// {
-//   printf("s0: %llu  s1: %llu\n", s0, s1);
-//   unsigned long long dif = s1 - s0;
-//   if (dif > 1e12) {
-//     printf("dif is %llu\n", dif);
-//     fprintf(stderr, "Requested read size, %llu samples, is very large\n", dif);
-//   }
+void _set_decode_filters(drf_file_handle * handle, hid_t dcpl, hid_t dtype)
+/*
+sets the filters of the handle's chunked rf_data that the decode pool can
+undo on its own: an optional deflate followed by an optional Fletcher32, as
+the writer sets them, on data in native byte order. Anything else leaves
+num_decode_filters at -1 so Hdf5 decodes the chunks.
+*/
+{
+  hid_t native;
+  H5Z_filter_t filter;
+  unsigned int flags, cd_values[8];
+  size_t cd_nelmts;
+  int num_filters, equal;
+
+  handle->num_decode_filters = -1;
+  native = H5Tget_native_type(dtype, H5T_DIR_ASCEND);
+  equal = H5Tequal(dtype, native);
+  H5Tclose(native);
+  num_filters = H5Pget_nfilters(dcpl);
+  if (equal <= 0 || num_filters < 0 || num_filters > 2) {
+    return;
+  }
+  for (int i = 0; i < num_filters; i++) {
+    cd_nelmts = 8;
+    filter = H5Pget_filter2(dcpl, (unsigned)i, &flags, &cd_nelmts, cd_values, 0, NULL, NULL);
+    if (!(filter == H5Z_FILTER_DEFLATE && i == 0)
+        && !(filter == H5Z_FILTER_FLETCHER32 && i == num_filters - 1)) {
+      return;
+    }
+    handle->decode_filters[i] = filter;
+  }
+  handle->num_decode_filters = num_filters;
+}
 
-//   char ** fileList = NULL;
 
-//   unsigned long long start_ts = (s0 / sps);
-//   unsigned long long end_ts = (s1 / sps) + 1;
-//   unsigned long long start_msts = ((s0 / sps) * 1000);
-//   unsigned long long end_msts = ((s1 / sps) * 1000);
+int _check_filters(drf_file_handle * handle, hid_t dcpl)
+/*
+checks that every filter of the handle's rf_data can be undone here. The
+codecs of digital_rf_set_codec other than deflate are third party filters
+Hdf5 loads as plugins, so a missing one is reported by name instead of
+failing every read of the file.
 
-//   unsigned long long start_sub_ts = (floor(start_ts / scs) * scs);
-//   unsigned long long end_sub_ts = (floor(end_ts / scs) * scs);
+returns 0 if all are available, -1 if not
+*/
+{
+  H5Z_filter_t filter;
+  unsigned int flags, cd_values[8];
+  size_t cd_nelmts;
+  char name[64];
+  int num_filters;
+
+  num_filters = H5Pget_nfilters(dcpl);
+  for (int i = 0; i < num_filters; i++) {
+    cd_nelmts = 8;
+    filter = H5Pget_filter2(dcpl, (unsigned)i, &flags, &cd_nelmts, cd_values, sizeof(name), name, NULL);
+    if (filter >= 0 && H5Zfilter_avail(filter) <= 0) {
+      fprintf(stderr, "rf_data in %s needs Hdf5 filter %d (%s), which is not available - check HDF5_PLUGIN_PATH\n",
+        handle->path, (int)filter, name[0] ? name : "unregistered");
+      return(-1);
+    }
+  }
+  return(0);
+}
 
-//   printf("start is %llu, end is %llu\n", start_sub_ts, end_sub_ts);
-//   /* for (uint64_t sub_ts = start_sub_ts; sub_ts < (end_sub_ts + scs); sub_ts += scs) {
-//     struct tm * utc_time;
-//     sub_ts = (time_t)sub_ts;
-//     time_t sub_time = time(&sub_ts);
-//     utc_time = gmtime(&sub_time);
 
-//     char subdir_str[SMALL_HDF5_STR];
-//     strftime(subdir_str, SMALL_HDF5_STR, "%Y-%m-%dT%H-%M-%S", utc_time);
-//     printf("time is &s\n", subdir_str);
+int _open_rf_data(Digital_rf_read_object * drf_read_obj, drf_file_handle * handle, uint64_t span)
+/*
+opens /rf_data of the handle's file with a chunk cache of the reader's
+rdcc_nbytes, set in the one open. With DIGITAL_RF_READ_RDCC_AUTO, the cache
+instead holds every chunk a read of span samples can touch, so consecutive and
+overlapping reads do not decompress the same chunk twice. It is capped by the
+memory budget of the handles, which all open files share. If rf_data is
+already open with a cache too small for span it is reopened with a larger one;
+otherwise nothing is done. Contiguous rf_data uses no cache. handle->dims must
+be set before span is nonzero.
+
+returns 0 if success, -1 if failure
+*/
+{
+  hid_t dcpl, dapl;
+  hid_t dtype;
+  uint64_t wanted, chunks, cap, nslots;
+  int i;
+
+  if (handle->dataset > 0) {
+    if (handle->chunk_nbytes == 0 || drf_read_obj->rdcc_nbytes != DIGITAL_RF_READ_RDCC_AUTO) {
+      return(0);
+    }
+  } else {
+    // a dataset's cache is fixed when opened: a fixed size is set now, while auto mode
+    // opens with no cache to learn the chunk shape, and reopens below
+    dapl = H5Pcreate(H5P_DATASET_ACCESS);
+    if (drf_read_obj->rdcc_nbytes != DIGITAL_RF_READ_RDCC_AUTO) {
+      H5Pset_chunk_cache(dapl, DIGITAL_RF_READ_RDCC_NSLOTS, drf_read_obj->rdcc_nbytes, 1.0);
+    } else {
+      H5Pset_chunk_cache(dapl, 0, 0, H5D_CHUNK_CACHE_W0_DEFAULT);
+    }
+    handle->dataset = H5Dopen2(handle->file, "rf_data", dapl);
+    H5Pclose(dapl);
+    if (handle->dataset < 0) {
+      fprintf(stderr, "Unable to get rf_data in %s\n", handle->path);
+      return(-1);
+    }
+    dcpl = H5Dget_create_plist(handle->dataset);
+    if (_check_filters(handle, dcpl)) {
+      H5Pclose(dcpl);
+      H5Dclose(handle->dataset);
+      handle->dataset = 0;
+      return(-1);
+    }
+    if (H5Pget_layout(dcpl) == H5D_CHUNKED && H5Pget_chunk(dcpl, 2, handle->chunk_dims) == 2) {
+      dtype = H5Dget_type(handle->dataset);
+      handle->chunk_nbytes = handle->chunk_dims[0] * handle->chunk_dims[1] * H5Tget_size(dtype);
+      _set_decode_filters(handle, dcpl, dtype);
+      H5Tclose(dtype);
+    }
+    H5Pclose(dcpl);
+    if (handle->chunk_nbytes == 0) {
+      return(0);
+    }
+    if (drf_read_obj->rdcc_nbytes != DIGITAL_RF_READ_RDCC_AUTO) {
+      handle->nbytes += drf_read_obj->rdcc_nbytes;
+      drf_read_obj->handle_nbytes += drf_read_obj->rdcc_nbytes;
+      handle->rdcc_nbytes = drf_read_obj->rdcc_nbytes;
+      return(0);
+    }
+  }
 
-//   } */
+  // rows of span samples starting anywhere in a chunk, times the chunks across each row
+  chunks = (span > 1) ? (span - 2) / handle->chunk_dims[0] + 2 : span;
+  if (chunks > (handle->dims[0] + handle->chunk_dims[0] - 1) / handle->chunk_dims[0]) {
+    chunks = (handle->dims[0] + handle->chunk_dims[0] - 1) / handle->chunk_dims[0];
+  }
+  chunks *= (handle->dims[1] + handle->chunk_dims[1] - 1) / handle->chunk_dims[1];
+  wanted = chunks * handle->chunk_nbytes;
+  cap = handle->nbytes - handle->rdcc_nbytes;
+  cap = (drf_read_obj->max_handle_nbytes > cap) ? drf_read_obj->max_handle_nbytes - cap : 0;
+  if (wanted > cap) {
+    wanted = cap;
+  }
+  if (wanted <= handle->rdcc_nbytes) {
+    return(0);
+  }
 
-//   return(fileList);
+  // about 100 hash slots per cached chunk, rounded to a prime as HDF5 recommends
+  nslots = 100 * (wanted / handle->chunk_nbytes + 1) + 1;
+  for (;; nslots += 2) {
+    for (i = 3; (uint64_t)i * i <= nslots && nslots % i != 0; i += 2);
+    if ((uint64_t)i * i > nslots) {
+      break;
+    }
+  }
+  dapl = H5Pcreate(H5P_DATASET_ACCESS);
+  H5Pset_chunk_cache(dapl, nslots, wanted, 1.0);
+  H5Dclose(handle->dataset);
+  handle->dataset = H5Dopen2(handle->file, "rf_data", dapl);
+  H5Pclose(dapl);
+  if (handle->dataset < 0) {
+    fprintf(stderr, "Unable to get rf_data in %s\n", handle->path);
+    return(-1);
+  }
 
-// }
+  handle->nbytes += wanted - handle->rdcc_nbytes;
+  drf_read_obj->handle_nbytes += wanted - handle->rdcc_nbytes;
+  handle->rdcc_nbytes = wanted;
+  return(0);
+}
 
 
-// // orderedDict return type
-// unsigned long long ** get_continuous_blocks(Digital_rf_read_object * drf_read_obj, unsigned long long start_sample, unsigned long long end_sample, char * channel_name)
-// /*
-// docs here
-// */
-// {
-//   int chan_idx = -1;
+drf_file_handle * _get_file_handle(Digital_rf_read_object * drf_read_obj, channel_properties * channel,
+  char * path, uint64_t span)
+/*
+returns the open handle of the rf file at path from the reader's LRU of
+handles, opening it (file, rf_data, its dataspace and decoded index) if it is
+not there. The handle is only valid until the next call, which may close it
+to stay within budget. Finalized rf files never change, so handles stay
+valid while open.
 
-//   for (int i = 0; i < drf_read_obj->num_channels; i++) {
-//     // this could definitely be optimized but lets get it working first!
-//     if (strcmp(drf_read_obj->channel_names[i], channel_name) == 0) {
-//       chan_idx = i;
-//     }
-//   }
+span is the number of samples about to be read from the file, used to size
+an automatic chunk cache, or 0 if no rf_data will be read.
 
-//   if (chan_idx < 0) {
-//     fprintf(stderr, "No channel found named %s\n", channel_name);
-//     exit(-16);
-//   }
+returns the handle, or NULL if failure
+*/
+{
+  top_level_dir_properties * props = channel->top_level_dir_meta;
+  drf_file_handle * handle;
+  int rank;
 
-//   uint64_t subdir_cadence_secs = drf_read_obj->channels[chan_idx]->top_level_dir_meta->subdir_cadence_secs;
-//   uint64_t file_cadence_msecs = drf_read_obj->channels[chan_idx]->top_level_dir_meta->file_cadence_millisecs;
-//   long double sample_rate = drf_read_obj->channels[chan_idx]->top_level_dir_meta->sample_rate;
+  for (handle = drf_read_obj->handles; handle != NULL; handle = handle->next) {
+    if (strcmp(handle->path, path) == 0) {
+      break;
+    }
+  }
 
-//   char ** paths = NULL;
-//   printf("start sample is %llu, end sample is %llu\n", start_sample, end_sample);
-//   paths = _get_file_list(start_sample, end_sample, sample_rate, (unsigned long long)subdir_cadence_secs, (unsigned long long)file_cadence_msecs);
+  if (handle == NULL) {
+    if ((handle = (drf_file_handle *)calloc(1, sizeof(drf_file_handle))) == NULL
+        || (handle->path = strdup(path)) == NULL) {
+      fprintf(stderr, "malloc failure - unrecoverable\n");
+      exit(-1);
+    }
+    handle->channel = channel;
+    handle->num_decode_filters = -1;
+    handle->nbytes = sizeof(drf_file_handle) + strlen(path) + 1;
+    drf_read_obj->handle_nbytes += handle->nbytes;
+
+    // link first so _close_handle can clean up a partly opened handle
+    handle->next = drf_read_obj->handles;
+    if (handle->next != NULL) {
+      handle->next->prev = handle;
+    } else {
+      drf_read_obj->handles_tail = handle;
+    }
+    drf_read_obj->handles = handle;
+    drf_read_obj->num_handles++;
 
-//   unsigned long long ** cont_blocks = NULL;
-//   _read(drf_read_obj->channels[chan_idx]->top_level_dir_meta, start_sample, end_sample, paths, cont_blocks, false, -1);
+    if ((handle->file = H5Fopen(path, H5F_ACC_RDONLY, H5P_DEFAULT)) < 0) {
+      fprintf(stderr, "Problem opening file %s\n", path);
+      _close_handle(drf_read_obj, handle);
+      return(NULL);
+    }
+    if (_open_rf_data(drf_read_obj, handle, 0)) {
+      _close_handle(drf_read_obj, handle);
+      return(NULL);
+    }
+    handle->dataspace = H5Dget_space(handle->dataset);
+    rank = H5Sget_simple_extent_ndims(handle->dataspace);
+    if (rank != 2) {
+      fprintf(stderr, "Unexpected rf_data rank %i in %s\n", rank, path);
+      _close_handle(drf_read_obj, handle);
+      return(NULL);
+    }
+    H5Sget_simple_extent_dims(handle->dataspace, handle->dims, NULL);
+    if (_set_mem_dtype(channel, handle->dataset) || _read_handle_index(handle)) {
+      _close_handle(drf_read_obj, handle);
+      return(NULL);
+    }
 
+    // charge the index to the budget (the chunk cache is charged by _open_rf_data)
+    handle->nbytes += handle->num_rows * 2 * sizeof(uint64_t);
+    drf_read_obj->handle_nbytes += handle->num_rows * 2 * sizeof(uint64_t);
+  } else if (handle != drf_read_obj->handles) {
+    // move to the front of the list
+    handle->prev->next = handle->next;
+    if (handle->next != NULL) {
+      handle->next->prev = handle->prev;
+    } else {
+      drf_read_obj->handles_tail = handle->prev;
+    }
+    handle->prev = NULL;
+    handle->next = drf_read_obj->handles;
+    drf_read_obj->handles->prev = handle;
+    drf_read_obj->handles = handle;
+  }
 
-//   // still need to combine blocks
-//   return(cont_blocks);
-// }
+  // an automatic chunk cache may need to grow for this read
+  if (span > 0 && _open_rf_data(drf_read_obj, handle, span)) {
+    _close_handle(drf_read_obj, handle);
+    return(NULL);
+  }
 
+  // the channel's cached file is the last one of its files used
+  strcpy(props->cachedFilename, handle->path);
+  props->cachedFile = handle->file;
 
-// float ** read_vector(Digital_rf_read_object * drf_read_obj, long long start_sample,
-//  int num_samples, char * channel_name, char * sub_channel)
-// /*
-// also also docs here
-// */
-// {
-//   if (num_samples < 1) {
-//     fprintf(stderr, "Number of samples requested must be greater than 0, not %d\n", num_samples);
-//     exit(-19);
-//   }
-//   float ** vector = NULL;
-//   long long end_sample = start_sample + ((long long)num_samples - 1);
+  _trim_handles(drf_read_obj);
+  return(handle);
+}
 
-  
 
-//   return(vector);
-// }
+#ifdef DRF_DECODE_THREADS
+typedef struct drf_decode_task {
+  unsigned char * raw;                // chunk as stored in the file, freed once decoded
+  size_t     raw_size;
+  unsigned int filter_mask;           // bit i set if filter i was skipped for this chunk
+  int        num_filters;
+  H5Z_filter_t filters[2];
+  size_t     chunk_nbytes;            // bytes of the decoded chunk
+  size_t     skip;                    // bytes of the decoded chunk before the part wanted
+  size_t     nbytes;                  // bytes wanted
+  char *     dest;                    // where they go in the caller's buffer
+  uint64_t   chunk_row;               // first rf_data row of the chunk, for messages
+} drf_decode_task;
+
+
+typedef struct drf_decode_pool {
+  pthread_t * threads;
+  int        num_threads;
+  pthread_mutex_t lock;
+  pthread_cond_t work;                // signaled when a task is queued or on shutdown
+  pthread_cond_t done;                // signaled when a task is taken or finished
+  drf_decode_task * tasks;            // ring of queued tasks
+  int        capacity;
+  int        first;
+  int        count;                   // tasks queued
+  int        active;                  // tasks being decoded
+  int        failed;                  // a task failed since the last _wait_decode
+  int        shutdown;
+} drf_decode_pool;
+
+
+int _decode_chunk(drf_decode_task * task)
+/*
+undoes the filters of the raw chunk of task, checking its Fletcher32
+checksum and inflating it, and copies the part wanted to task->dest. A chunk
+wanted whole is inflated straight into dest.
 
+returns 0 if success, -1 if failure
+*/
+{
+  unsigned char * data = task->raw;
+  size_t size = task->raw_size;
+  unsigned char * out = NULL;
+  uLongf out_size;
+  uint32_t stored, computed;
+
+  for (int i = task->num_filters - 1; i >= 0; i--) {
+    if (task->filter_mask & (1u << i)) {
+      continue;
+    }
+    if (task->filters[i] == H5Z_FILTER_FLETCHER32) {
+      if (size < 4) {
+        fprintf(stderr, "Truncated chunk at rf_data row %" PRIu64 "\n", task->chunk_row);
+        return(-1);
+      }
+      // stored little-endian; Hdf5 also accepts it byte-swapped from old versions
+      size -= 4;
+      stored = (uint32_t)data[size] | ((uint32_t)data[size + 1] << 8)
+        | ((uint32_t)data[size + 2] << 16) | ((uint32_t)data[size + 3] << 24);
+      computed = digital_rf_fletcher32(data, size);
+      if (stored != computed && stored != (((computed & 0xff) << 24) | ((computed & 0xff00) << 8)
+          | ((computed >> 8) & 0xff00) | (computed >> 24))) {
+        fprintf(stderr, "Fletcher32 checksum mismatch in chunk at rf_data row %" PRIu64 "\n", task->chunk_row);
+        return(-1);
+      }
+    } else {
+      if (task->skip == 0 && task->nbytes == task->chunk_nbytes) {
+        out = (unsigned char *)task->dest;
+      } else if ((out = (unsigned char *)malloc(task->chunk_nbytes)) == NULL) {
+        fprintf(stderr, "malloc failure - unrecoverable\n");
+        exit(-1);
+      }
+      out_size = (uLongf)task->chunk_nbytes;
+      if (uncompress(out, &out_size, data, (uLong)size) != Z_OK || out_size != task->chunk_nbytes) {
+        fprintf(stderr, "Unable to inflate chunk at rf_data row %" PRIu64 "\n", task->chunk_row);
+        if (out != (unsigned char *)task->dest) {
+          free(out);
+        }
+        return(-1);
+      }
+      data = out;
+      size = out_size;
+    }
+  }
+
+  if (data != (unsigned char *)task->dest) {
+    if (size != task->chunk_nbytes) {
+      fprintf(stderr, "Chunk at rf_data row %" PRIu64 " has %zu bytes, not %zu\n",
+        task->chunk_row, size, task->chunk_nbytes);
+      if (out != NULL) {
+        free(out);
+      }
+      return(-1);
+    }
+    memcpy(task->dest, data + task->skip, task->nbytes);
+  }
+  if (out != NULL && out != (unsigned char *)task->dest) {
+    free(out);
+  }
+  return(0);
+}
+
+
+void * _decode_worker(void * arg)
+/*
+decode pool thread: decodes queued tasks until the pool shuts down
+*/
+{
+  drf_decode_pool * pool = (drf_decode_pool *)arg;
+  drf_decode_task task;
+  int failed;
+
+  pthread_mutex_lock(&pool->lock);
+  for (;;) {
+    while (pool->count == 0 && !pool->shutdown) {
+      pthread_cond_wait(&pool->work, &pool->lock);
+    }
+    if (pool->count == 0) {
+      break;
+    }
+    task = pool->tasks[pool->first];
+    pool->first = (pool->first + 1) % pool->capacity;
+    pool->count--;
+    pool->active++;
+    pthread_cond_broadcast(&pool->done);
+    pthread_mutex_unlock(&pool->lock);
+
+    failed = _decode_chunk(&task);
+    free(task.raw);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->active--;
+    pool->failed |= failed;
+    pthread_cond_broadcast(&pool->done);
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return(NULL);
+}
+
+
+int _wait_decode(drf_decode_pool * pool)
+/*
+waits until every queued task has been decoded
+
+returns 0 if they all succeeded, -1 if any failed
+*/
+{
+  int failed;
+
+  pthread_mutex_lock(&pool->lock);
+  while (pool->count > 0 || pool->active > 0) {
+    pthread_cond_wait(&pool->done, &pool->lock);
+  }
+  failed = pool->failed;
+  pool->failed = 0;
+  pthread_mutex_unlock(&pool->lock);
+  return(failed ? -1 : 0);
+}
+
+
+int _queue_chunks(drf_decode_pool * pool, channel_properties * channel, drf_file_handle * handle,
+  uint64_t dataset_index, uint64_t n, char * data)
+/*
+reads the raw chunks holding rf_data rows [dataset_index, dataset_index + n)
+of the handle's file with H5Dread_chunk and queues them to be decoded into
+data by the pool. Chunks never written are set to the fill value here. Waits
+for room when the queue is full, which bounds the raw chunks held in memory.
+
+returns 0 if success, -1 if failure
+*/
+{
+  drf_decode_task task;
+  hsize_t offset[2] = {0, 0};
+  hsize_t raw_size;
+  uint64_t chunk_rows = handle->chunk_dims[0];
+  uint64_t first, last;
+
+  for (offset[0] = dataset_index - dataset_index % chunk_rows; offset[0] < dataset_index + n;
+      offset[0] += chunk_rows) {
+    first = (offset[0] > dataset_index) ? offset[0] : dataset_index;
+    last = (offset[0] + chunk_rows < dataset_index + n) ? offset[0] + chunk_rows : dataset_index + n;
+    if (H5Dget_chunk_storage_size(handle->dataset, offset, &raw_size) < 0) {
+      fprintf(stderr, "Unable to get chunk at rf_data row %" PRIu64 " in %s\n", (uint64_t)offset[0], handle->path);
+      return(-1);
+    }
+    if (raw_size == 0) {
+      _fill_samples(channel, data + (first - dataset_index) * channel->sample_size, last - first);
+      continue;
+    }
+
+    task.raw_size = (size_t)raw_size;
+    if ((task.raw = (unsigned char *)malloc(task.raw_size)) == NULL) {
+      fprintf(stderr, "malloc failure - unrecoverable\n");
+      exit(-1);
+    }
+    if (H5Dread_chunk(handle->dataset, H5P_DEFAULT, offset, &task.filter_mask, task.raw) < 0) {
+      fprintf(stderr, "Unable to read chunk at rf_data row %" PRIu64 " in %s\n", (uint64_t)offset[0], handle->path);
+      free(task.raw);
+      return(-1);
+    }
+    task.num_filters = handle->num_decode_filters;
+    memcpy(task.filters, handle->decode_filters, sizeof(task.filters));
+    task.chunk_nbytes = (size_t)handle->chunk_nbytes;
+    task.skip = (size_t)((first - offset[0]) * channel->sample_size);
+    task.nbytes = (size_t)((last - first) * channel->sample_size);
+    task.dest = data + (first - dataset_index) * channel->sample_size;
+    task.chunk_row = offset[0];
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->count == pool->capacity) {
+      pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pool->tasks[(pool->first + pool->count) % pool->capacity] = task;
+    pool->count++;
+    pthread_cond_signal(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+  }
+  return(0);
+}
+
+
+void _free_decode_pool(drf_decode_pool * pool)
+/*
+stops the threads of pool once the queue is drained, and frees it
+*/
+{
+  pthread_mutex_lock(&pool->lock);
+  pool->shutdown = 1;
+  pthread_cond_broadcast(&pool->work);
+  pthread_mutex_unlock(&pool->lock);
+  for (int i = 0; i < pool->num_threads; i++) {
+    pthread_join(pool->threads[i], NULL);
+  }
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->work);
+  pthread_cond_destroy(&pool->done);
+  free(pool->threads);
+  free(pool->tasks);
+  free(pool);
+}
+#endif
+
+
+int64_t _read_blocks(Digital_rf_read_object * drf_read_obj, channel_properties * channel,
+  drf_file_handle * handle, uint64_t start_sample, uint64_t end_sample, uint64_t vector_start,
+  char * data, uint64_t stride, uint64_t * next_unfilled)
+/*
+reads the samples in [start_sample, end_sample] held by the file of handle
+into data, where data[0] is vector_start and consecutive samples are stride
+bytes apart (sample_size, or more to interleave with other channels). Samples
+between *next_unfilled and the first block read are set to the fill value,
+and *next_unfilled is advanced past the last sample written.
+
+With a decode pool, chunks it can decode are only queued, and are in data
+once _wait_decode returns.
+
+returns the number of samples read, or -1 if failure
+*/
+{
+  hid_t mspace;
+  hsize_t offset[2], count[2], mem_offset[2], mem_dims[2];
+  uint64_t block_start_sample, block_stop_sample, block_start_index, block_stop_index;
+  uint64_t read_start_sample, read_stop_sample, n;
+  int64_t samples_read = 0;
+
+  for (uint64_t row = 0; row < handle->num_rows; row++) {
+    block_start_sample = handle->index[2 * row];
+    block_start_index = handle->index[2 * row + 1];
+    block_stop_index = (row + 1 == handle->num_rows) ? handle->dims[0] : handle->index[2 * row + 3];
+    if (block_stop_index > handle->dims[0]) {
+      // a file being written may index rows rf_data does not hold yet
+      block_stop_index = handle->dims[0];
+    }
+    if (block_start_index >= block_stop_index) {
+      continue;
+    }
+    block_stop_sample = block_start_sample + (block_stop_index - block_start_index);
+
+    // intersect [block_start_sample, block_stop_sample) with [start_sample, end_sample]
+    read_start_sample = (start_sample > block_start_sample) ? start_sample : block_start_sample;
+    read_stop_sample = (end_sample + 1 < block_stop_sample) ? end_sample + 1 : block_stop_sample;
+    if (read_start_sample >= read_stop_sample) {
+      continue;
+    }
+    n = read_stop_sample - read_start_sample;
+
+    if (read_start_sample > *next_unfilled) {
+      _fill_strided(channel, data + (*next_unfilled - vector_start) * stride,
+        read_start_sample - *next_unfilled, stride);
+    }
+
+    offset[0] = block_start_index + (read_start_sample - block_start_sample);
+#ifdef DRF_DECODE_THREADS
+    if (drf_read_obj->decode_pool != NULL && handle->num_decode_filters >= 0
+        && handle->chunk_dims[1] == handle->dims[1] && stride == channel->sample_size) {
+      if (_queue_chunks(drf_read_obj->decode_pool, channel, handle, offset[0], n,
+          data + (read_start_sample - vector_start) * channel->sample_size)) {
+        return(-1);
+      }
+      samples_read += n;
+      *next_unfilled = read_stop_sample;
+      continue;
+    }
+#endif
+    offset[1] = 0;
+    count[0] = n;
+    count[1] = channel->top_level_dir_meta->num_subchannels;
+    H5Sselect_hyperslab(handle->dataspace, H5S_SELECT_SET, offset, NULL, count, NULL);
+    if (stride == channel->sample_size) {
+      mspace = H5Screate_simple(2, count, NULL);
+    } else {
+      // rows of stride bytes, of which only this channel's leading values are written
+      mem_dims[0] = n;
+      mem_dims[1] = stride / (channel->sample_size / count[1]);
+      mspace = H5Screate_simple(2, mem_dims, NULL);
+      mem_offset[0] = 0;
+      mem_offset[1] = 0;
+      H5Sselect_hyperslab(mspace, H5S_SELECT_SET, mem_offset, NULL, count, NULL);
+    }
+    if (H5Dread(handle->dataset, channel->mem_dtype_id, mspace, handle->dataspace, H5P_DEFAULT,
+        data + (read_start_sample - vector_start) * stride) < 0) {
+      fprintf(stderr, "Unable to read rf_data in %s\n", handle->path);
+      H5Sclose(mspace);
+      return(-1);
+    }
+    H5Sclose(mspace);
+
+    samples_read += n;
+    *next_unfilled = read_stop_sample;
+  }
+  return(samples_read);
+}
+
+
+int _map_rf_data(drf_file_handle * handle)
+/*
+maps the handle's rf_data read-only, straight from the file, if it is stored
+contiguously (so uncompressed and without checksum) in the native type of
+its channel. Mapped pages live in the page cache and are not charged to the
+handle memory budget.
+
+returns 1 if mapped, 0 if rf_data cannot be mapped
+*/
+{
+#ifdef _WIN32
+  return(0);
+#else
+  hid_t dcpl, file_dtype;
+  H5D_layout_t layout;
+  haddr_t offset;
+  hsize_t storage_size;
+  struct stat st;
+  off_t page_start;
+  void * map;
+  int fd, native;
+
+  if (handle->map != NULL) {
+    return(1);
+  }
+
+  dcpl = H5Dget_create_plist(handle->dataset);
+  layout = H5Pget_layout(dcpl);
+  H5Pclose(dcpl);
+  file_dtype = H5Dget_type(handle->dataset);
+  native = H5Tequal(file_dtype, handle->channel->mem_dtype_id);
+  H5Tclose(file_dtype);
+  if (layout != H5D_CONTIGUOUS || native <= 0) {
+    return(0);
+  }
+  // HADDR_UNDEF until the writer has allocated storage
+  offset = H5Dget_offset(handle->dataset);
+  storage_size = H5Dget_storage_size(handle->dataset);
+  if (offset == HADDR_UNDEF || storage_size < handle->dims[0] * handle->channel->sample_size) {
+    return(0);
+  }
+
+  if ((fd = open(handle->path, O_RDONLY)) < 0) {
+    return(0);
+  }
+  page_start = (off_t)offset - (off_t)offset % sysconf(_SC_PAGESIZE);
+  if (fstat(fd, &st) || (uint64_t)st.st_size < offset + storage_size) {
+    close(fd);
+    return(0);
+  }
+  map = mmap(NULL, (size_t)(offset - page_start + storage_size), PROT_READ, MAP_SHARED, fd, page_start);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return(0);
+  }
+  handle->map = (char *)map;
+  handle->map_size = (size_t)(offset - page_start + storage_size);
+  handle->map_data = handle->map + (offset - page_start);
+  return(1);
+#endif
+}
+
+
+int _find_edge_file(channel_properties * channel, int last, int tmp, char * subdir, char * fname)
+/*
+finds the first (last == 0) or last (last == 1) rf file of the channel in name
+order, which is time order. Only the minimum or maximum entry of the channel
+directory and then of one subdirectory is kept, so nothing is listed or sorted.
+Empty subdirectories are skipped. tmp.rf@ files still being written are ignored
+unless tmp is set, in which case they are ordered by the rf@ name they will be
+renamed to.
+
+subdir and fname must hold SMALL_HDF5_STR chars and are set to the names of
+the subdirectory and the file
+
+returns 0 if found, 1 if the channel holds no rf files, -1 if failure
+*/
+{
+  regex_t re_subdir;
+  DIR * dir;
+  struct dirent * ent;
+  char path[BIG_HDF5_STR];
+  char skip[SMALL_HDF5_STR] = "";
+  const char * name;
+  size_t len;
+  int cmp;
+
+  if (regcomp(&re_subdir, "^[0-9][0-9][0-9][0-9]-[0-9][0-9]-[0-9][0-9]T[0-9][0-9]-[0-9][0-9]-[0-9][0-9]$", 0) != 0) {
+    fprintf(stderr, "Problem compiling regex\n");
+    return(-1);
+  }
+
+  for (;;) {
+    // edge subdirectory, not counting those at or beyond one found empty
+    if ((dir = opendir(channel->channel_dir)) == NULL) {
+      fprintf(stderr, "Problem opening directory %s\n", channel->channel_dir);
+      regfree(&re_subdir);
+      return(-1);
+    }
+    subdir[0] = '\0';
+    while ((ent = readdir(dir)) != NULL) {
+      if (regexec(&re_subdir, ent->d_name, 0, NULL, 0) != 0) {
+        continue;
+      }
+      if (skip[0] != '\0') {
+        cmp = strcmp(ent->d_name, skip);
+        if ((last && cmp >= 0) || (!last && cmp <= 0)) {
+          continue;
+        }
+      }
+      cmp = strcmp(ent->d_name, subdir);
+      if (subdir[0] == '\0' || (last && cmp > 0) || (!last && cmp < 0)) {
+        strcpy(subdir, ent->d_name);
+      }
+    }
+    closedir(dir);
+    if (subdir[0] == '\0') {
+      regfree(&re_subdir);
+      return(1);
+    }
+
+    // edge file within it
+    snprintf(path, BIG_HDF5_STR, "%s/%s", channel->channel_dir, subdir);
+    fname[0] = '\0';
+    if ((dir = opendir(path)) != NULL) {
+      while ((ent = readdir(dir)) != NULL) {
+        len = strlen(ent->d_name);
+        name = (tmp && strncmp(ent->d_name, "tmp.", 4) == 0) ? ent->d_name + 4 : ent->d_name;
+        if (strncmp(name, "rf@", 3) != 0 || len < 6 || strcmp(ent->d_name + len - 3, ".h5") != 0
+            || len >= SMALL_HDF5_STR) {
+          continue;
+        }
+        cmp = strcmp(name, strncmp(fname, "tmp.", 4) == 0 ? fname + 4 : fname);
+        if (fname[0] == '\0' || (last && cmp > 0) || (!last && cmp < 0)) {
+          strcpy(fname, ent->d_name);
+        }
+      }
+      closedir(dir);
+    }
+    if (fname[0] != '\0') {
+      regfree(&re_subdir);
+      return(0);
+    }
+    strcpy(skip, subdir);
+  }
+}
+
+
+int _read_edge_sample(Digital_rf_read_object * drf_read_obj, channel_properties * channel,
+  char * path, int last, uint64_t * sample)
+/*
+sets sample to the first sample (last == 0) or the last sample (last == 1)
+held by the rf file at path, from its index and the extent of rf_data
+
+returns 0 if success, -1 if failure
+*/
+{
+  drf_file_handle * handle;
+
+  if ((handle = _get_file_handle(drf_read_obj, channel, path, 0)) == NULL) {
+    return(-1);
+  }
+  if (handle->num_rows == 0) {
+    fprintf(stderr, "Empty rf_data_index in %s\n", path);
+    return(-1);
+  }
+  if (!last) {
+    *sample = handle->index[0];
+  } else {
+    // the last block runs from its index row to the end of rf_data
+    *sample = handle->index[2 * (handle->num_rows - 1)]
+      + (handle->dims[0] - handle->index[2 * (handle->num_rows - 1) + 1]) - 1;
+  }
+  return(0);
+}
+
+
+void _stat_bounds_paths(channel_properties * channel, time_t * mtimes)
+/*
+sets mtimes to the modification times of the paths the cached bounds depend
+on (see channel_properties); a path that cannot be stat'ed gets -1
+*/
+{
+  char path[BIG_HDF5_STR];
+  struct stat st;
+
+  mtimes[0] = (stat(channel->channel_dir, &st) == 0) ? st.st_mtime : -1;
+  snprintf(path, BIG_HDF5_STR, "%s/%s", channel->channel_dir, channel->bounds_first_dir);
+  mtimes[1] = (stat(path, &st) == 0) ? st.st_mtime : -1;
+  snprintf(path, BIG_HDF5_STR, "%s/%s", channel->channel_dir, channel->bounds_last_dir);
+  mtimes[2] = (stat(path, &st) == 0) ? st.st_mtime : -1;
+  snprintf(path, BIG_HDF5_STR, "%s/%s/%s", channel->channel_dir, channel->bounds_last_dir,
+    channel->bounds_last_file);
+  mtimes[3] = (stat(path, &st) == 0) ? st.st_mtime : -1;
+}
+
+
+int _bounds_cache_valid(channel_properties * channel)
+/*
+checks whether the cached bounds still hold with a few stat calls: adding or
+removing files or subdirectories at either end changes the mtime of the
+channel directory or of the first or last subdirectory. An mtime not older
+than the time the bounds were found may hide a later change in the same
+second, so such a cache is never trusted.
+
+returns 1 if the cached bounds can be used, 0 if not
+*/
+{
+  time_t mtimes[4];
+
+  if (channel->bounds_time == 0) {
+    return(0);
+  }
+  _stat_bounds_paths(channel, mtimes);
+  for (int i = 0; i < 4; i++) {
+    if (mtimes[i] < 0 || mtimes[i] != channel->bounds_mtime[i] || mtimes[i] >= channel->bounds_time) {
+      return(0);
+    }
+  }
+  return(1);
+}
+
+
+int get_bounds(Digital_rf_read_object * drf_read_obj, char * channel_name,
+  drf_bounds * bounds)
+/*
+sets bounds->b1 and bounds->b2 to the first and last sample of channel_name
+in number of samples since the epoch
+
+Only the first and last files are opened, found by name without listing the
+whole channel. The result is cached on the channel and revalidated with a
+few stat calls, so repeated calls on an unchanged channel open no files.
+
+returns 0 if success, -1 if the channel has no data or failure
+*/
+{
+  channel_properties * channel;
+  char first_file[SMALL_HDF5_STR];
+  char path[BIG_HDF5_STR];
+  uint64_t first_sample, last_sample;
+  time_t now;
+  int status;
+
+  if (strcmp(drf_read_obj->access_mode, "local") != 0) {
+    fprintf(stderr, "Access mode %s not implemented\n", drf_read_obj->access_mode);
+    return(-1);
+  }
+  if ((channel = _find_channel(drf_read_obj, channel_name)) == NULL) {
+    fprintf(stderr, "No channel found named %s\n", channel_name);
+    return(-1);
+  }
+
+  if (_bounds_cache_valid(channel)) {
+    *bounds = channel->bounds;
+    return(0);
+  }
+  channel->bounds_time = 0;
+  now = time(NULL);
+
+  if ((status = _find_edge_file(channel, 0, 0, channel->bounds_first_dir, first_file)) == 0) {
+    status = _find_edge_file(channel, 1, 0, channel->bounds_last_dir, channel->bounds_last_file);
+  }
+  if (status) {
+    if (status > 0) {
+      fprintf(stderr, "No data files found in channel %s\n", channel_name);
+    }
+    return(-1);
+  }
+  // stat before opening, so that changes while reading invalidate the cache
+  _stat_bounds_paths(channel, channel->bounds_mtime);
+
+  snprintf(path, BIG_HDF5_STR, "%s/%s/%s", channel->channel_dir, channel->bounds_first_dir, first_file);
+  if (_read_edge_sample(drf_read_obj, channel, path, 0, &first_sample)) {
+    return(-1);
+  }
+  snprintf(path, BIG_HDF5_STR, "%s/%s/%s", channel->channel_dir, channel->bounds_last_dir,
+    channel->bounds_last_file);
+  if (_read_edge_sample(drf_read_obj, channel, path, 1, &last_sample)) {
+    return(-1);
+  }
+
+  channel->bounds.b1 = first_sample;
+  channel->bounds.b2 = last_sample;
+  channel->bounds_time = now;
+  *bounds = channel->bounds;
+  return(0);
+}
+
+
+uint64_t get_sample_size(Digital_rf_read_object * drf_read_obj, char * channel_name)
+/*
+returns the number of bytes in one sample of channel_name as read by
+read_vector (all subchannels, real and imaginary parts if complex), or 0 if
+there is no such channel
+*/
+{
+  channel_properties * channel = _find_channel(drf_read_obj, channel_name);
+
+  if (channel == NULL) {
+    fprintf(stderr, "No channel found named %s\n", channel_name);
+    return(0);
+  }
+  return(channel->sample_size);
+}
+
+
+void _advise_files(channel_properties * channel, uint64_t start_sample, uint64_t end_sample)
+/*
+tells the kernel that the channel's files holding [start_sample, end_sample]
+will be read soon, so it fetches them in the background and, with several
+channels advised before any is read, all at once
+*/
+{
+#ifndef _WIN32
+  char path[BIG_HDF5_STR];
+  uint64_t sample, file_start_sample, next_file_start_sample;
+  int fd;
+
+  for (sample = start_sample; sample <= end_sample; sample = next_file_start_sample) {
+    if (_get_file_window(channel, sample, path, &file_start_sample, &next_file_start_sample)) {
+      return;
+    }
+    if ((fd = open(path, O_RDONLY)) >= 0) {
+      posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+      close(fd);
+    }
+  }
+#endif
+}
+
+
+int64_t _read_range(Digital_rf_read_object * drf_read_obj, channel_properties * channel,
+  uint64_t start_sample, uint64_t num_samples, char * data, uint64_t stride)
+/*
+reads num_samples samples of channel beginning at start_sample into data as
+read_vector does, with consecutive samples stride bytes apart
+
+returns the number of samples found, 0 if none (data untouched), or -1 if
+failure
+*/
+{
+  drf_file_handle * handle;
+  char path[BIG_HDF5_STR];
+  uint64_t end_sample, sample, next_unfilled;
+  uint64_t file_start_sample, next_file_start_sample, file_end_sample;
+  int64_t samples_found = 0;
+  int64_t n;
+
+  end_sample = start_sample + (num_samples - 1);
+  next_unfilled = start_sample;
+  sample = start_sample;
+
+  // step file by file through the cadence windows covering the range
+  while (sample <= end_sample) {
+    if (_get_file_window(channel, sample, path, &file_start_sample, &next_file_start_sample)) {
+      fprintf(stderr, "Unable to get file name for sample %" PRIu64 "\n", sample);
+      samples_found = -1;
+      break;
+    }
+    if (access(path, R_OK) == 0) {
+      file_end_sample = (next_file_start_sample - 1 < end_sample) ? next_file_start_sample - 1 : end_sample;
+      if ((handle = _get_file_handle(drf_read_obj, channel, path,
+          file_end_sample - sample + 1)) == NULL) {
+        samples_found = -1;
+        break;
+      }
+      n = _read_blocks(drf_read_obj, channel, handle, sample, file_end_sample, start_sample,
+        data, stride, &next_unfilled);
+      if (n < 0) {
+        samples_found = -1;
+        break;
+      }
+      samples_found += n;
+    }
+    sample = next_file_start_sample;
+  }
+
+#ifdef DRF_DECODE_THREADS
+  // queued chunks write into data, so wait for them even after a failure
+  if (drf_read_obj->decode_pool != NULL && _wait_decode(drf_read_obj->decode_pool)) {
+    fprintf(stderr, "Unable to decode rf_data chunks of channel %s\n", channel->channel_name);
+    samples_found = -1;
+  }
+#endif
+  if (samples_found < 0) {
+    return(-1);
+  }
+
+  // fill trailing gap, unless nothing was found (fill value may be unknown)
+  if (samples_found > 0 && next_unfilled <= end_sample) {
+    _fill_strided(channel, data + (next_unfilled - start_sample) * stride,
+      end_sample + 1 - next_unfilled, stride);
+  }
+
+  return(samples_found);
+}
+
+
+int64_t read_vector(Digital_rf_read_object * drf_read_obj, uint64_t start_sample,
+  uint64_t num_samples, char * channel_name, void * data)
+/*
+reads num_samples samples of every subchannel of channel_name, beginning at
+start_sample, into the caller-provided buffer data
+
+start_sample is given in number of samples since the epoch, like the values
+returned by get_bounds. data must hold num_samples * get_sample_size() bytes
+and be aligned for the sample type. Samples are stored in the file's type in
+native byte order, row after row as in rf_data: complex data is a struct of
+r and i values, and subchannels of each sample are adjacent. No conversion
+is done and no memory is allocated per call, so data can be reused.
+
+Samples inside the requested range that are missing from the data (gaps) are
+set to the rf_data fill value.
+
+returns the number of samples found in the data (num_samples if there are no
+gaps), 0 if there is no data at all in the range (data untouched), or -1 if
+failure
+*/
+{
+  channel_properties * channel;
+
+  if (num_samples < 1) {
+    fprintf(stderr, "Number of samples requested must be greater than 0, not %" PRIu64 "\n", num_samples);
+    return(-1);
+  }
+  if (data == NULL) {
+    fprintf(stderr, "Null data buffer passed in\n");
+    return(-1);
+  }
+  if ((channel = _find_channel(drf_read_obj, channel_name)) == NULL) {
+    fprintf(stderr, "No channel found named %s\n", channel_name);
+    return(-1);
+  }
+
+  return(_read_range(drf_read_obj, channel, start_sample, num_samples, (char *)data, channel->sample_size));
+}
+
+
+
+int64_t digital_rf_read_channels(Digital_rf_read_object * drf_read_obj, uint64_t start_sample,
+  uint64_t num_samples, int num_channels, char ** channel_names, int interleaved, void * data,
+  int64_t * samples_found)
+/*
+reads the same num_samples samples, beginning at start_sample, of the
+num_channels channels named in channel_names into the single caller-provided
+buffer data. The channels must have the same sample rate. Files of every
+channel are advised to the kernel before any is read, so their I/O proceeds
+concurrently.
+
+If interleaved is 0, data is planar: the samples of each channel, laid out as
+read_vector would, one channel after the other. Otherwise it is interleaved:
+each sample of every channel, in channel order, then the next sample, which
+needs the channels' values (a real or complex value of one subchannel) to
+have the same size. Either way data must hold num_samples times the sum of
+the channels' get_sample_size() bytes, and is read into in place with no
+transpose.
+
+Gaps are set to each channel's fill value, as is the whole span of a channel
+with no data in it (zeros if none of its files has been read yet).
+samples_found, unless NULL, receives the number of samples found for each
+channel.
+
+returns the total number of samples found, or -1 if failure
+*/
+{
+  channel_properties ** channels;
+  uint64_t stride = 0, offset = 0, value_size = 0;
+  int64_t total = 0;
+  int64_t n;
+  int i;
+
+  if (num_samples < 1 || num_channels < 1 || data == NULL) {
+    fprintf(stderr, "Need at least one sample, one channel, and a data buffer\n");
+    return(-1);
+  }
+  if ((channels = (channel_properties **)malloc(num_channels * sizeof(channel_properties *))) == NULL) {
+    fprintf(stderr, "malloc failure - unrecoverable\n");
+    exit(-1);
+  }
+  for (i = 0; i < num_channels; i++) {
+    if ((channels[i] = _find_channel(drf_read_obj, channel_names[i])) == NULL) {
+      fprintf(stderr, "No channel found named %s\n", channel_names[i]);
+      free(channels);
+      return(-1);
+    }
+    if (channels[i]->top_level_dir_meta->sample_rate_numerator != channels[0]->top_level_dir_meta->sample_rate_numerator
+        || channels[i]->top_level_dir_meta->sample_rate_denominator != channels[0]->top_level_dir_meta->sample_rate_denominator) {
+      fprintf(stderr, "Channel %s has a different sample rate than %s\n", channel_names[i], channel_names[0]);
+      free(channels);
+      return(-1);
+    }
+    if (interleaved) {
+      if (i == 0) {
+        value_size = channels[i]->sample_size / channels[i]->top_level_dir_meta->num_subchannels;
+      } else if (channels[i]->sample_size / channels[i]->top_level_dir_meta->num_subchannels != value_size) {
+        fprintf(stderr, "Channel %s cannot be interleaved with %s, their values differ in size\n",
+          channel_names[i], channel_names[0]);
+        free(channels);
+        return(-1);
+      }
+      stride += channels[i]->sample_size;
+    }
+  }
+
+  for (i = 0; i < num_channels; i++) {
+    _advise_files(channels[i], start_sample, start_sample + (num_samples - 1));
+  }
+
+  for (i = 0; i < num_channels; i++) {
+    if (!interleaved) {
+      stride = channels[i]->sample_size;
+    }
+    n = _read_range(drf_read_obj, channels[i], start_sample, num_samples, (char *)data + offset, stride);
+    if (n < 0) {
+      free(channels);
+      return(-1);
+    }
+    if (n == 0) {
+      _fill_strided(channels[i], (char *)data + offset, num_samples, stride);
+    }
+    if (samples_found != NULL) {
+      samples_found[i] = n;
+    }
+    total += n;
+    offset += interleaved ? channels[i]->sample_size : num_samples * channels[i]->sample_size;
+  }
+
+  free(channels);
+  return(total);
+}
+
+typedef struct drf_read_piece {
+  uint64_t   file_start_sample;       // first sample of the file window holding the piece
+  uint64_t   start_sample;            // samples [start_sample, end_sample] of one range
+  uint64_t   end_sample;
+  uint64_t   range;                   // index of the range
+} drf_read_piece;
+
+
+typedef struct drf_read_segment {
+  uint64_t   dataset_index;           // first rf_data row of the segment
+  uint64_t   n;                       // rows, which are consecutive samples
+  uint64_t   start_sample;            // sample of the first row
+  uint64_t   range;                   // index of the range it belongs to
+  uint64_t   scratch_index;           // row of the segment in the scratch buffer
+} drf_read_segment;
+
+
+typedef struct drf_read_batch {
+  uint64_t * ranges;                  // the caller's (start_sample, num_samples) pairs
+  void **    data;                    // the caller's buffers, one per range
+  uint64_t * next_unfilled;           // per range, first sample not yet written
+  int64_t *  found;                   // per range, samples found so far
+  drf_read_segment * segments;        // rows wanted from the present file
+  uint64_t   segments_capacity;
+  uint64_t * intervals;               // merged (dataset_index, rows) read from it, in scratch order
+  uint64_t   intervals_capacity;
+  char *     scratch;                 // those rows, back to back
+  size_t     scratch_size;
+} drf_read_batch;
+
+
+int _piece_cmp(const void * a, const void * b)
+/* orders pieces by file, then by first sample */
+{
+  const drf_read_piece * p = (const drf_read_piece *)a;
+  const drf_read_piece * q = (const drf_read_piece *)b;
+
+  if (p->file_start_sample != q->file_start_sample) {
+    return((p->file_start_sample < q->file_start_sample) ? -1 : 1);
+  }
+  if (p->start_sample != q->start_sample) {
+    return((p->start_sample < q->start_sample) ? -1 : 1);
+  }
+  return(0);
+}
+
+
+int _segment_cmp(const void * a, const void * b)
+/* orders segments by first rf_data row, then by range */
+{
+  const drf_read_segment * p = (const drf_read_segment *)a;
+  const drf_read_segment * q = (const drf_read_segment *)b;
+
+  if (p->dataset_index != q->dataset_index) {
+    return((p->dataset_index < q->dataset_index) ? -1 : 1);
+  }
+  if (p->range != q->range) {
+    return((p->range < q->range) ? -1 : 1);
+  }
+  return(0);
+}
+
+
+int64_t _read_file_pieces(Digital_rf_read_object * drf_read_obj, channel_properties * channel,
+  drf_file_handle * handle, drf_read_piece * pieces, uint64_t num_pieces, drf_read_batch * batch)
+/*
+reads the pieces of ranges held by the file of handle, all sorted by sample,
+with one read of rf_data, then copies each piece's samples to its range's
+buffer, filling the gap before them. Wanted rows sharing a chunk (or
+overlapping, if rf_data is not chunked) are merged into one hyperslab of a
+union, so each chunk is read and decoded once.
+
+returns the number of samples found, or -1 if failure
+*/
+{
+  drf_read_segment * segment;
+  uint64_t block_start_sample, block_stop_sample, block_start_index, block_stop_index;
+  uint64_t read_start_sample, read_stop_sample, merge_limit = 0, scratch_rows = 0, interval_scratch_index = 0;
+  uint64_t num_segments = 0, num_intervals = 0, range_start;
+  hid_t mspace;
+  hsize_t offset[2], count[2];
+  int64_t samples_read = 0;
+  char * dest;
+
+  // rows of the file wanted by each piece
+  for (uint64_t k = 0; k < num_pieces; k++) {
+    for (uint64_t row = 0; row < handle->num_rows; row++) {
+      block_start_sample = handle->index[2 * row];
+      block_start_index = handle->index[2 * row + 1];
+      block_stop_index = (row + 1 == handle->num_rows) ? handle->dims[0] : handle->index[2 * row + 3];
+      block_stop_sample = block_start_sample + (block_stop_index - block_start_index);
+      read_start_sample = (pieces[k].start_sample > block_start_sample) ? pieces[k].start_sample : block_start_sample;
+      read_stop_sample = (pieces[k].end_sample + 1 < block_stop_sample) ? pieces[k].end_sample + 1 : block_stop_sample;
+      if (read_start_sample >= read_stop_sample) {
+        continue;
+      }
+      if (num_segments == batch->segments_capacity) {
+        batch->segments_capacity = (batch->segments_capacity == 0) ? 64 : 2 * batch->segments_capacity;
+        if ((segment = realloc(batch->segments, batch->segments_capacity * sizeof(drf_read_segment))) == NULL) {
+          fprintf(stderr, "Realloc failure\n");
+          exit(-22);
+        }
+        batch->segments = segment;
+      }
+      segment = &batch->segments[num_segments++];
+      segment->dataset_index = block_start_index + (read_start_sample - block_start_sample);
+      segment->n = read_stop_sample - read_start_sample;
+      segment->start_sample = read_start_sample;
+      segment->range = pieces[k].range;
+    }
+  }
+  if (num_segments == 0) {
+    return(0);
+  }
+  qsort(batch->segments, num_segments, sizeof(drf_read_segment), _segment_cmp);
+
+  // merge the segments into intervals of rows, laid out back to back in scratch
+  for (uint64_t k = 0; k < num_segments; k++) {
+    segment = &batch->segments[k];
+    if (num_intervals > 0) {
+      merge_limit = batch->intervals[2 * num_intervals - 2] + batch->intervals[2 * num_intervals - 1];
+      if (handle->chunk_nbytes > 0) {
+        merge_limit = (merge_limit + handle->chunk_dims[0] - 1) / handle->chunk_dims[0] * handle->chunk_dims[0];
+      }
+    }
+    if (num_intervals == 0 || segment->dataset_index > merge_limit) {
+      if (num_intervals == batch->intervals_capacity) {
+        batch->intervals_capacity = (batch->intervals_capacity == 0) ? 64 : 2 * batch->intervals_capacity;
+        if ((dest = realloc(batch->intervals, batch->intervals_capacity * 2 * sizeof(uint64_t))) == NULL) {
+          fprintf(stderr, "Realloc failure\n");
+          exit(-22);
+        }
+        batch->intervals = (uint64_t *)dest;
+      }
+      batch->intervals[2 * num_intervals] = segment->dataset_index;
+      batch->intervals[2 * num_intervals + 1] = 0;
+      num_intervals++;
+      interval_scratch_index = scratch_rows;
+    }
+    segment->scratch_index = interval_scratch_index + (segment->dataset_index - batch->intervals[2 * num_intervals - 2]);
+    if (segment->dataset_index + segment->n > batch->intervals[2 * num_intervals - 2] + batch->intervals[2 * num_intervals - 1]) {
+      scratch_rows += segment->dataset_index + segment->n
+        - (batch->intervals[2 * num_intervals - 2] + batch->intervals[2 * num_intervals - 1]);
+      batch->intervals[2 * num_intervals - 1] = segment->dataset_index + segment->n - batch->intervals[2 * num_intervals - 2];
+    }
+  }
+  if (scratch_rows * channel->sample_size > batch->scratch_size) {
+    batch->scratch_size = scratch_rows * channel->sample_size;
+    free(batch->scratch);
+    if ((batch->scratch = (char *)malloc(batch->scratch_size)) == NULL) {
+      fprintf(stderr, "malloc failure - unrecoverable\n");
+      exit(-1);
+    }
+  }
+
+#ifdef DRF_DECODE_THREADS
+  if (drf_read_obj->decode_pool != NULL && handle->num_decode_filters >= 0
+      && handle->chunk_dims[1] == handle->dims[1]) {
+    dest = batch->scratch;
+    for (uint64_t k = 0; k < num_intervals; k++) {
+      if (_queue_chunks(drf_read_obj->decode_pool, channel, handle, batch->intervals[2 * k],
+          batch->intervals[2 * k + 1], dest)) {
+        _wait_decode(drf_read_obj->decode_pool);
+        return(-1);
+      }
+      dest += batch->intervals[2 * k + 1] * channel->sample_size;
+    }
+    if (_wait_decode(drf_read_obj->decode_pool)) {
+      fprintf(stderr, "Unable to decode rf_data chunks in %s\n", handle->path);
+      return(-1);
+    }
+  } else
+#endif
+  {
+    // one read of the union of the intervals, which Hdf5 delivers in row order
+    H5Sselect_none(handle->dataspace);
+    offset[1] = 0;
+    count[1] = channel->top_level_dir_meta->num_subchannels;
+    for (uint64_t k = 0; k < num_intervals; k++) {
+      offset[0] = batch->intervals[2 * k];
+      count[0] = batch->intervals[2 * k + 1];
+      H5Sselect_hyperslab(handle->dataspace, H5S_SELECT_OR, offset, NULL, count, NULL);
+    }
+    count[0] = scratch_rows;
+    mspace = H5Screate_simple(2, count, NULL);
+    if (H5Dread(handle->dataset, channel->mem_dtype_id, mspace, handle->dataspace, H5P_DEFAULT,
+        batch->scratch) < 0) {
+      fprintf(stderr, "Unable to read rf_data in %s\n", handle->path);
+      H5Sclose(mspace);
+      return(-1);
+    }
+    H5Sclose(mspace);
+  }
+
+  // hand each range its rows, filling any gap before them
+  for (uint64_t k = 0; k < num_segments; k++) {
+    segment = &batch->segments[k];
+    dest = (char *)batch->data[segment->range];
+    range_start = batch->ranges[2 * segment->range];
+    if (segment->start_sample > batch->next_unfilled[segment->range]) {
+      _fill_samples(channel, dest + (batch->next_unfilled[segment->range] - range_start) * channel->sample_size,
+        segment->start_sample - batch->next_unfilled[segment->range]);
+    }
+    memcpy(dest + (segment->start_sample - range_start) * channel->sample_size,
+      batch->scratch + segment->scratch_index * channel->sample_size, segment->n * channel->sample_size);
+    batch->next_unfilled[segment->range] = segment->start_sample + segment->n;
+    batch->found[segment->range] += segment->n;
+    samples_read += segment->n;
+  }
+  return(samples_read);
+}
+
+
+int64_t digital_rf_read_vectors(Digital_rf_read_object * drf_read_obj, char * channel_name,
+  uint64_t num_ranges, uint64_t * ranges, void ** data, int64_t * samples_found)
+/*
+reads many ranges of samples of channel_name at once, each into its own
+caller-provided buffer, as num_ranges calls of read_vector would, but opening
+and indexing each file once and reading everything wanted from a file with a
+single Hdf5 read of a union of hyperslabs
+
+ranges holds num_ranges (start_sample, num_samples) pairs, in any order and
+possibly overlapping. data[i] receives range i just as read_vector would fill
+it, and samples_found[i], unless samples_found is NULL, what read_vector
+would return: the samples found, with gaps set to the fill value, or 0 with
+data[i] untouched if the range holds no data.
+
+returns the total number of samples found, or -1 if failure
+*/
+{
+  channel_properties * channel;
+  drf_file_handle * handle;
+  drf_read_batch batch;
+  drf_read_piece * pieces = NULL;
+  drf_read_piece * grown;
+  uint64_t num_pieces = 0, pieces_capacity = 0, i, j;
+  uint64_t sample, end_sample, file_start_sample, next_file_start_sample, span;
+  char path[BIG_HDF5_STR];
+  int64_t total = 0;
+  int64_t n;
+
+  if ((channel = _find_channel(drf_read_obj, channel_name)) == NULL) {
+    fprintf(stderr, "No channel found named %s\n", channel_name);
+    return(-1);
+  }
+  for (i = 0; i < num_ranges; i++) {
+    if (ranges[2 * i + 1] < 1 || data[i] == NULL) {
+      fprintf(stderr, "Range %" PRIu64 " is empty or has a null data buffer\n", i);
+      return(-1);
+    }
+  }
+  if (num_ranges == 0) {
+    return(0);
+  }
+
+  memset(&batch, 0, sizeof(batch));
+  batch.ranges = ranges;
+  batch.data = data;
+  if ((batch.next_unfilled = (uint64_t *)malloc(num_ranges * sizeof(uint64_t))) == NULL
+      || (batch.found = (int64_t *)calloc(num_ranges, sizeof(int64_t))) == NULL) {
+    fprintf(stderr, "malloc failure - unrecoverable\n");
+    exit(-1);
+  }
+
+  // split the ranges at file boundaries, then group the pieces by file
+  for (i = 0; i < num_ranges && total >= 0; i++) {
+    batch.next_unfilled[i] = ranges[2 * i];
+    end_sample = ranges[2 * i] + (ranges[2 * i + 1] - 1);
+    for (sample = ranges[2 * i]; sample <= end_sample; sample = next_file_start_sample) {
+      if (_get_file_window(channel, sample, path, &file_start_sample, &next_file_start_sample)) {
+        fprintf(stderr, "Unable to get file name for sample %" PRIu64 "\n", sample);
+        total = -1;
+        break;
+      }
+      if (num_pieces == pieces_capacity) {
+        pieces_capacity = (pieces_capacity == 0) ? 2 * num_ranges : 2 * pieces_capacity;
+        if ((grown = realloc(pieces, pieces_capacity * sizeof(drf_read_piece))) == NULL) {
+          fprintf(stderr, "Realloc failure\n");
+          exit(-22);
+        }
+        pieces = grown;
+      }
+      pieces[num_pieces].file_start_sample = file_start_sample;
+      pieces[num_pieces].start_sample = sample;
+      pieces[num_pieces].end_sample = (next_file_start_sample - 1 < end_sample) ? next_file_start_sample - 1 : end_sample;
+      pieces[num_pieces].range = i;
+      num_pieces++;
+    }
+  }
+  if (total >= 0) {
+    qsort(pieces, num_pieces, sizeof(drf_read_piece), _piece_cmp);
+  }
+
+  // each file once, in time order, so every range is written front to back
+  for (i = 0; i < num_pieces && total >= 0; i = j) {
+    span = 0;
+    for (j = i; j < num_pieces && pieces[j].file_start_sample == pieces[i].file_start_sample; j++) {
+      if (pieces[j].end_sample - pieces[i].start_sample + 1 > span) {
+        span = pieces[j].end_sample - pieces[i].start_sample + 1;
+      }
+    }
+    if (_get_file_window(channel, pieces[i].start_sample, path, &file_start_sample, &next_file_start_sample)) {
+      fprintf(stderr, "Unable to get file name for sample %" PRIu64 "\n", pieces[i].start_sample);
+      total = -1;
+      break;
+    }
+    if (access(path, R_OK) != 0) {
+      continue;
+    }
+    if ((handle = _get_file_handle(drf_read_obj, channel, path, span)) == NULL
+        || (n = _read_file_pieces(drf_read_obj, channel, handle, pieces + i, j - i, &batch)) < 0) {
+      total = -1;
+      break;
+    }
+    total += n;
+  }
+
+  // fill trailing gaps of ranges holding any data
+  for (i = 0; i < num_ranges && total >= 0; i++) {
+    end_sample = ranges[2 * i] + ranges[2 * i + 1];
+    if (batch.found[i] > 0 && batch.next_unfilled[i] < end_sample) {
+      _fill_samples(channel, (char *)data[i] + (batch.next_unfilled[i] - ranges[2 * i]) * channel->sample_size,
+        end_sample - batch.next_unfilled[i]);
+    }
+    if (samples_found != NULL) {
+      samples_found[i] = batch.found[i];
+    }
+  }
+
+  free(pieces);
+  free(batch.next_unfilled);
+  free(batch.found);
+  free(batch.segments);
+  free(batch.intervals);
+  free(batch.scratch);
+  return(total);
+}
+
+
+
+int64_t digital_rf_read_vector_mapped(Digital_rf_read_object * drf_read_obj, uint64_t start_sample,
+  uint64_t num_samples, char * channel_name, void ** data)
+/*
+zero-copy counterpart of read_vector for channels whose rf_data is stored
+contiguously, which the writer does for continuous channels without
+compression or checksum: sets *data to start_sample in a read-only memory
+map of its rf file, so samples come straight from the page cache without
+H5Dread or any copy. Samples are laid out as in read_vector.
+
+Only the run of samples that starts at start_sample and is continuous within
+one file is returned, up to num_samples; call again from start_sample plus
+the count returned for the rest. *data is only valid until the next call on
+drf_read_obj, which may close the file (see digital_rf_set_handle_cache).
+
+returns the number of samples at *data, 0 if start_sample is not in the data
+(a gap or a missing file), -2 if its file cannot be mapped (read_vector
+still works), or -1 if failure
+*/
+{
+  channel_properties * channel;
+  drf_file_handle * handle;
+  char path[BIG_HDF5_STR];
+  uint64_t file_start_sample, next_file_start_sample;
+  uint64_t block_start_sample, block_start_index, block_stop_index, n;
+
+  if (num_samples < 1) {
+    fprintf(stderr, "Number of samples requested must be greater than 0, not %" PRIu64 "\n", num_samples);
+    return(-1);
+  }
+  if ((channel = _find_channel(drf_read_obj, channel_name)) == NULL) {
+    fprintf(stderr, "No channel found named %s\n", channel_name);
+    return(-1);
+  }
+  if (_get_file_window(channel, start_sample, path, &file_start_sample, &next_file_start_sample)) {
+    fprintf(stderr, "Unable to get file name for sample %" PRIu64 "\n", start_sample);
+    return(-1);
+  }
+  if (access(path, R_OK) != 0) {
+    return(0);
+  }
+  if ((handle = _get_file_handle(drf_read_obj, channel, path, 0)) == NULL) {
+    return(-1);
+  }
+  if (!_map_rf_data(handle)) {
+    return(-2);
+  }
+
+  for (uint64_t row = 0; row < handle->num_rows; row++) {
+    block_start_sample = handle->index[2 * row];
+    block_start_index = handle->index[2 * row + 1];
+    block_stop_index = (row + 1 == handle->num_rows) ? handle->dims[0] : handle->index[2 * row + 3];
+    if (start_sample < block_start_sample
+        || start_sample - block_start_sample >= block_stop_index - block_start_index) {
+      continue;
+    }
+    n = block_stop_index - block_start_index - (start_sample - block_start_sample);
+    *data = handle->map_data + (block_start_index + (start_sample - block_start_sample)) * channel->sample_size;
+    return((int64_t)((n < num_samples) ? n : num_samples));
+  }
+  return(0);
+}
+
+
+void _close_tail_handle(channel_properties * channel)
+/*
+closes the channel's tail handle, if any. Tail handles are kept out of the
+reader's LRU of handles, since the file they follow changes under them.
+*/
+{
+  drf_file_handle * handle = channel->tail_handle;
+
+  if (handle == NULL) {
+    return;
+  }
+  if (handle->index_dataset > 0) {
+    H5Dclose(handle->index_dataset);
+  }
+  if (handle->dataspace > 0) {
+    H5Sclose(handle->dataspace);
+  }
+  if (handle->dataset > 0) {
+    H5Dclose(handle->dataset);
+  }
+  if (handle->file > 0) {
+    H5Fclose(handle->file);
+  }
+  free(handle->index);
+  free(handle->path);
+  free(handle);
+  channel->tail_handle = NULL;
+}
+
+
+int _refresh_tail_handle(drf_file_handle * handle)
+/*
+brings the tail handle up to date with what the writer has flushed: rf_data
+first, then rf_data_index. The writer flushes index rows before the samples
+they describe (see digital_rf_set_swmr), so in this order every row of
+rf_data seen is indexed; rows indexing samples not in rf_data yet are
+clipped by _read_blocks. Rows are only ever appended, so only new ones are
+read.
+
+returns 0 if success, -1 if failure
+*/
+{
+#ifdef DRF_SWMR_READ
+  hid_t fspace, mspace;
+  hsize_t index_dims[2], offset[2] = {0, 0}, count[2];
+
+  if (H5Drefresh(handle->dataset) < 0) {
+    fprintf(stderr, "Unable to refresh rf_data in %s\n", handle->path);
+    return(-1);
+  }
+  H5Sclose(handle->dataspace);
+  handle->dataspace = H5Dget_space(handle->dataset);
+  H5Sget_simple_extent_dims(handle->dataspace, handle->dims, NULL);
+
+  if (H5Drefresh(handle->index_dataset) < 0) {
+    fprintf(stderr, "Unable to refresh rf_data_index in %s\n", handle->path);
+    return(-1);
+  }
+  fspace = H5Dget_space(handle->index_dataset);
+  H5Sget_simple_extent_dims(fspace, index_dims, NULL);
+  if (index_dims[0] <= handle->num_rows) {
+    H5Sclose(fspace);
+    return(0);
+  }
+  if ((handle->index = (uint64_t *)realloc(handle->index, index_dims[0] * 2 * sizeof(uint64_t))) == NULL) {
+    fprintf(stderr, "Realloc failure\n");
+    exit(-22);
+  }
+  offset[0] = handle->num_rows;
+  count[0] = index_dims[0] - handle->num_rows;
+  count[1] = 2;
+  H5Sselect_hyperslab(fspace, H5S_SELECT_SET, offset, NULL, count, NULL);
+  mspace = H5Screate_simple(2, count, NULL);
+  if (H5Dread(handle->index_dataset, H5T_NATIVE_UINT64, mspace, fspace, H5P_DEFAULT,
+      handle->index + 2 * handle->num_rows) < 0) {
+    fprintf(stderr, "Unable to read rf_data_index in %s\n", handle->path);
+    H5Sclose(mspace);
+    H5Sclose(fspace);
+    return(-1);
+  }
+  H5Sclose(mspace);
+  H5Sclose(fspace);
+  handle->num_rows = index_dims[0];
+  return(0);
+#else
+  (void)handle;
+  return(-1);
+#endif
+}
+
+
+drf_file_handle * _open_tail_handle(channel_properties * channel, char * path)
+/*
+opens the tmp.rf@ file at path for Hdf5 SWMR reading as the channel's tail
+handle. Only files written with digital_rf_set_swmr can be opened while the
+writer has them, so a file that cannot be opened is not an error: its
+samples become readable once the writer renames it.
+
+returns the handle, or NULL if the file cannot be followed
+*/
+{
+  _close_tail_handle(channel);
+#ifdef DRF_SWMR_READ
+  drf_file_handle * handle;
+
+  if ((handle = (drf_file_handle *)calloc(1, sizeof(drf_file_handle))) == NULL
+      || (handle->path = strdup(path)) == NULL) {
+    fprintf(stderr, "malloc failure - unrecoverable\n");
+    exit(-1);
+  }
+  handle->channel = channel;
+  handle->num_decode_filters = -1;
+  channel->tail_handle = handle;
+
+  H5E_BEGIN_TRY {
+    handle->file = H5Fopen(path, H5F_ACC_RDONLY | H5F_ACC_SWMR_READ, H5P_DEFAULT);
+    if (handle->file > 0) {
+      handle->dataset = H5Dopen2(handle->file, "rf_data", H5P_DEFAULT);
+      handle->index_dataset = H5Dopen2(handle->file, "rf_data_index", H5P_DEFAULT);
+    }
+  } H5E_END_TRY;
+  if (handle->file <= 0 || handle->dataset <= 0 || handle->index_dataset <= 0
+      || _set_mem_dtype(channel, handle->dataset)) {
+    _close_tail_handle(channel);
+    return(NULL);
+  }
+  handle->dataspace = H5Dget_space(handle->dataset);
+  return(handle);
+#else
+  (void)path;
+  return(NULL);
+#endif
+}
+
+
+int _tail_head(Digital_rf_read_object * drf_read_obj, channel_properties * channel, char * subdir,
+  uint64_t * head)
+/*
+sets head to the last sample written to the channel so far, following its
+newest file even while it is still tmp.rf@ (with channel->tail_handle, if
+the writer lets it be read). Every sample before the window of the newest
+file is final, so a tmp.rf@ file that cannot be read or holds nothing yet
+gives the sample before its window.
+
+subdir must hold SMALL_HDF5_STR chars and is set to the newest subdirectory
+
+returns 0 if success, 1 if nothing has been written yet, -1 if failure
+*/
+{
+  top_level_dir_properties * props = channel->top_level_dir_meta;
+  drf_file_handle * handle;
+  char fname[SMALL_HDF5_STR];
+  char path[BIG_HDF5_STR];
+  uint64_t file_millisec, window_start;
+  uint64_t row;
+  int status;
+
+  if ((status = _find_edge_file(channel, 1, 1, subdir, fname)) != 0) {
+    _close_tail_handle(channel);
+    return(status);
+  }
+  snprintf(path, BIG_HDF5_STR, "%s/%s/%s", channel->channel_dir, subdir, fname);
+  if (strncmp(fname, "tmp.", 4) != 0) {
+    _close_tail_handle(channel);
+    return(_read_edge_sample(drf_read_obj, channel, path, 1, head));
+  }
+
+  file_millisec = digital_rf_get_file_id(fname);
+  if (digital_rf_get_sample_ceil(file_millisec / 1000, (file_millisec % 1000) * 1000000000,
+      props->sample_rate_numerator, props->sample_rate_denominator, &window_start)) {
+    return(-1);
+  }
+  if ((handle = channel->tail_handle) == NULL || strcmp(handle->path, path) != 0) {
+    handle = _open_tail_handle(channel, path);
+  }
+  channel->tail_start_sample = window_start;
+  if (handle != NULL && _refresh_tail_handle(handle)) {
+    return(-1);
+  }
+
+  // the last block runs from the last row rf_data holds to the end of rf_data
+  row = (handle != NULL) ? handle->num_rows : 0;
+  while (row > 0 && handle->index[2 * (row - 1) + 1] >= handle->dims[0]) {
+    row--;
+  }
+  if (row > 0) {
+    *head = handle->index[2 * (row - 1)] + (handle->dims[0] - handle->index[2 * (row - 1) + 1]) - 1;
+    return(0);
+  }
+  if (window_start == 0) {
+    return(1);
+  }
+  *head = window_start - 1;
+  return(0);
+}
+
+
+uint64_t _monotonic_millisecs(void)
+/*
+returns a millisecond clock that only moves forward, for timeouts
+*/
+{
+#ifdef _WIN32
+  return((uint64_t)GetTickCount64());
+#else
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return((uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000);
+#endif
+}
+
+
+void _wait_tail(channel_properties * channel, char * subdir, int millisecs)
+/*
+waits up to millisecs (forever if negative) for the writer to change the
+channel. On Linux, inotify watches the channel directory for new
+subdirectories and its newest subdirectory subdir (NULL if none yet) for
+new, renamed and modified files, which every SWMR flush and every rename
+touches. A watch that was just added may have missed a change made before
+it, so then this returns at once for the caller to look again. Elsewhere,
+or if inotify is unusable, it sleeps 10 ms.
+*/
+{
+#ifdef __linux__
+  char path[BIG_HDF5_STR];
+  char events[4096];
+  struct pollfd pfd;
+  int wd;
+
+  if (channel->tail_notify_fd == -1) {
+    if ((channel->tail_notify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) < 0
+        || inotify_add_watch(channel->tail_notify_fd, channel->channel_dir, IN_CREATE | IN_MOVED_TO) < 0) {
+      if (channel->tail_notify_fd >= 0) {
+        close(channel->tail_notify_fd);
+      }
+      channel->tail_notify_fd = -2;
+    } else {
+      return;
+    }
+  }
+  if (channel->tail_notify_fd >= 0) {
+    wd = channel->tail_subdir_wd;
+    if (subdir != NULL) {
+      snprintf(path, BIG_HDF5_STR, "%s/%s", channel->channel_dir, subdir);
+      wd = inotify_add_watch(channel->tail_notify_fd, path, IN_CREATE | IN_MOVED_TO | IN_MODIFY | IN_CLOSE_WRITE);
+    }
+    if (wd != channel->tail_subdir_wd) {
+      // only the newest subdirectory is written to
+      if (channel->tail_subdir_wd >= 0) {
+        inotify_rm_watch(channel->tail_notify_fd, channel->tail_subdir_wd);
+      }
+      channel->tail_subdir_wd = wd;
+      return;
+    }
+    pfd.fd = channel->tail_notify_fd;
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, (wd >= 0 || (millisecs >= 0 && millisecs < 10)) ? millisecs : 10) > 0) {
+      while (read(channel->tail_notify_fd, events, sizeof(events)) > 0);
+    }
+    return;
+  }
+#else
+  (void)channel;
+  (void)subdir;
+#endif
+  if (millisecs < 0 || millisecs > 10) {
+    millisecs = 10;
+  }
+#ifdef _WIN32
+  Sleep(millisecs);
+#else
+  usleep(millisecs * 1000);
+#endif
+}
+
+
+int64_t digital_rf_read_tail(Digital_rf_read_object * drf_read_obj, char * channel_name,
+  uint64_t start_sample, uint64_t num_samples, void * data, int timeout_millisecs)
+/*
+low-latency counterpart of read_vector for following a channel as it is
+written: reads the samples from start_sample to the last one written so far,
+at most num_samples, into data as read_vector does. Samples in the tmp.rf@
+file the writer still has open are included if it writes with
+digital_rf_set_swmr (otherwise they appear when the file is renamed), so the
+lag behind the writer is one write instead of up to a file cadence.
+
+If nothing at or after start_sample is written yet, waits up to
+timeout_millisecs (forever if negative, not at all if 0) for the writer,
+sleeping on inotify events on Linux and polling every 10 ms elsewhere.
+
+returns the number of samples read into data (gaps among them set to the
+fill value), 0 if nothing new was written before the timeout, or -1 if
+failure. Calling again from start_sample plus the count returned follows
+the channel.
+*/
+{
+  channel_properties * channel;
+  drf_file_handle * tail;
+  char subdir[SMALL_HDF5_STR];
+  uint64_t head, end_sample, finished_end, next_unfilled, deadline = 0, now;
+  int64_t n;
+  int status;
+
+  if (num_samples < 1) {
+    fprintf(stderr, "Number of samples requested must be greater than 0, not %" PRIu64 "\n", num_samples);
+    return(-1);
+  }
+  if (data == NULL) {
+    fprintf(stderr, "Null data buffer passed in\n");
+    return(-1);
+  }
+  if ((channel = _find_channel(drf_read_obj, channel_name)) == NULL) {
+    fprintf(stderr, "No channel found named %s\n", channel_name);
+    return(-1);
+  }
+
+  if (timeout_millisecs > 0) {
+    deadline = _monotonic_millisecs() + (uint64_t)timeout_millisecs;
+  }
+  for (;;) {
+    if ((status = _tail_head(drf_read_obj, channel, subdir, &head)) < 0) {
+      return(-1);
+    }
+    if (status == 0 && head >= start_sample) {
+      break;
+    }
+    if (timeout_millisecs == 0) {
+      return(0);
+    }
+    if (timeout_millisecs > 0) {
+      if ((now = _monotonic_millisecs()) >= deadline) {
+        return(0);
+      }
+      _wait_tail(channel, (status == 0) ? subdir : NULL, (int)(deadline - now));
+    } else {
+      _wait_tail(channel, (status == 0) ? subdir : NULL, -1);
+    }
+  }
+
+  end_sample = (head - start_sample < num_samples - 1) ? head : start_sample + (num_samples - 1);
+  next_unfilled = start_sample;
+  tail = channel->tail_handle;
+
+  // finished files first, then the tmp.rf@ file being followed
+  if (tail == NULL || start_sample < channel->tail_start_sample) {
+    finished_end = (tail != NULL && channel->tail_start_sample - 1 < end_sample)
+      ? channel->tail_start_sample - 1 : end_sample;
+    n = _read_range(drf_read_obj, channel, start_sample, finished_end - start_sample + 1,
+      (char *)data, channel->sample_size);
+    if (n < 0) {
+      return(-1);
+    }
+    if (n > 0) {
+      next_unfilled = finished_end + 1;
+    }
+  }
+  if (tail != NULL && end_sample >= channel->tail_start_sample) {
+    if (_read_blocks(drf_read_obj, channel, tail,
+        (start_sample > channel->tail_start_sample) ? start_sample : channel->tail_start_sample,
+        end_sample, start_sample, (char *)data, channel->sample_size, &next_unfilled) < 0) {
+      return(-1);
+    }
+  }
+  if (next_unfilled <= end_sample) {
+    _fill_samples(channel, (char *)data + (next_unfilled - start_sample) * channel->sample_size,
+      end_sample + 1 - next_unfilled);
+  }
+
+  return((int64_t)(end_sample - start_sample + 1));
+}
+
+
+int digital_rf_locate_sample(Digital_rf_read_object * drf_read_obj, char * channel_name,
+  uint64_t sample, char * path, uint64_t * dataset_index)
+/*
+finds the file and rf_data row holding sample of channel_name with a binary
+search of the channel's mmap'ed sidecar index (see digital_rf_set_sidecar_index),
+without opening any Hdf5 file
+
+path must hold BIG_HDF5_STR chars and is set to the full path of the file,
+and dataset_index to the row of sample in its rf_data.
+
+returns 1 if found, 0 if sample is not in the sidecar index (a gap, or not
+yet indexed), -1 if the channel has no sidecar index or failure
+*/
+{
+  channel_properties * channel;
+  uint64_t * rows;
+  int64_t i;
+
+  if ((channel = _find_channel(drf_read_obj, channel_name)) == NULL) {
+    fprintf(stderr, "No channel found named %s\n", channel_name);
+    return(-1);
+  }
+  if (!_map_sidecar(channel)) {
+    fprintf(stderr, "No sidecar index for channel %s\n", channel_name);
+    return(-1);
+  }
+
+  rows = channel->sidecar_map + 2;
+  i = _sidecar_search(channel, sample);
+  // the block of row i ends at the next row of the same file, or at a gap
+  if (i < 0 || (uint64_t)i + 1 >= channel->sidecar_num_rows || rows[3 * (i + 1) + 1] != rows[3 * i + 1]
+      || sample - rows[3 * i] >= rows[3 * (i + 1) + 2] - rows[3 * i + 2]) {
+    return(0);
+  }
+  if (_get_file_path(channel, rows[3 * i + 1], path)) {
+    return(-1);
+  }
+  *dataset_index = rows[3 * i + 2] + (sample - rows[3 * i]);
+  return(1);
+}
+
+char ** get_file_list(Digital_rf_read_object * drf_read_obj, uint64_t start_sample,
+  uint64_t end_sample, char * channel_name, int * num_files)
+/*
+returns the NULL terminated list of full paths of the files of channel_name
+that could hold samples in [start_sample, end_sample], in time order, without
+scanning the channel directories (see _get_file_list). Files in the list may
+not exist if the data has gaps. num_files is set to the number of paths.
+
+The list must be released with free_file_list.
+
+returns the list, or NULL if failure
+*/
+{
+  channel_properties * channel = _find_channel(drf_read_obj, channel_name);
+
+  if (channel == NULL) {
+    fprintf(stderr, "No channel found named %s\n", channel_name);
+    return(NULL);
+  }
+  return(_get_file_list(channel, start_sample, end_sample, num_files));
+}
+
+
+void free_file_list(char ** file_list)
+/*
+frees a list returned by get_file_list
+*/
+{
+  if (file_list == NULL) {
+    return;
+  }
+  for (int i = 0; file_list[i] != NULL; i++) {
+    free(file_list[i]);
+  }
+  free(file_list);
+}
+
+
+uint64_t _interval_search(drf_interval_set * set, uint64_t value)
+/*
+returns the index of the first range of set whose stop is >= value, or
+set->num_ranges if there is none
+*/
+{
+  uint64_t lo = 0, hi = set->num_ranges, mid;
+
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (set->ranges[2 * mid + 1] < value) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return(lo);
+}
+
+
+void _interval_insert(drf_interval_set * set, uint64_t start, uint64_t stop)
+/*
+adds [start, stop) to set, merging it with every range it overlaps or touches
+*/
+{
+  uint64_t i, j;
+  uint64_t * ranges;
+
+  i = _interval_search(set, start);
+  for (j = i; j < set->num_ranges && set->ranges[2 * j] <= stop; j++) {
+    if (set->ranges[2 * j] < start) {
+      start = set->ranges[2 * j];
+    }
+    if (set->ranges[2 * j + 1] > stop) {
+      stop = set->ranges[2 * j + 1];
+    }
+  }
+
+  // ranges i to j - 1 are replaced by one
+  if (i == j) {
+    if (set->num_ranges == set->capacity) {
+      set->capacity = (set->capacity == 0) ? 64 : 2 * set->capacity;
+      if ((ranges = realloc(set->ranges, set->capacity * 2 * sizeof(uint64_t))) == NULL) {
+        fprintf(stderr, "Realloc failure\n");
+        exit(-22);
+      }
+      set->ranges = ranges;
+    }
+    memmove(set->ranges + 2 * (i + 1), set->ranges + 2 * i, (set->num_ranges - i) * 2 * sizeof(uint64_t));
+    set->num_ranges++;
+  } else if (j > i + 1) {
+    memmove(set->ranges + 2 * (i + 1), set->ranges + 2 * j, (set->num_ranges - j) * 2 * sizeof(uint64_t));
+    set->num_ranges -= j - (i + 1);
+  }
+  set->ranges[2 * i] = start;
+  set->ranges[2 * i + 1] = stop;
+}
+
+
+int _index_file_blocks(Digital_rf_read_object * drf_read_obj, channel_properties * channel, char * path)
+/*
+adds the continuous blocks of one rf file to the channel's blocks, from its
+index and the extent of rf_data; no sample data is read
+
+returns 0 if success, -1 if failure
+*/
+{
+  drf_file_handle * handle;
+  uint64_t stop_index;
+
+  if ((handle = _get_file_handle(drf_read_obj, channel, path, 0)) == NULL) {
+    return(-1);
+  }
+  // block i runs from its row to the next row, the last one to the end of rf_data
+  for (uint64_t i = 0; i < handle->num_rows; i++) {
+    stop_index = (i + 1 < handle->num_rows) ? handle->index[2 * (i + 1) + 1] : handle->dims[0];
+    if (stop_index > handle->index[2 * i + 1]) {
+      _interval_insert(&channel->blocks, handle->index[2 * i],
+        handle->index[2 * i] + (stop_index - handle->index[2 * i + 1]));
+    }
+  }
+  return(0);
+}
+
+
+int64_t get_continuous_blocks(Digital_rf_read_object * drf_read_obj, uint64_t start_sample,
+  uint64_t end_sample, char * channel_name, uint64_t ** blocks)
+/*
+finds the continuous blocks of data of channel_name in [start_sample,
+end_sample], like DigitalRFReader.get_continuous_blocks
+
+blocks is set to a malloc'ed array of (start sample, number of samples) pairs
+in time order, which the caller must free, or NULL if no data is found. Blocks
+that continue across file boundaries are merged, and blocks are clipped to
+the requested range.
+
+Only rf_data_index and the extent of rf_data are read. Blocks are kept on
+the channel in a sorted interval set, and file windows already indexed are
+skipped, so repeated queries over overlapping ranges are answered from
+memory. A missing file is only taken as a gap once a later file exists,
+since the writer may not have reached it yet, and the walk stops after the
+channel's last file, so a range reaching UINT64_MAX ends there. Files removed
+after being indexed are still reported.
+
+returns the number of blocks, or -1 if failure
+*/
+{
+  channel_properties * channel;
+  char path[BIG_HDF5_STR];
+  char last_dir[SMALL_HDF5_STR];
+  char last_file[SMALL_HDF5_STR];
+  char * basename;
+  uint64_t sample, file_start_sample, next_file_start_sample;
+  uint64_t unconfirmed_start = 0, last_file_id = 0;
+  uint64_t i, first, n;
+  int unconfirmed = 0, last_found = 0;
+
+  *blocks = NULL;
+  if (end_sample < start_sample) {
+    fprintf(stderr, "End sample %" PRIu64 " before start sample %" PRIu64 "\n", end_sample, start_sample);
+    return(-1);
+  }
+  if ((channel = _find_channel(drf_read_obj, channel_name)) == NULL) {
+    fprintf(stderr, "No channel found named %s\n", channel_name);
+    return(-1);
+  }
+
+  // index every file window in range that is not already scanned
+  sample = start_sample;
+  while (sample <= end_sample) {
+    i = _interval_search(&channel->scanned, sample + 1);
+    if (i < channel->scanned.num_ranges && channel->scanned.ranges[2 * i] <= sample) {
+      // data was found after the missing windows before this scanned range
+      if (unconfirmed) {
+        _interval_insert(&channel->scanned, unconfirmed_start, sample);
+        unconfirmed = 0;
+      }
+      sample = channel->scanned.ranges[2 * i + 1];
+      continue;
+    }
+    if (_get_file_window(channel, sample, path, &file_start_sample, &next_file_start_sample)) {
+      fprintf(stderr, "Unable to get file name for sample %" PRIu64 "\n", sample);
+      return(-1);
+    }
+    // windows after the last file hold nothing yet, found once for the first window not already scanned
+    if (last_found == 0) {
+      if ((last_found = _find_edge_file(channel, 1, 0, last_dir, last_file)) < 0) {
+        return(-1);
+      }
+      last_found = (last_found == 0) ? 1 : -1;
+      last_file_id = (last_found > 0) ? digital_rf_get_file_id(last_file) : 0;
+    }
+    basename = strrchr(path, '/');
+    if (last_found < 0 || digital_rf_get_file_id(basename ? basename + 1 : path) > last_file_id) {
+      break;
+    }
+    if (access(path, R_OK) == 0) {
+      if (_index_file_blocks(drf_read_obj, channel, path)) {
+        return(-1);
+      }
+      // earlier missing windows are real gaps now that a later file exists
+      _interval_insert(&channel->scanned, unconfirmed ? unconfirmed_start : file_start_sample,
+        next_file_start_sample);
+      unconfirmed = 0;
+    } else if (!unconfirmed) {
+      unconfirmed_start = file_start_sample;
+      unconfirmed = 1;
+    }
+    sample = next_file_start_sample;
+  }
+
+  // blocks are half open, so none holds UINT64_MAX
+  if (start_sample == UINT64_MAX) {
+    return(0);
+  }
+  first = _interval_search(&channel->blocks, start_sample + 1);
+  for (n = 0; first + n < channel->blocks.num_ranges && channel->blocks.ranges[2 * (first + n)] <= end_sample; n++);
+  if (n == 0) {
+    return(0);
+  }
+
+  if ((*blocks = (uint64_t *)malloc(n * 2 * sizeof(uint64_t))) == NULL) {
+    fprintf(stderr, "malloc failure - unrecoverable\n");
+    exit(-1);
+  }
+  for (i = 0; i < n; i++) {
+    uint64_t block_start = channel->blocks.ranges[2 * (first + i)];
+    uint64_t block_stop = channel->blocks.ranges[2 * (first + i) + 1];
+
+    if (block_start < start_sample) {
+      block_start = start_sample;
+    }
+    if (end_sample != UINT64_MAX && block_stop > end_sample + 1) {
+      block_stop = end_sample + 1;
+    }
+    (*blocks)[2 * i] = block_start;
+    (*blocks)[2 * i + 1] = block_stop - block_start;
+  }
+  return((int64_t)n);
+}
+
+
+int digital_rf_set_handle_cache(Digital_rf_read_object * drf_read_obj, int max_handles,
+  uint64_t max_nbytes)
+/*
+sets the budgets of the reader's LRU of open file handles, which is shared by
+all channels: at most max_handles files are kept open, using at most
+max_nbytes of memory for their indices and chunk caches. The defaults are
+DIGITAL_RF_READ_MAX_HANDLES and DIGITAL_RF_READ_MAX_HANDLE_NBYTES. Least
+recently used handles over the new budgets are closed now.
+
+returns 0 if success, -1 if failure
+*/
+{
+  if (max_handles < 1) {
+    fprintf(stderr, "max_handles must be at least 1, not %i\n", max_handles);
+    return(-1);
+  }
+  drf_read_obj->max_handles = max_handles;
+  drf_read_obj->max_handle_nbytes = max_nbytes;
+  _trim_handles(drf_read_obj);
+  return(0);
+}
+
+
+int digital_rf_set_decode_threads(Digital_rf_read_object * drf_read_obj, int num_threads)
+/*
+sets the number of threads the reader decodes compressed and checksummed
+rf_data with. With num_threads > 0, read_vector fetches the raw chunks of
+files written with deflate and/or Fletcher32 with H5Dread_chunk, and the
+threads check the checksums and inflate the chunks, straight into the
+caller's buffer when a chunk is wanted whole. Other files are still decoded
+by Hdf5. num_threads == 0, the default, lets Hdf5 decode every chunk on the
+calling thread.
+
+returns 0 if success, -1 if failure or if threaded decoding is not available
+in this build (it needs zlib, POSIX threads, and Hdf5 1.10.3 or later)
+*/
+{
+  if (num_threads < 0) {
+    fprintf(stderr, "num_threads must not be negative, not %i\n", num_threads);
+    return(-1);
+  }
+#ifdef DRF_DECODE_THREADS
+  drf_decode_pool * pool;
+
+  if (drf_read_obj->decode_pool != NULL) {
+    _free_decode_pool(drf_read_obj->decode_pool);
+    drf_read_obj->decode_pool = NULL;
+  }
+  if (num_threads == 0) {
+    return(0);
+  }
+
+  if ((pool = (drf_decode_pool *)calloc(1, sizeof(drf_decode_pool))) == NULL
+      || (pool->threads = (pthread_t *)malloc(num_threads * sizeof(pthread_t))) == NULL
+      || (pool->tasks = (drf_decode_task *)malloc(4 * num_threads * sizeof(drf_decode_task))) == NULL) {
+    fprintf(stderr, "malloc failure - unrecoverable\n");
+    exit(-1);
+  }
+  pool->capacity = 4 * num_threads;
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->work, NULL);
+  pthread_cond_init(&pool->done, NULL);
+  for (pool->num_threads = 0; pool->num_threads < num_threads; pool->num_threads++) {
+    if (pthread_create(&pool->threads[pool->num_threads], NULL, _decode_worker, pool) != 0) {
+      fprintf(stderr, "Unable to start decode thread %i\n", pool->num_threads);
+      _free_decode_pool(pool);
+      return(-1);
+    }
+  }
+  drf_read_obj->decode_pool = pool;
+  return(0);
+#else
+  if (num_threads > 0) {
+    fprintf(stderr, "Threaded decoding is not available in this build\n");
+    return(-1);
+  }
+  return(0);
+#endif
+}
+
+
+struct digital_rf_read_cursor {
+  Digital_rf_read_object * reader;    // private reader, used only by the prefetch thread once started
+  channel_properties * channel;       // the channel, in reader
+  uint64_t   block_samples;           // samples per block
+  int        num_slots;               // blocks buffered: depth prefetched plus the one held by the caller
+  char **    slots;
+  int64_t *  slot_found;              // samples found in each ready block, -1 if its read failed
+  uint64_t   next_sample;             // first sample of the next block to read
+  int        first;                   // slot of the next block to hand out
+  int        count;                   // blocks ready to hand out
+  int        held;                    // slot held by the caller, -1 if none
+  int        stopped;                 // prefetching ended by a failure or by close
+  int        threaded;                // prefetching on a thread, else each block is read on demand
+#ifndef _WIN32
+  pthread_t  thread;
+  pthread_mutex_t lock;
+  pthread_cond_t changed;             // signaled when a block is ready or a slot is freed
+#endif
+};
+
+
+int64_t _read_cursor_block(Digital_rf_read_cursor * cursor, char * data)
+/*
+reads the cursor's next block into data, setting samples outside the data to
+the fill value, and advises the kernel of the files of the block as far ahead
+as the cursor buffers
+
+returns the number of samples found, or -1 if failure
+*/
+{
+  uint64_t ahead = cursor->next_sample + (cursor->num_slots - 1) * cursor->block_samples;
+  int64_t n;
+
+  _advise_files(cursor->channel, ahead, ahead + (cursor->block_samples - 1));
+  n = _read_range(cursor->reader, cursor->channel, cursor->next_sample, cursor->block_samples, data,
+    cursor->channel->sample_size);
+  if (n == 0) {
+    _fill_samples(cursor->channel, data, cursor->block_samples);
+  }
+  cursor->next_sample += cursor->block_samples;
+  return(n);
+}
+
+
+#ifndef _WIN32
+void * _cursor_prefetch(void * arg)
+/*
+cursor thread: reads blocks into free slots until a read fails or the cursor
+is closed
+*/
+{
+  Digital_rf_read_cursor * cursor = (Digital_rf_read_cursor *)arg;
+  int64_t n;
+  int slot;
+
+  pthread_mutex_lock(&cursor->lock);
+  while (!cursor->stopped) {
+    if (cursor->count + (cursor->held >= 0) >= cursor->num_slots) {
+      pthread_cond_wait(&cursor->changed, &cursor->lock);
+      continue;
+    }
+    slot = (cursor->first + cursor->count) % cursor->num_slots;
+    pthread_mutex_unlock(&cursor->lock);
+
+    n = _read_cursor_block(cursor, cursor->slots[slot]);
+
+    pthread_mutex_lock(&cursor->lock);
+    cursor->slot_found[slot] = n;
+    cursor->count++;
+    if (n < 0) {
+      cursor->stopped = 1;
+    }
+    pthread_cond_broadcast(&cursor->changed);
+  }
+  pthread_mutex_unlock(&cursor->lock);
+  return(NULL);
+}
+#endif
+
+
+Digital_rf_read_cursor * digital_rf_open_read_cursor(Digital_rf_read_object * drf_read_obj,
+  char * channel_name, uint64_t start_sample, uint64_t block_samples, int depth)
+/*
+opens a cursor streaming channel_name from start_sample onwards, block_samples
+samples at a time (see digital_rf_read_cursor_next). While the caller works
+on one block, a thread reads and decodes the next depth blocks, across file
+boundaries, and advises the kernel of the files after them.
+
+The cursor reads through a reader of its own over the same directory, with
+the same chunk cache size and decode threads, so drf_read_obj stays free for
+the caller. Without thread-safe Hdf5 (or on Windows) the cursor reads each
+block when it is asked for.
+
+returns the cursor, or NULL if failure
+*/
+{
+  Digital_rf_read_cursor * cursor;
+  hbool_t threadsafe = 0;
+
+  if (block_samples < 1 || depth < 1) {
+    fprintf(stderr, "block_samples and depth must be at least 1\n");
+    return(NULL);
+  }
+  if (_find_channel(drf_read_obj, channel_name) == NULL) {
+    fprintf(stderr, "No channel found named %s\n", channel_name);
+    return(NULL);
+  }
+  if ((cursor = (Digital_rf_read_cursor *)calloc(1, sizeof(Digital_rf_read_cursor))) == NULL
+      || (cursor->slots = (char **)calloc(depth + 1, sizeof(char *))) == NULL
+      || (cursor->slot_found = (int64_t *)calloc(depth + 1, sizeof(int64_t))) == NULL) {
+    fprintf(stderr, "malloc failure - unrecoverable\n");
+    exit(-1);
+  }
+  cursor->reader = digital_rf_create_read_hdf5(drf_read_obj->top_level_directory, drf_read_obj->rdcc_nbytes);
+#ifdef DRF_DECODE_THREADS
+  if (cursor->reader != NULL && drf_read_obj->decode_pool != NULL) {
+    digital_rf_set_decode_threads(cursor->reader, drf_read_obj->decode_pool->num_threads);
+  }
+#endif
+  if (cursor->reader != NULL) {
+    cursor->channel = _find_channel(cursor->reader, channel_name);
+  }
+  if (cursor->channel == NULL) {
+    fprintf(stderr, "Could not open channel %s for the cursor\n", channel_name);
+    digital_rf_close_read_hdf5(cursor->reader);
+    free(cursor->slot_found);
+    free(cursor->slots);
+    free(cursor);
+    return(NULL);
+  }
+  cursor->block_samples = block_samples;
+  cursor->next_sample = start_sample;
+  cursor->held = -1;
+  cursor->num_slots = 1;
+
+#ifndef _WIN32
+  H5is_library_threadsafe(&threadsafe);
+#endif
+  if (threadsafe) {
+    cursor->num_slots = depth + 1;
+  }
+  for (int i = 0; i < cursor->num_slots; i++) {
+    if ((cursor->slots[i] = (char *)malloc(block_samples * cursor->channel->sample_size)) == NULL) {
+      fprintf(stderr, "malloc failure - unrecoverable\n");
+      exit(-1);
+    }
+  }
+
+#ifndef _WIN32
+  if (threadsafe) {
+    pthread_mutex_init(&cursor->lock, NULL);
+    pthread_cond_init(&cursor->changed, NULL);
+    _advise_files(cursor->channel, start_sample, start_sample + (depth * block_samples - 1));
+    if (pthread_create(&cursor->thread, NULL, _cursor_prefetch, cursor) == 0) {
+      cursor->threaded = 1;
+    } else {
+      pthread_mutex_destroy(&cursor->lock);
+      pthread_cond_destroy(&cursor->changed);
+    }
+  }
+#endif
+  return(cursor);
+}
+
+
+int64_t digital_rf_read_cursor_next(Digital_rf_read_cursor * cursor, void ** data)
+/*
+sets *data to the cursor's next block of block_samples samples, laid out as
+read_vector would, and moves the cursor past it. Samples missing from the
+data, including whole blocks beyond it, are set to the fill value. *data is
+owned by the cursor and only valid until the next call.
+
+returns the number of samples found in the block, or -1 if failure, after
+which the cursor can only be closed
+*/
+{
+  int64_t n;
+
+  if (!cursor->threaded) {
+    if (cursor->stopped) {
+      return(-1);
+    }
+    n = _read_cursor_block(cursor, cursor->slots[0]);
+    cursor->stopped = (n < 0);
+    *data = cursor->slots[0];
+    return(n);
+  }
+
+#ifndef _WIN32
+  pthread_mutex_lock(&cursor->lock);
+  // the block handed out last time is done with
+  if (cursor->held >= 0) {
+    cursor->held = -1;
+    pthread_cond_broadcast(&cursor->changed);
+  }
+  while (cursor->count == 0 && !cursor->stopped) {
+    pthread_cond_wait(&cursor->changed, &cursor->lock);
+  }
+  if (cursor->count == 0) {
+    pthread_mutex_unlock(&cursor->lock);
+    return(-1);
+  }
+  cursor->held = cursor->first;
+  cursor->first = (cursor->first + 1) % cursor->num_slots;
+  cursor->count--;
+  n = cursor->slot_found[cursor->held];
+  *data = cursor->slots[cursor->held];
+  pthread_mutex_unlock(&cursor->lock);
+  return(n);
+#else
+  return(-1);
+#endif
+}
+
+
+void digital_rf_close_read_cursor(Digital_rf_read_cursor * cursor)
+/*
+stops the cursor's prefetching and frees it, with its reader and blocks
+*/
+{
+#ifndef _WIN32
+  if (cursor->threaded) {
+    pthread_mutex_lock(&cursor->lock);
+    cursor->stopped = 1;
+    pthread_cond_broadcast(&cursor->changed);
+    pthread_mutex_unlock(&cursor->lock);
+    pthread_join(cursor->thread, NULL);
+    pthread_mutex_destroy(&cursor->lock);
+    pthread_cond_destroy(&cursor->changed);
+  }
+#endif
+  for (int i = 0; i < cursor->num_slots; i++) {
+    free(cursor->slots[i]);
+  }
+  free(cursor->slots);
+  free(cursor->slot_found);
+  digital_rf_close_read_hdf5(cursor->reader);
+  free(cursor);
+}
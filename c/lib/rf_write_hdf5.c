@@ -17,10 +17,18 @@
   $Id$
 */
 
+/* O_DIRECT, see digital_rf_set_direct_io */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#  define _GNU_SOURCE
+#endif
+
 #ifdef _WIN32
 #  include "wincompat.h"
 #else
 #  include <unistd.h>
+#  include <pthread.h>
+#  include <fcntl.h>
+#  include <dirent.h>
 #endif
 
 #include <stdio.h>
@@ -34,6 +42,169 @@
 #include "digital_rf.h"
 #include "hdf5.h"
 
+/* rf_data chunks are compressed and checksummed on threads of the writer when zlib and direct chunk writes are
+ * available, see digital_rf_set_compress_threads */
+#if !defined(_WIN32) && defined(DIGITAL_RF_HAVE_ZLIB) && H5_VERSION_GE(1, 10, 3)
+#  define DRF_ENCODE_THREADS
+#  include <zlib.h>
+#endif
+
+/* bytes the core driver of digital_rf_set_memory_files grows a file by: one step holds the whole file */
+#define DRF_MEMORY_FILE_INCREMENT(obj, file) ((size_t)((file)->max_samples_this_file * (obj)->sample_size) + 64 * 1024)
+
+/* contiguous rf_data is written around Hdf5 with aligned writes where the system has O_DIRECT,
+ * see digital_rf_set_direct_io */
+#if !defined(_WIN32) && defined(O_DIRECT)
+#  define DRF_DIRECT_IO
+/* bytes staged for each aligned write */
+#  define DRF_DIRECT_IO_BLOCK (1024 * 1024)
+
+struct drf_direct_io {
+	size_t     alignment;               /* of the file offsets, lengths and memory of O_DIRECT writes */
+	int        fd;                      /* second descriptor of the open file, -1 if /rf_data is written by Hdf5 */
+	int        direct;                  /* 1 if fd has O_DIRECT, 0 if refused or /rf_data is not aligned */
+	uint64_t   next_row;                /* rows of /rf_data before this are staged or written */
+	uint64_t   file_rows;               /* rows of /rf_data in the open file */
+	unsigned char * stage;              /* aligned buffer of stage_size bytes collecting rows */
+	size_t     stage_size;
+	size_t     stage_used;              /* bytes in stage */
+	uint64_t   stage_offset;            /* file offset stage[0] goes to */
+	unsigned char * fill;               /* one sample of fill values, all subchannels */
+};
+#endif
+
+#ifndef _WIN32
+/* one queued write of the async writer, see digital_rf_set_async */
+typedef struct drf_async_buffer {
+	uint64_t * global_index_arr;        /* index arrays of the write, as passed to digital_rf_write_blocks_hdf5 */
+	uint64_t * data_index_arr;
+	uint64_t   index_len;
+	uint64_t   index_capacity;          /* number of entries the index arrays can hold */
+	char *     vector;                  /* copy of the samples, buffer_samples long */
+	uint64_t   vector_length;
+} drf_async_buffer;
+
+struct drf_async_writer {
+	pthread_t  thread;                  /* writer thread draining the ring */
+	pthread_mutex_t lock;               /* guards everything below */
+	pthread_cond_t not_empty;           /* signalled when a buffer is queued or the thread must stop */
+	pthread_cond_t not_full;            /* signalled when the thread is done with a buffer */
+	drf_async_buffer * buffers;         /* ring of num_buffers preallocated buffers */
+	int        num_buffers;
+	uint64_t   buffer_samples;          /* samples each buffer holds */
+	uint64_t   sample_size;             /* bytes in one sample of the vector */
+	int        block;                   /* 1 if a write waits for a free buffer, 0 if it is dropped */
+	int        head;                    /* next buffer to fill */
+	int        count;                   /* queued buffers, including the one being written */
+	int        stop;                    /* set by digital_rf_end_async to end the thread */
+	int        error;                   /* result of the first failed write, 0 if none */
+	uint64_t   next_global_index;       /* global index just past the last write queued, kept by the caller */
+	uint64_t   stalls;                  /* writes that waited for a free buffer */
+	uint64_t   overflows;               /* writes dropped because the ring was full */
+	uint64_t   samples_dropped;         /* samples in those writes */
+	int        max_queued;              /* most buffers ever queued at once */
+	struct digital_rf_write_hub * hub;  /* hub whose threads write the ring instead of thread, NULL if none */
+	int        writing;                 /* 1 while a hub thread (then in thread) writes the ring */
+};
+
+/* states of the file a drf_precreate thread works on */
+#define DRF_PRECREATE_IDLE 0                /* nothing requested */
+#define DRF_PRECREATE_REQUESTED 1           /* file describes the next file, not yet started */
+#define DRF_PRECREATE_BUSY 2                /* the thread is preparing file */
+#define DRF_PRECREATE_READY 3               /* file is open on disk under its "next." name */
+
+/* thread preparing the file after the open one, see digital_rf_set_precreate */
+struct drf_precreate {
+	pthread_t  thread;
+	pthread_mutex_t lock;               /* guards everything below */
+	pthread_cond_t changed;             /* signalled whenever state or stop changes */
+	drf_prepared_file file;             /* the next file */
+	int        state;                   /* one of DRF_PRECREATE_* */
+	int        stop;                    /* set by digital_rf_end_precreate to end the thread */
+	struct digital_rf_write_hub * hub;  /* hub whose threads prepare files instead of thread, NULL if none */
+};
+
+/* one channel of a writer hub */
+typedef struct drf_hub_channel {
+	Digital_rf_write_object * obj;
+	int        busy;                    /* 1 while a hub thread writes to obj or prepares its next file */
+} drf_hub_channel;
+
+/* I/O threads shared by many channel writers, see digital_rf_create_write_hub */
+struct digital_rf_write_hub {
+	pthread_t * threads;
+	int        num_threads;
+	int        precreate;               /* 1 if the threads prepare each channel's next file when idle */
+	pthread_mutex_t lock;               /* guards everything below */
+	pthread_cond_t work;                /* signalled when there may be something for a thread to do, or on stop */
+	pthread_cond_t idle;                /* signalled when a channel stops being busy */
+	drf_hub_channel * channels;
+	int        num_channels;
+	int        channel_capacity;        /* number of channels the array can hold */
+	int        queued;                  /* buffers queued across all channels and not yet written */
+	int        max_queued;              /* most buffers ever queued at once */
+	uint64_t   bytes_written;           /* bytes of samples written by the threads */
+	struct timespec start;              /* when the hub was created, for bytes_per_sec */
+	int        stop;                    /* set by digital_rf_close_write_hub to end the threads */
+};
+#endif
+
+#ifdef DRF_ENCODE_THREADS
+/* states of a drf_chunk_job */
+#define DRF_CHUNK_FREE 0                    /* unused, or being filled by the writer */
+#define DRF_CHUNK_QUEUED 1                  /* raw is full, waiting for a thread */
+#define DRF_CHUNK_WORKING 2                 /* a thread is encoding raw */
+#define DRF_CHUNK_DONE 3                    /* data is ready to be committed */
+
+/* one rf_data chunk on its way to the file */
+typedef struct drf_chunk_job {
+	unsigned char * raw;                /* chunk_size samples as written, with room for a checksum */
+	unsigned char * out;                /* compressed chunk, with room for a checksum */
+	unsigned char * data;               /* raw or out, whichever holds the encoded chunk */
+	size_t     data_size;               /* bytes in the encoded chunk */
+	hsize_t    offset[2];               /* position of the chunk in rf_data */
+	int        state;                   /* one of DRF_CHUNK_* */
+	int        error;                   /* 1 if zlib failed on the chunk */
+} drf_chunk_job;
+
+/* threads encoding rf_data chunks for H5Dwrite_chunk, see digital_rf_set_compress_threads */
+struct drf_chunk_pool {
+	pthread_t * threads;
+	int        num_threads;
+	pthread_mutex_t lock;               /* guards the states of the jobs, next_work and stop */
+	pthread_cond_t work;                /* signalled when a job is queued or the threads must stop */
+	pthread_cond_t done;                /* signalled when a job is encoded */
+	drf_chunk_job * jobs;               /* ring of num_jobs chunks, committed in order */
+	int        num_jobs;
+	int        head;                    /* job being filled by the writer */
+	int        tail;                    /* oldest job not yet committed */
+	int        pending;                 /* jobs queued and not yet committed */
+	int        next_work;               /* next job for a thread to take */
+	uint64_t   stage_rows;              /* samples in the job being filled */
+	size_t     chunk_bytes;             /* bytes in a chunk before encoding, 0 until the first write */
+	size_t     out_capacity;            /* bytes out can hold */
+	int        compression_level;       /* gzip level, 0 if chunks are only checksummed */
+	int        checksum;                /* 1 if chunks get a Fletcher32 checksum */
+	unsigned char * fill;               /* one sample of fill values, padding the last chunk of a file */
+	int        stop;                    /* set by digital_rf_end_chunk_pool to end the threads */
+};
+#endif
+
+/* image of an empty file, see digital_rf_set_file_template */
+struct drf_file_template {
+	uint64_t   max_samples_this_file;   /* maximum size of rf_data in files made from image */
+	void *     image;                   /* the closed file as written by the core driver */
+	size_t     image_size;
+	struct drf_file_template * next;    /* image for another maximum size, NULL if none */
+};
+
+/* the buffer of the core driver building a template, kept when the file closes, see digital_rf_get_file_template */
+struct drf_template_buffer {
+	void *     image;                   /* the core driver's buffer, holding the closed file once closed is 1 */
+	size_t     image_size;              /* bytes in image */
+	int        closed;                  /* 1 once the driver has let go of image as the file closed */
+};
+
 
 /* Public method implementations */
 const char * digital_rf_get_version(void)
@@ -114,10 +285,51 @@ Digital_rf_write_object * digital_rf_create_write_hdf5(char * directory, hid_t d
 	hdf5_data_object->dataspace = 0;
 	hdf5_data_object->filespace = 0;
 	hdf5_data_object->memspace = 0;
+	hdf5_data_object->memspace_samples = 0;
 	hdf5_data_object->hdf5_file = 0; /* indicates no Hdf5 file presently opened */
 	hdf5_data_object->index_dataset = 0;
 	hdf5_data_object->index_prop = 0;
 	hdf5_data_object->next_index_avail = 0;
+	hdf5_data_object->index_filespace = 0;
+	hdf5_data_object->index_memspace = 0;
+	hdf5_data_object->index_memspace_rows = 0;
+	hdf5_data_object->index_scratch = NULL;
+	hdf5_data_object->index_scratch_rows = 0;
+	hdf5_data_object->deferred_index = 0;
+	hdf5_data_object->index_flush_secs = 0;
+	hdf5_data_object->pending_index = NULL;
+	hdf5_data_object->pending_index_rows = 0;
+	hdf5_data_object->pending_index_capacity = 0;
+	hdf5_data_object->last_index_flush = 0;
+	hdf5_data_object->sidecar_index = 0;
+	hdf5_data_object->sidecar_rows = NULL;
+	hdf5_data_object->sidecar_num_rows = 0;
+	hdf5_data_object->sidecar_capacity = 0;
+	hdf5_data_object->sidecar_file_id = 0;
+	hdf5_data_object->swmr = 0;
+	hdf5_data_object->async = NULL;
+	hdf5_data_object->precreate = NULL;
+	hdf5_data_object->file_template = 0;
+	hdf5_data_object->file_templates = NULL;
+	hdf5_data_object->compression_level = 0;
+	hdf5_data_object->codec = DIGITAL_RF_CODEC_NONE;
+	hdf5_data_object->checksum = 0;
+	hdf5_data_object->chunk_pool = NULL;
+	hdf5_data_object->file_alignment = 0;
+	hdf5_data_object->direct_io = NULL;
+	hdf5_data_object->memory_files = 0;
+	hdf5_data_object->memory_preallocate = 0;
+	hdf5_data_object->memory_image = NULL;
+	hdf5_data_object->memory_image_capacity = 0;
+	hdf5_data_object->staging = 0;
+	hdf5_data_object->staging_fp = NULL;
+	hdf5_data_object->staging_name[0] = '\0';
+	hdf5_data_object->staging_end = 0;
+	hdf5_data_object->staging_samples = 0;
+	hdf5_data_object->staging_rows = NULL;
+	hdf5_data_object->staging_num_rows = 0;
+	hdf5_data_object->staging_capacity = 0;
+	hdf5_data_object->packed_staging[0] = '\0';
 
 	/* strip any trailing slash from directory (or else stat fails on windows) */
 	if (directory[strlen(directory) - 1] == '/' || directory[strlen(directory) - 1] == '\\')
@@ -152,6 +364,9 @@ Digital_rf_write_object * digital_rf_create_write_hdf5(char * directory, hid_t d
 		digital_rf_close_write_hdf5(hdf5_data_object);
 		return(NULL);
 	}
+	hdf5_data_object->compression_level = compression_level;
+	hdf5_data_object->codec = compression_level ? DIGITAL_RF_CODEC_DEFLATE : DIGITAL_RF_CODEC_NONE;
+	hdf5_data_object->checksum = checksum ? 1 : 0;
 
 	if (num_subchannels < 1)
 	{
@@ -220,6 +435,8 @@ Digital_rf_write_object * digital_rf_create_write_hdf5(char * directory, hid_t d
 		hdf5_data_object->is_complex = 0;
 		hdf5_data_object->complex_dtype_id = (hid_t)0; /* make sure its not used by accident */
 	}
+	hdf5_data_object->sample_size = H5Tget_size(hdf5_data_object->dtype_id) * (hdf5_data_object->is_complex ? 2 : 1)
+			* hdf5_data_object->num_subchannels;
 
 	/* check for illegal values */
 	if (hdf5_data_object->sample_rate <= 0.0)
@@ -240,6 +457,10 @@ Digital_rf_write_object * digital_rf_create_write_hdf5(char * directory, hid_t d
 	if (checksum)
 		H5Pset_filter (hdf5_data_object->dataset_prop, H5Z_FILTER_FLETCHER32, 0, 0, NULL);
 	hdf5_data_object->chunk_size = 0;
+	hdf5_data_object->chunk_shape = 0;
+	hdf5_data_object->chunk_samples = DIGITAL_RF_CHUNK_AUTO;
+	hdf5_data_object->chunk_subchannels = hdf5_data_object->num_subchannels;
+	hdf5_data_object->chunk_target_nbytes = DIGITAL_RF_CHUNK_TARGET_NBYTES;
 	if (checksum || compression_level != 0 || is_continuous != 1)
 		hdf5_data_object->needs_chunking = 1;
 	else
@@ -295,7 +516,8 @@ int digital_rf_write_hdf5(Digital_rf_write_object *hdf5_data_object, uint64_t gl
 	uint64_t index_len = 1;
 	int result;
 
-	if (hdf5_data_object->has_failure)
+	/* in async mode the writer thread reports failures */
+	if (hdf5_data_object->async == NULL && hdf5_data_object->has_failure)
 	{
 		fprintf(stderr, "A previous fatal io error precludes any further calls to digital_rf_write_hdf5.\n");
 		return(-1);
@@ -327,9 +549,10 @@ int digital_rf_write_blocks_hdf5(Digital_rf_write_object *hdf5_data_object, uint
  * 		uint64_t vector_length - number of samples to write to Hdf5
  *
  * 	Affects - Writes data to existing open Hdf5 file.  May close that file and write some or all of remaining data to
- * 		new Hdf5 file.
+ * 		new Hdf5 file.  In async mode (see digital_rf_set_async) the data is only copied for the writer thread.
  *
- * 	Returns 0 if success, non-zero and error written if failure.
+ * 	Returns 0 if success, non-zero and error written if failure.  In async mode, returns -7 if the ring of
+ * 	buffers is full and the write was dropped, or the error of an earlier write that failed on the writer thread.
  *
  */
 {
@@ -339,6 +562,13 @@ int digital_rf_write_blocks_hdf5(Digital_rf_write_object *hdf5_data_object, uint
 	hsize_t chunk_dims[2] = {0, hdf5_data_object->num_subchannels};
 	hsize_t chunk_size = 0;
 
+#ifndef _WIN32
+	/* in async mode samples are queued for the writer thread, which comes back here to write them */
+	if (hdf5_data_object->async != NULL && !digital_rf_is_async_writer(hdf5_data_object))
+		return(digital_rf_queue_async_write(hdf5_data_object, global_index_arr, data_index_arr, index_len,
+				vector, vector_length));
+#endif
+
 	if (hdf5_data_object->has_failure)
 	{
 		fprintf(stderr, "A previous fatal io error precludes any further calls to digital_rf_write_blocks_hdf5.\n");
@@ -365,17 +595,20 @@ int digital_rf_write_blocks_hdf5(Digital_rf_write_object *hdf5_data_object, uint
 	/* set chunking if needed */
 	if (hdf5_data_object->needs_chunking && !hdf5_data_object->chunk_size)
 	{
-		if (vector_length*10 < hdf5_data_object->max_chunk_size)
-			chunk_size = vector_length*10;
-		else if (vector_length < hdf5_data_object->max_chunk_size)
-			chunk_size = vector_length;
-		else
-			chunk_size = hdf5_data_object->max_chunk_size;
+		chunk_size = digital_rf_choose_chunk_size(hdf5_data_object, vector_length);
 		hdf5_data_object->chunk_size = chunk_size;
 		chunk_dims[0] = chunk_size;
+		chunk_dims[1] = hdf5_data_object->chunk_subchannels;
 		H5Pset_chunk (hdf5_data_object->dataset_prop, hdf5_data_object->rank, chunk_dims);
 	}
 
+	/* contiguous /rf_data written by digital_rf_direct_write takes its space as each file is created, unfilled */
+	if (hdf5_data_object->direct_io != NULL && !hdf5_data_object->needs_chunking && hdf5_data_object->present_seq == -1)
+	{
+		H5Pset_alloc_time (hdf5_data_object->dataset_prop, H5D_ALLOC_TIME_EARLY);
+		H5Pset_fill_time (hdf5_data_object->dataset_prop, H5D_FILL_TIME_NEVER);
+	}
+
 	/* verify continuous if is_continuous */
 	if (hdf5_data_object->is_continuous && index_len > 1)
 	{
@@ -384,6 +617,13 @@ int digital_rf_write_blocks_hdf5(Digital_rf_write_object *hdf5_data_object, uint
 		return(-4);
 	}
 
+#ifndef _WIN32
+	/* in staging mode samples are appended to raw files, packed into Hdf5 files by digital_rf_pack_staging */
+	if (hdf5_data_object->staging)
+		return(digital_rf_write_staging(hdf5_data_object, global_index_arr, data_index_arr, index_len,
+				vector, vector_length));
+#endif
+
 	/* loop until all data written - this loop breaks multiple file writes into a series single file writes*/
 	while (samples_written < vector_length)
 	{
@@ -401,1998 +641,5486 @@ int digital_rf_write_blocks_hdf5(Digital_rf_write_object *hdf5_data_object, uint
 	return(0);
 }
 
-char * digital_rf_get_last_file_written(Digital_rf_write_object *hdf5_data_object)
-/* digital_rf_get_last_file_written returns a malloced string containing the full path to the last hdf5 file written to
+int digital_rf_set_sidecar_index(Digital_rf_write_object *hdf5_data_object, int enable)
+/* digital_rf_set_sidecar_index turns on or off the per-channel sidecar index DIGITAL_RF_SIDECAR_INDEX
  *
  * Inputs:
  * 		Digital_rf_write_object *hdf5_data_object - C struct created by digital_rf_create_write_hdf5
+ * 		int enable - 1 to append the rf_data_index rows of every file to the sidecar index as the file
+ * 			is finalized, 0 (the default) to not
  *
- * 	Returns:
- * 		char * containing the full path to the last hdf5 file written to. User is responsible for freeing string when done.
- * 		Returns empty string if no data written.
+ * 	The sidecar index is an append-only binary file in the channel directory (format described in
+ * 	digital_rf.h) that readers can mmap to locate any sample without opening Hdf5 files.  Must be
+ * 	called before the first write.
+ *
+ * 	Returns 0 if success, -1 if failure
  */
 {
-	/* local variables */
-	char fullpath[BIG_HDF5_STR] = ""; 	/* to be set to the full path */
-	char * ret_str;  /* string to be malloced */
-
-	if (hdf5_data_object->sub_directory == NULL)
+	if (hdf5_data_object->present_seq != -1)
 	{
-		/* no data written yet */
-		if ((ret_str = (char *)malloc(sizeof(char) * (2)))==0)
-		{
-			fprintf(stderr, "malloc failure - unrecoverable\n");
-			exit(-1);
-		}
-		strcpy(ret_str, "");
-		return(ret_str);
+		fprintf(stderr, "digital_rf_set_sidecar_index must be called before the first write\n");
+		return(-1);
 	}
+	hdf5_data_object->sidecar_index = enable ? 1 : 0;
+	return(0);
+}
 
-	strcpy(fullpath, hdf5_data_object->directory);
-	strcat(fullpath, "/");
-	strcat(fullpath, hdf5_data_object->sub_directory);
-	strcat(fullpath, "/");
-	strcat(fullpath, strstr(hdf5_data_object->basename, "rf"));
-	if ((ret_str = (char *)malloc(sizeof(char) * (strlen(fullpath)+2)))==0)
+int digital_rf_set_swmr(Digital_rf_write_object *hdf5_data_object, int enable)
+/* digital_rf_set_swmr turns on or off single-writer/multiple-reader (SWMR) writing of each tmp.rf@ file
+ *
+ * Inputs:
+ * 		Digital_rf_write_object *hdf5_data_object - C struct created by digital_rf_create_write_hdf5
+ * 		int enable - 1 to write each file in Hdf5 SWMR mode, 0 (the default) to not
+ *
+ * 	With SWMR on, every file is created with the latest Hdf5 file format (readable by Hdf5 1.10 or
+ * 	later only), rf_data is always chunked, and both datasets are flushed after every write, so a
+ * 	reader can follow samples in the open tmp.rf@ file before it is renamed (see digital_rf_read_tail).
+ * 	rf_data_index rows are flushed before the samples they describe.  Turning SWMR off again
+ * 	restores the contiguous rf_data an uncompressed continuous channel would otherwise get.
+ * 	Must be called before the first write.
+ *
+ * 	Returns 0 if success, -1 if failure
+ */
+{
+	if (hdf5_data_object->present_seq != -1)
 	{
-		fprintf(stderr, "malloc failure - unrecoverable\n");
-		exit(-1);
+		fprintf(stderr, "digital_rf_set_swmr must be called before the first write\n");
+		return(-1);
 	}
-	strcpy(ret_str, fullpath);
-	return(ret_str);
+	if (enable && hdf5_data_object->chunk_pool != NULL)
+	{
+		fprintf(stderr, "digital_rf_set_swmr can not be used with digital_rf_set_compress_threads\n");
+		return(-1);
+	}
+	if (enable && hdf5_data_object->memory_files)
+	{
+		fprintf(stderr, "digital_rf_set_swmr can not be used with digital_rf_set_memory_files\n");
+		return(-1);
+	}
+#if H5_VERSION_GE(1, 10, 0)
+	hdf5_data_object->swmr = enable ? 1 : 0;
+	/* readers can only follow an extensible rf_data; turning SWMR back off returns to
+	 * whatever layout the codec, checksum, continuity and chunk shape call for */
+	hdf5_data_object->needs_chunking = (hdf5_data_object->codec != DIGITAL_RF_CODEC_NONE
+										|| hdf5_data_object->checksum || hdf5_data_object->is_continuous != 1
+										|| hdf5_data_object->swmr || hdf5_data_object->chunk_shape);
+	return(0);
+#else
+	if (!enable)
+		return(0);
+	fprintf(stderr, "digital_rf_set_swmr needs Hdf5 1.10 or later\n");
+	return(-1);
+#endif
 }
 
 
-char * digital_rf_get_last_dir_written(Digital_rf_write_object *hdf5_data_object)
-/* digital_rf_get_last_dir_written returns a malloced string containing the full path to the last dir written to
+int digital_rf_set_async(Digital_rf_write_object *hdf5_data_object, int num_buffers, uint64_t buffer_samples, int block)
+/* digital_rf_set_async moves all file writing of hdf5_data_object to a writer thread of its own
  *
  * Inputs:
  * 		Digital_rf_write_object *hdf5_data_object - C struct created by digital_rf_create_write_hdf5
+ * 		int num_buffers - number of buffers in the ring between the caller and the writer thread, 2 or more
+ * 			to let the caller fill one while another is written
+ * 		uint64_t buffer_samples - number of samples each buffer holds.  Longer writes are split across buffers.
+ * 		int block - 1 to make a write wait for free buffers when the ring is full (backpressure), 0 to drop
+ * 			it whole and return -7 instead, counting it in digital_rf_get_async_stats.  A write is either
+ * 			queued whole or not at all, so without blocking one longer than num_buffers * buffer_samples
+ * 			is always dropped.
  *
- * 	Returns:
- * 		char * containing the full path to the last directory written to. User is responsible for freeing string when done.
- * 		Returns empty string if no data written.
+ * 	All buffers are allocated here, so digital_rf_write_hdf5 and digital_rf_write_blocks_hdf5 only copy
+ * 	samples into the ring while H5Dwrite, file creation and renames happen on the writer thread.  A write
+ * 	before the next expected index or with illegal indices is refused as it is queued, returning what it
+ * 	would without a writer thread, and writing goes on.  What fails on the writer thread can only be writing
+ * 	the files, which is fatal as it is without one: the rest of the queue is discarded, and the error is
+ * 	returned by every later write, digital_rf_flush_async and digital_rf_close_write_hdf5.  Only
+ * 	the writer thread calls Hdf5 for this object, so a caller that uses Hdf5 itself in the meantime needs a
+ * 	thread-safe Hdf5 build.  Must be called before the first write.  Not available on Windows.
+ *
+ * 	Returns 0 if success, -1 if failure
  */
 {
-	/* local variables */
-	char fullpath[BIG_HDF5_STR] = ""; 	/* to be set to the full path */
-	char * ret_str;  /* string to be malloced */
+#ifndef _WIN32
+	struct drf_async_writer * async;
 
-	if (hdf5_data_object->sub_directory == NULL)
+	if (hdf5_data_object->present_seq != -1 || hdf5_data_object->async != NULL)
 	{
-		/* no data written yet */
-		if ((ret_str = (char *)malloc(sizeof(char) * (2)))==0)
-		{
-			fprintf(stderr, "malloc failure - unrecoverable\n");
-			exit(-1);
-		}
-		strcpy(ret_str, "");
-		return(ret_str);
+		fprintf(stderr, "digital_rf_set_async must be called once before the first write\n");
+		return(-1);
 	}
+	if ((async = digital_rf_alloc_async(hdf5_data_object, num_buffers, buffer_samples, block)) == NULL)
+		return(-1);
 
-	strcpy(fullpath, hdf5_data_object->directory);
-	strcat(fullpath, "/");
-	strcat(fullpath, hdf5_data_object->sub_directory);
-	strcat(fullpath, "/");
-	if ((ret_str = (char *)malloc(sizeof(char) * (strlen(fullpath)+2)))==0)
+	hdf5_data_object->async = async;
+	if (pthread_create(&async->thread, NULL, digital_rf_async_writer_thread, hdf5_data_object))
 	{
-		fprintf(stderr, "malloc failure - unrecoverable\n");
-		exit(-1);
+		fprintf(stderr, "Unable to start the writer thread\n");
+		hdf5_data_object->async = NULL;
+		digital_rf_free_async(async);
+		return(-1);
 	}
-	strcpy(ret_str, fullpath);
-	return(ret_str);
+	return(0);
+#else
+	fprintf(stderr, "digital_rf_set_async is not available on Windows\n");
+	return(-1);
+#endif
 }
 
 
 
-uint64_t digital_rf_get_last_write_time(Digital_rf_write_object *hdf5_data_object)
-/* digital_rf_get_last_write_time returns the unix timestamp of the last write
+int digital_rf_flush_async(Digital_rf_write_object *hdf5_data_object)
+/* digital_rf_flush_async waits until the writer thread has written every queued write
  *
  * Inputs:
  * 		Digital_rf_write_object *hdf5_data_object - C struct created by digital_rf_create_write_hdf5
  *
- * 	Returns: uint64_t representing the unix timestamp of the last write.  If no writes occurred yet, returns 0.
+ * 	Returns 0 if success or not in async mode, else the result of the first write that failed on the writer thread
  */
 {
-	return(hdf5_data_object->last_utc_timestamp);
+#ifndef _WIN32
+	struct drf_async_writer * async = hdf5_data_object->async;
+	int result;
+
+	if (async == NULL)
+		return(0);
+	pthread_mutex_lock(&async->lock);
+	while (async->count > 0)
+		pthread_cond_wait(&async->not_full, &async->lock);
+	result = async->error;
+	pthread_mutex_unlock(&async->lock);
+	return(result);
+#else
+	return(0);
+#endif
 }
 
 
-int digital_rf_close_write_hdf5(Digital_rf_write_object *hdf5_data_object)
-/* digital_rf_close_write_hdf5 closes open Hdf5 file if needed and releases all memory associated with hdf5_data_object
+int digital_rf_get_async_stats(Digital_rf_write_object *hdf5_data_object, uint64_t * stalls, uint64_t * overflows,
+		uint64_t * samples_dropped, int * max_queued)
+/* digital_rf_get_async_stats reports how well the writer thread has kept up, see digital_rf_set_async
  *
  * Inputs:
  * 		Digital_rf_write_object *hdf5_data_object - C struct created by digital_rf_create_write_hdf5
+ * 		uint64_t * stalls - set to the number of writes that waited for a free buffer (block == 1)
+ * 		uint64_t * overflows - set to the number of writes dropped because the ring was full (block == 0)
+ * 		uint64_t * samples_dropped - set to the number of samples in those writes
+ * 		int * max_queued - set to the most buffers ever queued at once
+ *
+ * 	Any of the outputs may be NULL.
+ *
+ * 	Returns 0 if success, -1 if not in async mode
  */
 {
-	if (hdf5_data_object != NULL)
-	{
-		/* close file */
-		if (hdf5_data_object->dataset)
-		{
-			H5Dclose (hdf5_data_object->dataset);
-			hdf5_data_object->dataset = 0;
-		}
-		if (hdf5_data_object->index_dataset)
-		{
-			H5Dclose (hdf5_data_object->index_dataset);
-			hdf5_data_object->index_dataset = 0;
-		}
-		if (hdf5_data_object->dataspace)
-		{
-			H5Sclose (hdf5_data_object->dataspace);
-			hdf5_data_object->dataspace = 0;
-		}
-		if (hdf5_data_object->filespace)
-		{
-			H5Sclose (hdf5_data_object->filespace);
-			hdf5_data_object->filespace = 0;
-		}
-		if (hdf5_data_object->memspace)
-		{
-			H5Sclose (hdf5_data_object->memspace);
-			hdf5_data_object->memspace = 0;
-		}
-		if (hdf5_data_object->hdf5_file)
-		{
-			H5Fclose (hdf5_data_object->hdf5_file);
-			hdf5_data_object->hdf5_file = 0;
-		}
-		hdf5_data_object->dataset_index = 0;
-
-		/* rename closed file to finalized name (or delete if errored) */
-		digital_rf_close_hdf5_file(hdf5_data_object);
+#ifndef _WIN32
+	struct drf_async_writer * async = hdf5_data_object->async;
 
-		/* finally free all resources in hdf5_data_object */
-		digital_rf_free_hdf5_data_object(hdf5_data_object);
-	}
+	if (async == NULL)
+		return(-1);
+	pthread_mutex_lock(&async->lock);
+	if (stalls)
+		*stalls = async->stalls;
+	if (overflows)
+		*overflows = async->overflows;
+	if (samples_dropped)
+		*samples_dropped = async->samples_dropped;
+	if (max_queued)
+		*max_queued = async->max_queued;
+	pthread_mutex_unlock(&async->lock);
 	return(0);
+#else
+	return(-1);
+#endif
 }
 
 
-int digital_rf_get_unix_time(uint64_t global_sample, long double sample_rate, int * year, int * month, int *day,
-		                     int * hour, int * minute, int * second, uint64_t * picosecond)
-/* get_unix_time converts a global_sample and a sample rate into year, month, day
- * 	hour, minute, second, picosecond
+int digital_rf_set_precreate(Digital_rf_write_object *hdf5_data_object, int enable)
+/* digital_rf_set_precreate turns on preparing each next file in the background
  *
- *  ***DEPRECATED*** Use digital_rf_get_unix_time_rational instead.
+ * Inputs:
+ * 		Digital_rf_write_object *hdf5_data_object - C struct created by digital_rf_create_write_hdf5
+ * 		int enable - 1 to prepare files ahead of time, 0 to create them at rollover (the default)
  *
- * 	Returns 0 if success, -1 if failure.
+ * 	Once a file is opened, a thread of its own creates the file after it (and its subdirectory if new) with its
+ * 	dataset and metadata, under the name "next." followed by its tmp. basename so readers ignore it.  When writing
+ * 	reaches that file, it is only renamed to its tmp. name and its handles swapped in.  If the next write skips
+ * 	past it instead, the prepared file is removed.  Closing and renaming the finished file still happen at
+ * 	rollover.  Needs a thread-safe Hdf5 build.  Must be called before the first write.  Not available on Windows.
  *
+ * 	Returns 0 if success, -1 if failure
  */
 {
-	time_t unix_second;
-	long double unix_remainder;
+#ifndef _WIN32
+	struct drf_precreate * precreate;
+	hbool_t is_ts = 0;
 
-	/* set values down to second using gmtime */
-	unix_second = (time_t)(global_sample / sample_rate);
-	if (digital_rf_get_time_parts(unix_second, year, month, day, hour, minute, second))
+	if (hdf5_data_object->present_seq != -1)
+	{
+		fprintf(stderr, "digital_rf_set_precreate must be called before the first write\n");
+		return(-1);
+	}
+	if (!enable)
+	{
+		if (hdf5_data_object->precreate != NULL && hdf5_data_object->precreate->hub != NULL)
+		{
+			fprintf(stderr, "the next files of a channel of a writer hub are prepared as set by its hub\n");
+			return(-1);
+		}
+		if (hdf5_data_object->precreate != NULL)
+			digital_rf_end_precreate(hdf5_data_object);
+		return(0);
+	}
+	if (hdf5_data_object->precreate != NULL)
+		return(0);
+	if (hdf5_data_object->staging)
+	{
+		fprintf(stderr, "digital_rf_set_precreate can not be used with digital_rf_set_staging\n");
 		return(-1);
+	}
+	H5is_library_threadsafe(&is_ts);
+	if (!is_ts)
+	{
+		fprintf(stderr, "digital_rf_set_precreate needs a thread-safe Hdf5 library\n");
+		return(-1);
+	}
 
-	/* set picoseconds */
-	if (fmod(sample_rate, 1.0) == 0.0) /* use integer logic when sample rate can be converted to an integer */
-		unix_remainder = (long double)(global_sample - (unix_second * (uint64_t)sample_rate));
-	else
-		unix_remainder = fmodl((long double)global_sample, sample_rate);
-	*picosecond = (uint64_t)floorl((unix_remainder/sample_rate)*1.0E12L + 0.5L);
+	if ((precreate = (struct drf_precreate *)calloc(1, sizeof(struct drf_precreate))) == NULL)
+	{
+		fprintf(stderr, "malloc failure - unrecoverable\n");
+		exit(-1);
+	}
+	precreate->state = DRF_PRECREATE_IDLE;
+	pthread_mutex_init(&precreate->lock, NULL);
+	pthread_cond_init(&precreate->changed, NULL);
+
+	hdf5_data_object->precreate = precreate;
+	if (pthread_create(&precreate->thread, NULL, digital_rf_precreate_thread, hdf5_data_object))
+	{
+		fprintf(stderr, "Unable to start the precreate thread\n");
+		hdf5_data_object->precreate = NULL;
+		pthread_mutex_destroy(&precreate->lock);
+		pthread_cond_destroy(&precreate->changed);
+		free(precreate);
+		return(-1);
+	}
 	return(0);
+#else
+	if (!enable)
+		return(0);
+	fprintf(stderr, "digital_rf_set_precreate is not available on Windows\n");
+	return(-1);
+#endif
 }
 
 
-int digital_rf_get_timestamp_floor(uint64_t sample_index,
-	uint64_t sample_rate_numerator, uint64_t sample_rate_denominator,
-	uint64_t * second, uint64_t * picosecond)
-/* get_timestamp_floor converts a sample index into the nearest earlier timestamp
- *  (flooring) divided into second and picosecond parts, using the sample rate
- *  expressed as a rational fraction.
+int digital_rf_set_file_template(Digital_rf_write_object *hdf5_data_object, int enable)
+/* digital_rf_set_file_template turns on creating files from an in-memory template
  *
- *  Flooring is used so that sample falls in the window of time represented by
- *  the returned timestamp, which includes that time up until the next possible
- *  timestamp: second + [picosecond, picosecond + 1).
+ * Inputs:
+ * 		Digital_rf_write_object *hdf5_data_object - C struct created by digital_rf_create_write_hdf5
+ * 		int enable - 1 to create files from a template image, 0 to create each file with Hdf5 (the default)
  *
- * 	Returns 0 if success, -1 if failure.
+ * 	Every attribute of /rf_data except sequence_num and computer_time is the same in all files of a writer.  In
+ * 	this mode an empty file with the dataset and all its metadata is built once in memory with the core driver,
+ * 	and each new file is a copy of that image with only those two attributes rewritten.  One image is kept for
+ * 	each maximum file size seen, since that is part of the dataset shape.  Must be called before the first write.
  *
+ * 	Returns 0 if success, -1 if failure
  */
 {
-	uint64_t tmp_div;
-	uint64_t tmp_mod;
-	uint64_t tmp;
-
-	/* calculate with divide/modulus split to avoid overflow */
-	/* second = si * d / n = ((si / n) * d) + ((si % n) * d) / n */
-	tmp_div = sample_index / sample_rate_numerator;
-	tmp_mod = sample_index % sample_rate_numerator;
-	*second = tmp_div * sample_rate_denominator;
-	tmp = tmp_mod * sample_rate_denominator;
-	tmp_div = tmp / sample_rate_numerator;
-	tmp_mod = tmp % sample_rate_numerator;
-	*second += tmp_div;
-	/* picoseconds calculated from remainder of division to calculate seconds */
-	/* picsecond = rem * 1e12 / n = rem * (1e12 / n) + (rem * (1e12 % n)) / n */
-	tmp = tmp_mod;
-	tmp_div = 1000000000000 / sample_rate_numerator;
-	tmp_mod = 1000000000000 % sample_rate_numerator;
-	*picosecond = (tmp * tmp_div) + (tmp * tmp_mod / sample_rate_numerator);
-
+	if (hdf5_data_object->present_seq != -1)
+	{
+		fprintf(stderr, "digital_rf_set_file_template must be called before the first write\n");
+		return(-1);
+	}
+	hdf5_data_object->file_template = enable ? 1 : 0;
 	return(0);
 }
 
 
-int digital_rf_get_sample_ceil(uint64_t second, uint64_t picosecond,
-	uint64_t sample_rate_numerator, uint64_t sample_rate_denominator,
-	uint64_t * sample_index)
-/* get_sample_ceil converts a timestamp (divided into second and picosecond parts)
- *  into the next nearest sample (ceil), using the sample rate expressed as a
- *  rational fraction.
+int digital_rf_set_deferred_index(Digital_rf_write_object *hdf5_data_object, int enable, uint64_t flush_interval_secs)
+/* digital_rf_set_deferred_index turns on holding /rf_data_index rows in memory until the file is closed
  *
- *  Ceiling is used to complement the flooring in get_timestamp_floor, so that
- *  get_sample_ceil(get_timestamp_floor(sample_index)) == sample_index.
+ * Inputs:
+ * 		Digital_rf_write_object *hdf5_data_object - C struct created by digital_rf_create_write_hdf5
+ * 		int enable - 1 to hold rows, 0 to write them with each write (the default)
+ * 		uint64_t flush_interval_secs - if non-zero, rows are also written by the first write at least this many
+ * 			seconds after /rf_data_index was last written, and the file flushed, bounding how much of the index
+ * 			of an open file a crash can lose.  0 writes them only when the file is closed.
  *
- * 	Returns 0 if success, -1 if failure.
+ * 	Gapped writes add a row each, so this turns one small extend and write of /rf_data_index per write into one
+ * 	per file.  Ignored in SWMR mode, where readers need each row before its samples.  Must be called before
+ * 	the first write.
  *
+ * 	Returns 0 if success, -1 if failure
  */
 {
-	uint64_t nanosecond;
-	uint64_t quotient;
-	uint64_t remainder;
-	uint64_t tmp_div;
-	uint64_t tmp_mod;
-
-	/* divide picosecond into nanosecond and remainder so both use < 32 bits */
-	nanosecond = picosecond / 1000;
-	picosecond = picosecond % 1000;
-
-	/* calculate with divide/modulus split to avoid overflow */
-	/* si = ts * n / d = (sec + (nsec / 1e9) + (psec / 1e12)) * n / d */
-
-	/* start with picosecond part */
-	tmp_div = picosecond / sample_rate_denominator;
-	tmp_mod = picosecond % sample_rate_denominator;
-	tmp_div *= sample_rate_numerator;
-	tmp_mod *= sample_rate_numerator;
-	tmp_div += tmp_mod / sample_rate_denominator;
-	tmp_mod = tmp_mod % sample_rate_denominator;
-	/* quotient and remainder are in terms of (samples * 1e12) */
-	quotient = tmp_div;
-	remainder = tmp_mod;  /* remainder w.r.t sample_rate_denominator */
-
-	/* multiply and divide nanosecond part */
-	tmp_div = nanosecond / sample_rate_denominator;
-	tmp_mod = nanosecond % sample_rate_denominator;
-	tmp_div *= sample_rate_numerator;
-	tmp_mod *= sample_rate_numerator;
-	tmp_div += tmp_mod / sample_rate_denominator;
-	tmp_mod = tmp_mod % sample_rate_denominator;
-	/* consolidate: tmp_div + tmp_mod / d + quotient / 1e3 + remainder / 1e3 / d */
-	/* add nanosecond remainder to picosecond part in terms of (samples * 1e12) */
-	remainder += tmp_mod * 1000;
-	quotient += remainder / sample_rate_denominator;
-	remainder = remainder % sample_rate_denominator;
-	/* now have: tmp_div + quotient / 1e3 + remainder / 1e3 / d */
-	/* consolidate into a single quotient and remainder */
-	tmp_div += quotient / 1000;
-	quotient = quotient % 1000;
-	remainder += quotient * sample_rate_denominator;
-	quotient = tmp_div;
-	/* now have: quotient + remainder / 1e3 / d */
-	/* update remainder to be in terms of (samples * 1e9) using ceiling rounding */
-	remainder = remainder / 1000 + (remainder % 1000 != 0);
-	/* now have in terms of (samples * 1e9): quotient + remainder / d */
-
-	/* multiply and divide second part */
-	tmp_div = second / sample_rate_denominator;
-	tmp_mod = second % sample_rate_denominator;
-	tmp_div *= sample_rate_numerator;
-	tmp_mod *= sample_rate_numerator;
-	tmp_div += tmp_mod / sample_rate_denominator;
-	tmp_mod = tmp_mod % sample_rate_denominator;
-	/* consolidate: tmp_div + tmp_mod / d + quotient / 1e9 + remainder / 1e9 / d */
-	/* add second remainder to nanosecond part in terms of (samples * 1e9) */
-	remainder += tmp_mod * 1000000000;
-	quotient += remainder / sample_rate_denominator;
-	remainder = remainder % sample_rate_denominator;
-	/* now have: tmp_div + quotient / 1e9 + remainder / 1e9 / d */
-	/* consolidate into a single quotient and remainder */
-	tmp_div += quotient / 1000000000;
-	quotient = quotient % 1000000000;
-	remainder += quotient * sample_rate_denominator;
-	quotient = tmp_div;
-	/* now have: quotient + remainder / 1e9 / d */
-	/* update remainder to be in terms of samples using ceiling rounding */
-	remainder = remainder / 1000000000 + (remainder % 1000000000 != 0);
-	/* now have in terms of samples: quotient + remainder / d */
-	/* finally ceiling round remainder into quotient */
-	quotient += (remainder != 0);
-
-	*sample_index = quotient;
-
+	if (hdf5_data_object->present_seq != -1)
+	{
+		fprintf(stderr, "digital_rf_set_deferred_index must be called before the first write\n");
+		return(-1);
+	}
+	hdf5_data_object->deferred_index = enable ? 1 : 0;
+	hdf5_data_object->index_flush_secs = flush_interval_secs;
 	return(0);
 }
 
-
-int digital_rf_get_unix_time_rational(uint64_t global_sample,
-	uint64_t sample_rate_numerator, uint64_t sample_rate_denominator,
-	int * year, int * month, int *day, int * hour, int * minute, int * second,
-	uint64_t * picosecond)
-/* get_unix_time_rational converts a global_sample and a sample rate into year,
- *  month, day, hour, minute, second, picosecond
+int digital_rf_set_compress_threads(Digital_rf_write_object *hdf5_data_object, int num_threads)
+/* digital_rf_set_compress_threads moves compression and checksums of /rf_data to threads of the writer
  *
- * 	Returns 0 if success, -1 if failure.
+ * Inputs:
+ * 		Digital_rf_write_object *hdf5_data_object - C struct created by digital_rf_create_write_hdf5
+ * 		int num_threads - number of threads encoding chunks, 0 to let Hdf5 filter each chunk as it is
+ * 			written (the default)
  *
+ * 	Samples are collected into whole /rf_data chunks, which are deflated and given their Fletcher32
+ * 	checksum exactly as the Hdf5 filters would, up to num_threads at a time, while the caller goes on
+ * 	writing.  Encoded chunks are committed in order with H5Dwrite_chunk on the writing thread, so the
+ * 	files are the same to any reader.  The last chunk of each file is padded with fill values as Hdf5
+ * 	would.  Only useful with compression or checksums, and not with SWMR.  Needs zlib, POSIX threads
+ * 	and Hdf5 1.10.3 or later.  Must be called before the first write.
+ *
+ * 	Returns 0 if success, -1 if failure
  */
 {
-	uint64_t timestamp_second;
-	time_t unix_second;
+#ifdef DRF_ENCODE_THREADS
+	struct drf_chunk_pool * pool;
+	hid_t fill_type;
+	size_t fill_size;
+	int i;
 
-	/* get second timestamp and picosecond value */
-	if (digital_rf_get_timestamp_floor(global_sample, sample_rate_numerator, sample_rate_denominator, &timestamp_second, picosecond))
+	if (hdf5_data_object->present_seq != -1)
+	{
+		fprintf(stderr, "digital_rf_set_compress_threads must be called before the first write\n");
 		return(-1);
-
-	/* set values down to second from timestamp*/
-	unix_second = (time_t)timestamp_second;
-	if (digital_rf_get_time_parts(unix_second, year, month, day, hour, minute, second))
+	}
+	if (num_threads < 0)
+	{
+		fprintf(stderr, "Illegal num_threads %i, must not be negative\n", num_threads);
+		return(-1);
+	}
+	if (hdf5_data_object->chunk_pool != NULL)
+		digital_rf_end_chunk_pool(hdf5_data_object);
+	if (num_threads == 0)
+		return(0);
+	if (hdf5_data_object->compression_level == 0 && !hdf5_data_object->checksum)
+	{
+		fprintf(stderr, "digital_rf_set_compress_threads needs compression or checksums\n");
+		return(-1);
+	}
+	if (hdf5_data_object->codec != DIGITAL_RF_CODEC_NONE && hdf5_data_object->codec != DIGITAL_RF_CODEC_DEFLATE)
+	{
+		fprintf(stderr, "digital_rf_set_compress_threads only encodes deflate, not codec %i\n", hdf5_data_object->codec);
+		return(-1);
+	}
+	if (hdf5_data_object->swmr)
+	{
+		fprintf(stderr, "digital_rf_set_compress_threads can not be used with digital_rf_set_swmr\n");
 		return(-1);
+	}
+	if (hdf5_data_object->chunk_subchannels != 0 && hdf5_data_object->chunk_subchannels != hdf5_data_object->num_subchannels)
+	{
+		fprintf(stderr, "digital_rf_set_compress_threads needs chunks of all subchannels\n");
+		return(-1);
+	}
 
+	if ((pool = (struct drf_chunk_pool *)calloc(1, sizeof(struct drf_chunk_pool))) == NULL
+			|| (pool->threads = (pthread_t *)calloc(num_threads, sizeof(pthread_t))) == NULL
+			|| (pool->jobs = (drf_chunk_job *)calloc(2 * num_threads, sizeof(drf_chunk_job))) == NULL
+			|| (pool->fill = (unsigned char *)malloc(hdf5_data_object->sample_size)) == NULL)
+	{
+		fprintf(stderr, "malloc failure - unrecoverable\n");
+		exit(-1);
+	}
+	/* two chunks per thread, so one can be filled and committed while the others are encoded */
+	pool->num_jobs = 2 * num_threads;
+	pool->compression_level = hdf5_data_object->compression_level;
+	pool->checksum = hdf5_data_object->checksum;
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->work, NULL);
+	pthread_cond_init(&pool->done, NULL);
+
+	/* fill value of one subchannel, as set by digital_rf_set_fill_value, repeated for each */
+	fill_type = hdf5_data_object->is_complex ? hdf5_data_object->complex_dtype_id : hdf5_data_object->dtype_id;
+	fill_size = H5Tget_size(fill_type);
+	if (H5Pget_fill_value(hdf5_data_object->dataset_prop, fill_type, pool->fill) < 0)
+		memset(pool->fill, 0, fill_size);
+	for (i=1; i<hdf5_data_object->num_subchannels; i++)
+		memcpy(pool->fill + i * fill_size, pool->fill, fill_size);
+
+	hdf5_data_object->chunk_pool = pool;
+	for (i=0; i<num_threads; i++)
+	{
+		if (pthread_create(&pool->threads[i], NULL, digital_rf_chunk_thread, pool))
+		{
+			fprintf(stderr, "Unable to start compression thread %i\n", i);
+			digital_rf_end_chunk_pool(hdf5_data_object);
+			return(-1);
+		}
+		pool->num_threads++;
+	}
 	return(0);
+#else
+	if (num_threads == 0)
+		return(0);
+	fprintf(stderr, "digital_rf_set_compress_threads needs zlib, POSIX threads and Hdf5 1.10.3 or later\n");
+	return(-1);
+#endif
 }
 
-
-
-/* Private Method implementations */
-
-
-int digital_rf_get_time_parts(time_t unix_second, int * year, int * month, int *day,
-		                     int * hour, int * minute, int * second)
-/* get_time_parts converts a Unix timestamp into year, month, day
- * 	hour, minute, second
+int digital_rf_set_codec(Digital_rf_write_object *hdf5_data_object, int codec, int level)
+/* digital_rf_set_codec chooses the compression of /rf_data, replacing the gzip compression_level given to
+ * digital_rf_create_write_hdf5
  *
- * 	Returns 0 if success, -1 if failure.
+ * Inputs:
+ * 		Digital_rf_write_object *hdf5_data_object - C struct created by digital_rf_create_write_hdf5
+ * 		int codec - one of the DIGITAL_RF_CODEC_* values in digital_rf.h
+ * 		int level - compression level for DIGITAL_RF_CODEC_DEFLATE (1-9) and DIGITAL_RF_CODEC_ZSTD (1-22),
+ * 			ignored by the others
  *
+ * 	Every codec but deflate is a registered third party Hdf5 filter, which must be available (usually as a plugin
+ * 	found through HDF5_PLUGIN_PATH) here and wherever the files are read.  The Fletcher32 checksum, if used, is
+ * 	still applied after compression.  Compressed rf_data is always chunked.  digital_rf_set_compress_threads only
+ * 	works with deflate.  Must be called before the first write.
+ *
+ * 	Returns 0 if success, -1 if failure (compression is then unchanged)
  */
 {
-	struct tm *gm;
+	unsigned int cd_values[2] = {0, 0};
+	size_t cd_nelmts = 0;
+	hid_t dataset_prop;
 
-	gm = gmtime(&unix_second);
-	if (gm == NULL)
+	if (hdf5_data_object->present_seq != -1)
+	{
+		fprintf(stderr, "digital_rf_set_codec must be called before the first write\n");
 		return(-1);
-	*year = gm->tm_year + 1900;
-	*month = gm->tm_mon + 1;
-	*day = gm->tm_mday;
-	*hour = gm->tm_hour;
-	*minute = gm->tm_min;
-	*second = gm->tm_sec;
+	}
+	switch (codec)
+	{
+	case DIGITAL_RF_CODEC_NONE:
+		break;
+	case DIGITAL_RF_CODEC_DEFLATE:
+		if (level < 1 || level > 9)
+		{
+			fprintf(stderr, "Illegal deflate level %i, must be 1-9\n", level);
+			return(-1);
+		}
+		cd_values[0] = (unsigned int)level;
+		cd_nelmts = 1;
+		break;
+	case DIGITAL_RF_CODEC_LZ4:
+		break;
+	case DIGITAL_RF_CODEC_BITSHUFFLE_LZ4:
+		/* block size chosen by the filter, then its LZ4 option */
+		cd_values[1] = 2;
+		cd_nelmts = 2;
+		break;
+	case DIGITAL_RF_CODEC_ZSTD:
+		if (level < 1 || level > 22)
+		{
+			fprintf(stderr, "Illegal zstd level %i, must be 1-22\n", level);
+			return(-1);
+		}
+		cd_values[0] = (unsigned int)level;
+		cd_nelmts = 1;
+		break;
+	default:
+		fprintf(stderr, "Unknown codec %i\n", codec);
+		return(-1);
+	}
+	if (codec != DIGITAL_RF_CODEC_NONE && H5Zfilter_avail((H5Z_filter_t)codec) <= 0)
+	{
+		fprintf(stderr, "Hdf5 filter %i of codec is not available, check HDF5_PLUGIN_PATH\n", codec);
+		return(-1);
+	}
+	if (hdf5_data_object->chunk_pool != NULL && codec != DIGITAL_RF_CODEC_NONE && codec != DIGITAL_RF_CODEC_DEFLATE)
+	{
+		fprintf(stderr, "digital_rf_set_compress_threads only encodes deflate, not codec %i\n", codec);
+		return(-1);
+	}
 
+	/* rebuild the filter pipeline on a copy, compression first and the checksum last.  The codec is mandatory, so
+	 * a chunk it fails to encode fails the write instead of being stored raw */
+	if ((dataset_prop = H5Pcopy(hdf5_data_object->dataset_prop)) < 0)
+	{
+		fprintf(stderr, "H5Pcopy failed for codec %i\n", codec);
+		return(-1);
+	}
+	if (H5Premove_filter(dataset_prop, H5Z_FILTER_ALL) < 0
+		|| (codec != DIGITAL_RF_CODEC_NONE
+			&& H5Pset_filter(dataset_prop, (H5Z_filter_t)codec, H5Z_FLAG_MANDATORY, cd_nelmts, cd_values) < 0)
+		|| (hdf5_data_object->checksum && H5Pset_filter(dataset_prop, H5Z_FILTER_FLETCHER32, 0, 0, NULL) < 0))
+	{
+		fprintf(stderr, "failed to set the Hdf5 filters of codec %i\n", codec);
+		H5Pclose(dataset_prop);
+		return(-1);
+	}
+	H5Pclose(hdf5_data_object->dataset_prop);
+	hdf5_data_object->dataset_prop = dataset_prop;
+	hdf5_data_object->codec = codec;
+	hdf5_data_object->compression_level = (codec == DIGITAL_RF_CODEC_DEFLATE) ? level : 0;
+	hdf5_data_object->needs_chunking = (codec != DIGITAL_RF_CODEC_NONE || hdf5_data_object->checksum
+										|| hdf5_data_object->is_continuous != 1 || hdf5_data_object->swmr
+										|| hdf5_data_object->chunk_shape);
+#ifdef DRF_ENCODE_THREADS
+	if (hdf5_data_object->chunk_pool != NULL)
+		hdf5_data_object->chunk_pool->compression_level = hdf5_data_object->compression_level;
+#endif
 	return(0);
 }
 
-
-int digital_rf_get_subdir_file(Digital_rf_write_object *hdf5_data_object, uint64_t global_sample,
-							   char * subdir, char * basename, uint64_t * samples_left, uint64_t * max_samples_this_file)
-/* digital_rf_get_subdir_file sets the name of the derived subdir in form YYYY-MM-DDTHH-MM-SS and basename in form
- * rf@%llu.3f.h5
+int digital_rf_set_chunk_shape(Digital_rf_write_object *hdf5_data_object, uint64_t chunk_samples,
+							   int chunk_subchannels, uint64_t target_nbytes)
+/* digital_rf_set_chunk_shape chooses the chunks of /rf_data instead of sizing them from the first write
  *
  * Inputs:
- * 	Digital_rf_write_object *hdf5_data_object - C struct created by digital_rf_create_write_hdf5
- * 	global_sample - global sample of first sample to write to file (first sample written is 0)
- * 	subdir - char array allocated by caller to be filled in with YYYY-MM-DDTHH-MM-SS according to global_sample
- * 		and subdir_cadence_secs
- * 	basename - char array allocated by caller to be filled in with rf@%llu.3f.tmp.h5 according to global_sample and
- * 		subdir_cadence_secs and file_cadence_millisecs.  Note that when file is no longer actively written to, or
- * 		when digital_rf_close_write_hdf5 called, will be moved to remove tmp. part of name.
- * 	samples_left - pointer to uint64_t to be set to the number of samples left to be written in file.  Will be greater than
- * 		zero and less than or equal to max_samples_this_file
- *  max_samples_this_file - pointer to uint64_t to be set to the maximum total number of samples that this file can hold
+ * 		Digital_rf_write_object *hdf5_data_object - C struct created by digital_rf_create_write_hdf5
+ * 		uint64_t chunk_samples - samples per chunk, or DIGITAL_RF_CHUNK_AUTO to size chunks from target_nbytes
+ * 		int chunk_subchannels - subchannels per chunk, 0 for all (in auto mode, as few as needed to keep a
+ * 			chunk of one sample within target_nbytes)
+ * 		uint64_t target_nbytes - in auto mode the largest chunk wanted in bytes before compression, 0 for
+ * 			DIGITAL_RF_CHUNK_TARGET_NBYTES.  Ignored otherwise.
  *
- * 	Returns 0 if success, -1 if failure.
+ * 	In auto mode a chunk holds as many samples as fit in target_nbytes, then is evened out so that the
+ * 	fewest samples a file can hold (file_cadence_millisecs at sample_rate) are split into chunks of near
+ * 	equal size, never more than a file.  Since the compression ratio is not known until the data is
+ * 	written, the target bounds the chunks as stored and compressed chunks come out smaller by that ratio.
+ * 	Larger chunks compress better and cost less per chunk to write, smaller ones make short reads cheaper
+ * 	(see benchmark_rf_write_hdf5).  Sets chunked /rf_data even for uncompressed continuous data.  Chunks
+ * 	narrower than all subchannels can not be used with digital_rf_set_compress_threads.  Must be called
+ * 	before the first write.
  *
+ * 	Returns 0 if success, -1 if failure
  */
 {
-	int year, month, day, hour, minute, second; /* for time conversion */
-	uint64_t picosecond;			/* for time conversion */
-	uint64_t sample_sec;      		/* the unix second associated with global_sample */
-	uint64_t sample_millisec; 		/* the unix millisecond associated with global_sample */
-	uint64_t dir_sec;  				/* the unix second the directory starts */
-	uint64_t file_millisec;  		/* the unix millisecond the file starts */
-	uint64_t file_sec_part; 		/* second part of file name */
-	uint64_t file_millisec_part; 	/* millisecond part of file name */
-	uint64_t file_start_sample;		/* first sample in file */
-	uint64_t next_file_millisec;	/* the unix millisecond the *next* file starts */
-	uint64_t next_file_sec_part;	/* second part of *next* file name */
-	uint64_t next_file_millisec_part;		/* millisecond part of *next* file name */
-	uint64_t next_file_start_sample;		/* first sample in *next* file */
-
-	/* convert global_sample to absolute samples since 1970 */
-	global_sample += hdf5_data_object->global_start_sample;
+	size_t subchannel_size = hdf5_data_object->sample_size / hdf5_data_object->num_subchannels;
 
-	/* get floored millisecond timestamp corresponding to sample */
-	if (digital_rf_get_timestamp_floor(global_sample, hdf5_data_object->sample_rate_numerator, hdf5_data_object->sample_rate_denominator, &sample_sec, &picosecond))
+	if (hdf5_data_object->present_seq != -1)
+	{
+		fprintf(stderr, "digital_rf_set_chunk_shape must be called before the first write\n");
 		return(-1);
-	sample_millisec = sample_sec * 1000 + picosecond / 1000000000;
-
-	/* first derive the subdirectory name */
-	dir_sec = (sample_sec / hdf5_data_object->subdir_cadence_secs) * hdf5_data_object->subdir_cadence_secs;
-	if (digital_rf_get_time_parts((time_t)dir_sec, &year, &month, &day, &hour, &minute, &second))
+	}
+	if (chunk_subchannels < 0 || chunk_subchannels > hdf5_data_object->num_subchannels)
+	{
+		fprintf(stderr, "Illegal chunk_subchannels %i, must be 0-%i\n", chunk_subchannels,
+				hdf5_data_object->num_subchannels);
 		return(-1);
-	snprintf(subdir, BIG_HDF5_STR, "%04i-%02i-%02iT%02i-%02i-%02i", year, month, day, hour, minute, second);
-
-	/* next derive the file name */
-	file_millisec = (sample_millisec / hdf5_data_object->file_cadence_millisecs) * hdf5_data_object->file_cadence_millisecs;
-	file_sec_part = file_millisec / 1000; /* second part of file name */
-	file_millisec_part = file_millisec % 1000; /* millisecond part of file name */
-	snprintf(basename, SMALL_HDF5_STR, "tmp.rf@%" PRIu64 ".%03" PRIu64 ".h5", file_sec_part, file_millisec_part);
-	next_file_millisec = file_millisec + hdf5_data_object->file_cadence_millisecs;
-	next_file_sec_part = next_file_millisec / 1000;
-	next_file_millisec_part = next_file_millisec % 1000;
-
-	/* finally derive the number of samples available to write in this file (independent of whether file exists) */
-	/* ceil needed because implicit flooring puts sample at time just before file starts */
-	if (digital_rf_get_sample_ceil(file_sec_part, file_millisec_part * 1000000000,
-	hdf5_data_object->sample_rate_numerator, hdf5_data_object->sample_rate_denominator,
-	&file_start_sample))
+	}
+	/* Hdf5 chunks must be under 4 GiB */
+	if (chunk_samples != DIGITAL_RF_CHUNK_AUTO && chunk_samples > (uint64_t)UINT32_MAX / (subchannel_size
+			* (chunk_subchannels ? chunk_subchannels : hdf5_data_object->num_subchannels)))
+	{
+		fprintf(stderr, "Illegal chunk_samples %" PRIu64 ", chunks must be under 4 GiB\n", chunk_samples);
 		return(-1);
-	if (digital_rf_get_sample_ceil(next_file_sec_part, next_file_millisec_part * 1000000000,
-	hdf5_data_object->sample_rate_numerator, hdf5_data_object->sample_rate_denominator,
-	&next_file_start_sample))
+	}
+	if (target_nbytes >= (uint64_t)UINT32_MAX)
+	{
+		fprintf(stderr, "Illegal target_nbytes %" PRIu64 ", chunks must be under 4 GiB\n", target_nbytes);
 		return(-1);
-	*samples_left = next_file_start_sample - global_sample;
-	*max_samples_this_file = next_file_start_sample - file_start_sample;
-
-	if (*samples_left < 1 || *samples_left > *max_samples_this_file)
+	}
+	if (hdf5_data_object->chunk_pool != NULL && chunk_subchannels != 0
+			&& chunk_subchannels != hdf5_data_object->num_subchannels)
 	{
-		fprintf(stderr, "got illegal samples_left %" PRIu64 "\n", *samples_left);
+		fprintf(stderr, "digital_rf_set_compress_threads needs chunks of all subchannels\n");
 		return(-1);
 	}
 
+	hdf5_data_object->chunk_shape = 1;
+	hdf5_data_object->chunk_samples = chunk_samples;
+	hdf5_data_object->chunk_subchannels = chunk_subchannels;
+	hdf5_data_object->chunk_target_nbytes = target_nbytes ? target_nbytes : DIGITAL_RF_CHUNK_TARGET_NBYTES;
+	hdf5_data_object->needs_chunking = 1;
 	return(0);
 }
 
+int digital_rf_set_direct_io(Digital_rf_write_object *hdf5_data_object, int enable, uint64_t alignment)
+/* digital_rf_set_direct_io aligns the layout of each file, and writes contiguous /rf_data around the page cache
+ *
+ * Inputs:
+ * 		Digital_rf_write_object *hdf5_data_object - C struct created by digital_rf_create_write_hdf5
+ * 		int enable - 1 for aligned files and direct writes, 0 to leave both to Hdf5 (the default)
+ * 		uint64_t alignment - power of two, at least 512, that file offsets, lengths and buffers of direct writes
+ * 			are aligned to, 0 for DIGITAL_RF_DIRECT_IO_ALIGNMENT.  Should be a multiple of the filesystem block size.
+ *
+ * 	Files are created with objects of alignment bytes or more (so /rf_data) at aligned offsets, and with metadata
+ * 	and small raw data such as /rf_data_index gathered into aligned blocks of their own.  Contiguous /rf_data
+ * 	(continuous data without compression, checksums or SWMR) is then allocated when each file is created and
+ * 	written by this library in aligned blocks through a second O_DIRECT descriptor, so samples never pile up as
+ * 	dirty pages whose writeback stalls a later write: latency is steadier, at some cost in peak throughput.
+ * 	Skipped samples and the end of the last file are given fill values, as Hdf5 would.  Where the filesystem
+ * 	refuses O_DIRECT, or /rf_data is smaller than the alignment, the same writes go through the page cache.
+ * 	Chunked /rf_data gets the aligned layout only, as does everything on systems without O_DIRECT.  Files of
+ * 	contiguous /rf_data are not made from digital_rf_set_file_template images.  Must be called before the first
+ * 	write.
+ *
+ * 	Returns 0 if success, -1 if failure
+ */
+{
+#ifdef DRF_DIRECT_IO
+	struct drf_direct_io * direct;
+	hid_t fill_type;
+	size_t fill_size;
+	int i;
+#endif
 
-int digital_rf_free_hdf5_data_object(Digital_rf_write_object *hdf5_data_object)
-/* digital_rf_free_hdf5_data_object frees all resources in hdf5_data_object */
-{
-	if (hdf5_data_object->directory != NULL)
-		free(hdf5_data_object->directory);
-	if (hdf5_data_object->sub_directory != NULL)
-		free(hdf5_data_object->sub_directory);
-	if (hdf5_data_object->uuid_str != NULL)
-		free(hdf5_data_object->uuid_str);
-
-	/* free all Hdf5 resources */
-	if (hdf5_data_object->dataset)
-		H5Dclose (hdf5_data_object->dataset);
-	if (hdf5_data_object->dataset_prop)
-		H5Pclose (hdf5_data_object->dataset_prop);
-	if (hdf5_data_object->dataspace)
-		H5Sclose (hdf5_data_object->dataspace);
-	if (hdf5_data_object->filespace)
-		H5Sclose (hdf5_data_object->filespace);
-	if (hdf5_data_object->memspace)
-		H5Sclose (hdf5_data_object->memspace);
-	if (hdf5_data_object->index_dataset)
-		H5Dclose (hdf5_data_object->index_dataset);
-	if (hdf5_data_object->index_prop)
-		H5Pclose (hdf5_data_object->index_prop);
-	if (hdf5_data_object->hdf5_file)
-		H5Fclose (hdf5_data_object->hdf5_file);
-	free(hdf5_data_object);
+	if (hdf5_data_object->present_seq != -1)
+	{
+		fprintf(stderr, "digital_rf_set_direct_io must be called before the first write\n");
+		return(-1);
+	}
+	if (alignment == 0)
+		alignment = DIGITAL_RF_DIRECT_IO_ALIGNMENT;
+	if (alignment < 512 || (alignment & (alignment - 1)) != 0)
+	{
+		fprintf(stderr, "Illegal alignment %" PRIu64 ", must be a power of two of at least 512\n", alignment);
+		return(-1);
+	}
+#ifdef DRF_DIRECT_IO
+	if (hdf5_data_object->direct_io != NULL)
+		digital_rf_free_direct_io(hdf5_data_object);
+#endif
+	hdf5_data_object->file_alignment = 0;
+	if (!enable)
+		return(0);
+	if (hdf5_data_object->memory_files)
+	{
+		fprintf(stderr, "digital_rf_set_direct_io can not be used with digital_rf_set_memory_files\n");
+		return(-1);
+	}
+	hdf5_data_object->file_alignment = alignment;
+
+#ifdef DRF_DIRECT_IO
+	if ((direct = (struct drf_direct_io *)calloc(1, sizeof(struct drf_direct_io))) == NULL
+			|| (direct->fill = (unsigned char *)malloc(hdf5_data_object->sample_size)) == NULL)
+	{
+		fprintf(stderr, "malloc failure - unrecoverable\n");
+		exit(-1);
+	}
+	direct->alignment = (size_t)alignment;
+	direct->fd = -1;
+	direct->stage_size = DRF_DIRECT_IO_BLOCK < alignment ? (size_t)alignment : DRF_DIRECT_IO_BLOCK;
+	if (posix_memalign((void **)&direct->stage, direct->alignment, direct->stage_size))
+	{
+		fprintf(stderr, "malloc failure - unrecoverable\n");
+		exit(-1);
+	}
 
+	/* fill value of one subchannel, as set by digital_rf_set_fill_value, repeated for each */
+	fill_type = hdf5_data_object->is_complex ? hdf5_data_object->complex_dtype_id : hdf5_data_object->dtype_id;
+	fill_size = H5Tget_size(fill_type);
+	if (H5Pget_fill_value(hdf5_data_object->dataset_prop, fill_type, direct->fill) < 0)
+		memset(direct->fill, 0, fill_size);
+	for (i=1; i<hdf5_data_object->num_subchannels; i++)
+		memcpy(direct->fill + i * fill_size, direct->fill, fill_size);
+	hdf5_data_object->direct_io = direct;
+#endif
 	return(0);
 }
 
-int digital_rf_check_hdf5_directory(char * directory)
-/* digital_rf_check_hdf5_directory checks if directory exists.  If it does not
- * exist, returns -1.  If okay, returns 0.
+int digital_rf_set_memory_files(Digital_rf_write_object *hdf5_data_object, int enable, int preallocate)
+/* digital_rf_set_memory_files builds each file in memory and writes it to disk in one piece when it is closed
+ *
+ * Inputs:
+ * 		Digital_rf_write_object *hdf5_data_object - C struct created by digital_rf_create_write_hdf5
+ * 		int enable - 1 to build files in memory, 0 to write them as they are filled (the default)
+ * 		int preallocate - 1 to reserve the space of each file with fallocate before writing it, where the
+ * 			system and filesystem support it, 0 not to
  *
+ * 	Files are created with the Hdf5 core driver and no backing store, so nothing of a file reaches the disk
+ * 	until it is closed, when its complete image is written to its tmp. name in a single write and renamed.
+ * 	Small files otherwise cost many small metadata writes each, which dominate on network and rotating disks.
+ * 	Each file is held in memory until closed, so this suits files of modest size.  Samples of the open
+ * 	file are lost if the writer dies.  Can not be used with digital_rf_set_swmr or digital_rf_set_direct_io.
+ * 	Must be called before the first write.
+ *
+ * 	Returns 0 if success, -1 if failure
  */
 {
-	/* local variable */
-	struct stat stat_obj = {0}; /* used to run stat to determine if directory exists */
-
-	/* see if directory needs to be created */
-	if (stat(directory, &stat_obj))
+	if (hdf5_data_object->present_seq != -1)
 	{
+		fprintf(stderr, "digital_rf_set_memory_files must be called before the first write\n");
+		return(-1);
+	}
+	if (enable && hdf5_data_object->swmr)
+	{
+		fprintf(stderr, "digital_rf_set_memory_files can not be used with digital_rf_set_swmr\n");
 		return(-1);
-	} else {
-		/* verify it's a directory */
-		if(!S_ISDIR(stat_obj.st_mode))
-		{
-			return(-1);
-		}
 	}
+	if (enable && hdf5_data_object->file_alignment)
+	{
+		fprintf(stderr, "digital_rf_set_memory_files can not be used with digital_rf_set_direct_io\n");
+		return(-1);
+	}
+	hdf5_data_object->memory_files = enable ? 1 : 0;
+	hdf5_data_object->memory_preallocate = (enable && preallocate) ? 1 : 0;
 	return(0);
 }
 
-
-uint64_t digital_rf_write_samples_to_file(Digital_rf_write_object *hdf5_data_object, uint64_t samples_written, uint64_t * global_index_arr,
-		uint64_t * data_index_arr, uint64_t index_len, void * vector, uint64_t vector_length)
-/* digital_rf_write_samples_to_file writes some or all of the data to a single Hdf5 file.
- *
- * Returns the number of samples written. Returns 0 if error.
+int digital_rf_set_staging(Digital_rf_write_object *hdf5_data_object, int enable)
+/* digital_rf_set_staging turns on capture to raw staging files, to be packed into Hdf5 files later
  *
  * Inputs:
- * 	Digital_rf_write_object *hdf5_data_object - the Digital_rf_write_object created by digital_rf_create_write_hdf5
- * 	uint64_t samples_written - the number of samples written to previous files during this particular user write call
- * 	uint64_t * global_index_arr - an array of global indices into the samples being written.  The global
- * 		index is the total number of sample periods since data taking began, including gaps.  Error
- * 		is raised if any value is before its expected value (meaning repeated data).
- * 	uint64_t * data_index_arr - an array of len = len(global_index_arr), where the indices are related to which
- * 		sample in the vector being passed in by the user, so that the first value is always 0,
- * 		or error raised.  Values must be increasing, and cannot be equal or greater than index_len or error raised.
- * 	uint_64 index_len - the len of both global_index_arr and data_index_arr.  Must be greater than 0.
- * 	void * vector - the vector (either single valued or complex) containing the data, or NULL pointer if no data to be written.
- * 	uint64_t vector_length - the total number of samples to write from vector.
+ * 		Digital_rf_write_object *hdf5_data_object - C struct created by digital_rf_create_write_hdf5
+ * 		int enable - 1 to write raw staging files, 0 to write Hdf5 files (the default)
+ *
+ * 	Samples are appended as written to a raw file per Hdf5 file period in the DIGITAL_RF_STAGING_DIR
+ * 	subdirectory of the channel, its whole size reserved with fallocate where supported, and only a row per
+ * 	contiguous block is kept besides, so a write costs little more than fwrite.  When writing passes the end of
+ * 	a period or the channel is closed, the rows and final header are added and the file is synced to disk and
+ * 	renamed from its tmp. name; it is never changed after that.  digital_rf_pack_staging converts finished
+ * 	files to Hdf5 files, from another thread or process, with the options of its own writer: compression,
+ * 	checksums and other Hdf5 file options set here are ignored.  Can not be used with digital_rf_set_precreate.
+ * 	Must be called before the first write.  Not available on Windows.
  *
+ * 	Returns 0 if success, -1 if failure
  */
 {
-	/* local variables */
-	int64_t last_global_index; /* may possibly be negative if first write not to first sample in file */
-	uint64_t samples_to_write, samples_after_last_global_index;
-	uint64_t next_global_index;
-	int block_index_len; /* len of /rf_data_index dataset needed for this particular write */
-	uint64_t * rf_data_index_arr = NULL; /* will be malloced and filled out with all data needed for rf_data_index table */
-	int result;
-	hsize_t size[2] = {0, hdf5_data_object->num_subchannels}; /* will be set to size of full dataset in file */
-	hsize_t offset[2] = {0,0};        /* will be set to the index in file writing to */
-	herr_t  status;                   /* Hdf5 error status */
-	int file_exists;                  /* set to 1 if file being written to already exists, 0 if not */
-	time_t  computer_time;            /* these two variables used to update last_unix_time */
-	int64_t u_computer_time;
-
-	char subdir[BIG_HDF5_STR] = ""; 	/* to be set to the subdirectory to write to */
-	char basename[SMALL_HDF5_STR] = ""; /* to be set to the file basename to write to */
-	uint64_t samples_left = 0;				/* to be set to the number of samples available to write to this file */
-	uint64_t max_samples_this_file;			/* to be set to the maximum total number of samples that can be in this file */
-
-
-	/* verify inputs are sensible */
-	if (index_len < 1)
+#ifndef _WIN32
+	if (hdf5_data_object->present_seq != -1)
 	{
-		fprintf(stderr, "Illegal index_len %" PRIu64 " in digital_rf_write_samples_to_file\n", index_len);
-		return(0);
+		fprintf(stderr, "digital_rf_set_staging must be called before the first write\n");
+		return(-1);
 	}
-	if (data_index_arr[0] != 0)
+	if (enable && hdf5_data_object->precreate != NULL)
 	{
-		fprintf(stderr, "Illegal first value %" PRIu64 " in data_index_arr, must be 0\n", data_index_arr[0]);
-				return(0);
+		fprintf(stderr, "digital_rf_set_staging can not be used with digital_rf_set_precreate\n");
+		return(-1);
 	}
+	hdf5_data_object->staging = enable ? 1 : 0;
+	return(0);
+#else
+	(void)hdf5_data_object;
+	(void)enable;
+	fprintf(stderr, "digital_rf_set_staging is not available on Windows\n");
+	return(-1);
+#endif
+}
 
-	/* get needed subdir, basename, and samples_left */
-	next_global_index = digital_rf_get_global_sample(samples_written, global_index_arr, data_index_arr, index_len);
-	result = digital_rf_get_subdir_file(hdf5_data_object, next_global_index, subdir, basename, &samples_left, &max_samples_this_file);
-	if (result) return(0);
-
-	/* We need to see if we need to open a new file or expand an existing one */
-	if (hdf5_data_object->sub_directory == NULL || strcmp(hdf5_data_object->sub_directory, subdir)
-			|| strcmp(hdf5_data_object->basename, basename))
-		file_exists = 0;
-	else
-		file_exists = 1;
-
-	/* get all the info needed to create (or expand) /rf_data_index and fill it out, along with calculating samples_to_write  */
-	rf_data_index_arr = digital_rf_create_rf_data_index(hdf5_data_object, samples_written, samples_left, max_samples_this_file, global_index_arr,
-				data_index_arr, index_len, vector_length, next_global_index, &block_index_len, &samples_to_write, file_exists);
-	assert(samples_to_write <= max_samples_this_file);
-	if (!rf_data_index_arr && block_index_len == -1)
-		return(0);
 
-	/* Either create new file or expand old one or if contiguous continue writing to old one */
-	if (!file_exists)
+int64_t digital_rf_pack_staging(Digital_rf_write_object *hdf5_data_object)
+/* digital_rf_pack_staging writes the samples of finished staging files into Hdf5 files, see digital_rf_set_staging
+ *
+ * Inputs:
+ * 		Digital_rf_write_object *hdf5_data_object - C struct created by digital_rf_create_write_hdf5 for the
+ * 			channel directory staged to, with the sample type, sample rate and file cadence of the capture and
+ * 			the compression and other options wanted in the Hdf5 files.  Its start_global_index must not be
+ * 			after that of the capture, and is usually the same.
+ *
+ * 	Finished staging files are packed in time order, each into the Hdf5 file of its period through
+ * 	digital_rf_write_blocks_hdf5.  A staging file is only removed once its Hdf5 file is finalized, when the next
+ * 	one is started or hdf5_data_object is closed, so a packer that dies loses nothing: the next one removes
+ * 	staging files whose Hdf5 file exists and any tmp. Hdf5 file left by the last, and packs the rest again.
+ * 	Call it again as more files are finished, from a thread of its own or another process; the capturing writer
+ * 	never waits for it.  Only one packer may work on a channel.  Not available on Windows.
+ *
+ * 	Returns the number of staging files packed, or -1 if failure
+ */
+{
+#ifndef _WIN32
+	char staging_dir[BIG_HDF5_STR] = "";
+	char fullname[2*BIG_HDF5_STR] = "";
+	DIR * dir;
+	struct dirent * ent;
+	char ** names = NULL;
+	int num_names = 0;
+	int capacity = 0;
+	void * buffer = NULL;
+	size_t buffer_size = 0;
+	size_t len;
+	int64_t packed = 0;
+	int i, result;
+
+	if (hdf5_data_object->staging)
 	{
-		result = digital_rf_create_hdf5_file(hdf5_data_object, subdir, basename, samples_to_write, samples_left, max_samples_this_file);
-		if (result)
-		{
-			fprintf(stderr, "failed to create subdir %s, basename %s\n", subdir, basename);
-			if (rf_data_index_arr)
-				free(rf_data_index_arr);
-			return(0);
-		}
+		fprintf(stderr, "digital_rf_pack_staging needs a writer without digital_rf_set_staging\n");
+		return(-1);
 	}
-	else
+	if (hdf5_data_object->has_failure)
 	{
-		if (hdf5_data_object->needs_chunking)
+		fprintf(stderr, "A previous fatal io error precludes any further calls to digital_rf_pack_staging.\n");
+		return(-1);
+	}
+
+	snprintf(staging_dir, BIG_HDF5_STR, "%s/%s", hdf5_data_object->directory, DIGITAL_RF_STAGING_DIR);
+	if ((dir = opendir(staging_dir)) == NULL)
+		return(0); /* nothing staged yet */
+	while ((ent = readdir(dir)) != NULL)
+	{
+		/* only finished files, and not the one in the open Hdf5 file again */
+		len = strlen(ent->d_name);
+		if (strncmp(ent->d_name, "rf@", 3) || len < 8 || strcmp(ent->d_name + len - 4, ".raw")
+				|| !strcmp(ent->d_name, hdf5_data_object->packed_staging))
+			continue;
+		if (num_names == capacity)
 		{
-			/* expand this file's dataset to hold the new data */
-			digital_rf_extend_dataset(hdf5_data_object, samples_to_write);
+			capacity = capacity ? 2 * capacity : 16;
+			if ((names = (char **)realloc(names, sizeof(char *) * capacity)) == NULL)
+			{
+				fprintf(stderr, "Realloc failure\n");
+				exit(-22);
+			}
 		}
-		else
+		if ((names[num_names++] = strdup(ent->d_name)) == NULL)
 		{
-			/* set global and dataset indices in case we skipped samples since
-			 * previous write, samples_left calculated earlier based on next_global_index */
-			hdf5_data_object->global_index = next_global_index;
-			hdf5_data_object->dataset_index = max_samples_this_file - samples_left;
+			fprintf(stderr, "malloc failure - unrecoverable\n");
+			exit(-1);
 		}
-		assert(hdf5_data_object->dataset_index + samples_to_write <= max_samples_this_file);
 	}
+	closedir(dir);
+	if (num_names > 1)
+		qsort(names, num_names, sizeof(char *), digital_rf_compare_staging_names);
 
-	/* create dataspace hyperslab to write to */
-	if (hdf5_data_object->filespace)
-		H5Sclose (hdf5_data_object->filespace);
-	hdf5_data_object->filespace = H5Dget_space(hdf5_data_object->dataset);
-	offset[0] = hdf5_data_object->dataset_index;
-	size[0] = samples_to_write;
-	H5Sselect_hyperslab(hdf5_data_object->filespace, H5S_SELECT_SET,
-						offset, NULL, size, NULL);
+	for (i=0; i<num_names && packed != -1; i++)
+	{
+		snprintf(fullname, 2*BIG_HDF5_STR, "%s/%s", staging_dir, names[i]);
+		result = digital_rf_pack_staging_file(hdf5_data_object, fullname, &buffer, &buffer_size);
+		if (result < 0 || hdf5_data_object->has_failure)
+			packed = -1;
+		else if (result == 0)
+		{
+			/* the Hdf5 file of the last one packed was finalized by starting this one */
+			if (digital_rf_unlink_packed_staging(hdf5_data_object))
+				packed = -1;
+			else
+			{
+				strcpy(hdf5_data_object->packed_staging, names[i]);
+				packed++;
+			}
+		}
+	}
 
-	/* set up memspace to control write */
-	if (hdf5_data_object->memspace)
-		H5Sclose (hdf5_data_object->memspace);
-	hdf5_data_object->memspace = H5Screate_simple(hdf5_data_object->rank, size, NULL);
+	for (i=0; i<num_names; i++)
+		free(names[i]);
+	if (names != NULL)
+		free(names);
+	if (buffer != NULL)
+		free(buffer);
+	return(packed);
+#else
+	(void)hdf5_data_object;
+	fprintf(stderr, "digital_rf_pack_staging is not available on Windows\n");
+	return(-1);
+#endif
+}
 
-	/* write rf_data */
-	if (hdf5_data_object->is_complex == 0)
-		status = H5Dwrite(hdf5_data_object->dataset, hdf5_data_object->dtype_id, hdf5_data_object->memspace,
-						  hdf5_data_object->filespace, H5P_DEFAULT,
-						  (char *)vector + (samples_written * H5Tget_size(hdf5_data_object->dtype_id) * hdf5_data_object->num_subchannels));
-	else /* complex */
-		status = H5Dwrite(hdf5_data_object->dataset, hdf5_data_object->complex_dtype_id, hdf5_data_object->memspace,
-						  hdf5_data_object->filespace, H5P_DEFAULT,
-						  (char *)vector + (samples_written * H5Tget_size(hdf5_data_object->dtype_id) * 2* hdf5_data_object->num_subchannels));
+Digital_rf_write_hub * digital_rf_create_write_hub(int num_threads, int precreate)
+/* digital_rf_create_write_hub creates a hub of I/O threads shared by the writers of many channels
+ *
+ * Inputs:
+ * 		int num_threads - number of I/O threads, 1 or more.  Usually far fewer than channels.
+ * 		int precreate - 1 to have idle threads prepare each channel's next file, as digital_rf_set_precreate
+ * 			does with a thread per channel, 0 to create files at rollover
+ *
+ * 	Writers are added with digital_rf_hub_add_channel.  Each then queues its writes into a ring of its own as in
+ * 	digital_rf_set_async, but the rings are written by the threads of the hub: a free thread takes the channel
+ * 	with the longest backlog and writes all it has queued, so at most num_threads channels hit the disk at once
+ * 	and a channel that falls behind is served first.  All channels cross a file_cadence_millisecs boundary
+ * 	together, since file names follow sample times; with precreate the file creation that would pile up there
+ * 	is instead done for each channel in turn while the threads have no writes to do, leaving a rename at the
+ * 	boundary.  Needs a thread-safe Hdf5 build.  Not available on Windows.
+ *
+ * 	Returns the hub, or NULL if failure
+ */
+{
+#ifndef _WIN32
+	Digital_rf_write_hub * hub;
+	hbool_t is_ts = 0;
+	int i;
 
-	if (status < 0)
+	if (num_threads < 1)
 	{
-		H5Eprint(H5E_DEFAULT, stderr);
-		hdf5_data_object->has_failure = 1;
-		free(rf_data_index_arr);
-		return(0);
+		fprintf(stderr, "Illegal num_threads %i, must be at least 1\n", num_threads);
+		return(NULL);
 	}
-
-	/* write rf_data_index dataset */
-	if (block_index_len > 0)
+	H5is_library_threadsafe(&is_ts);
+	if (!is_ts)
 	{
-		if (digital_rf_write_rf_data_index(hdf5_data_object, rf_data_index_arr, block_index_len))
-		{
-			free(rf_data_index_arr);
-			return(0);
-		}
+		fprintf(stderr, "digital_rf_create_write_hub needs a thread-safe Hdf5 library\n");
+		return(NULL);
 	}
 
-	/* advance state */
-	hdf5_data_object->dataset_index += samples_to_write;
-	hdf5_data_object->dataset_avail -= samples_to_write;
-	/* update global_index - see meaning of rf_data_index_arr and block_index_len for logic.
-	 * Basically using last line and counting extra samples after last global index */
-	if (block_index_len > 0)
+	if ((hub = (Digital_rf_write_hub *)calloc(1, sizeof(Digital_rf_write_hub))) == NULL
+			|| (hub->threads = (pthread_t *)calloc(num_threads, sizeof(pthread_t))) == NULL)
 	{
-		/* last_global_index is relative to global_start_sample, and it could be
-		 * negative if write is continuous + non-chunked and starts in middle of file */
-		last_global_index = rf_data_index_arr[block_index_len*2 - 2] - hdf5_data_object->global_start_sample;
-		/* dataset_index is adjusted forward when write starts in middle of file
-		 * so any negativity in last_global_index is made up here */
-		samples_after_last_global_index = hdf5_data_object->dataset_index - rf_data_index_arr[block_index_len*2 - 1];
-		hdf5_data_object->global_index = last_global_index + samples_after_last_global_index;
-		free(rf_data_index_arr);
+		fprintf(stderr, "malloc failure - unrecoverable\n");
+		exit(-1);
 	}
-	else
+	hub->precreate = precreate ? 1 : 0;
+	clock_gettime(CLOCK_MONOTONIC, &hub->start);
+	pthread_mutex_init(&hub->lock, NULL);
+	pthread_cond_init(&hub->work, NULL);
+	pthread_cond_init(&hub->idle, NULL);
+	for (i=0; i<num_threads; i++)
 	{
-		/* if no indices were used, then all data written must have been continuous */
-		hdf5_data_object->global_index += samples_to_write;
+		if (pthread_create(&hub->threads[i], NULL, digital_rf_hub_thread, hub))
+		{
+			fprintf(stderr, "Unable to start hub thread %i\n", i);
+			digital_rf_close_write_hub(hub);
+			return(NULL);
+		}
+		hub->num_threads++;
 	}
-
-	assert(hdf5_data_object->dataset_index <= max_samples_this_file); /* debug */
-
-	/* update hdf5_data_object->last_unix_time */
-	computer_time = time(NULL);
-	u_computer_time = (uint64_t)computer_time;
-	hdf5_data_object->last_utc_timestamp = u_computer_time;
-
-	return(samples_to_write);
+	return(hub);
+#else
+	(void)num_threads;
+	(void)precreate;
+	fprintf(stderr, "digital_rf_create_write_hub is not available on Windows\n");
+	return(NULL);
+#endif
 }
 
 
-int digital_rf_create_hdf5_file(Digital_rf_write_object *hdf5_data_object, char * subdir, char * basename,
-								uint64_t samples_to_write, uint64_t samples_left, uint64_t max_samples_this_file)
-/* digital_rf_create_hdf5_file opens a new Hdf5 file
+int digital_rf_hub_add_channel(Digital_rf_write_hub * hub, Digital_rf_write_object *hdf5_data_object,
+		int num_buffers, uint64_t buffer_samples, int block)
+/* digital_rf_hub_add_channel hands all file writing of hdf5_data_object to the threads of hub
  *
  * Inputs:
- * 	Digital_rf_write_object *hdf5_data_object - the Digital_rf_write_object created by digital_rf_create_write_hdf5
- * 	subdir - base subdir to create file in.  May need to be created.
- * 	basename - basename of file to create.
- * 	samples_to_write - number of samples to write in this write call (may need to be expanded later)
- * 	samples_left - number of samples that can possible be written in this file.  If not max_samples_this_file, affects
- * 		dataset_index if not needs_chunking
- *  max_samples_this_file - total number of samples that can be in this file
+ * 		Digital_rf_write_hub * hub - hub created by digital_rf_create_write_hub
+ * 		Digital_rf_write_object *hdf5_data_object - C struct created by digital_rf_create_write_hdf5
+ * 		int num_buffers, uint64_t buffer_samples, int block - ring of the channel, as in digital_rf_set_async
  *
- * 	Creates a file with /rf_data dataset of size (*, 2)
+ * 	Writes, digital_rf_flush_async and digital_rf_get_async_stats then work as in async mode.  The channel
+ * 	leaves the hub when closed with digital_rf_close_write_hdf5 or digital_rf_close_write_hub.  Must be called
+ * 	before the first write, instead of digital_rf_set_async and digital_rf_set_precreate.
  *
  * 	Returns 0 if success, -1 if failure
- *
  */
 {
-	/* local variables */
-	char datasetname[] = "rf_data";
-	char fullname[BIG_HDF5_STR] = "";
-	char finished_fullname[BIG_HDF5_STR] = "";
-	char error_str[2*BIG_HDF5_STR] = "";
-	uint64_t num_rows = 0;
-	hsize_t  dims[2]  = {0, hdf5_data_object->num_subchannels};
-	hsize_t  maxdims[2] = {max_samples_this_file, hdf5_data_object->num_subchannels};
+#ifndef _WIN32
+	struct drf_async_writer * async;
+	struct drf_precreate * precreate = NULL;
 
-    if (hdf5_data_object->marching_dots)
-    {
-		printf(".");
-		fflush(stdout);
-    }
-
-    if (hdf5_data_object->hdf5_file != 0)
+	if (hdf5_data_object->present_seq != -1 || hdf5_data_object->async != NULL
+			|| hdf5_data_object->precreate != NULL)
 	{
-		/* close previous file */
-		H5Dclose (hdf5_data_object->dataset);
-		hdf5_data_object->dataset = 0;
-		H5Dclose (hdf5_data_object->index_dataset);
-		hdf5_data_object->index_dataset = 0;
-		H5Sclose (hdf5_data_object->dataspace);
-		hdf5_data_object->dataspace = 0;
-		if (hdf5_data_object->filespace)
-		{
-			H5Sclose (hdf5_data_object->filespace);
-			hdf5_data_object->filespace = 0;
-		}
-		if (hdf5_data_object->memspace)
+		fprintf(stderr, "digital_rf_hub_add_channel must be called before the first write, without "
+				"digital_rf_set_async or digital_rf_set_precreate\n");
+		return(-1);
+	}
+	if ((async = digital_rf_alloc_async(hdf5_data_object, num_buffers, buffer_samples, block)) == NULL)
+		return(-1);
+	async->hub = hub;
+	if (hub->precreate)
+	{
+		if ((precreate = (struct drf_precreate *)calloc(1, sizeof(struct drf_precreate))) == NULL)
 		{
-			H5Sclose (hdf5_data_object->memspace);
-			hdf5_data_object->memspace = 0;
+			fprintf(stderr, "malloc failure - unrecoverable\n");
+			exit(-1);
 		}
-		H5Fclose (hdf5_data_object->hdf5_file);
-		hdf5_data_object->hdf5_file = 0;
-		hdf5_data_object->dataset_index = 0;
-
-		/* now rename this closed file */
-		digital_rf_close_hdf5_file(hdf5_data_object);
-
+		precreate->state = DRF_PRECREATE_IDLE;
+		precreate->hub = hub;
+		pthread_mutex_init(&precreate->lock, NULL);
+		pthread_cond_init(&precreate->changed, NULL);
 	}
 
-	hdf5_data_object->present_seq++; /* indicates the creation of a new file */
-
-	/* create new directory if needed */
-	if (hdf5_data_object->sub_directory == NULL || digital_rf_check_hdf5_directory(subdir)
-			|| strcmp(hdf5_data_object->sub_directory, subdir))
+	pthread_mutex_lock(&hub->lock);
+	if (hub->num_channels == hub->channel_capacity)
 	{
-		if (digital_rf_create_new_directory(hdf5_data_object, subdir))
-			return(-1);
+		hub->channel_capacity = hub->channel_capacity ? 2 * hub->channel_capacity : 16;
+		hub->channels = (drf_hub_channel *)realloc(hub->channels, hub->channel_capacity * sizeof(drf_hub_channel));
+		if (!hub->channels)
+		{
+			fprintf(stderr, "Realloc failure\n");
+			exit(-22);
+		}
 	}
+	hdf5_data_object->async = async;
+	hdf5_data_object->precreate = precreate;
+	hub->channels[hub->num_channels].obj = hdf5_data_object;
+	hub->channels[hub->num_channels].busy = 0;
+	hub->num_channels++;
+	pthread_mutex_unlock(&hub->lock);
+	return(0);
+#else
+	(void)hub;
+	(void)hdf5_data_object;
+	(void)num_buffers;
+	(void)buffer_samples;
+	(void)block;
+	fprintf(stderr, "digital_rf_hub_add_channel is not available on Windows\n");
+	return(-1);
+#endif
+}
 
 
-	strcpy(fullname, hdf5_data_object->directory); /* previous check ensures these three commands succeed */
-	strcat(fullname, "/");
-	strcat(fullname, hdf5_data_object->sub_directory);
-	strcat(fullname, "/");
-	strcpy(hdf5_data_object->basename, basename);
-	strcat(fullname, hdf5_data_object->basename);
+int digital_rf_get_hub_stats(Digital_rf_write_hub * hub, uint64_t * bytes_written, double * bytes_per_sec,
+		int * backlog, int * max_backlog, uint64_t * stalls, uint64_t * overflows)
+/* digital_rf_get_hub_stats reports the throughput and backlog of all channels of hub together
+ *
+ * Inputs:
+ * 		Digital_rf_write_hub * hub - hub created by digital_rf_create_write_hub
+ * 		uint64_t * bytes_written - set to the bytes of samples written by the hub so far
+ * 		double * bytes_per_sec - set to bytes_written over the time since the hub was created
+ * 		int * backlog - set to the number of buffers queued across all channels and not yet written
+ * 		int * max_backlog - set to the largest backlog so far
+ * 		uint64_t * stalls, uint64_t * overflows - set to the sums over the open channels of the counts of
+ * 			digital_rf_get_async_stats
+ *
+ * 	Any of the outputs may be NULL.
+ *
+ * 	Returns 0 if success, -1 if failure
+ */
+{
+#ifndef _WIN32
+	struct drf_async_writer * async;
+	struct timespec now;
+	double secs;
+	uint64_t channel_stalls = 0, channel_overflows = 0;
+	int i;
 
-	/* check if file exists with the finished name, fail if it does */
-	strcpy(finished_fullname, hdf5_data_object->directory);
-	strcat(finished_fullname, "/");
-	strcat(finished_fullname, hdf5_data_object->sub_directory);
-	strcat(finished_fullname, "/");
-	strcat(finished_fullname, strstr(hdf5_data_object->basename, "rf"));
-	if( access( finished_fullname, F_OK ) != -1 )
+	pthread_mutex_lock(&hub->lock);
+	for (i=0; i<hub->num_channels; i++)
 	{
-		snprintf(error_str, sizeof(error_str), "The following Hdf5 file already exists: %s\n", finished_fullname);
-		fprintf(stderr, "%s", error_str);
-		return(-1);
+		async = hub->channels[i].obj->async;
+		pthread_mutex_lock(&async->lock);
+		channel_stalls += async->stalls;
+		channel_overflows += async->overflows;
+		pthread_mutex_unlock(&async->lock);
 	}
-
-	/* Create a new file. If file exists will fail. */
-	hdf5_data_object->hdf5_file = H5Fcreate (fullname, H5F_ACC_EXCL, H5P_DEFAULT, H5P_DEFAULT);
-	if (hdf5_data_object->hdf5_file < 0)
+	if (bytes_written)
+		*bytes_written = hub->bytes_written;
+	if (bytes_per_sec)
 	{
-		snprintf(error_str, sizeof(error_str), "The following Hdf5 file could not be created, or already exists: %s\n", fullname);
-		fprintf(stderr, "%s", error_str);
-		hdf5_data_object->has_failure = 1;
-		hdf5_data_object->hdf5_file = 0;
-		return(-1);
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		secs = (now.tv_sec - hub->start.tv_sec) + (now.tv_nsec - hub->start.tv_nsec) / 1e9;
+		*bytes_per_sec = (secs > 0.0) ? hub->bytes_written / secs : 0.0;
 	}
+	if (backlog)
+		*backlog = hub->queued;
+	if (max_backlog)
+		*max_backlog = hub->max_queued;
+	pthread_mutex_unlock(&hub->lock);
+	if (stalls)
+		*stalls = channel_stalls;
+	if (overflows)
+		*overflows = channel_overflows;
+	return(0);
+#else
+	(void)hub;
+	(void)bytes_written;
+	(void)bytes_per_sec;
+	(void)backlog;
+	(void)max_backlog;
+	(void)stalls;
+	(void)overflows;
+	return(-1);
+#endif
+}
 
-	/* now we add the dataset to create */
-	if (hdf5_data_object->needs_chunking)
-		num_rows = samples_to_write;
-	else
-		num_rows = max_samples_this_file;
-	dims[0] = num_rows;
-	/* Create the data space with set dimensions. */
-	if (hdf5_data_object->dataspace)
-			H5Sclose (hdf5_data_object->dataspace);
-	hdf5_data_object->dataspace = H5Screate_simple (hdf5_data_object->rank, dims, maxdims);
-	/* create the dataset */
-	if (hdf5_data_object->dataset)
-			H5Dclose (hdf5_data_object->dataset);
 
-	if (hdf5_data_object->is_complex == 0)
-		hdf5_data_object->dataset = H5Dcreate2 (hdf5_data_object->hdf5_file, datasetname,
-												hdf5_data_object->dtype_id,
-												hdf5_data_object->dataspace, H5P_DEFAULT,
-												hdf5_data_object->dataset_prop, H5P_DEFAULT);
-	else
-		hdf5_data_object->dataset = H5Dcreate2 (hdf5_data_object->hdf5_file, datasetname,
-												hdf5_data_object->complex_dtype_id,
-												hdf5_data_object->dataspace, H5P_DEFAULT,
-												hdf5_data_object->dataset_prop, H5P_DEFAULT);
+int digital_rf_close_write_hub(Digital_rf_write_hub * hub)
+/* digital_rf_close_write_hub closes every channel still on hub with digital_rf_close_write_hdf5, then stops the
+ * threads and frees hub
+ *
+ * 	Returns 0, or the first non-zero result of closing a channel
+ */
+{
+#ifndef _WIN32
+	Digital_rf_write_object * hdf5_data_object;
+	int result = 0, channel_result, i;
 
-	if (hdf5_data_object->needs_chunking)
-		hdf5_data_object->dataset_index = 0;        /* next write will be to first row */
-	else
-		hdf5_data_object->dataset_index = max_samples_this_file - samples_left;
+	pthread_mutex_lock(&hub->lock);
+	while (hub->num_channels > 0)
+	{
+		hdf5_data_object = hub->channels[0].obj;
+		pthread_mutex_unlock(&hub->lock);
+		channel_result = digital_rf_close_write_hdf5(hdf5_data_object);
+		if (channel_result && !result)
+			result = channel_result;
+		pthread_mutex_lock(&hub->lock);
+	}
+	hub->stop = 1;
+	pthread_cond_broadcast(&hub->work);
+	pthread_mutex_unlock(&hub->lock);
+	for (i=0; i<hub->num_threads; i++)
+		pthread_join(hub->threads[i], NULL);
+
+	free(hub->channels);
+	free(hub->threads);
+	pthread_mutex_destroy(&hub->lock);
+	pthread_cond_destroy(&hub->work);
+	pthread_cond_destroy(&hub->idle);
+	free(hub);
+	return(result);
+#else
+	(void)hub;
+	return(-1);
+#endif
+}
 
-	hdf5_data_object->dataset_avail = num_rows; /* size available to next write */
 
-	/* last we add metadata */
-	digital_rf_write_metadata(hdf5_data_object);
-	return(0);
-}
 
 
-int digital_rf_close_hdf5_file(Digital_rf_write_object *hdf5_data_object)
-/* digital_rf_close_hdf5_file closes the present hdf5 file by removing the tmp. part of the file name
+
+char * digital_rf_get_last_file_written(Digital_rf_write_object *hdf5_data_object)
+/* digital_rf_get_last_file_written returns a malloced string containing the full path to the last hdf5 file written to
  *
  * Inputs:
- * 	Digital_rf_write_object *hdf5_data_object - the Digital_rf_write_object created by digital_rf_create_write_hdf5
- *
- * 	Renames last file written to by removing tmp. at beginning of basename, if it exists.  Returns success if it does not exist.
- *
- * 	Returns 0 if success, -1 if failure
+ * 		Digital_rf_write_object *hdf5_data_object - C struct created by digital_rf_create_write_hdf5
  *
+ * 	Returns:
+ * 		char * containing the full path to the last hdf5 file written to. User is responsible for freeing string when done.
+ * 		Returns empty string if no data written.
  */
 {
 	/* local variables */
-	char fullname[BIG_HDF5_STR] = "";
-	char new_fullfilename[BIG_HDF5_STR] = "";
-
-	if (hdf5_data_object->directory == NULL ||
-			hdf5_data_object->sub_directory == NULL)
-		return(0); /* nothing to close */
+	char fullpath[BIG_HDF5_STR] = ""; 	/* to be set to the full path */
+	char * ret_str;  /* string to be malloced */
 
-	strcpy(fullname, hdf5_data_object->directory);
-	strcat(fullname, "/");
-	strcat(fullname, hdf5_data_object->sub_directory);
-	strcat(fullname, "/");
-	strcat(fullname, hdf5_data_object->basename);
+	/* the writer thread, if any, owns this state until it is done */
+	digital_rf_flush_async(hdf5_data_object);
 
-	strcpy(new_fullfilename, hdf5_data_object->directory);
-	strcat(new_fullfilename, "/");
-	strcat(new_fullfilename, hdf5_data_object->sub_directory);
-	strcat(new_fullfilename, "/");
-	strcat(new_fullfilename, strstr(hdf5_data_object->basename, "rf"));
+	if (hdf5_data_object->sub_directory == NULL)
+	{
+		/* no data written yet */
+		if ((ret_str = (char *)malloc(sizeof(char) * (2)))==0)
+		{
+			fprintf(stderr, "malloc failure - unrecoverable\n");
+			exit(-1);
+		}
+		strcpy(ret_str, "");
+		return(ret_str);
+	}
 
-	if( access( fullname, F_OK ) != -1 )
-		/* remove file if error has occurred, rename otherwise */
-		if (hdf5_data_object->has_failure)
-			return(remove(fullname));
-		else
-			return(rename(fullname, new_fullfilename));
-	else
-		return(0); /* file already closed */
+	strcpy(fullpath, hdf5_data_object->directory);
+	strcat(fullpath, "/");
+	strcat(fullpath, hdf5_data_object->sub_directory);
+	strcat(fullpath, "/");
+	strcat(fullpath, strstr(hdf5_data_object->basename, "rf"));
+	if ((ret_str = (char *)malloc(sizeof(char) * (strlen(fullpath)+2)))==0)
+	{
+		fprintf(stderr, "malloc failure - unrecoverable\n");
+		exit(-1);
+	}
+	strcpy(ret_str, fullpath);
+	return(ret_str);
 }
 
 
-int digital_rf_create_new_directory(Digital_rf_write_object *hdf5_data_object, char * subdir)
-/* digital_rf_create_new_directory creates a new subdirectory to store Hdf5 files in
- *
- * 	Digital_rf_write_object *hdf5_data_object - the Digital_rf_write_object created by digital_rf_create_write_hdf5
- * 	subdir - base subdir to create.
- *
- * Affects: sets hdf5_data_object->sub_directory.
+char * digital_rf_get_last_dir_written(Digital_rf_write_object *hdf5_data_object)
+/* digital_rf_get_last_dir_written returns a malloced string containing the full path to the last dir written to
  *
- * Returns 0 if success, -1 if failure. Fails if this directory can't be written.
+ * Inputs:
+ * 		Digital_rf_write_object *hdf5_data_object - C struct created by digital_rf_create_write_hdf5
  *
+ * 	Returns:
+ * 		char * containing the full path to the last directory written to. User is responsible for freeing string when done.
+ * 		Returns empty string if no data written.
  */
 {
 	/* local variables */
-	char full_directory[BIG_HDF5_STR] = "";
-	int result;
+	char fullpath[BIG_HDF5_STR] = ""; 	/* to be set to the full path */
+	char * ret_str;  /* string to be malloced */
 
-	strcpy(full_directory, hdf5_data_object->directory);
-	strcat(full_directory, "/");
-	strcat(full_directory, subdir);
+	/* the writer thread, if any, owns this state until it is done */
+	digital_rf_flush_async(hdf5_data_object);
 
-	#if defined(_WIN32)
-		result = _mkdir(full_directory);
-	#else
-		result = mkdir(full_directory, S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
-	#endif
-	if (result && errno != EEXIST)
+	if (hdf5_data_object->sub_directory == NULL)
 	{
-		fprintf(stderr, "Unable to create directory %s\n", full_directory);
-		hdf5_data_object->has_failure = 1;
-		return(-1);
+		/* no data written yet */
+		if ((ret_str = (char *)malloc(sizeof(char) * (2)))==0)
+		{
+			fprintf(stderr, "malloc failure - unrecoverable\n");
+			exit(-1);
+		}
+		strcpy(ret_str, "");
+		return(ret_str);
 	}
 
-	if (hdf5_data_object->sub_directory != NULL)
-		free(hdf5_data_object->sub_directory);
-
-	if ((hdf5_data_object->sub_directory = (char *)malloc(sizeof(char) * (strlen(subdir)+2)))==0)
+	strcpy(fullpath, hdf5_data_object->directory);
+	strcat(fullpath, "/");
+	strcat(fullpath, hdf5_data_object->sub_directory);
+	strcat(fullpath, "/");
+	if ((ret_str = (char *)malloc(sizeof(char) * (strlen(fullpath)+2)))==0)
 	{
 		fprintf(stderr, "malloc failure - unrecoverable\n");
 		exit(-1);
 	}
-	strcpy(hdf5_data_object->sub_directory, subdir);
-	return(0);
+	strcpy(ret_str, fullpath);
+	return(ret_str);
 }
 
 
 
-int digital_rf_set_fill_value(Digital_rf_write_object *hdf5_data_object)
-/* digital_rf_set_fill_value sets the fill value property in hdf5_data_object->dataset_prop according to dtype_id.
+uint64_t digital_rf_get_last_write_time(Digital_rf_write_object *hdf5_data_object)
+/* digital_rf_get_last_write_time returns the unix timestamp of the last write
  *
- * Returns 0 if success, -1 if failure
+ * Inputs:
+ * 		Digital_rf_write_object *hdf5_data_object - C struct created by digital_rf_create_write_hdf5
+ *
+ * 	Returns: uint64_t representing the unix timestamp of the last write.  If no writes occurred yet, returns 0.
  */
 {
-	/* local variables */
+	/* the writer thread, if any, owns this state until it is done */
+	digital_rf_flush_async(hdf5_data_object);
+	return(hdf5_data_object->last_utc_timestamp);
+}
 
-	/* integer minimum values, first value is matching byte order, second is reversed byte order */
 
-	int64_t minUnsignedInt = 0;
+int digital_rf_close_write_hdf5(Digital_rf_write_object *hdf5_data_object)
+/* digital_rf_close_write_hdf5 closes open Hdf5 file if needed and releases all memory associated with hdf5_data_object
+ *
+ * Inputs:
+ * 		Digital_rf_write_object *hdf5_data_object - C struct created by digital_rf_create_write_hdf5
+ *
+ * 	In async mode (see digital_rf_set_async), first waits for the writer thread to write everything queued.
+ *
+ * 	Returns 0, or in async mode the result of the first write that failed on the writer thread
+ */
+{
+	int result = 0;
 
-	/* char */
-	int8_t minChar = INT8_MIN;
-	struct complex_char_fill_type { int8_t r, i; };
-	struct complex_char_fill_type complex_char_fill = { minChar, minChar };
-	struct complex_uchar_fill_type { uint8_t r, i; };
-	struct complex_uchar_fill_type complex_uchar_fill = { 0, 0 };
+	if (hdf5_data_object != NULL)
+	{
+#ifndef _WIN32
+		/* let the writer thread finish everything queued first */
+		if (hdf5_data_object->async != NULL)
+			result = digital_rf_end_async(hdf5_data_object);
+		/* then remove any file prepared ahead of time */
+		if (hdf5_data_object->precreate != NULL)
+			digital_rf_end_precreate(hdf5_data_object);
+#endif
 
-	/* short */
-	int16_t minShort[2] = {INT16_MIN, 128};
-	struct complex_short_fill_type { int16_t r, i; };
-	struct complex_short_fill_type complex_short_fill[2] = { {minShort[0], minShort[0]}, {minShort[1], minShort[1]} };
-	struct complex_ushort_fill_type { uint16_t r, i; };
-	struct complex_ushort_fill_type complex_ushort_fill = { 0, 0 };
-
-	/* int */
-	int32_t minInt[2] = {INT32_MIN, 128};
-	struct complex_int_fill_type { int32_t r, i; };
-	struct complex_int_fill_type complex_int_fill[2] = { {minInt[0], minInt[0]}, {minInt[1], minInt[1]} };
-	struct complex_uint_fill_type { uint32_t r, i; };
-	struct complex_uint_fill_type complex_uint_fill = { 0, 0 };
-
-	/* int64 */
-	int64_t minLLong[2] = {INT64_MIN, 128};
-	struct complex_long_fill_type { int64_t r, i; };
-	struct complex_long_fill_type complex_long_fill[2] = { {minLLong[0], minLLong[0]}, {minLLong[1], minLLong[1]} };
-	struct complex_ulong_fill_type { uint64_t r, i; };
-	struct complex_ulong_fill_type complex_ulong_fill = { 0, 0 };
-
-	// float
-	#if defined(_MSC_VER) && _MSC_VER < 1900
-		float float_fill = (float) HUGE_VAL * 0.0f;  /* NAN but works in C89 (MSVC++ 2008)*/
-	#else
-		float float_fill = NAN;
-	#endif
-	struct complex_float_fill_type { float r, i; };
-	struct complex_float_fill_type complex_float_fill = { float_fill, float_fill };
-
-	// double
-	#if defined(_MSC_VER) && _MSC_VER < 1900
-		double double_fill = HUGE_VAL * 0.0;  /* NAN but works in C89 (MSVC++ 2008)*/
-	#else
-		double double_fill = NAN;
-	#endif
-	struct complex_double_fill_type { double r, i; };
-	struct complex_double_fill_type complex_double_fill = { double_fill, double_fill };
-
-	char error_str[SMALL_HDF5_STR] = "";
-	H5T_class_t classType;
-	H5T_sign_t signType;
-	int numBytes;
-	int endian_flip, write_endian;
-
-	/* found out if the output endian differs from the host endian */
-	endian_flip = 0;
-	write_endian = H5Tget_order(hdf5_data_object->dtype_id);
-	if (write_endian == H5T_ORDER_ERROR)
-	{
-		H5Eprint(H5E_DEFAULT, stderr);
-		return(-1);
-	}
-	if (digital_rf_is_little_endian() && (write_endian == H5T_ORDER_BE))
-		endian_flip = 1;
-	else if ((!digital_rf_is_little_endian()) && (write_endian == H5T_ORDER_LE))
-		endian_flip = 1;
+		/* commit the chunks still being encoded, then stop their threads */
+		if (digital_rf_finish_chunks(hdf5_data_object))
+		{
+			hdf5_data_object->has_failure = 1;
+			result = -1;
+		}
+#ifdef DRF_ENCODE_THREADS
+		if (hdf5_data_object->chunk_pool != NULL)
+			digital_rf_end_chunk_pool(hdf5_data_object);
+#endif
 
-	/* find out whether we are using integers or floats */
-	classType = H5Tget_class( hdf5_data_object->dtype_id );
-	if (classType == H5T_NO_CLASS)
-	{
-		H5Eprint(H5E_DEFAULT, stderr);
-		return(-1);
-	}
-	/* get number of bytes for type */
-	numBytes = (int)H5Tget_size(hdf5_data_object->dtype_id);
-	if (numBytes == 0)
-	{
-		H5Eprint(H5E_DEFAULT, stderr);
-		return(-1);
-	}
+		/* write out any /rf_data_index rows still held */
+		if (digital_rf_flush_rf_data_index(hdf5_data_object))
+		{
+			hdf5_data_object->has_failure = 1;
+			result = -1;
+		}
+		if (digital_rf_end_direct_file(hdf5_data_object))
+		{
+			hdf5_data_object->has_failure = 1;
+			result = -1;
+		}
+#ifdef DRF_DIRECT_IO
+		if (hdf5_data_object->direct_io != NULL)
+			digital_rf_free_direct_io(hdf5_data_object);
+#endif
 
-	if (classType == H5T_FLOAT && hdf5_data_object->is_complex == 0 && numBytes == 4)
-	{
-		H5Pset_fill_value(hdf5_data_object->dataset_prop, hdf5_data_object->dtype_id, &float_fill);
-	}
-	else if (classType == H5T_FLOAT && hdf5_data_object->is_complex == 0 && numBytes == 8)
-	{
-		H5Pset_fill_value(hdf5_data_object->dataset_prop, hdf5_data_object->dtype_id, &double_fill);
-	}
-	else if (classType == H5T_FLOAT && hdf5_data_object->is_complex != 0 && numBytes == 4)
-	{
-		H5Pset_fill_value(hdf5_data_object->dataset_prop, hdf5_data_object->complex_dtype_id, &complex_float_fill);
-	}
-	else if (classType == H5T_FLOAT && hdf5_data_object->is_complex != 0 && numBytes == 8)
-	{
-		H5Pset_fill_value(hdf5_data_object->dataset_prop, hdf5_data_object->complex_dtype_id, &complex_double_fill);
-	}
-	else if (classType == H5T_INTEGER)
-	{
-		/* find out if integer is signed */
-		signType = H5Tget_sign(hdf5_data_object->dtype_id);
-		if (signType == H5T_SGN_ERROR)
+		/* close file */
+		if (hdf5_data_object->dataset)
 		{
-			H5Eprint(H5E_DEFAULT, stderr);
-			return(-1);
+			digital_rf_end_sidecar_file(hdf5_data_object);
+			H5Dclose (hdf5_data_object->dataset);
+			hdf5_data_object->dataset = 0;
 		}
-		if (hdf5_data_object->is_complex == 0)
+		if (hdf5_data_object->index_dataset)
 		{
-			if (signType == H5T_SGN_NONE)
-				H5Pset_fill_value(hdf5_data_object->dataset_prop, hdf5_data_object->dtype_id, &minUnsignedInt);
-			else
-			{
-				switch(numBytes)
-				{
-					case 1:
-						H5Pset_fill_value(hdf5_data_object->dataset_prop, hdf5_data_object->dtype_id, &minChar);
-						break;
-					case 2:
-						H5Pset_fill_value(hdf5_data_object->dataset_prop, hdf5_data_object->dtype_id, &minShort[endian_flip]);
-						break;
-					case 4:
-						H5Pset_fill_value(hdf5_data_object->dataset_prop, hdf5_data_object->dtype_id, &minInt[endian_flip]);
-						break;
-					case 8:
-						H5Pset_fill_value(hdf5_data_object->dataset_prop, hdf5_data_object->dtype_id, &minLLong[endian_flip]);
-						break;
-					default:
-						snprintf(error_str, SMALL_HDF5_STR, "Integer type has unexpected number of bytes: %i\n", numBytes);
-						fprintf(stderr, "%s", error_str);
-						return(-1);
-				}
-			}
+			H5Dclose (hdf5_data_object->index_dataset);
+			hdf5_data_object->index_dataset = 0;
 		}
-		else /* complex data */
+		if (hdf5_data_object->index_filespace)
 		{
-			switch(numBytes)
+			H5Sclose (hdf5_data_object->index_filespace);
+			hdf5_data_object->index_filespace = 0;
+		}
+		if (hdf5_data_object->dataspace)
+		{
+			H5Sclose (hdf5_data_object->dataspace);
+			hdf5_data_object->dataspace = 0;
+		}
+		if (hdf5_data_object->filespace)
+		{
+			H5Sclose (hdf5_data_object->filespace);
+			hdf5_data_object->filespace = 0;
+		}
+		if (hdf5_data_object->memspace)
+		{
+			H5Sclose (hdf5_data_object->memspace);
+			hdf5_data_object->memspace = 0;
+		}
+		if (hdf5_data_object->hdf5_file)
+		{
+			if (digital_rf_write_memory_file(hdf5_data_object))
 			{
-				case 1:
-					if (signType == H5T_SGN_NONE)
-						H5Pset_fill_value(hdf5_data_object->dataset_prop, hdf5_data_object->complex_dtype_id, &complex_uchar_fill);
-					else
-						H5Pset_fill_value(hdf5_data_object->dataset_prop, hdf5_data_object->complex_dtype_id, &complex_char_fill);
-					break;
-				case 2:
-					if (signType == H5T_SGN_NONE)
-						H5Pset_fill_value(hdf5_data_object->dataset_prop, hdf5_data_object->complex_dtype_id,
-								&complex_ushort_fill);
-					else
-						H5Pset_fill_value(hdf5_data_object->dataset_prop, hdf5_data_object->complex_dtype_id,
-								&complex_short_fill[endian_flip]);
-					break;
-				case 4:
-					if (signType == H5T_SGN_NONE)
-						H5Pset_fill_value(hdf5_data_object->dataset_prop, hdf5_data_object->complex_dtype_id,
-								&complex_uint_fill);
-					else
-						H5Pset_fill_value(hdf5_data_object->dataset_prop, hdf5_data_object->complex_dtype_id,
-								&complex_int_fill[endian_flip]);
-					break;
-				case 8:
-					if (signType == H5T_SGN_NONE)
-						H5Pset_fill_value(hdf5_data_object->dataset_prop, hdf5_data_object->complex_dtype_id,
-								&complex_ulong_fill);
-					else
-						H5Pset_fill_value(hdf5_data_object->dataset_prop, hdf5_data_object->complex_dtype_id,
-								&complex_long_fill[endian_flip]);
-					break;
-				default:
-					snprintf(error_str, SMALL_HDF5_STR, "Integer type has unexpected number of bytes: %i\n", numBytes);
-					fprintf(stderr, "%s", error_str);
-					return(-1);
+				hdf5_data_object->has_failure = 1;
+				result = -1;
 			}
+			H5Fclose (hdf5_data_object->hdf5_file);
+			hdf5_data_object->hdf5_file = 0;
 		}
+		hdf5_data_object->dataset_index = 0;
 
-	}
-	else
-	{
-		fprintf(stderr, "Hdf5 datatype passed into dtype_id is neither integer nor float - aborting\n");
-		return(-1);
-	}
-	return(0);
+		/* rename closed file to finalized name (or delete if errored) */
+		digital_rf_close_hdf5_file(hdf5_data_object);
 
+#ifndef _WIN32
+		/* finish the open staging file, or remove the staging file packed into the file just finalized */
+		if (digital_rf_end_staging_file(hdf5_data_object))
+			result = -1;
+		if (!hdf5_data_object->has_failure && digital_rf_unlink_packed_staging(hdf5_data_object))
+			result = -1;
+#endif
+
+		/* finally free all resources in hdf5_data_object */
+		digital_rf_free_hdf5_data_object(hdf5_data_object);
+	}
+	return(result);
 }
 
 
-void digital_rf_write_metadata(Digital_rf_write_object *hdf5_data_object)
-/* digital_rf_write_metadata writes the following metadata to the open file:
- *  Fields that match those in the drf_properties.h5 file
- * 	1. uint64_t H5Tget_class (result of H5Tget_class(hdf5_data_object->hdf5_data_object)
- * 	2. uint64_t H5Tget_size (result of H5Tget_size(hdf5_data_object->hdf5_data_object)
- * 	3. uint64_t H5Tget_order (result of H5Tget_order(hdf5_data_object->hdf5_data_object)
- * 	4. uint64_t H5Tget_precision (result of H5Tget_precision(hdf5_data_object->hdf5_data_object)
- * 	5. uint64_t H5Tget_offset (result of H5Tget_offset(hdf5_data_object->hdf5_data_object)
- * 	6. uint64_t subdir_cadence_secs,
- * 	7. uint64_t file_cadence_millisecs
- * 	8. uint64_t sample_rate_numerator
- * 	9. uint64_t sample_rate_denominator
- * 	10. int is_complex
- * 	11. int num_subchannels
- * 	12. int is_continuous
- * 	13. char[] epoch
- * 	14. char[] digital_rf_time_description
- * 	15. char[] digital_rf_version
- *
- * 	Not found in drf_properties.h5 because possibly unique to each file
- * 	1. int sequence_num (incremented for each file)
- * 	2. uint64_t init_utc_timestamp (changes at each restart of the recorder - needed if leapseconds correction applied)
- * 	3. uint64_t computer_time (time of initial file creation)
- * 	4. char[] uuid_str - set independently at each restart of the recorder
+int digital_rf_get_unix_time(uint64_t global_sample, long double sample_rate, int * year, int * month, int *day,
+		                     int * hour, int * minute, int * second, uint64_t * picosecond)
+/* get_unix_time converts a global_sample and a sample rate into year, month, day
+ * 	hour, minute, second, picosecond
  *
- * 	Must match drf_properties.h5, except adds sequence_num
+ *  ***DEPRECATED*** Use digital_rf_get_unix_time_rational instead.
  *
- * Inputs:
- * 	Digital_rf_write_object *hdf5_data_object - the Digital_rf_write_object created by digital_rf_create_write_hdf5
+ * 	Returns 0 if success, -1 if failure.
  *
  */
 {
-	/* local variables */
-	hid_t       attribute_id, dataspace_id;  /* identifiers */
-	hid_t       str_type, str_attribute;
-	time_t      computer_time;
-	int64_t    u_computer_time;
-	uint64_t result;
-
-	dataspace_id = H5Screate(H5S_SCALAR);
+	time_t unix_second;
+	long double unix_remainder;
 
-	/* sequence_num */
-	attribute_id = H5Acreate2 (hdf5_data_object->dataset, "sequence_num", H5T_NATIVE_INT, dataspace_id,
-								 H5P_DEFAULT, H5P_DEFAULT);
-	H5Awrite(attribute_id, H5T_NATIVE_INT, &(hdf5_data_object->present_seq));
-	H5Aclose(attribute_id);
+	/* set values down to second using gmtime */
+	unix_second = (time_t)(global_sample / sample_rate);
+	if (digital_rf_get_time_parts(unix_second, year, month, day, hour, minute, second))
+		return(-1);
 
-	/* H5Tget_class */
-	attribute_id = H5Acreate2 (hdf5_data_object->dataset, "H5Tget_class", H5T_NATIVE_ULLONG, dataspace_id,
-							   H5P_DEFAULT, H5P_DEFAULT);
-	result = (uint64_t)H5Tget_class(hdf5_data_object->dtype_id);
-	H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(result));
-	H5Aclose(attribute_id);
+	/* set picoseconds */
+	if (fmod(sample_rate, 1.0) == 0.0) /* use integer logic when sample rate can be converted to an integer */
+		unix_remainder = (long double)(global_sample - (unix_second * (uint64_t)sample_rate));
+	else
+		unix_remainder = fmodl((long double)global_sample, sample_rate);
+	*picosecond = (uint64_t)floorl((unix_remainder/sample_rate)*1.0E12L + 0.5L);
+	return(0);
+}
 
-	/* H5Tget_size */
-	attribute_id = H5Acreate2 (hdf5_data_object->dataset, "H5Tget_size", H5T_NATIVE_ULLONG, dataspace_id,
-							   H5P_DEFAULT, H5P_DEFAULT);
-	result = (uint64_t)H5Tget_size(hdf5_data_object->dtype_id);
-	H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(result));
-	H5Aclose(attribute_id);
 
-	/* H5Tget_order */
-	attribute_id = H5Acreate2 (hdf5_data_object->dataset, "H5Tget_order", H5T_NATIVE_ULLONG, dataspace_id,
-							   H5P_DEFAULT, H5P_DEFAULT);
-	result = (uint64_t)H5Tget_order(hdf5_data_object->dtype_id);
-	H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(result));
-	H5Aclose(attribute_id);
+int digital_rf_get_timestamp_floor(uint64_t sample_index,
+	uint64_t sample_rate_numerator, uint64_t sample_rate_denominator,
+	uint64_t * second, uint64_t * picosecond)
+/* get_timestamp_floor converts a sample index into the nearest earlier timestamp
+ *  (flooring) divided into second and picosecond parts, using the sample rate
+ *  expressed as a rational fraction.
+ *
+ *  Flooring is used so that sample falls in the window of time represented by
+ *  the returned timestamp, which includes that time up until the next possible
+ *  timestamp: second + [picosecond, picosecond + 1).
+ *
+ * 	Returns 0 if success, -1 if failure.
+ *
+ */
+{
+	uint64_t tmp_div;
+	uint64_t tmp_mod;
+	uint64_t tmp;
 
-	/* H5Tget_precision */
-	attribute_id = H5Acreate2 (hdf5_data_object->dataset, "H5Tget_precision", H5T_NATIVE_ULLONG, dataspace_id,
-							   H5P_DEFAULT, H5P_DEFAULT);
-	result = (uint64_t)H5Tget_precision(hdf5_data_object->dtype_id);
-	H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(result));
-	H5Aclose(attribute_id);
+	/* calculate with divide/modulus split to avoid overflow */
+	/* second = si * d / n = ((si / n) * d) + ((si % n) * d) / n */
+	tmp_div = sample_index / sample_rate_numerator;
+	tmp_mod = sample_index % sample_rate_numerator;
+	*second = tmp_div * sample_rate_denominator;
+	tmp = tmp_mod * sample_rate_denominator;
+	tmp_div = tmp / sample_rate_numerator;
+	tmp_mod = tmp % sample_rate_numerator;
+	*second += tmp_div;
+	/* picoseconds calculated from remainder of division to calculate seconds */
+	/* picsecond = rem * 1e12 / n = rem * (1e12 / n) + (rem * (1e12 % n)) / n */
+	tmp = tmp_mod;
+	tmp_div = 1000000000000 / sample_rate_numerator;
+	tmp_mod = 1000000000000 % sample_rate_numerator;
+	*picosecond = (tmp * tmp_div) + (tmp * tmp_mod / sample_rate_numerator);
 
-	/* H5Tget_offset */
-	attribute_id = H5Acreate2 (hdf5_data_object->dataset, "H5Tget_offset", H5T_NATIVE_ULLONG, dataspace_id,
-							   H5P_DEFAULT, H5P_DEFAULT);
-	result = (uint64_t)H5Tget_offset(hdf5_data_object->dtype_id);
-	H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(result));
-	H5Aclose(attribute_id);
+	return(0);
+}
 
-	/* num_subchannels */
-	attribute_id = H5Acreate2 (hdf5_data_object->dataset, "num_subchannels", H5T_NATIVE_INT, dataspace_id,
-								 H5P_DEFAULT, H5P_DEFAULT);
-	H5Awrite(attribute_id, H5T_NATIVE_INT, &(hdf5_data_object->num_subchannels));
-	H5Aclose(attribute_id);
 
-	/* is_complex */
-	attribute_id = H5Acreate2 (hdf5_data_object->dataset, "is_complex", H5T_NATIVE_INT, dataspace_id,
-								 H5P_DEFAULT, H5P_DEFAULT);
-	H5Awrite(attribute_id, H5T_NATIVE_INT, &(hdf5_data_object->is_complex));
-	H5Aclose(attribute_id);
+int digital_rf_get_sample_ceil(uint64_t second, uint64_t picosecond,
+	uint64_t sample_rate_numerator, uint64_t sample_rate_denominator,
+	uint64_t * sample_index)
+/* get_sample_ceil converts a timestamp (divided into second and picosecond parts)
+ *  into the next nearest sample (ceil), using the sample rate expressed as a
+ *  rational fraction.
+ *
+ *  Ceiling is used to complement the flooring in get_timestamp_floor, so that
+ *  get_sample_ceil(get_timestamp_floor(sample_index)) == sample_index.
+ *
+ * 	Returns 0 if success, -1 if failure.
+ *
+ */
+{
+	uint64_t nanosecond;
+	uint64_t quotient;
+	uint64_t remainder;
+	uint64_t tmp_div;
+	uint64_t tmp_mod;
 
-	/* subdir_cadence_secs */
-	attribute_id = H5Acreate2 (hdf5_data_object->dataset, "subdir_cadence_secs", H5T_NATIVE_ULLONG, dataspace_id,
-								 H5P_DEFAULT, H5P_DEFAULT);
-	H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(hdf5_data_object->subdir_cadence_secs));
-	H5Aclose(attribute_id);
+	/* divide picosecond into nanosecond and remainder so both use < 32 bits */
+	nanosecond = picosecond / 1000;
+	picosecond = picosecond % 1000;
 
-	/* file_cadence_millisecs */
-	attribute_id = H5Acreate2 (hdf5_data_object->dataset, "file_cadence_millisecs", H5T_NATIVE_ULLONG, dataspace_id,
-								 H5P_DEFAULT, H5P_DEFAULT);
-	H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(hdf5_data_object->file_cadence_millisecs));
-	H5Aclose(attribute_id);
+	/* calculate with divide/modulus split to avoid overflow */
+	/* si = ts * n / d = (sec + (nsec / 1e9) + (psec / 1e12)) * n / d */
 
-	/* is_continuous */
-	attribute_id = H5Acreate2 (hdf5_data_object->dataset, "is_continuous", H5T_NATIVE_INT, dataspace_id,
-								 H5P_DEFAULT, H5P_DEFAULT);
-	H5Awrite(attribute_id, H5T_NATIVE_INT, &(hdf5_data_object->is_continuous));
-	H5Aclose(attribute_id);
+	/* start with picosecond part */
+	tmp_div = picosecond / sample_rate_denominator;
+	tmp_mod = picosecond % sample_rate_denominator;
+	tmp_div *= sample_rate_numerator;
+	tmp_mod *= sample_rate_numerator;
+	tmp_div += tmp_mod / sample_rate_denominator;
+	tmp_mod = tmp_mod % sample_rate_denominator;
+	/* quotient and remainder are in terms of (samples * 1e12) */
+	quotient = tmp_div;
+	remainder = tmp_mod;  /* remainder w.r.t sample_rate_denominator */
 
-	/* sample_rate_numerator */
-	attribute_id = H5Acreate2 (hdf5_data_object->dataset, "sample_rate_numerator", H5T_NATIVE_ULLONG, dataspace_id,
-								 H5P_DEFAULT, H5P_DEFAULT);
-	H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(hdf5_data_object->sample_rate_numerator));
-	H5Aclose(attribute_id);
+	/* multiply and divide nanosecond part */
+	tmp_div = nanosecond / sample_rate_denominator;
+	tmp_mod = nanosecond % sample_rate_denominator;
+	tmp_div *= sample_rate_numerator;
+	tmp_mod *= sample_rate_numerator;
+	tmp_div += tmp_mod / sample_rate_denominator;
+	tmp_mod = tmp_mod % sample_rate_denominator;
+	/* consolidate: tmp_div + tmp_mod / d + quotient / 1e3 + remainder / 1e3 / d */
+	/* add nanosecond remainder to picosecond part in terms of (samples * 1e12) */
+	remainder += tmp_mod * 1000;
+	quotient += remainder / sample_rate_denominator;
+	remainder = remainder % sample_rate_denominator;
+	/* now have: tmp_div + quotient / 1e3 + remainder / 1e3 / d */
+	/* consolidate into a single quotient and remainder */
+	tmp_div += quotient / 1000;
+	quotient = quotient % 1000;
+	remainder += quotient * sample_rate_denominator;
+	quotient = tmp_div;
+	/* now have: quotient + remainder / 1e3 / d */
+	/* update remainder to be in terms of (samples * 1e9) using ceiling rounding */
+	remainder = remainder / 1000 + (remainder % 1000 != 0);
+	/* now have in terms of (samples * 1e9): quotient + remainder / d */
 
-	/* sample_rate_denominator */
-	attribute_id = H5Acreate2 (hdf5_data_object->dataset, "sample_rate_denominator", H5T_NATIVE_ULLONG, dataspace_id,
-								 H5P_DEFAULT, H5P_DEFAULT);
-	H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(hdf5_data_object->sample_rate_denominator));
-	H5Aclose(attribute_id);
+	/* multiply and divide second part */
+	tmp_div = second / sample_rate_denominator;
+	tmp_mod = second % sample_rate_denominator;
+	tmp_div *= sample_rate_numerator;
+	tmp_mod *= sample_rate_numerator;
+	tmp_div += tmp_mod / sample_rate_denominator;
+	tmp_mod = tmp_mod % sample_rate_denominator;
+	/* consolidate: tmp_div + tmp_mod / d + quotient / 1e9 + remainder / 1e9 / d */
+	/* add second remainder to nanosecond part in terms of (samples * 1e9) */
+	remainder += tmp_mod * 1000000000;
+	quotient += remainder / sample_rate_denominator;
+	remainder = remainder % sample_rate_denominator;
+	/* now have: tmp_div + quotient / 1e9 + remainder / 1e9 / d */
+	/* consolidate into a single quotient and remainder */
+	tmp_div += quotient / 1000000000;
+	quotient = quotient % 1000000000;
+	remainder += quotient * sample_rate_denominator;
+	quotient = tmp_div;
+	/* now have: quotient + remainder / 1e9 / d */
+	/* update remainder to be in terms of samples using ceiling rounding */
+	remainder = remainder / 1000000000 + (remainder % 1000000000 != 0);
+	/* now have in terms of samples: quotient + remainder / d */
+	/* finally ceiling round remainder into quotient */
+	quotient += (remainder != 0);
 
-	/* init_utc_timestamp */
-	attribute_id = H5Acreate2 (hdf5_data_object->dataset, "init_utc_timestamp", H5T_NATIVE_ULLONG, dataspace_id,
-								 H5P_DEFAULT, H5P_DEFAULT);
-	H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(hdf5_data_object->init_utc_timestamp));
-	H5Aclose(attribute_id);
+	*sample_index = quotient;
 
+	return(0);
+}
 
-	/* computer time */
-	attribute_id = H5Acreate2 (hdf5_data_object->dataset, "computer_time", H5T_NATIVE_ULLONG, dataspace_id,
-								 H5P_DEFAULT, H5P_DEFAULT);
-	computer_time = time(NULL);
-	u_computer_time = (uint64_t)computer_time;
-	H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(u_computer_time));
-	H5Aclose(attribute_id);
 
-	/* uuid_str */
-    str_type = H5Tcopy(H5T_C_S1);
-	H5Tset_size(str_type, strlen(hdf5_data_object->uuid_str)+1);
-    str_attribute = H5Acreate2(hdf5_data_object->dataset, "uuid_str", str_type, dataspace_id, H5P_DEFAULT, H5P_DEFAULT);
-    H5Awrite(str_attribute, str_type, hdf5_data_object->uuid_str);
-    H5Aclose(str_attribute);
+int digital_rf_get_unix_time_rational(uint64_t global_sample,
+	uint64_t sample_rate_numerator, uint64_t sample_rate_denominator,
+	int * year, int * month, int *day, int * hour, int * minute, int * second,
+	uint64_t * picosecond)
+/* get_unix_time_rational converts a global_sample and a sample rate into year,
+ *  month, day, hour, minute, second, picosecond
+ *
+ * 	Returns 0 if success, -1 if failure.
+ *
+ */
+{
+	uint64_t timestamp_second;
+	time_t unix_second;
 
-    /* epoch */
-	H5Tset_size(str_type, strlen(DIGITAL_RF_EPOCH)+1);
-	str_attribute = H5Acreate2(hdf5_data_object->dataset, "epoch", str_type, dataspace_id, H5P_DEFAULT, H5P_DEFAULT);
-	H5Awrite(str_attribute, str_type, DIGITAL_RF_EPOCH);
-	H5Aclose(str_attribute);
+	/* get second timestamp and picosecond value */
+	if (digital_rf_get_timestamp_floor(global_sample, sample_rate_numerator, sample_rate_denominator, &timestamp_second, picosecond))
+		return(-1);
 
-	/* digital_rf_time_description */
-	H5Tset_size(str_type, strlen(DIGITAL_RF_TIME_DESCRIPTION)+1);
-	str_attribute = H5Acreate2(hdf5_data_object->dataset, "digital_rf_time_description", str_type, dataspace_id, H5P_DEFAULT, H5P_DEFAULT);
-	H5Awrite(str_attribute, str_type, DIGITAL_RF_TIME_DESCRIPTION);
-	H5Aclose(str_attribute);
+	/* set values down to second from timestamp*/
+	unix_second = (time_t)timestamp_second;
+	if (digital_rf_get_time_parts(unix_second, year, month, day, hour, minute, second))
+		return(-1);
 
-	/* digital_rf_version */
-	H5Tset_size(str_type, strlen(DIGITAL_RF_VERSION)+1);
-	str_attribute = H5Acreate2(hdf5_data_object->dataset, "digital_rf_version", str_type, dataspace_id, H5P_DEFAULT, H5P_DEFAULT);
-	H5Awrite(str_attribute, str_type, DIGITAL_RF_VERSION);
-	H5Aclose(str_attribute);
+	return(0);
+}
 
-    /* free resources used */
-	H5Tclose(str_type);
-    H5Sclose(dataspace_id);
 
 
-}
+/* Private Method implementations */
 
 
-uint64_t * digital_rf_create_rf_data_index(Digital_rf_write_object *hdf5_data_object, uint64_t samples_written, uint64_t samples_left,
-		uint64_t max_samples_this_file, uint64_t * global_index_arr, uint64_t * data_index_arr, uint64_t index_len, uint64_t vector_len,
-		uint64_t next_global_sample, int * rows_to_write, uint64_t * samples_to_write, int file_exists)
-/* digital_rf_create_rf_data_index returns a malloced block of rf_data_index index data to write into the existing Hdf5 file
- * also sets the number of rows to be written.  Number of rows to be written may be zero, in which case returns NULL and
- * rows_to_write set to 0.
- * With Digital RF 2.0, now also calculates samples_to_write whether or not rows_to_write zero or non-zero
+int digital_rf_get_time_parts(time_t unix_second, int * year, int * month, int *day,
+		                     int * hour, int * minute, int * second)
+/* get_time_parts converts a Unix timestamp into year, month, day
+ * 	hour, minute, second
  *
- *  Digital_rf_write_object *hdf5_data_object - the Digital_rf_write_object created by digital_rf_create_write_hdf5
- * 	uint64_t samples_written - the number of samples written to previous files during this particular user write call
- * 	uint64_t samples_left - the maximum continuous samples that can be written to this file
- *	uint64_t max_samples_this_file - the maximum total number of samples the can be in this file
- * 	uint64_t * global_index_arr - an array of global indices into the samples being written.  The global
- * 		index is the total number of sample periods since data taking began, including gaps.  Error
- * 		is raised if any value is before its expected value (meaning repeated data).
- * 	uint64_t * data_index_arr - an array of len = len(global_index_arr), where the indices are related to which
- * 		sample in the vector being passed in by the user, so that the first value is always 0,
- * 		or error raised.  Values must be increasing, and cannot be equal or greater than index_len or error raised.
- * 	uint_64 index_len - the len of data_index_arr.  Must be greater than 0.
- * 	uint64_t vector_length - the total number of samples to write from vector.
- * 	uint64_t next_global_sample - first global sample to write in this file.
- * 	int * rows_to_write - this int will be set to the number of rows malloced in returned data
- * 	uint64_t * samples_to_write - total number of samples to write to this file given the file boundaries
- * 	int file_exists - 1 if file being written to already exists, 0 if not
+ * 	Returns 0 if success, -1 if failure.
  *
- * 	Returns a malloced uint64_t array of size (rows_to_write, 2) with columns
- * 		dataset for this particular file, or -1 if an error detected. Used to allocate or increase size of /rf_data_index.
- * 		Returned array adds hdf5_data_object->global_start_sample to all global indices so that all are zero at 0UT 1970-01-01
- * 		May be NULL if rows_to_write is 0. Caller is responsible for freeing this.
- * 		Returns NULL and rows_to_write = -1 and error printed to stderr if error detected
  */
 {
-	uint64_t i; /* block loop variable */
-	uint64_t this_index, this_sample;
-	uint64_t last_global_sample;  /* last possible global sample that be written to this file */
-	int64_t top_index = -1, bottom_index = -1; /* temp indecies used to calc samples_to write */
-	int row_count = 0;
-	uint64_t prev_index = 0; /* make sure indices are increasing at least as much as global_index_arr */
-	uint64_t prev_sample = 0;
-	char error_str[BIG_HDF5_STR] = "";
-	uint64_t * ret_arr; /* will hold malloced data to be returned */
-	int rows_written = 0; /* keeps tracks of rows written */
+	struct tm *gm;
+#ifndef _WIN32
+	struct tm gm_buf;
 
-	if (index_len < 1)
+	/* writer, precreate and hub threads may all name files at once */
+	gm = gmtime_r(&unix_second, &gm_buf);
+#else
+	gm = gmtime(&unix_second);
+#endif
+	if (gm == NULL)
+		return(-1);
+	*year = gm->tm_year + 1900;
+	*month = gm->tm_mon + 1;
+	*day = gm->tm_mday;
+	*hour = gm->tm_hour;
+	*minute = gm->tm_min;
+	*second = gm->tm_sec;
+
+	return(0);
+}
+
+
+int digital_rf_get_subdir_file(Digital_rf_write_object *hdf5_data_object, uint64_t global_sample,
+							   char * subdir, char * basename, uint64_t * samples_left, uint64_t * max_samples_this_file)
+/* digital_rf_get_subdir_file sets the name of the derived subdir in form YYYY-MM-DDTHH-MM-SS and basename in form
+ * rf@%llu.3f.h5
+ *
+ * Inputs:
+ * 	Digital_rf_write_object *hdf5_data_object - C struct created by digital_rf_create_write_hdf5
+ * 	global_sample - global sample of first sample to write to file (first sample written is 0)
+ * 	subdir - char array allocated by caller to be filled in with YYYY-MM-DDTHH-MM-SS according to global_sample
+ * 		and subdir_cadence_secs
+ * 	basename - char array allocated by caller to be filled in with rf@%llu.3f.tmp.h5 according to global_sample and
+ * 		subdir_cadence_secs and file_cadence_millisecs.  Note that when file is no longer actively written to, or
+ * 		when digital_rf_close_write_hdf5 called, will be moved to remove tmp. part of name.
+ * 	samples_left - pointer to uint64_t to be set to the number of samples left to be written in file.  Will be greater than
+ * 		zero and less than or equal to max_samples_this_file
+ *  max_samples_this_file - pointer to uint64_t to be set to the maximum total number of samples that this file can hold
+ *
+ * 	Returns 0 if success, -1 if failure.
+ *
+ */
+{
+	int year, month, day, hour, minute, second; /* for time conversion */
+	uint64_t picosecond;			/* for time conversion */
+	uint64_t sample_sec;      		/* the unix second associated with global_sample */
+	uint64_t sample_millisec; 		/* the unix millisecond associated with global_sample */
+	uint64_t dir_sec;  				/* the unix second the directory starts */
+	uint64_t file_millisec;  		/* the unix millisecond the file starts */
+	uint64_t file_sec_part; 		/* second part of file name */
+	uint64_t file_millisec_part; 	/* millisecond part of file name */
+	uint64_t file_start_sample;		/* first sample in file */
+	uint64_t next_file_millisec;	/* the unix millisecond the *next* file starts */
+	uint64_t next_file_sec_part;	/* second part of *next* file name */
+	uint64_t next_file_millisec_part;		/* millisecond part of *next* file name */
+	uint64_t next_file_start_sample;		/* first sample in *next* file */
+
+	/* convert global_sample to absolute samples since 1970 */
+	global_sample += hdf5_data_object->global_start_sample;
+
+	/* get floored millisecond timestamp corresponding to sample */
+	if (digital_rf_get_timestamp_floor(global_sample, hdf5_data_object->sample_rate_numerator, hdf5_data_object->sample_rate_denominator, &sample_sec, &picosecond))
+		return(-1);
+	sample_millisec = sample_sec * 1000 + picosecond / 1000000000;
+
+	/* first derive the subdirectory name */
+	dir_sec = (sample_sec / hdf5_data_object->subdir_cadence_secs) * hdf5_data_object->subdir_cadence_secs;
+	if (digital_rf_get_time_parts((time_t)dir_sec, &year, &month, &day, &hour, &minute, &second))
+		return(-1);
+	snprintf(subdir, BIG_HDF5_STR, "%04i-%02i-%02iT%02i-%02i-%02i", year, month, day, hour, minute, second);
+
+	/* next derive the file name */
+	file_millisec = (sample_millisec / hdf5_data_object->file_cadence_millisecs) * hdf5_data_object->file_cadence_millisecs;
+	file_sec_part = file_millisec / 1000; /* second part of file name */
+	file_millisec_part = file_millisec % 1000; /* millisecond part of file name */
+	snprintf(basename, SMALL_HDF5_STR, "tmp.rf@%" PRIu64 ".%03" PRIu64 ".h5", file_sec_part, file_millisec_part);
+	next_file_millisec = file_millisec + hdf5_data_object->file_cadence_millisecs;
+	next_file_sec_part = next_file_millisec / 1000;
+	next_file_millisec_part = next_file_millisec % 1000;
+
+	/* finally derive the number of samples available to write in this file (independent of whether file exists) */
+	/* ceil needed because implicit flooring puts sample at time just before file starts */
+	if (digital_rf_get_sample_ceil(file_sec_part, file_millisec_part * 1000000000,
+	hdf5_data_object->sample_rate_numerator, hdf5_data_object->sample_rate_denominator,
+	&file_start_sample))
+		return(-1);
+	if (digital_rf_get_sample_ceil(next_file_sec_part, next_file_millisec_part * 1000000000,
+	hdf5_data_object->sample_rate_numerator, hdf5_data_object->sample_rate_denominator,
+	&next_file_start_sample))
+		return(-1);
+	*samples_left = next_file_start_sample - global_sample;
+	*max_samples_this_file = next_file_start_sample - file_start_sample;
+
+	if (*samples_left < 1 || *samples_left > *max_samples_this_file)
 	{
-		snprintf(error_str, BIG_HDF5_STR, "index_len (%" PRIu64 ") must be greater than 0\n",
-				index_len);
-		fprintf(stderr, "%s", error_str);
-		*rows_to_write = -1;
-		return(NULL);
+		fprintf(stderr, "got illegal samples_left %" PRIu64 "\n", *samples_left);
+		return(-1);
 	}
 
-	/* init samples_to_write */
-	*samples_to_write = 0;
-	last_global_sample = next_global_sample + samples_left;
+	return(0);
+}
 
-	/* this first pass is just to count the number of rows needed before the malloc, and to valid data is reasonable */
-	if (samples_written == 0 && global_index_arr[0] < hdf5_data_object->global_index)
+
+int digital_rf_free_hdf5_data_object(Digital_rf_write_object *hdf5_data_object)
+/* digital_rf_free_hdf5_data_object frees all resources in hdf5_data_object */
+{
+	struct drf_file_template * file_template;
+
+	if (hdf5_data_object->directory != NULL)
+		free(hdf5_data_object->directory);
+	if (hdf5_data_object->sub_directory != NULL)
+		free(hdf5_data_object->sub_directory);
+	if (hdf5_data_object->uuid_str != NULL)
+		free(hdf5_data_object->uuid_str);
+	if (hdf5_data_object->sidecar_rows != NULL)
+		free(hdf5_data_object->sidecar_rows);
+	if (hdf5_data_object->index_scratch != NULL)
+		free(hdf5_data_object->index_scratch);
+	if (hdf5_data_object->pending_index != NULL)
+		free(hdf5_data_object->pending_index);
+	if (hdf5_data_object->memory_image != NULL)
+		free(hdf5_data_object->memory_image);
+	if (hdf5_data_object->staging_rows != NULL)
+		free(hdf5_data_object->staging_rows);
+	while (hdf5_data_object->file_templates != NULL)
 	{
-		snprintf(error_str, BIG_HDF5_STR, "global_index_arr passed in %" PRIu64 " before minimum value of %" PRIu64 "\n",
-				global_index_arr[0], hdf5_data_object->global_index);
-		fprintf(stderr, "%s", error_str);
-		*rows_to_write = -1;
-		return(NULL);
+		file_template = hdf5_data_object->file_templates;
+		hdf5_data_object->file_templates = file_template->next;
+		free(file_template->image);
+		free(file_template);
 	}
 
-	for (i=0; i<index_len; i++)
-	{
-		this_index = data_index_arr[i];
-		this_sample = global_index_arr[i];
+	/* free all Hdf5 resources */
+	if (hdf5_data_object->dataset)
+		H5Dclose (hdf5_data_object->dataset);
+	if (hdf5_data_object->dataset_prop)
+		H5Pclose (hdf5_data_object->dataset_prop);
+	if (hdf5_data_object->dataspace)
+		H5Sclose (hdf5_data_object->dataspace);
+	if (hdf5_data_object->filespace)
+		H5Sclose (hdf5_data_object->filespace);
+	if (hdf5_data_object->memspace)
+		H5Sclose (hdf5_data_object->memspace);
+	if (hdf5_data_object->index_dataset)
+		H5Dclose (hdf5_data_object->index_dataset);
+	if (hdf5_data_object->index_filespace)
+		H5Sclose (hdf5_data_object->index_filespace);
+	if (hdf5_data_object->index_memspace)
+		H5Sclose (hdf5_data_object->index_memspace);
+	if (hdf5_data_object->index_prop)
+		H5Pclose (hdf5_data_object->index_prop);
+	if (hdf5_data_object->hdf5_file)
+		H5Fclose (hdf5_data_object->hdf5_file);
+	free(hdf5_data_object);
 
-		/* more input data sanity checks */
-		if (this_index >= vector_len)
+	return(0);
+}
+
+int digital_rf_check_hdf5_directory(char * directory)
+/* digital_rf_check_hdf5_directory checks if directory exists.  If it does not
+ * exist, returns -1.  If okay, returns 0.
+ *
+ */
+{
+	/* local variable */
+	struct stat stat_obj = {0}; /* used to run stat to determine if directory exists */
+
+	/* see if directory needs to be created */
+	if (stat(directory, &stat_obj))
+	{
+		return(-1);
+	} else {
+		/* verify it's a directory */
+		if(!S_ISDIR(stat_obj.st_mode))
 		{
-			snprintf(error_str, BIG_HDF5_STR, "index %" PRIu64 " (%" PRIu64 ") in data_index_arr is beyond end of data (len %" PRIu64 ")", i, this_index, vector_len);
-			fprintf(stderr, "%s", error_str);
-			*rows_to_write = -1;
-			return(NULL);
+			return(-1);
 		}
-		if (i>0 && prev_index >= this_index)
+	}
+	return(0);
+}
+
+
+uint64_t digital_rf_write_samples_to_file(Digital_rf_write_object *hdf5_data_object, uint64_t samples_written, uint64_t * global_index_arr,
+		uint64_t * data_index_arr, uint64_t index_len, void * vector, uint64_t vector_length)
+/* digital_rf_write_samples_to_file writes some or all of the data to a single Hdf5 file.
+ *
+ * Returns the number of samples written. Returns 0 if error.
+ *
+ * Inputs:
+ * 	Digital_rf_write_object *hdf5_data_object - the Digital_rf_write_object created by digital_rf_create_write_hdf5
+ * 	uint64_t samples_written - the number of samples written to previous files during this particular user write call
+ * 	uint64_t * global_index_arr - an array of global indices into the samples being written.  The global
+ * 		index is the total number of sample periods since data taking began, including gaps.  Error
+ * 		is raised if any value is before its expected value (meaning repeated data).
+ * 	uint64_t * data_index_arr - an array of len = len(global_index_arr), where the indices are related to which
+ * 		sample in the vector being passed in by the user, so that the first value is always 0,
+ * 		or error raised.  Values must be increasing, and cannot be equal or greater than index_len or error raised.
+ * 	uint_64 index_len - the len of both global_index_arr and data_index_arr.  Must be greater than 0.
+ * 	void * vector - the vector (either single valued or complex) containing the data, or NULL pointer if no data to be written.
+ * 	uint64_t vector_length - the total number of samples to write from vector.
+ *
+ */
+{
+	/* local variables */
+	int64_t last_global_index; /* may possibly be negative if first write not to first sample in file */
+	uint64_t samples_to_write, samples_after_last_global_index;
+	uint64_t next_global_index;
+	int block_index_len; /* len of /rf_data_index dataset needed for this particular write */
+	uint64_t * rf_data_index_arr = NULL; /* index_scratch filled out with all data needed for rf_data_index table */
+	int result;
+	hsize_t size[2] = {0, hdf5_data_object->num_subchannels}; /* will be set to size of full dataset in file */
+	hsize_t offset[2] = {0,0};        /* will be set to the index in file writing to */
+	herr_t  status;                   /* Hdf5 error status */
+	int file_exists;                  /* set to 1 if file being written to already exists, 0 if not */
+	time_t  computer_time;            /* these two variables used to update last_unix_time */
+	int64_t u_computer_time;
+
+	char subdir[BIG_HDF5_STR] = ""; 	/* to be set to the subdirectory to write to */
+	char basename[SMALL_HDF5_STR] = ""; /* to be set to the file basename to write to */
+	uint64_t samples_left = 0;				/* to be set to the number of samples available to write to this file */
+	uint64_t max_samples_this_file;			/* to be set to the maximum total number of samples that can be in this file */
+
+
+	/* verify inputs are sensible */
+	if (index_len < 1)
+	{
+		fprintf(stderr, "Illegal index_len %" PRIu64 " in digital_rf_write_samples_to_file\n", index_len);
+		return(0);
+	}
+	if (data_index_arr[0] != 0)
+	{
+		fprintf(stderr, "Illegal first value %" PRIu64 " in data_index_arr, must be 0\n", data_index_arr[0]);
+				return(0);
+	}
+
+	/* get needed subdir, basename, and samples_left */
+	next_global_index = digital_rf_get_global_sample(samples_written, global_index_arr, data_index_arr, index_len);
+	result = digital_rf_get_subdir_file(hdf5_data_object, next_global_index, subdir, basename, &samples_left, &max_samples_this_file);
+	if (result) return(0);
+
+	/* We need to see if we need to open a new file or expand an existing one */
+	if (hdf5_data_object->sub_directory == NULL || strcmp(hdf5_data_object->sub_directory, subdir)
+			|| strcmp(hdf5_data_object->basename, basename))
+		file_exists = 0;
+	else
+		file_exists = 1;
+
+	/* get all the info needed to create (or expand) /rf_data_index and fill it out, along with calculating samples_to_write  */
+	rf_data_index_arr = digital_rf_create_rf_data_index(hdf5_data_object, samples_written, samples_left, max_samples_this_file, global_index_arr,
+				data_index_arr, index_len, vector_length, next_global_index, &block_index_len, &samples_to_write, file_exists);
+	assert(samples_to_write <= max_samples_this_file);
+	if (!rf_data_index_arr && block_index_len == -1)
+		return(0);
+
+	/* Either create new file or expand old one or if contiguous continue writing to old one */
+	if (!file_exists)
+	{
+		result = digital_rf_create_hdf5_file(hdf5_data_object, subdir, basename, samples_to_write, samples_left, max_samples_this_file);
+		if (result)
+		{
+			fprintf(stderr, "failed to create subdir %s, basename %s\n", subdir, basename);
+			return(0);
+		}
+		/* start on the file after this one while this one is written */
+		if (hdf5_data_object->precreate != NULL)
+			digital_rf_request_precreate(hdf5_data_object, next_global_index + samples_left);
+	}
+	else
+	{
+		if (hdf5_data_object->needs_chunking)
+		{
+			/* expand this file's dataset to hold the new data (after its index in SWMR mode) */
+			if (!hdf5_data_object->swmr)
+				digital_rf_extend_dataset(hdf5_data_object, samples_to_write);
+		}
+		else
+		{
+			/* set global and dataset indices in case we skipped samples since
+			 * previous write, samples_left calculated earlier based on next_global_index */
+			hdf5_data_object->global_index = next_global_index;
+			hdf5_data_object->dataset_index = max_samples_this_file - samples_left;
+		}
+		assert(hdf5_data_object->dataset_index + samples_to_write <= max_samples_this_file);
+	}
+
+	/* in SWMR mode the index goes first, so a reader never sees rf_data rows its index does not cover */
+	if (hdf5_data_object->swmr)
+	{
+		if (block_index_len > 0)
+		{
+			if (digital_rf_write_rf_data_index(hdf5_data_object, rf_data_index_arr, block_index_len))
+				return(0);
+#if H5_VERSION_GE(1, 10, 0)
+			H5Dflush(hdf5_data_object->index_dataset);
+#endif
+		}
+		digital_rf_extend_dataset(hdf5_data_object, samples_to_write);
+	}
+
+	if (hdf5_data_object->chunk_pool != NULL)
+	{
+		/* whole chunks are encoded by the threads of digital_rf_set_compress_threads */
+		if (digital_rf_stage_chunks(hdf5_data_object, (char *)vector + (samples_written * hdf5_data_object->sample_size),
+									samples_to_write))
+		{
+			hdf5_data_object->has_failure = 1;
+			return(0);
+		}
+	}
+	else if (hdf5_data_object->direct_io != NULL && !hdf5_data_object->needs_chunking)
+	{
+		/* contiguous samples are staged for aligned writes of digital_rf_set_direct_io */
+		if (digital_rf_direct_write(hdf5_data_object, hdf5_data_object->dataset_index,
+				(unsigned char *)vector + (samples_written * hdf5_data_object->sample_size), samples_to_write))
+		{
+			hdf5_data_object->has_failure = 1;
+			return(0);
+		}
+	}
+	else
+	{
+		/* create dataspace hyperslab to write to (filespace is kept up to date by digital_rf_extend_dataset) */
+		if (!hdf5_data_object->filespace)
+			hdf5_data_object->filespace = H5Dget_space(hdf5_data_object->dataset);
+		offset[0] = hdf5_data_object->dataset_index;
+		size[0] = samples_to_write;
+		H5Sselect_hyperslab(hdf5_data_object->filespace, H5S_SELECT_SET,
+							offset, NULL, size, NULL);
+
+		/* set up memspace to control write, reshaped only when the write size changes */
+		if (!hdf5_data_object->memspace)
+			hdf5_data_object->memspace = H5Screate_simple(hdf5_data_object->rank, size, NULL);
+		else if (hdf5_data_object->memspace_samples != samples_to_write)
+			H5Sset_extent_simple(hdf5_data_object->memspace, hdf5_data_object->rank, size, NULL);
+		hdf5_data_object->memspace_samples = samples_to_write;
+
+		/* write rf_data */
+		if (hdf5_data_object->is_complex == 0)
+			status = H5Dwrite(hdf5_data_object->dataset, hdf5_data_object->dtype_id, hdf5_data_object->memspace,
+							  hdf5_data_object->filespace, H5P_DEFAULT,
+							  (char *)vector + (samples_written * hdf5_data_object->sample_size));
+		else /* complex */
+			status = H5Dwrite(hdf5_data_object->dataset, hdf5_data_object->complex_dtype_id, hdf5_data_object->memspace,
+							  hdf5_data_object->filespace, H5P_DEFAULT,
+							  (char *)vector + (samples_written * hdf5_data_object->sample_size));
+
+		if (status < 0)
+		{
+			H5Eprint(H5E_DEFAULT, stderr);
+			hdf5_data_object->has_failure = 1;
+			return(0);
+		}
+	}
+
+#if H5_VERSION_GE(1, 10, 0)
+	if (hdf5_data_object->swmr)
+		H5Dflush(hdf5_data_object->dataset);
+#endif
+
+	/* write rf_data_index dataset */
+	if (block_index_len > 0)
+	{
+		if (!hdf5_data_object->swmr && digital_rf_write_rf_data_index(hdf5_data_object, rf_data_index_arr, block_index_len))
+			return(0);
+		if (hdf5_data_object->sidecar_index)
+			digital_rf_add_sidecar_rows(hdf5_data_object, rf_data_index_arr, block_index_len);
+	}
+
+	/* advance state */
+	hdf5_data_object->dataset_index += samples_to_write;
+	hdf5_data_object->dataset_avail -= samples_to_write;
+	/* update global_index - see meaning of rf_data_index_arr and block_index_len for logic.
+	 * Basically using last line and counting extra samples after last global index */
+	if (block_index_len > 0)
+	{
+		/* last_global_index is relative to global_start_sample, and it could be
+		 * negative if write is continuous + non-chunked and starts in middle of file */
+		last_global_index = rf_data_index_arr[block_index_len*2 - 2] - hdf5_data_object->global_start_sample;
+		/* dataset_index is adjusted forward when write starts in middle of file
+		 * so any negativity in last_global_index is made up here */
+		samples_after_last_global_index = hdf5_data_object->dataset_index - rf_data_index_arr[block_index_len*2 - 1];
+		hdf5_data_object->global_index = last_global_index + samples_after_last_global_index;
+	}
+	else
+	{
+		/* if no indices were used, then all data written must have been continuous */
+		hdf5_data_object->global_index += samples_to_write;
+	}
+
+	assert(hdf5_data_object->dataset_index <= max_samples_this_file); /* debug */
+
+	/* update hdf5_data_object->last_unix_time */
+	computer_time = time(NULL);
+	u_computer_time = (uint64_t)computer_time;
+	hdf5_data_object->last_utc_timestamp = u_computer_time;
+
+	return(samples_to_write);
+}
+
+
+int digital_rf_create_hdf5_file(Digital_rf_write_object *hdf5_data_object, char * subdir, char * basename,
+								uint64_t samples_to_write, uint64_t samples_left, uint64_t max_samples_this_file)
+/* digital_rf_create_hdf5_file opens a new Hdf5 file
+ *
+ * Inputs:
+ * 	Digital_rf_write_object *hdf5_data_object - the Digital_rf_write_object created by digital_rf_create_write_hdf5
+ * 	subdir - base subdir to create file in.  May need to be created.
+ * 	basename - basename of file to create.
+ * 	samples_to_write - number of samples to write in this write call (may need to be expanded later)
+ * 	samples_left - number of samples that can possible be written in this file.  If not max_samples_this_file, affects
+ * 		dataset_index if not needs_chunking
+ *  max_samples_this_file - total number of samples that can be in this file
+ *
+ * 	Creates a file with /rf_data dataset of size (*, 2), or takes it over from digital_rf_set_precreate if the file
+ * 	was prepared ahead of time
+ *
+ * 	Returns 0 if success, -1 if failure
+ *
+ */
+{
+	/* local variables */
+	drf_prepared_file file;
+	char fullname[BIG_HDF5_STR] = "";
+
+    if (hdf5_data_object->marching_dots)
+    {
+		printf(".");
+		fflush(stdout);
+    }
+
+    if (hdf5_data_object->hdf5_file != 0)
+	{
+		/* close previous file, with any chunks being encoded and /rf_data_index rows still held */
+		if (digital_rf_finish_chunks(hdf5_data_object))
+			hdf5_data_object->has_failure = 1;
+		if (digital_rf_flush_rf_data_index(hdf5_data_object))
+			hdf5_data_object->has_failure = 1;
+		if (digital_rf_end_direct_file(hdf5_data_object))
+			hdf5_data_object->has_failure = 1;
+		digital_rf_end_sidecar_file(hdf5_data_object);
+		H5Dclose (hdf5_data_object->dataset);
+		hdf5_data_object->dataset = 0;
+		H5Dclose (hdf5_data_object->index_dataset);
+		hdf5_data_object->index_dataset = 0;
+		H5Sclose (hdf5_data_object->dataspace);
+		hdf5_data_object->dataspace = 0;
+		/* the filespaces belong to this file, the memspaces are kept for the next */
+		if (hdf5_data_object->filespace)
+		{
+			H5Sclose (hdf5_data_object->filespace);
+			hdf5_data_object->filespace = 0;
+		}
+		if (hdf5_data_object->index_filespace)
+		{
+			H5Sclose (hdf5_data_object->index_filespace);
+			hdf5_data_object->index_filespace = 0;
+		}
+		if (digital_rf_write_memory_file(hdf5_data_object))
+			hdf5_data_object->has_failure = 1;
+		H5Fclose (hdf5_data_object->hdf5_file);
+		hdf5_data_object->hdf5_file = 0;
+		hdf5_data_object->dataset_index = 0;
+
+		/* now rename this closed file */
+		if (digital_rf_close_hdf5_file(hdf5_data_object))
+			hdf5_data_object->has_failure = 1;
+
+		/* the file was removed if it could not be finished, and this write fails with it */
+		if (hdf5_data_object->has_failure)
+		{
+			fprintf(stderr, "failed to finish %s before starting %s\n", hdf5_data_object->basename, basename);
+			return(-1);
+		}
+	}
+
+	hdf5_data_object->present_seq++; /* indicates the creation of a new file */
+
+	/* create new directory if needed */
+	if (hdf5_data_object->sub_directory == NULL || digital_rf_check_hdf5_directory(subdir)
+			|| strcmp(hdf5_data_object->sub_directory, subdir))
+	{
+		if (digital_rf_create_new_directory(hdf5_data_object, subdir))
+			return(-1);
+	}
+
+	strcpy(hdf5_data_object->basename, basename);
+	hdf5_data_object->sidecar_file_id = digital_rf_get_file_id(basename);
+
+	/* a file prepared ahead of time makes this a handle swap */
+	if (!digital_rf_take_prepared_file(hdf5_data_object, subdir, basename, max_samples_this_file, &file))
+	{
+		strcpy(file.subdir, subdir);
+		strcpy(file.basename, basename);
+		file.max_samples_this_file = max_samples_this_file;
+		file.sequence_num = hdf5_data_object->present_seq;
+		if (digital_rf_prepare_hdf5_file(hdf5_data_object, &file, ""))
+		{
+			hdf5_data_object->has_failure = 1;
+			return(-1);
+		}
+	}
+	hdf5_data_object->hdf5_file = file.hdf5_file;
+	hdf5_data_object->dataset = file.dataset;
+	if (hdf5_data_object->dataspace)
+		H5Sclose (hdf5_data_object->dataspace);
+	hdf5_data_object->dataspace = file.dataspace;
+	hdf5_data_object->index_dataset = file.index_dataset;
+	hdf5_data_object->next_index_avail = 0;
+
+	if (hdf5_data_object->needs_chunking)
+	{
+		hdf5_data_object->dataset_index = 0;        /* next write will be to first row */
+		hdf5_data_object->dataset_avail = samples_to_write; /* size available to next write */
+		/* in SWMR mode rf_data is extended once the index covers the first write */
+		if (!hdf5_data_object->swmr)
+			digital_rf_extend_dataset(hdf5_data_object, samples_to_write);
+	}
+	else
+	{
+		hdf5_data_object->dataset_index = max_samples_this_file - samples_left;
+		hdf5_data_object->dataset_avail = max_samples_this_file;
+		if (hdf5_data_object->direct_io != NULL)
+		{
+			snprintf(fullname, BIG_HDF5_STR, "%s/%s/%s", hdf5_data_object->directory, subdir, basename);
+			if (digital_rf_start_direct_file(hdf5_data_object, fullname, max_samples_this_file))
+			{
+				hdf5_data_object->has_failure = 1;
+				return(-1);
+			}
+		}
+	}
+	return(0);
+}
+
+
+int digital_rf_prepare_hdf5_file(Digital_rf_write_object *hdf5_data_object, drf_prepared_file * file, char * prefix)
+/* digital_rf_prepare_hdf5_file creates the Hdf5 file described by file, up to the point where samples can be written
+ *
+ * Inputs:
+ * 	Digital_rf_write_object *hdf5_data_object - the Digital_rf_write_object created by digital_rf_create_write_hdf5
+ * 	drf_prepared_file * file - subdir, basename, max_samples_this_file and sequence_num are set by the caller; the
+ * 		Hdf5 identifiers and made_subdir are set here
+ * 	char * prefix - prepended to the basename of the file on disk, "" unless prepared ahead of time
+ *
+ * 	Creates subdir if needed, then the file with an /rf_data dataset empty if chunked (full size if not), its metadata
+ * 	and in SWMR mode an empty /rf_data_index, either directly or from the image of digital_rf_set_file_template.
+ * 	Apart from building template images, only reads settings of hdf5_data_object that are fixed once writing has
+ * 	started, so it can run on the thread of digital_rf_set_precreate.
+ *
+ * 	Returns 0 if success, -1 if failure (nothing left behind)
+ *
+ */
+{
+	/* local variables */
+	char fullname[BIG_HDF5_STR] = "";
+	char finished_fullname[BIG_HDF5_STR] = "";
+	hid_t    fapl;
+	int result;
+
+	file->hdf5_file = 0;
+	file->dataset = 0;
+	file->dataspace = 0;
+	file->index_dataset = 0;
+	file->made_subdir = 0;
+
+	strcpy(fullname, hdf5_data_object->directory);
+	strcat(fullname, "/");
+	strcat(fullname, file->subdir);
+	#if defined(_WIN32)
+		result = _mkdir(fullname);
+	#else
+		result = mkdir(fullname, S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+	#endif
+	if (result && errno != EEXIST)
+	{
+		fprintf(stderr, "Unable to create directory %s\n", fullname);
+		return(-1);
+	}
+	file->made_subdir = (result == 0);
+
+	/* check if file exists with the finished name, fail if it does */
+	strcpy(finished_fullname, hdf5_data_object->directory);
+	strcat(finished_fullname, "/");
+	strcat(finished_fullname, file->subdir);
+	strcat(finished_fullname, "/");
+	strcat(finished_fullname, strstr(file->basename, "rf"));
+	if( access( finished_fullname, F_OK ) != -1 )
+	{
+		fprintf(stderr, "The following Hdf5 file already exists: %s\n", finished_fullname);
+		digital_rf_discard_prepared_file(hdf5_data_object, file, prefix);
+		return(-1);
+	}
+
+	/* Create a new file, from the template image if there is one. If file exists will fail. */
+	strcpy(fullname, hdf5_data_object->directory);
+	strcat(fullname, "/");
+	strcat(fullname, file->subdir);
+	strcat(fullname, "/");
+	strcat(fullname, prefix);
+	strcat(fullname, file->basename);
+	if (hdf5_data_object->file_template && (hdf5_data_object->direct_io == NULL || hdf5_data_object->needs_chunking))
+		result = digital_rf_stamp_hdf5_file(hdf5_data_object, file, fullname);
+	else
+	{
+		/* SWMR needs the latest file format */
+		fapl = H5Pcreate (H5P_FILE_ACCESS);
+		if (hdf5_data_object->swmr)
+			H5Pset_libver_bounds (fapl, H5F_LIBVER_LATEST, H5F_LIBVER_LATEST);
+		digital_rf_set_file_layout(hdf5_data_object, fapl);
+		if (hdf5_data_object->memory_files)
+			H5Pset_fapl_core (fapl, DRF_MEMORY_FILE_INCREMENT(hdf5_data_object, file), 0);
+		result = digital_rf_build_hdf5_file(hdf5_data_object, file, fullname, fapl);
+		H5Pclose (fapl);
+	}
+	if (result)
+	{
+		digital_rf_discard_prepared_file(hdf5_data_object, file, prefix);
+		return(-1);
+	}
+
+#if H5_VERSION_GE(1, 10, 0)
+	if (hdf5_data_object->swmr && H5Fstart_swmr_write (file->hdf5_file) < 0)
+	{
+		H5Eprint(H5E_DEFAULT, stderr);
+		digital_rf_discard_prepared_file(hdf5_data_object, file, prefix);
+		return(-1);
+	}
+#endif
+	return(0);
+}
+
+
+int digital_rf_build_hdf5_file(Digital_rf_write_object *hdf5_data_object, drf_prepared_file * file, char * fullname,
+							   hid_t fapl)
+/* digital_rf_build_hdf5_file creates fullname with file access property list fapl and adds the /rf_data dataset
+ * (empty if chunked, full size if not), its metadata and in SWMR mode an empty /rf_data_index.
+ *
+ * 	Sets the Hdf5 identifiers in file.  Returns 0 if success, -1 if failure, in which case any identifiers
+ * 	already set in file are left for the caller to close.
+ */
+{
+	/* local variables */
+	hsize_t  dims[2]  = {0, hdf5_data_object->num_subchannels};
+	hsize_t  maxdims[2] = {file->max_samples_this_file, hdf5_data_object->num_subchannels};
+	hsize_t  index_dims[2] = {0, 2};
+	hsize_t  index_maxdims[2] = {H5S_UNLIMITED, 2};
+	hid_t    index_dataspace;
+
+	file->hdf5_file = H5Fcreate (fullname, H5F_ACC_EXCL, H5P_DEFAULT, fapl);
+	if (file->hdf5_file < 0)
+	{
+		fprintf(stderr, "The following Hdf5 file could not be created, or already exists: %s\n", fullname);
+		file->hdf5_file = 0;
+		return(-1);
+	}
+
+	/* now we add the dataset to create, extended by the first write if chunked */
+	if (!hdf5_data_object->needs_chunking)
+		dims[0] = file->max_samples_this_file;
+	file->dataspace = H5Screate_simple (hdf5_data_object->rank, dims, maxdims);
+	if (hdf5_data_object->is_complex == 0)
+		file->dataset = H5Dcreate2 (file->hdf5_file, "rf_data", hdf5_data_object->dtype_id,
+									file->dataspace, H5P_DEFAULT, hdf5_data_object->dataset_prop, H5P_DEFAULT);
+	else
+		file->dataset = H5Dcreate2 (file->hdf5_file, "rf_data", hdf5_data_object->complex_dtype_id,
+									file->dataspace, H5P_DEFAULT, hdf5_data_object->dataset_prop, H5P_DEFAULT);
+	if (file->dataset < 0)
+	{
+		H5Eprint(H5E_DEFAULT, stderr);
+		file->dataset = 0;
+		return(-1);
+	}
+
+	/* last we add metadata */
+	digital_rf_write_metadata(hdf5_data_object, file->dataset, file->sequence_num);
+
+	if (hdf5_data_object->swmr)
+	{
+		/* no objects can be created once SWMR writing starts, so rf_data_index starts out empty */
+		index_dataspace = H5Screate_simple (2, index_dims, index_maxdims);
+		file->index_dataset = H5Dcreate2 (file->hdf5_file, "rf_data_index", H5T_NATIVE_ULLONG,
+										  index_dataspace, H5P_DEFAULT, hdf5_data_object->index_prop, H5P_DEFAULT);
+		H5Sclose (index_dataspace);
+		if (file->index_dataset < 0)
+		{
+			H5Eprint(H5E_DEFAULT, stderr);
+			file->index_dataset = 0;
+			return(-1);
+		}
+	}
+	return(0);
+}
+
+
+void * digital_rf_template_malloc(size_t size, H5FD_file_image_op_t file_image_op, void * udata)
+/* digital_rf_template_malloc allocates the buffer of the core driver building a template */
+{
+	struct drf_template_buffer * buffer = (struct drf_template_buffer *)udata;
+
+	(void)file_image_op;
+	if ((buffer->image = malloc(size)) != NULL)
+		buffer->image_size = size;
+	return(buffer->image);
+}
+
+
+void * digital_rf_template_realloc(void * ptr, size_t size, H5FD_file_image_op_t file_image_op, void * udata)
+/* digital_rf_template_realloc grows or trims the buffer of the core driver building a template */
+{
+	struct drf_template_buffer * buffer = (struct drf_template_buffer *)udata;
+	void * image;
+
+	(void)file_image_op;
+	if ((image = realloc(ptr, size)) != NULL)
+	{
+		buffer->image = image;
+		buffer->image_size = size;
+	}
+	return(image);
+}
+
+
+herr_t digital_rf_template_free(void * ptr, H5FD_file_image_op_t file_image_op, void * udata)
+/* digital_rf_template_free keeps the buffer the core driver lets go of as the template file closes, which then
+ * holds the closed file, and frees any other */
+{
+	struct drf_template_buffer * buffer = (struct drf_template_buffer *)udata;
+
+	if (file_image_op == H5FD_FILE_IMAGE_OP_FILE_CLOSE && ptr == buffer->image)
+		buffer->closed = 1;
+	else
+		free(ptr);
+	return(0);
+}
+
+
+void * digital_rf_template_udata_copy(void * udata)
+/* digital_rf_template_udata_copy shares the drf_template_buffer between copies of the file access property list */
+{
+	return(udata);
+}
+
+
+herr_t digital_rf_template_udata_free(void * udata)
+/* digital_rf_template_udata_free leaves the drf_template_buffer to digital_rf_get_file_template */
+{
+	(void)udata;
+	return(0);
+}
+
+
+struct drf_file_template * digital_rf_get_file_template(Digital_rf_write_object *hdf5_data_object,
+														uint64_t max_samples_this_file)
+/* digital_rf_get_file_template returns the file image for files holding max_samples_this_file samples, building it
+ * the first time it is needed.  Only called from digital_rf_prepare_hdf5_file, which never runs on two threads at
+ * once.
+ *
+ * 	The file is built in memory by the core driver without a backing store, so nothing touches the filesystem.
+ * 	Its buffer is kept when the file closes, since only a closed file has a consistent superblock
+ * 	(H5Fget_file_image of the open file does not for the latest file format).
+ *
+ * 	Returns NULL if the image could not be built
+ */
+{
+	/* local variables */
+	struct drf_file_template * file_template;
+	struct drf_template_buffer buffer = {NULL, 0, 0};
+	H5FD_file_image_callbacks_t callbacks = {digital_rf_template_malloc, NULL, digital_rf_template_realloc,
+											 digital_rf_template_free, digital_rf_template_udata_copy,
+											 digital_rf_template_udata_free, NULL};
+	drf_prepared_file file;
+	char fullname[BIG_HDF5_STR] = "";
+	hid_t fapl;
+	int result;
+
+	for (file_template = hdf5_data_object->file_templates; file_template != NULL; file_template = file_template->next)
+		if (file_template->max_samples_this_file == max_samples_this_file)
+			return(file_template);
+
+	memset(&file, 0, sizeof(drf_prepared_file));
+	file.max_samples_this_file = max_samples_this_file;
+	/* only names the file within Hdf5 */
+	snprintf(fullname, BIG_HDF5_STR, "%s/tmp.drf_template.h5", hdf5_data_object->directory);
+	callbacks.udata = &buffer;
+	fapl = H5Pcreate (H5P_FILE_ACCESS);
+	H5Pset_fapl_core (fapl, 64 * 1024, 0);
+	result = (H5Pset_file_image_callbacks (fapl, &callbacks) < 0) ? -1 : 0;
+	digital_rf_set_file_layout(hdf5_data_object, fapl);
+	if (hdf5_data_object->swmr)
+		H5Pset_libver_bounds (fapl, H5F_LIBVER_LATEST, H5F_LIBVER_LATEST);
+	if (result == 0)
+		result = digital_rf_build_hdf5_file(hdf5_data_object, &file, fullname, fapl);
+	if (file.index_dataset)
+		H5Dclose (file.index_dataset);
+	if (file.dataset)
+		H5Dclose (file.dataset);
+	if (file.dataspace)
+		H5Sclose (file.dataspace);
+	if (file.hdf5_file && H5Fclose (file.hdf5_file) < 0)
+		result = -1;
+	H5Pclose (fapl);
+	if (result != 0 || !buffer.closed || buffer.image_size == 0)
+	{
+		fprintf(stderr, "Unable to build the file template for %" PRIu64 " samples\n", max_samples_this_file);
+		if (buffer.closed)
+			free(buffer.image);
+		return(NULL);
+	}
+
+	if ((file_template = (struct drf_file_template *)malloc(sizeof(struct drf_file_template))) == NULL)
+	{
+		fprintf(stderr, "malloc failure - unrecoverable\n");
+		exit(-1);
+	}
+	file_template->max_samples_this_file = max_samples_this_file;
+	file_template->image = buffer.image;
+	file_template->image_size = buffer.image_size;
+	file_template->next = hdf5_data_object->file_templates;
+	hdf5_data_object->file_templates = file_template;
+	return(file_template);
+}
+
+
+int digital_rf_stamp_hdf5_file(Digital_rf_write_object *hdf5_data_object, drf_prepared_file * file, char * fullname)
+/* digital_rf_stamp_hdf5_file creates fullname as a copy of the template image from digital_rf_get_file_template,
+ * opens it and sets the sequence_num and computer_time attributes, the only ones that differ between files.
+ *
+ * 	Sets the Hdf5 identifiers in file.  Returns 0 if success, -1 if failure, in which case any identifiers
+ * 	already set in file are left for the caller to close.
+ */
+{
+	/* local variables */
+	struct drf_file_template * file_template;
+	FILE * fp;
+	hid_t fapl, attribute_id;
+	uint64_t u_computer_time;
+	int result = 0;
+
+	if ((file_template = digital_rf_get_file_template(hdf5_data_object, file->max_samples_this_file)) == NULL)
+		return(-1);
+
+	/* SWMR needs the latest file format */
+	fapl = H5Pcreate (H5P_FILE_ACCESS);
+	if (hdf5_data_object->swmr)
+		H5Pset_libver_bounds (fapl, H5F_LIBVER_LATEST, H5F_LIBVER_LATEST);
+	if (hdf5_data_object->memory_files)
+	{
+		/* a copy of the image is opened in memory, to be written out by digital_rf_write_memory_file */
+		H5Pset_fapl_core (fapl, DRF_MEMORY_FILE_INCREMENT(hdf5_data_object, file), 0);
+		if (H5Pset_file_image (fapl, file_template->image, file_template->image_size) < 0)
+			result = -1;
+	}
+	/* "x" makes this fail like H5Fcreate with H5F_ACC_EXCL if the file exists */
+	else if ((fp = fopen(fullname, "wbx")) == NULL)
+	{
+		fprintf(stderr, "The following Hdf5 file could not be created, or already exists: %s\n", fullname);
+		H5Pclose (fapl);
+		return(-1);
+	}
+	else
+	{
+		if (fwrite(file_template->image, 1, file_template->image_size, fp) != file_template->image_size)
+			result = -1;
+		if (fclose(fp))
+			result = -1;
+	}
+	if (result == 0)
+		file->hdf5_file = H5Fopen (fullname, H5F_ACC_RDWR, fapl);
+	H5Pclose (fapl);
+	if (result || file->hdf5_file < 0)
+	{
+		fprintf(stderr, "The following Hdf5 file could not be created from its template: %s\n", fullname);
+		file->hdf5_file = 0;
+		if (!hdf5_data_object->memory_files)
+			remove(fullname);
+		return(-1);
+	}
+
+	if ((file->dataset = H5Dopen2 (file->hdf5_file, "rf_data", H5P_DEFAULT)) < 0
+			|| (file->dataspace = H5Dget_space (file->dataset)) < 0
+			|| (hdf5_data_object->swmr
+				&& (file->index_dataset = H5Dopen2 (file->hdf5_file, "rf_data_index", H5P_DEFAULT)) < 0))
+	{
+		H5Eprint(H5E_DEFAULT, stderr);
+		if (file->dataset < 0)
+			file->dataset = 0;
+		if (file->dataspace < 0)
+			file->dataspace = 0;
+		if (file->index_dataset < 0)
+			file->index_dataset = 0;
+		return(-1);
+	}
+
+	/* sequence_num */
+	attribute_id = H5Aopen (file->dataset, "sequence_num", H5P_DEFAULT);
+	result = H5Awrite(attribute_id, H5T_NATIVE_INT, &(file->sequence_num));
+	H5Aclose(attribute_id);
+
+	/* computer time */
+	attribute_id = H5Aopen (file->dataset, "computer_time", H5P_DEFAULT);
+	u_computer_time = (uint64_t)time(NULL);
+	if (H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(u_computer_time)) < 0)
+		result = -1;
+	H5Aclose(attribute_id);
+	if (result < 0)
+	{
+		H5Eprint(H5E_DEFAULT, stderr);
+		return(-1);
+	}
+	return(0);
+}
+
+
+void digital_rf_discard_prepared_file(Digital_rf_write_object *hdf5_data_object, drf_prepared_file * file, char * prefix)
+/* digital_rf_discard_prepared_file closes and removes a file made by digital_rf_prepare_hdf5_file that will not be
+ * written to, and its subdirectory if made for it and still empty
+ */
+{
+	char fullname[BIG_HDF5_STR] = "";
+
+	if (file->index_dataset)
+		H5Dclose (file->index_dataset);
+	if (file->dataspace)
+		H5Sclose (file->dataspace);
+	if (file->dataset)
+		H5Dclose (file->dataset);
+	if (file->hdf5_file)
+	{
+		H5Fclose (file->hdf5_file);
+		strcpy(fullname, hdf5_data_object->directory);
+		strcat(fullname, "/");
+		strcat(fullname, file->subdir);
+		strcat(fullname, "/");
+		strcat(fullname, prefix);
+		strcat(fullname, file->basename);
+		remove(fullname);
+	}
+	if (file->made_subdir)
+	{
+		strcpy(fullname, hdf5_data_object->directory);
+		strcat(fullname, "/");
+		strcat(fullname, file->subdir);
+		rmdir(fullname);
+	}
+	file->hdf5_file = 0;
+	file->dataset = 0;
+	file->dataspace = 0;
+	file->index_dataset = 0;
+	file->made_subdir = 0;
+}
+
+
+int digital_rf_close_hdf5_file(Digital_rf_write_object *hdf5_data_object)
+/* digital_rf_close_hdf5_file closes the present hdf5 file by removing the tmp. part of the file name
+ *
+ * Inputs:
+ * 	Digital_rf_write_object *hdf5_data_object - the Digital_rf_write_object created by digital_rf_create_write_hdf5
+ *
+ * 	Renames last file written to by removing tmp. at beginning of basename, if it exists.  Returns success if it does not exist.
+ *
+ * 	Returns 0 if success, -1 if failure
+ *
+ */
+{
+	/* local variables */
+	char fullname[BIG_HDF5_STR] = "";
+	char new_fullfilename[BIG_HDF5_STR] = "";
+
+	if (hdf5_data_object->directory == NULL ||
+			hdf5_data_object->sub_directory == NULL)
+		return(0); /* nothing to close */
+
+	strcpy(fullname, hdf5_data_object->directory);
+	strcat(fullname, "/");
+	strcat(fullname, hdf5_data_object->sub_directory);
+	strcat(fullname, "/");
+	strcat(fullname, hdf5_data_object->basename);
+
+	strcpy(new_fullfilename, hdf5_data_object->directory);
+	strcat(new_fullfilename, "/");
+	strcat(new_fullfilename, hdf5_data_object->sub_directory);
+	strcat(new_fullfilename, "/");
+	strcat(new_fullfilename, strstr(hdf5_data_object->basename, "rf"));
+
+	if( access( fullname, F_OK ) != -1 )
+		/* remove file if error has occurred, rename otherwise */
+		if (hdf5_data_object->has_failure)
+		{
+			hdf5_data_object->sidecar_num_rows = 0;
+			return(remove(fullname));
+		}
+		else
+		{
+			if (rename(fullname, new_fullfilename))
+				return(-1);
+			/* only finalized files are ever in the sidecar index */
+			return(digital_rf_append_sidecar_index(hdf5_data_object));
+		}
+	else
+		return(0); /* file already closed */
+}
+
+
+int digital_rf_create_new_directory(Digital_rf_write_object *hdf5_data_object, char * subdir)
+/* digital_rf_create_new_directory creates a new subdirectory to store Hdf5 files in
+ *
+ * 	Digital_rf_write_object *hdf5_data_object - the Digital_rf_write_object created by digital_rf_create_write_hdf5
+ * 	subdir - base subdir to create.
+ *
+ * Affects: sets hdf5_data_object->sub_directory.
+ *
+ * Returns 0 if success, -1 if failure. Fails if this directory can't be written.
+ *
+ */
+{
+	/* local variables */
+	char full_directory[BIG_HDF5_STR] = "";
+	int result;
+
+	strcpy(full_directory, hdf5_data_object->directory);
+	strcat(full_directory, "/");
+	strcat(full_directory, subdir);
+
+	#if defined(_WIN32)
+		result = _mkdir(full_directory);
+	#else
+		result = mkdir(full_directory, S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+	#endif
+	if (result && errno != EEXIST)
+	{
+		fprintf(stderr, "Unable to create directory %s\n", full_directory);
+		hdf5_data_object->has_failure = 1;
+		return(-1);
+	}
+
+	if (hdf5_data_object->sub_directory != NULL)
+		free(hdf5_data_object->sub_directory);
+
+	if ((hdf5_data_object->sub_directory = (char *)malloc(sizeof(char) * (strlen(subdir)+2)))==0)
+	{
+		fprintf(stderr, "malloc failure - unrecoverable\n");
+		exit(-1);
+	}
+	strcpy(hdf5_data_object->sub_directory, subdir);
+	return(0);
+}
+
+
+
+hsize_t digital_rf_choose_chunk_size(Digital_rf_write_object *hdf5_data_object, uint64_t vector_length)
+/* digital_rf_choose_chunk_size returns the samples per /rf_data chunk, called at the first write with its
+ * vector_length.  Unless digital_rf_set_chunk_shape was called, a chunk holds ten such writes as in Digital RF 2.0.
+ * Also settles chunk_subchannels.  Never more than max_chunk_size, the fewest samples a file can hold.
+ */
+{
+	uint64_t max_size = hdf5_data_object->max_chunk_size ? hdf5_data_object->max_chunk_size : 1;
+	size_t subchannel_size = hdf5_data_object->sample_size / hdf5_data_object->num_subchannels;
+	uint64_t chunk_size, num_chunks;
+	int auto_subchannels = (hdf5_data_object->chunk_subchannels == 0);
+
+	if (auto_subchannels)
+		hdf5_data_object->chunk_subchannels = hdf5_data_object->num_subchannels;
+
+	if (!hdf5_data_object->chunk_shape)
+	{
+		if (vector_length*10 < max_size)
+			return(vector_length*10);
+		else if (vector_length < max_size)
+			return(vector_length);
+		return(max_size);
+	}
+	if (hdf5_data_object->chunk_samples != DIGITAL_RF_CHUNK_AUTO)
+		return(hdf5_data_object->chunk_samples < max_size ? hdf5_data_object->chunk_samples : max_size);
+
+	/* split the subchannels if one sample of all of them is over the target */
+	if (auto_subchannels && hdf5_data_object->chunk_pool == NULL
+			&& subchannel_size * hdf5_data_object->num_subchannels > hdf5_data_object->chunk_target_nbytes)
+	{
+		hdf5_data_object->chunk_subchannels = (int)(hdf5_data_object->chunk_target_nbytes / subchannel_size);
+		if (hdf5_data_object->chunk_subchannels < 1)
+			hdf5_data_object->chunk_subchannels = 1;
+	}
+	chunk_size = hdf5_data_object->chunk_target_nbytes / (subchannel_size * hdf5_data_object->chunk_subchannels);
+	if (chunk_size < 1)
+		chunk_size = 1;
+	if (chunk_size >= max_size)
+		return(max_size);
+
+	/* as many chunks as the target needs, as equal as possible so the last in a file is not a sliver */
+	num_chunks = (max_size + chunk_size - 1) / chunk_size;
+	return((max_size + num_chunks - 1) / num_chunks);
+}
+
+
+
+int digital_rf_set_fill_value(Digital_rf_write_object *hdf5_data_object)
+/* digital_rf_set_fill_value sets the fill value property in hdf5_data_object->dataset_prop according to dtype_id.
+ *
+ * Returns 0 if success, -1 if failure
+ */
+{
+	/* local variables */
+
+	/* integer minimum values, first value is matching byte order, second is reversed byte order */
+
+	int64_t minUnsignedInt = 0;
+
+	/* char */
+	int8_t minChar = INT8_MIN;
+	struct complex_char_fill_type { int8_t r, i; };
+	struct complex_char_fill_type complex_char_fill = { minChar, minChar };
+	struct complex_uchar_fill_type { uint8_t r, i; };
+	struct complex_uchar_fill_type complex_uchar_fill = { 0, 0 };
+
+	/* short */
+	int16_t minShort[2] = {INT16_MIN, 128};
+	struct complex_short_fill_type { int16_t r, i; };
+	struct complex_short_fill_type complex_short_fill[2] = { {minShort[0], minShort[0]}, {minShort[1], minShort[1]} };
+	struct complex_ushort_fill_type { uint16_t r, i; };
+	struct complex_ushort_fill_type complex_ushort_fill = { 0, 0 };
+
+	/* int */
+	int32_t minInt[2] = {INT32_MIN, 128};
+	struct complex_int_fill_type { int32_t r, i; };
+	struct complex_int_fill_type complex_int_fill[2] = { {minInt[0], minInt[0]}, {minInt[1], minInt[1]} };
+	struct complex_uint_fill_type { uint32_t r, i; };
+	struct complex_uint_fill_type complex_uint_fill = { 0, 0 };
+
+	/* int64 */
+	int64_t minLLong[2] = {INT64_MIN, 128};
+	struct complex_long_fill_type { int64_t r, i; };
+	struct complex_long_fill_type complex_long_fill[2] = { {minLLong[0], minLLong[0]}, {minLLong[1], minLLong[1]} };
+	struct complex_ulong_fill_type { uint64_t r, i; };
+	struct complex_ulong_fill_type complex_ulong_fill = { 0, 0 };
+
+	// float
+	#if defined(_MSC_VER) && _MSC_VER < 1900
+		float float_fill = (float) HUGE_VAL * 0.0f;  /* NAN but works in C89 (MSVC++ 2008)*/
+	#else
+		float float_fill = NAN;
+	#endif
+	struct complex_float_fill_type { float r, i; };
+	struct complex_float_fill_type complex_float_fill = { float_fill, float_fill };
+
+	// double
+	#if defined(_MSC_VER) && _MSC_VER < 1900
+		double double_fill = HUGE_VAL * 0.0;  /* NAN but works in C89 (MSVC++ 2008)*/
+	#else
+		double double_fill = NAN;
+	#endif
+	struct complex_double_fill_type { double r, i; };
+	struct complex_double_fill_type complex_double_fill = { double_fill, double_fill };
+
+	char error_str[SMALL_HDF5_STR] = "";
+	H5T_class_t classType;
+	H5T_sign_t signType;
+	int numBytes;
+	int endian_flip, write_endian;
+
+	/* found out if the output endian differs from the host endian */
+	endian_flip = 0;
+	write_endian = H5Tget_order(hdf5_data_object->dtype_id);
+	if (write_endian == H5T_ORDER_ERROR)
+	{
+		H5Eprint(H5E_DEFAULT, stderr);
+		return(-1);
+	}
+	if (digital_rf_is_little_endian() && (write_endian == H5T_ORDER_BE))
+		endian_flip = 1;
+	else if ((!digital_rf_is_little_endian()) && (write_endian == H5T_ORDER_LE))
+		endian_flip = 1;
+
+	/* find out whether we are using integers or floats */
+	classType = H5Tget_class( hdf5_data_object->dtype_id );
+	if (classType == H5T_NO_CLASS)
+	{
+		H5Eprint(H5E_DEFAULT, stderr);
+		return(-1);
+	}
+	/* get number of bytes for type */
+	numBytes = (int)H5Tget_size(hdf5_data_object->dtype_id);
+	if (numBytes == 0)
+	{
+		H5Eprint(H5E_DEFAULT, stderr);
+		return(-1);
+	}
+
+	if (classType == H5T_FLOAT && hdf5_data_object->is_complex == 0 && numBytes == 4)
+	{
+		H5Pset_fill_value(hdf5_data_object->dataset_prop, hdf5_data_object->dtype_id, &float_fill);
+	}
+	else if (classType == H5T_FLOAT && hdf5_data_object->is_complex == 0 && numBytes == 8)
+	{
+		H5Pset_fill_value(hdf5_data_object->dataset_prop, hdf5_data_object->dtype_id, &double_fill);
+	}
+	else if (classType == H5T_FLOAT && hdf5_data_object->is_complex != 0 && numBytes == 4)
+	{
+		H5Pset_fill_value(hdf5_data_object->dataset_prop, hdf5_data_object->complex_dtype_id, &complex_float_fill);
+	}
+	else if (classType == H5T_FLOAT && hdf5_data_object->is_complex != 0 && numBytes == 8)
+	{
+		H5Pset_fill_value(hdf5_data_object->dataset_prop, hdf5_data_object->complex_dtype_id, &complex_double_fill);
+	}
+	else if (classType == H5T_INTEGER)
+	{
+		/* find out if integer is signed */
+		signType = H5Tget_sign(hdf5_data_object->dtype_id);
+		if (signType == H5T_SGN_ERROR)
+		{
+			H5Eprint(H5E_DEFAULT, stderr);
+			return(-1);
+		}
+		if (hdf5_data_object->is_complex == 0)
+		{
+			if (signType == H5T_SGN_NONE)
+				H5Pset_fill_value(hdf5_data_object->dataset_prop, hdf5_data_object->dtype_id, &minUnsignedInt);
+			else
+			{
+				switch(numBytes)
+				{
+					case 1:
+						H5Pset_fill_value(hdf5_data_object->dataset_prop, hdf5_data_object->dtype_id, &minChar);
+						break;
+					case 2:
+						H5Pset_fill_value(hdf5_data_object->dataset_prop, hdf5_data_object->dtype_id, &minShort[endian_flip]);
+						break;
+					case 4:
+						H5Pset_fill_value(hdf5_data_object->dataset_prop, hdf5_data_object->dtype_id, &minInt[endian_flip]);
+						break;
+					case 8:
+						H5Pset_fill_value(hdf5_data_object->dataset_prop, hdf5_data_object->dtype_id, &minLLong[endian_flip]);
+						break;
+					default:
+						snprintf(error_str, SMALL_HDF5_STR, "Integer type has unexpected number of bytes: %i\n", numBytes);
+						fprintf(stderr, "%s", error_str);
+						return(-1);
+				}
+			}
+		}
+		else /* complex data */
+		{
+			switch(numBytes)
+			{
+				case 1:
+					if (signType == H5T_SGN_NONE)
+						H5Pset_fill_value(hdf5_data_object->dataset_prop, hdf5_data_object->complex_dtype_id, &complex_uchar_fill);
+					else
+						H5Pset_fill_value(hdf5_data_object->dataset_prop, hdf5_data_object->complex_dtype_id, &complex_char_fill);
+					break;
+				case 2:
+					if (signType == H5T_SGN_NONE)
+						H5Pset_fill_value(hdf5_data_object->dataset_prop, hdf5_data_object->complex_dtype_id,
+								&complex_ushort_fill);
+					else
+						H5Pset_fill_value(hdf5_data_object->dataset_prop, hdf5_data_object->complex_dtype_id,
+								&complex_short_fill[endian_flip]);
+					break;
+				case 4:
+					if (signType == H5T_SGN_NONE)
+						H5Pset_fill_value(hdf5_data_object->dataset_prop, hdf5_data_object->complex_dtype_id,
+								&complex_uint_fill);
+					else
+						H5Pset_fill_value(hdf5_data_object->dataset_prop, hdf5_data_object->complex_dtype_id,
+								&complex_int_fill[endian_flip]);
+					break;
+				case 8:
+					if (signType == H5T_SGN_NONE)
+						H5Pset_fill_value(hdf5_data_object->dataset_prop, hdf5_data_object->complex_dtype_id,
+								&complex_ulong_fill);
+					else
+						H5Pset_fill_value(hdf5_data_object->dataset_prop, hdf5_data_object->complex_dtype_id,
+								&complex_long_fill[endian_flip]);
+					break;
+				default:
+					snprintf(error_str, SMALL_HDF5_STR, "Integer type has unexpected number of bytes: %i\n", numBytes);
+					fprintf(stderr, "%s", error_str);
+					return(-1);
+			}
+		}
+
+	}
+	else
+	{
+		fprintf(stderr, "Hdf5 datatype passed into dtype_id is neither integer nor float - aborting\n");
+		return(-1);
+	}
+	return(0);
+
+}
+
+
+void digital_rf_write_metadata(Digital_rf_write_object *hdf5_data_object, hid_t dataset, int sequence_num)
+/* digital_rf_write_metadata writes the following metadata to dataset of a new file:
+ *  Fields that match those in the drf_properties.h5 file
+ * 	1. uint64_t H5Tget_class (result of H5Tget_class(hdf5_data_object->hdf5_data_object)
+ * 	2. uint64_t H5Tget_size (result of H5Tget_size(hdf5_data_object->hdf5_data_object)
+ * 	3. uint64_t H5Tget_order (result of H5Tget_order(hdf5_data_object->hdf5_data_object)
+ * 	4. uint64_t H5Tget_precision (result of H5Tget_precision(hdf5_data_object->hdf5_data_object)
+ * 	5. uint64_t H5Tget_offset (result of H5Tget_offset(hdf5_data_object->hdf5_data_object)
+ * 	6. uint64_t subdir_cadence_secs,
+ * 	7. uint64_t file_cadence_millisecs
+ * 	8. uint64_t sample_rate_numerator
+ * 	9. uint64_t sample_rate_denominator
+ * 	10. int is_complex
+ * 	11. int num_subchannels
+ * 	12. int is_continuous
+ * 	13. char[] epoch
+ * 	14. char[] digital_rf_time_description
+ * 	15. char[] digital_rf_version
+ *
+ * 	Not found in drf_properties.h5 because possibly unique to each file
+ * 	1. int sequence_num (incremented for each file)
+ * 	2. uint64_t init_utc_timestamp (changes at each restart of the recorder - needed if leapseconds correction applied)
+ * 	3. uint64_t computer_time (time of initial file creation)
+ * 	4. char[] uuid_str - set independently at each restart of the recorder
+ *
+ * 	Must match drf_properties.h5, except adds sequence_num
+ *
+ * Inputs:
+ * 	Digital_rf_write_object *hdf5_data_object - the Digital_rf_write_object created by digital_rf_create_write_hdf5
+ * 	hid_t dataset - the /rf_data dataset of the new file
+ * 	int sequence_num - sequence_num of the new file
+ *
+ */
+{
+	/* local variables */
+	hid_t       attribute_id, dataspace_id;  /* identifiers */
+	hid_t       str_type, str_attribute;
+	time_t      computer_time;
+	int64_t    u_computer_time;
+	uint64_t result;
+
+	dataspace_id = H5Screate(H5S_SCALAR);
+
+	/* sequence_num */
+	attribute_id = H5Acreate2 (dataset, "sequence_num", H5T_NATIVE_INT, dataspace_id,
+								 H5P_DEFAULT, H5P_DEFAULT);
+	H5Awrite(attribute_id, H5T_NATIVE_INT, &sequence_num);
+	H5Aclose(attribute_id);
+
+	/* H5Tget_class */
+	attribute_id = H5Acreate2 (dataset, "H5Tget_class", H5T_NATIVE_ULLONG, dataspace_id,
+							   H5P_DEFAULT, H5P_DEFAULT);
+	result = (uint64_t)H5Tget_class(hdf5_data_object->dtype_id);
+	H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(result));
+	H5Aclose(attribute_id);
+
+	/* H5Tget_size */
+	attribute_id = H5Acreate2 (dataset, "H5Tget_size", H5T_NATIVE_ULLONG, dataspace_id,
+							   H5P_DEFAULT, H5P_DEFAULT);
+	result = (uint64_t)H5Tget_size(hdf5_data_object->dtype_id);
+	H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(result));
+	H5Aclose(attribute_id);
+
+	/* H5Tget_order */
+	attribute_id = H5Acreate2 (dataset, "H5Tget_order", H5T_NATIVE_ULLONG, dataspace_id,
+							   H5P_DEFAULT, H5P_DEFAULT);
+	result = (uint64_t)H5Tget_order(hdf5_data_object->dtype_id);
+	H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(result));
+	H5Aclose(attribute_id);
+
+	/* H5Tget_precision */
+	attribute_id = H5Acreate2 (dataset, "H5Tget_precision", H5T_NATIVE_ULLONG, dataspace_id,
+							   H5P_DEFAULT, H5P_DEFAULT);
+	result = (uint64_t)H5Tget_precision(hdf5_data_object->dtype_id);
+	H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(result));
+	H5Aclose(attribute_id);
+
+	/* H5Tget_offset */
+	attribute_id = H5Acreate2 (dataset, "H5Tget_offset", H5T_NATIVE_ULLONG, dataspace_id,
+							   H5P_DEFAULT, H5P_DEFAULT);
+	result = (uint64_t)H5Tget_offset(hdf5_data_object->dtype_id);
+	H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(result));
+	H5Aclose(attribute_id);
+
+	/* num_subchannels */
+	attribute_id = H5Acreate2 (dataset, "num_subchannels", H5T_NATIVE_INT, dataspace_id,
+								 H5P_DEFAULT, H5P_DEFAULT);
+	H5Awrite(attribute_id, H5T_NATIVE_INT, &(hdf5_data_object->num_subchannels));
+	H5Aclose(attribute_id);
+
+	/* is_complex */
+	attribute_id = H5Acreate2 (dataset, "is_complex", H5T_NATIVE_INT, dataspace_id,
+								 H5P_DEFAULT, H5P_DEFAULT);
+	H5Awrite(attribute_id, H5T_NATIVE_INT, &(hdf5_data_object->is_complex));
+	H5Aclose(attribute_id);
+
+	/* subdir_cadence_secs */
+	attribute_id = H5Acreate2 (dataset, "subdir_cadence_secs", H5T_NATIVE_ULLONG, dataspace_id,
+								 H5P_DEFAULT, H5P_DEFAULT);
+	H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(hdf5_data_object->subdir_cadence_secs));
+	H5Aclose(attribute_id);
+
+	/* file_cadence_millisecs */
+	attribute_id = H5Acreate2 (dataset, "file_cadence_millisecs", H5T_NATIVE_ULLONG, dataspace_id,
+								 H5P_DEFAULT, H5P_DEFAULT);
+	H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(hdf5_data_object->file_cadence_millisecs));
+	H5Aclose(attribute_id);
+
+	/* is_continuous */
+	attribute_id = H5Acreate2 (dataset, "is_continuous", H5T_NATIVE_INT, dataspace_id,
+								 H5P_DEFAULT, H5P_DEFAULT);
+	H5Awrite(attribute_id, H5T_NATIVE_INT, &(hdf5_data_object->is_continuous));
+	H5Aclose(attribute_id);
+
+	/* sample_rate_numerator */
+	attribute_id = H5Acreate2 (dataset, "sample_rate_numerator", H5T_NATIVE_ULLONG, dataspace_id,
+								 H5P_DEFAULT, H5P_DEFAULT);
+	H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(hdf5_data_object->sample_rate_numerator));
+	H5Aclose(attribute_id);
+
+	/* sample_rate_denominator */
+	attribute_id = H5Acreate2 (dataset, "sample_rate_denominator", H5T_NATIVE_ULLONG, dataspace_id,
+								 H5P_DEFAULT, H5P_DEFAULT);
+	H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(hdf5_data_object->sample_rate_denominator));
+	H5Aclose(attribute_id);
+
+	/* init_utc_timestamp */
+	attribute_id = H5Acreate2 (dataset, "init_utc_timestamp", H5T_NATIVE_ULLONG, dataspace_id,
+								 H5P_DEFAULT, H5P_DEFAULT);
+	H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(hdf5_data_object->init_utc_timestamp));
+	H5Aclose(attribute_id);
+
+
+	/* computer time */
+	attribute_id = H5Acreate2 (dataset, "computer_time", H5T_NATIVE_ULLONG, dataspace_id,
+								 H5P_DEFAULT, H5P_DEFAULT);
+	computer_time = time(NULL);
+	u_computer_time = (uint64_t)computer_time;
+	H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(u_computer_time));
+	H5Aclose(attribute_id);
+
+	/* uuid_str */
+    str_type = H5Tcopy(H5T_C_S1);
+	H5Tset_size(str_type, strlen(hdf5_data_object->uuid_str)+1);
+    str_attribute = H5Acreate2(dataset, "uuid_str", str_type, dataspace_id, H5P_DEFAULT, H5P_DEFAULT);
+    H5Awrite(str_attribute, str_type, hdf5_data_object->uuid_str);
+    H5Aclose(str_attribute);
+
+    /* epoch */
+	H5Tset_size(str_type, strlen(DIGITAL_RF_EPOCH)+1);
+	str_attribute = H5Acreate2(dataset, "epoch", str_type, dataspace_id, H5P_DEFAULT, H5P_DEFAULT);
+	H5Awrite(str_attribute, str_type, DIGITAL_RF_EPOCH);
+	H5Aclose(str_attribute);
+
+	/* digital_rf_time_description */
+	H5Tset_size(str_type, strlen(DIGITAL_RF_TIME_DESCRIPTION)+1);
+	str_attribute = H5Acreate2(dataset, "digital_rf_time_description", str_type, dataspace_id, H5P_DEFAULT, H5P_DEFAULT);
+	H5Awrite(str_attribute, str_type, DIGITAL_RF_TIME_DESCRIPTION);
+	H5Aclose(str_attribute);
+
+	/* digital_rf_version */
+	H5Tset_size(str_type, strlen(DIGITAL_RF_VERSION)+1);
+	str_attribute = H5Acreate2(dataset, "digital_rf_version", str_type, dataspace_id, H5P_DEFAULT, H5P_DEFAULT);
+	H5Awrite(str_attribute, str_type, DIGITAL_RF_VERSION);
+	H5Aclose(str_attribute);
+
+    /* free resources used */
+	H5Tclose(str_type);
+    H5Sclose(dataspace_id);
+
+
+}
+
+
+uint64_t * digital_rf_create_rf_data_index(Digital_rf_write_object *hdf5_data_object, uint64_t samples_written, uint64_t samples_left,
+		uint64_t max_samples_this_file, uint64_t * global_index_arr, uint64_t * data_index_arr, uint64_t index_len, uint64_t vector_len,
+		uint64_t next_global_sample, int * rows_to_write, uint64_t * samples_to_write, int file_exists)
+/* digital_rf_create_rf_data_index returns a block of rf_data_index index data to write into the existing Hdf5 file
+ * also sets the number of rows to be written.  Number of rows to be written may be zero, in which case returns NULL and
+ * rows_to_write set to 0.
+ * With Digital RF 2.0, now also calculates samples_to_write whether or not rows_to_write zero or non-zero
+ *
+ *  Digital_rf_write_object *hdf5_data_object - the Digital_rf_write_object created by digital_rf_create_write_hdf5
+ * 	uint64_t samples_written - the number of samples written to previous files during this particular user write call
+ * 	uint64_t samples_left - the maximum continuous samples that can be written to this file
+ *	uint64_t max_samples_this_file - the maximum total number of samples the can be in this file
+ * 	uint64_t * global_index_arr - an array of global indices into the samples being written.  The global
+ * 		index is the total number of sample periods since data taking began, including gaps.  Error
+ * 		is raised if any value is before its expected value (meaning repeated data).
+ * 	uint64_t * data_index_arr - an array of len = len(global_index_arr), where the indices are related to which
+ * 		sample in the vector being passed in by the user, so that the first value is always 0,
+ * 		or error raised.  Values must be increasing, and cannot be equal or greater than index_len or error raised.
+ * 	uint_64 index_len - the len of data_index_arr.  Must be greater than 0.
+ * 	uint64_t vector_length - the total number of samples to write from vector.
+ * 	uint64_t next_global_sample - first global sample to write in this file.
+ * 	int * rows_to_write - this int will be set to the number of rows in returned data
+ * 	uint64_t * samples_to_write - total number of samples to write to this file given the file boundaries
+ * 	int file_exists - 1 if file being written to already exists, 0 if not
+ *
+ * 	Returns hdf5_data_object->index_scratch, grown if needed, filled as a uint64_t array of size (rows_to_write, 2) with columns
+ * 		dataset for this particular file, or -1 if an error detected. Used to allocate or increase size of /rf_data_index.
+ * 		Returned array adds hdf5_data_object->global_start_sample to all global indices so that all are zero at 0UT 1970-01-01
+ * 		May be NULL if rows_to_write is 0. Only valid until the next call.
+ * 		Returns NULL and rows_to_write = -1 and error printed to stderr if error detected
+ */
+{
+	uint64_t i; /* block loop variable */
+	uint64_t this_index, this_sample;
+	uint64_t last_global_sample;  /* last possible global sample that be written to this file */
+	int64_t top_index = -1, bottom_index = -1; /* temp indecies used to calc samples_to write */
+	int row_count = 0;
+	uint64_t prev_index = 0; /* make sure indices are increasing at least as much as global_index_arr */
+	uint64_t prev_sample = 0;
+	char error_str[BIG_HDF5_STR] = "";
+	uint64_t * ret_arr; /* will hold data to be returned */
+	int rows_written = 0; /* keeps tracks of rows written */
+
+	if (index_len < 1)
+	{
+		snprintf(error_str, BIG_HDF5_STR, "index_len (%" PRIu64 ") must be greater than 0\n",
+				index_len);
+		fprintf(stderr, "%s", error_str);
+		*rows_to_write = -1;
+		return(NULL);
+	}
+
+	/* init samples_to_write */
+	*samples_to_write = 0;
+	last_global_sample = next_global_sample + samples_left;
+
+	/* this first pass is just to count the number of rows needed, and to valid data is reasonable */
+	if (samples_written == 0 && global_index_arr[0] < hdf5_data_object->global_index)
+	{
+		snprintf(error_str, BIG_HDF5_STR, "global_index_arr passed in %" PRIu64 " before minimum value of %" PRIu64 "\n",
+				global_index_arr[0], hdf5_data_object->global_index);
+		fprintf(stderr, "%s", error_str);
+		*rows_to_write = -1;
+		return(NULL);
+	}
+
+	for (i=0; i<index_len; i++)
+	{
+		this_index = data_index_arr[i];
+		this_sample = global_index_arr[i];
+
+		/* more input data sanity checks */
+		if (this_index >= vector_len)
+		{
+			snprintf(error_str, BIG_HDF5_STR, "index %" PRIu64 " (%" PRIu64 ") in data_index_arr is beyond end of data (len %" PRIu64 ")", i, this_index, vector_len);
+			fprintf(stderr, "%s", error_str);
+			*rows_to_write = -1;
+			return(NULL);
+		}
+		if (i>0 && prev_index >= this_index)
+		{
+			snprintf(error_str, BIG_HDF5_STR, "indices in data_index_arr out of order - index %" PRIu64 " and %" PRIu64 "\n", i-1,i);
+			fprintf(stderr, "%s", error_str);
+			*rows_to_write = -1;
+			return(NULL);
+		}
+		if (i>0 && prev_sample >= this_sample)
+		{
+			snprintf(error_str, BIG_HDF5_STR, "indices in global_index_arr out of order - index %" PRIu64 " and %" PRIu64 "\n", i-1,i);
+			fprintf(stderr, "%s", error_str);
+			*rows_to_write = -1;
+			return(NULL);
+		}
+		if (i>0 && ((this_index - prev_index) > (this_sample - prev_sample)))
+		{
+			snprintf(error_str, BIG_HDF5_STR, "error - indices advancing faster than global index at index %" PRIu64 ", illegal\n", i);
+			fprintf(stderr, "%s", error_str);
+			*rows_to_write = -1;
+			return(NULL);
+		}
+
+		/* see if these indices are needed for this file */
+		if (i > 0)
+		{
+			if (next_global_sample < prev_sample + (this_index - prev_index) && last_global_sample >= this_sample)
+				row_count++;
+		}
+		else if (!file_exists || hdf5_data_object->needs_chunking)
+			row_count++;
+
+		/* determine range of data [bottom_index, top_index] that will be written to this file */
+		/* set bottom_index if unset and the global sample for this block is past the next sample to be written */
+		if (this_sample > next_global_sample && bottom_index == -1)
+		{
+			/* calculate bottom index */
+			if (i>0)
+			{
+				if (prev_sample + (this_index-prev_index) < next_global_sample)
+				{
+					/* next_global_sample falls in a gap */
+					bottom_index = this_index;
+				}
+				else
+					bottom_index = prev_index + (next_global_sample - prev_sample);
+			}
+			else
+				bottom_index = 0;
+		}
+		/* set top_index if unset and the global sample for this block is past the last sample to be in the file */
+		if (this_sample > last_global_sample && top_index == -1)
+		{
+			/* calculate top index */
+			if (last_global_sample > prev_sample + (this_index - prev_index))
+			{
+				/* last sample falls in a gap */
+				top_index = this_index;
+			}
+			else
+				top_index = prev_index + (last_global_sample - prev_sample);
+		}
+
+		prev_index = this_index;
+		prev_sample = this_sample;
+	}
+
+	/* now handle write data beyond last gap */
+	this_index = vector_len;
+	this_sample = prev_sample + (this_index-prev_index);
+
+	/* set bottom_index according to last data block if unset */
+	if (bottom_index == -1)
+		bottom_index = prev_index + (next_global_sample-prev_sample);
+
+	/* set top_index according to last data block if unset */
+	if (top_index == -1)
+	{
+		if (last_global_sample < this_sample)
+			/* file ends before last sample in data block */
+			top_index = prev_index + (last_global_sample - prev_sample);
+		else
+			/* write includes last sample in data block */
+			/* works out to top_index == vector_len */
+			top_index = prev_index + (this_sample - prev_sample);
+	}
+	/* now we know how many samples to write from the data to this file */
+	*samples_to_write = top_index - bottom_index;
+
+	/* if no indices are needed, return now */
+	if (row_count == 0)
+	{
+		*rows_to_write = 0;
+		return(NULL);
+	}
+
+	/* now that we know how many rows are needed, make sure the scratch rows can hold them */
+	if (row_count > hdf5_data_object->index_scratch_rows)
+	{
+		if ((ret_arr = (uint64_t *)realloc(hdf5_data_object->index_scratch, sizeof(uint64_t)*row_count*2))==0)
+		{
+			fprintf(stderr, "Realloc failure\n");
+			exit(-22);
+		}
+		hdf5_data_object->index_scratch = ret_arr;
+		hdf5_data_object->index_scratch_rows = row_count;
+	}
+	ret_arr = hdf5_data_object->index_scratch;
+
+	/* next pass is to fill out ret_arr */
+	/* ret_arr is [global_sampleN, data_indexN, ...] for blocks in file */
+	for (i=0; i<index_len; i++)
+	{
+		this_index = data_index_arr[i];
+		this_sample = global_index_arr[i];
+
+		/* only thing we do on the first pass is add to ret_arr for start of
+		 * data if it's a new file or the data is written in chunked format */
+		if (i == 0 && (!file_exists || hdf5_data_object->needs_chunking))
+		{
+			ret_arr[0] = next_global_sample + hdf5_data_object->global_start_sample;
+			/* handle the case of the first sample written where it may not be the first sample in the file */
+			/* and we're writing the data in continuous format */
+			if (hdf5_data_object->is_continuous && !hdf5_data_object->needs_chunking)
+				ret_arr[0] -= max_samples_this_file - samples_left;
+			    /* since ret_arr is referenced to first global sample, may actually be negative */
+			/* ret_arr[1] will have hdf5_data_object->dataset_index added later
+			 * upon expansion to account for existing data in file */
+			ret_arr[1] = 0;
+			rows_written++;
+		}
+		/* on subsequent passes, add the block to ret_arr when it falls in the file */
+		if (i > 0)
+		{
+			if (next_global_sample < prev_sample + (this_index - prev_index) && last_global_sample >= this_sample)
+			{
+				ret_arr[2*rows_written] = this_sample + hdf5_data_object->global_start_sample;
+				/* data index for data in file is different from data index of the data in the write call */
+				/* by the number of samples previously written from the data (to previous files) */
+				ret_arr[2*rows_written + 1] = this_index - samples_written;
+				rows_written++;
+			}
+		}
+
+		prev_index = this_index;
+		prev_sample = this_sample;
+	}
+	assert(rows_written==row_count);  /* or else there's a bug in my logic */
+	*rows_to_write = rows_written;
+
+	return(ret_arr);
+
+}
+
+
+int digital_rf_write_rf_data_index(Digital_rf_write_object * hdf5_data_object, uint64_t * rf_data_index_arr, int block_index_len)
+/* digital_rf_write_rf_data_index adds rows to rf_data_index of the open Hdf5 file, or holds them until the file is
+ * closed if digital_rf_set_deferred_index was called
+ *
+ * Inputs:
+ *  Digital_rf_write_object *hdf5_data_object - the Digital_rf_write_object created by digital_rf_create_write_hdf5
+ *  uint64_t * rf_data_index_arr - uint64_t array of size (block_index_len * 2) to write - all values are already set
+ *
+ *  Returns 0 if success, non-zero if error
+ */
+{
+	int i;
+	uint64_t * pending;
+	time_t computer_time;
+
+	/* unless these are the first rows of the file,
+	 * adjust data index in rf_data_index_arr to account for samples already in file */
+	if (hdf5_data_object->index_dataset != 0 || hdf5_data_object->pending_index_rows > 0)
+	{
+		for (i=0; i<block_index_len; i++)
+		{
+			/* data index are odd terms in rf_data_index_arr,
+			 * dataset_index adds number of samples already in file */
+			rf_data_index_arr[2*i + 1] += hdf5_data_object->dataset_index;
+		}
+	}
+
+	if (!hdf5_data_object->deferred_index || hdf5_data_object->swmr)
+		return(digital_rf_put_rf_data_index(hdf5_data_object, rf_data_index_arr, block_index_len));
+
+	/* hold the rows, growing pending_index by doubling */
+	if (hdf5_data_object->pending_index_rows + block_index_len > hdf5_data_object->pending_index_capacity)
+	{
+		i = hdf5_data_object->pending_index_capacity ? hdf5_data_object->pending_index_capacity : 64;
+		while (i < hdf5_data_object->pending_index_rows + block_index_len)
+			i *= 2;
+		if ((pending = (uint64_t *)realloc(hdf5_data_object->pending_index, sizeof(uint64_t)*i*2))==0)
+		{
+			fprintf(stderr, "Realloc failure\n");
+			exit(-22);
+		}
+		hdf5_data_object->pending_index = pending;
+		hdf5_data_object->pending_index_capacity = i;
+	}
+	if (hdf5_data_object->pending_index_rows == 0 && hdf5_data_object->index_dataset == 0)
+		hdf5_data_object->last_index_flush = (uint64_t)time(NULL); /* the interval counts from the first row */
+	memcpy(hdf5_data_object->pending_index + 2*hdf5_data_object->pending_index_rows, rf_data_index_arr,
+		   sizeof(uint64_t)*block_index_len*2);
+	hdf5_data_object->pending_index_rows += block_index_len;
+
+	if (hdf5_data_object->index_flush_secs)
+	{
+		computer_time = time(NULL);
+		if ((uint64_t)computer_time >= hdf5_data_object->last_index_flush + hdf5_data_object->index_flush_secs)
+		{
+			/* and flushed, so the open file on disk has them */
+			if (digital_rf_flush_rf_data_index(hdf5_data_object)
+					|| H5Fflush (hdf5_data_object->hdf5_file, H5F_SCOPE_LOCAL) < 0)
+				return(-1);
+		}
+	}
+	return(0);
+}
+
+
+int digital_rf_flush_rf_data_index(Digital_rf_write_object * hdf5_data_object)
+/* digital_rf_flush_rf_data_index writes the rf_data_index rows held by digital_rf_write_rf_data_index, if any,
+ * with a single extend of the dataset
+ *
+ *  Returns 0 if success, non-zero if error
+ */
+{
+	int rows = hdf5_data_object->pending_index_rows;
+
+	if (rows == 0 || !hdf5_data_object->hdf5_file)
+		return(0);
+	hdf5_data_object->pending_index_rows = 0;
+	hdf5_data_object->last_index_flush = (uint64_t)time(NULL);
+	return(digital_rf_put_rf_data_index(hdf5_data_object, hdf5_data_object->pending_index, rows));
+}
+
+
+int digital_rf_put_rf_data_index(Digital_rf_write_object * hdf5_data_object, uint64_t * rf_data_index_arr, int block_index_len)
+/* digital_rf_put_rf_data_index writes rows to rf_data_index of the open Hdf5 file, creating it if needed
+ *
+ * Inputs:
+ *  Digital_rf_write_object *hdf5_data_object - the Digital_rf_write_object created by digital_rf_create_write_hdf5
+ *  uint64_t * rf_data_index_arr - uint64_t array of size (block_index_len * 2) to write - all values are already set,
+ *  	including the adjustment of data indices by digital_rf_write_rf_data_index
+ *
+ *  Returns 0 if success, non-zero if error
+ */
+{
+	/* variables for /rf_data_index */
+	char index_datasetname[] = "rf_data_index";
+	hsize_t  index_dims[2]  = {0, 2};
+	hsize_t  dimsext[2] = {block_index_len, 2};
+	hsize_t  index_maxdims[2] = {H5S_UNLIMITED, 2};
+	hsize_t  offset[2] = {0, 0};
+	hid_t    index_dataspace;
+	herr_t      status;
+
+	/* find out if we need to create a new dataset, or expand and existing one */
+	if (hdf5_data_object->index_dataset == 0)
+	{
+		/* create new dataset */
+		index_dims[0] = block_index_len;
+		index_dataspace = H5Screate_simple (2, index_dims, index_maxdims);
+		hdf5_data_object->index_dataset = H5Dcreate2 (hdf5_data_object->hdf5_file, index_datasetname,
+												H5T_NATIVE_ULLONG,
+												index_dataspace, H5P_DEFAULT,
+												hdf5_data_object->index_prop, H5P_DEFAULT);
+		status = H5Dwrite(hdf5_data_object->index_dataset, H5T_NATIVE_ULLONG, H5S_ALL, H5S_ALL, H5P_DEFAULT,
+					rf_data_index_arr);
+		if (status < 0)
+			return(status);
+
+		H5Sclose(index_dataspace);
+		hdf5_data_object->next_index_avail = block_index_len;
+	}
+	else
+	{
+		/* expand dataset */
+		/* write to existing index, through dataspaces kept between writes */
+		index_dims[0] = hdf5_data_object->next_index_avail + block_index_len;
+		status = H5Dset_extent (hdf5_data_object->index_dataset, index_dims);
+		if (!hdf5_data_object->index_filespace)
+			hdf5_data_object->index_filespace = H5Dget_space (hdf5_data_object->index_dataset);
+		else
+			H5Sset_extent_simple (hdf5_data_object->index_filespace, 2, index_dims, index_maxdims);
+		offset[0] = hdf5_data_object->next_index_avail;
+		status = H5Sselect_hyperslab (hdf5_data_object->index_filespace, H5S_SELECT_SET, offset, NULL,
+				dimsext, NULL);
+		if (status < 0)
+			return(status);
+		if (!hdf5_data_object->index_memspace)
+			hdf5_data_object->index_memspace = H5Screate_simple (2, dimsext, NULL);
+		else if (hdf5_data_object->index_memspace_rows != block_index_len)
+			H5Sset_extent_simple (hdf5_data_object->index_memspace, 2, dimsext, NULL);
+		hdf5_data_object->index_memspace_rows = block_index_len;
+		status = H5Dwrite (hdf5_data_object->index_dataset, H5T_NATIVE_ULLONG, hdf5_data_object->index_memspace,
+						   hdf5_data_object->index_filespace, H5P_DEFAULT, rf_data_index_arr);
+		if (status < 0)
+			return(status);
+
+		hdf5_data_object->next_index_avail += block_index_len;
+	}
+	return(0);
+}
+
+
+uint64_t digital_rf_get_global_sample(uint64_t samples_written, uint64_t * global_index_arr, uint64_t * data_index_arr,
+		                              uint64_t index_len)
+/* digital_rf_get_global_sample calculates the global_sample given samples_written using global_index_arr and data_index_arr
+ *
+ *  uint64_t samples_written - the number of samples written to previous files during this particular user write call
+ * 	uint64_t * global_index_arr - an array of global indices into the samples being written.  The global
+ * 		index is the total number of sample periods since data taking began, including gaps.
+ * 	uint64_t * data_index_arr - an array of len = len(global_index_arr), where the indices are related to which
+ * 		sample in the vector being passed in by the user, so that the first value is always 0
+ * 	uint_64 index_len - the len of both global_index_arr and data_index_arr.  Must be greater than 0.
+ *
+ * 	This method tells the global index when some samples have already been written.  If samples_written == 0,
+ * 	returns global_index_arr[0].  Else returns global_index_arr[i] + (samples_written-data_index_arr[i]) where
+ * 	i is the highest row where data_index_arr[i] <= samples_written
+ *
+ */
+{
+	/* local variables */
+	uint64_t i;
+	uint64_t ret_value;
+
+	ret_value = global_index_arr[0] + (samples_written - data_index_arr[0]);
+	for (i=1; i<index_len; i++)
+	{
+		if (samples_written < data_index_arr[i])
+			break;
+		ret_value = global_index_arr[i] + (samples_written - data_index_arr[i]);
+	}
+	return(ret_value);
+}
+
+int digital_rf_extend_dataset(Digital_rf_write_object * hdf5_data_object, uint64_t samples_to_write)
+/* digital_rf_extend_dataset is a method to extend the dataset of on opened Hdf5 file
+ *
+ * Digital_rf_write_object *hdf5_data_object - the Digital_rf_write_object created by digital_rf_create_write_hdf5
+ * uint64_t - the number of samples to expand existing dataset
+ *
+ */
+{
+	/* local variables */
+	herr_t   status;
+	hsize_t  dims[2]  = {0, hdf5_data_object->num_subchannels};
+
+	hsize_t  maxdims[2];
+
+	dims[0] = hdf5_data_object->dataset_index + samples_to_write;
+	status = H5Dset_extent (hdf5_data_object->dataset, dims);
+	/* keep the cached filespace in step rather than getting a new one */
+	if (status >= 0 && hdf5_data_object->filespace)
+	{
+		H5Sget_simple_extent_dims (hdf5_data_object->filespace, NULL, maxdims);
+		status = H5Sset_extent_simple (hdf5_data_object->filespace, hdf5_data_object->rank, dims, maxdims);
+	}
+	return((int)status);
+}
+
+int digital_rf_handle_metadata(Digital_rf_write_object * hdf5_data_object)
+/* digital_rf_handle_metadata is a method that either creates or verifies consistency with <channel>/drf_properties.h5
+ *
+ * drf_properties.h5 is a simple hdf5 file where the root group has the following attributes:
+ * 	1. uint64_t H5Tget_class (result of H5Tget_class(hdf5_data_object->hdf5_data_object)
+ * 	2. uint64_t H5Tget_size (result of H5Tget_size(hdf5_data_object->hdf5_data_object)
+ * 	3. uint64_t H5Tget_order (result of H5Tget_order(hdf5_data_object->hdf5_data_object)
+ * 	4. uint64_t H5Tget_precision (result of H5Tget_precision(hdf5_data_object->hdf5_data_object)
+ * 	5. uint64_t H5Tget_offset (result of H5Tget_offset(hdf5_data_object->hdf5_data_object)
+ * 	6. uint64_t subdir_cadence_secs,
+ * 	7. uint64_t file_cadence_millisecs
+ * 	8. uint64_t sample_rate_numerator
+ * 	9. uint64_t sample_rate_denominator
+ * 	10. int is_complex
+ * 	11. int num_subchannels
+ * 	12. int is_continuous
+ * 	13. char[] epoch
+ * 	14. char[] digital_rf_time_description
+ * 	15. char[] digital_rf_version
+ *
+ * 	If drf_properties.h5 does not exist, creates it. Returns 0 if success, 1 if not.
+ *
+ * 	If drf_properties.h5 does exist, verifies that first 11 attributes match that in init.  If so, returns
+ * 	0. If not, returns -1
+ *
+ */
+{
+	/* local variables */
+	char metadata_file[BIG_HDF5_STR] = "";
+	char error_str[2*BIG_HDF5_STR] = "";
+	int metadata_exists = 0;
+	hid_t hdf5_file, str_type, str_attribute;
+	hid_t attribute_id, dataspace_id;  /* identifiers */
+	uint64_t result;
+	int int_result;
+
+	/* find out if drf_properties.h5 exists */
+	strcpy(metadata_file, hdf5_data_object->directory);
+	strcat(metadata_file, "/");
+	strcat(metadata_file, "drf_properties.h5");
+	if( access( metadata_file, R_OK ) != -1 )
+	    metadata_exists = 1;
+	else
+		metadata_exists = 0;
+
+	if (metadata_exists == 0)
+	{
+		dataspace_id = H5Screate(H5S_SCALAR);
+		hdf5_file = H5Fcreate (metadata_file, H5F_ACC_EXCL, H5P_DEFAULT, H5P_DEFAULT);
+		if (hdf5_file < 0)
+		{
+			snprintf(error_str, sizeof(error_str), "The following metadata file could not be created: %s\n", metadata_file);
+			fprintf(stderr, "%s", error_str);
+			return(1);
+		}
+
+		/* H5Tget_class */
+		attribute_id = H5Acreate2 (hdf5_file, "H5Tget_class", H5T_NATIVE_ULLONG, dataspace_id,
+								   H5P_DEFAULT, H5P_DEFAULT);
+		result = (uint64_t)H5Tget_class(hdf5_data_object->dtype_id);
+		H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(result));
+		H5Aclose(attribute_id);
+
+		/* H5Tget_size */
+		attribute_id = H5Acreate2 (hdf5_file, "H5Tget_size", H5T_NATIVE_ULLONG, dataspace_id,
+								   H5P_DEFAULT, H5P_DEFAULT);
+		result = (uint64_t)H5Tget_size(hdf5_data_object->dtype_id);
+		H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(result));
+		H5Aclose(attribute_id);
+
+		/* H5Tget_order */
+		attribute_id = H5Acreate2 (hdf5_file, "H5Tget_order", H5T_NATIVE_ULLONG, dataspace_id,
+								   H5P_DEFAULT, H5P_DEFAULT);
+		result = (uint64_t)H5Tget_order(hdf5_data_object->dtype_id);
+		H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(result));
+		H5Aclose(attribute_id);
+
+		/* H5Tget_precision */
+		attribute_id = H5Acreate2 (hdf5_file, "H5Tget_precision", H5T_NATIVE_ULLONG, dataspace_id,
+								   H5P_DEFAULT, H5P_DEFAULT);
+		result = (uint64_t)H5Tget_precision(hdf5_data_object->dtype_id);
+		H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(result));
+		H5Aclose(attribute_id);
+
+		/* H5Tget_offset */
+		attribute_id = H5Acreate2 (hdf5_file, "H5Tget_offset", H5T_NATIVE_ULLONG, dataspace_id,
+								   H5P_DEFAULT, H5P_DEFAULT);
+		result = (uint64_t)H5Tget_offset(hdf5_data_object->dtype_id);
+		H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(result));
+		H5Aclose(attribute_id);
+
+		/* subdir_cadence_secs */
+		attribute_id = H5Acreate2 (hdf5_file, "subdir_cadence_secs", H5T_NATIVE_ULLONG, dataspace_id,
+								   H5P_DEFAULT, H5P_DEFAULT);
+		H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(hdf5_data_object->subdir_cadence_secs));
+		H5Aclose(attribute_id);
+
+		/* file_cadence_millisecs */
+		attribute_id = H5Acreate2 (hdf5_file, "file_cadence_millisecs", H5T_NATIVE_ULLONG, dataspace_id,
+								   H5P_DEFAULT, H5P_DEFAULT);
+		H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(hdf5_data_object->file_cadence_millisecs));
+		H5Aclose(attribute_id);
+
+		/* sample_rate_numerator */
+		attribute_id = H5Acreate2 (hdf5_file, "sample_rate_numerator", H5T_NATIVE_ULLONG, dataspace_id,
+								   H5P_DEFAULT, H5P_DEFAULT);
+		H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(hdf5_data_object->sample_rate_numerator));
+		H5Aclose(attribute_id);
+
+		/* sample_rate_denominator */
+		attribute_id = H5Acreate2 (hdf5_file, "sample_rate_denominator", H5T_NATIVE_ULLONG, dataspace_id,
+								   H5P_DEFAULT, H5P_DEFAULT);
+		H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(hdf5_data_object->sample_rate_denominator));
+		H5Aclose(attribute_id);
+
+		/* is_complex */
+		attribute_id = H5Acreate2 (hdf5_file, "is_complex", H5T_NATIVE_INT, dataspace_id,
+								   H5P_DEFAULT, H5P_DEFAULT);
+		H5Awrite(attribute_id, H5T_NATIVE_INT, &(hdf5_data_object->is_complex));
+		H5Aclose(attribute_id);
+
+		/* num_subchannels */
+		attribute_id = H5Acreate2 (hdf5_file, "num_subchannels", H5T_NATIVE_INT, dataspace_id,
+								   H5P_DEFAULT, H5P_DEFAULT);
+		H5Awrite(attribute_id, H5T_NATIVE_INT, &(hdf5_data_object->num_subchannels));
+		H5Aclose(attribute_id);
+
+		/* is_continuous */
+		attribute_id = H5Acreate2 (hdf5_file, "is_continuous", H5T_NATIVE_INT, dataspace_id,
+								   H5P_DEFAULT, H5P_DEFAULT);
+		H5Awrite(attribute_id, H5T_NATIVE_INT, &(hdf5_data_object->is_continuous));
+		H5Aclose(attribute_id);
+
+		/* epoch */
+		str_type = H5Tcopy(H5T_C_S1);
+		H5Tset_size(str_type, strlen(DIGITAL_RF_EPOCH)+1);
+		str_attribute = H5Acreate2(hdf5_file, "epoch", str_type, dataspace_id, H5P_DEFAULT, H5P_DEFAULT);
+		H5Awrite(str_attribute, str_type, DIGITAL_RF_EPOCH);
+		H5Aclose(str_attribute);
+
+		/* digital_rf_time_description */
+		H5Tset_size(str_type, strlen(DIGITAL_RF_TIME_DESCRIPTION)+1);
+		str_attribute = H5Acreate2(hdf5_file, "digital_rf_time_description", str_type, dataspace_id, H5P_DEFAULT, H5P_DEFAULT);
+		H5Awrite(str_attribute, str_type, DIGITAL_RF_TIME_DESCRIPTION);
+		H5Aclose(str_attribute);
+
+		/* digital_rf_version */
+		H5Tset_size(str_type, strlen(DIGITAL_RF_VERSION)+1);
+		str_attribute = H5Acreate2(hdf5_file, "digital_rf_version", str_type, dataspace_id, H5P_DEFAULT, H5P_DEFAULT);
+		H5Awrite(str_attribute, str_type, DIGITAL_RF_VERSION);
+		H5Aclose(str_attribute);
+
+		/* free resources used */
+		H5Tclose(str_type);
+		H5Sclose(dataspace_id);
+		H5Fclose(hdf5_file);
+	}
+	else
+	{
+		hdf5_file = H5Fopen(metadata_file, H5F_ACC_RDONLY, H5P_DEFAULT);
+		if (hdf5_file < 0)
+		{
+			snprintf(error_str, sizeof(error_str), "The following metadata file could not be opened: %s\n", metadata_file);
+			fprintf(stderr, "%s", error_str);
+			return(-1);
+		}
+
+		/* read all attributes and compare */
+
+		/* H5Tget_class attribute */
+		attribute_id = H5Aopen(hdf5_file, "H5Tget_class", H5P_DEFAULT);
+		if (attribute_id < 0)
+		{
+			snprintf(error_str, sizeof(error_str), "The H5Tget_class attribute not found in %s\n", metadata_file);
+			fprintf(stderr, "%s", error_str);
+			return(-1);
+		}
+		H5Aread(attribute_id, H5T_NATIVE_ULLONG, &result);
+		if (result != (uint64_t)H5Tget_class(hdf5_data_object->dtype_id))
+		{
+			fprintf(stderr, "Mismatching datatype found using H5Tget_class\n");
+			return(-1);
+		}
+		H5Aclose(attribute_id);
+
+		/* H5Tget_size attribute */
+		attribute_id = H5Aopen(hdf5_file, "H5Tget_size", H5P_DEFAULT);
+		if (attribute_id < 0)
+		{
+			snprintf(error_str, sizeof(error_str), "The H5Tget_size attribute not found in %s\n", metadata_file);
+			fprintf(stderr, "%s", error_str);
+			return(-1);
+		}
+		H5Aread(attribute_id, H5T_NATIVE_ULLONG, &result);
+		if (result != (uint64_t)H5Tget_size(hdf5_data_object->dtype_id))
+		{
+			fprintf(stderr, "Mismatching datatype found using H5Tget_size\n");
+			return(-1);
+		}
+		H5Aclose(attribute_id);
+
+		/* H5Tget_order attribute */
+		attribute_id = H5Aopen(hdf5_file, "H5Tget_order", H5P_DEFAULT);
+		if (attribute_id < 0)
+		{
+			snprintf(error_str, sizeof(error_str), "The H5Tget_order attribute not found in %s\n", metadata_file);
+			fprintf(stderr, "%s", error_str);
+			return(-1);
+		}
+		H5Aread(attribute_id, H5T_NATIVE_ULLONG, &result);
+		if (result != (uint64_t)H5Tget_order(hdf5_data_object->dtype_id))
+		{
+			fprintf(stderr, "Mismatching datatype found using H5Tget_order\n");
+			return(-1);
+		}
+		H5Aclose(attribute_id);
+
+		/* H5Tget_precision attribute */
+		attribute_id = H5Aopen(hdf5_file, "H5Tget_precision", H5P_DEFAULT);
+		if (attribute_id < 0)
+		{
+			snprintf(error_str, sizeof(error_str), "The H5Tget_precision attribute not found in %s\n", metadata_file);
+			fprintf(stderr, "%s", error_str);
+			return(-1);
+		}
+		H5Aread(attribute_id, H5T_NATIVE_ULLONG, &result);
+		if (result != (uint64_t)H5Tget_precision(hdf5_data_object->dtype_id))
+		{
+			fprintf(stderr, "Mismatching datatype found using H5Tget_precision\n");
+			return(-1);
+		}
+		H5Aclose(attribute_id);
+
+		/* H5Tget_offset attribute */
+		attribute_id = H5Aopen(hdf5_file, "H5Tget_offset", H5P_DEFAULT);
+		if (attribute_id < 0)
+		{
+			snprintf(error_str, sizeof(error_str), "The H5Tget_offset attribute not found in %s\n", metadata_file);
+			fprintf(stderr, "%s", error_str);
+			return(-1);
+		}
+		H5Aread(attribute_id, H5T_NATIVE_ULLONG, &result);
+		if (result != (uint64_t)H5Tget_offset(hdf5_data_object->dtype_id))
+		{
+			fprintf(stderr, "Mismatching datatype found using H5Tget_offset\n");
+			return(-1);
+		}
+		H5Aclose(attribute_id);
+
+		/* subdir_cadence_secs attribute */
+		attribute_id = H5Aopen(hdf5_file, "subdir_cadence_secs", H5P_DEFAULT);
+		if (attribute_id < 0)
+		{
+			snprintf(error_str, sizeof(error_str), "The subdir_cadence_secs attribute not found in %s\n", metadata_file);
+			fprintf(stderr, "%s", error_str);
+			return(-1);
+		}
+		H5Aread(attribute_id, H5T_NATIVE_ULLONG, &result);
+		if (result != hdf5_data_object->subdir_cadence_secs)
+		{
+			fprintf(stderr, "Mismatching subdir_cadence_secs found\n");
+			return(-1);
+		}
+		H5Aclose(attribute_id);
+
+		/* file_cadence_millisecs attribute */
+		attribute_id = H5Aopen(hdf5_file, "file_cadence_millisecs", H5P_DEFAULT);
+		if (attribute_id < 0)
+		{
+			snprintf(error_str, sizeof(error_str), "The file_cadence_millisecs attribute not found in %s\n", metadata_file);
+			fprintf(stderr, "%s", error_str);
+			return(-1);
+		}
+		H5Aread(attribute_id, H5T_NATIVE_ULLONG, &result);
+		if (result != hdf5_data_object->file_cadence_millisecs)
+		{
+			fprintf(stderr, "Mismatching file_cadence_millisecs found\n");
+			return(-1);
+		}
+		H5Aclose(attribute_id);
+
+		/* sample_rate_numerator attribute */
+		attribute_id = H5Aopen(hdf5_file, "sample_rate_numerator", H5P_DEFAULT);
+		if (attribute_id < 0)
+		{
+			snprintf(error_str, sizeof(error_str), "The sample_rate_numerator attribute not found in %s\n", metadata_file);
+			fprintf(stderr, "%s", error_str);
+			return(-1);
+		}
+		H5Aread(attribute_id, H5T_NATIVE_ULLONG, &result);
+		if (result != hdf5_data_object->sample_rate_numerator)
+		{
+			fprintf(stderr, "Mismatching sample_rate_numerator found\n");
+			return(-1);
+		}
+		H5Aclose(attribute_id);
+
+		/* sample_rate_denominator attribute */
+		attribute_id = H5Aopen(hdf5_file, "sample_rate_denominator", H5P_DEFAULT);
+		if (attribute_id < 0)
+		{
+			snprintf(error_str, sizeof(error_str), "The sample_rate_denominator attribute not found in %s\n", metadata_file);
+			fprintf(stderr, "%s", error_str);
+			return(-1);
+		}
+		H5Aread(attribute_id, H5T_NATIVE_ULLONG, &result);
+		if (result != hdf5_data_object->sample_rate_denominator)
+		{
+			fprintf(stderr, "Mismatching sample_rate_denominator found\n");
+			return(-1);
+		}
+		H5Aclose(attribute_id);
+
+		/* is_complex attribute */
+		attribute_id = H5Aopen(hdf5_file, "is_complex", H5P_DEFAULT);
+		if (attribute_id < 0)
 		{
-			snprintf(error_str, BIG_HDF5_STR, "indices in data_index_arr out of order - index %" PRIu64 " and %" PRIu64 "\n", i-1,i);
+			snprintf(error_str, sizeof(error_str), "The is_complex attribute not found in %s\n", metadata_file);
 			fprintf(stderr, "%s", error_str);
-			*rows_to_write = -1;
-			return(NULL);
+			return(-1);
 		}
-		if (i>0 && prev_sample >= this_sample)
+		H5Aread(attribute_id, H5T_NATIVE_INT, &int_result);
+		if (int_result != hdf5_data_object->is_complex)
 		{
-			snprintf(error_str, BIG_HDF5_STR, "indices in global_index_arr out of order - index %" PRIu64 " and %" PRIu64 "\n", i-1,i);
-			fprintf(stderr, "%s", error_str);
-			*rows_to_write = -1;
-			return(NULL);
+			fprintf(stderr, "Mismatching is_complex found\n");
+			return(-1);
 		}
-		if (i>0 && ((this_index - prev_index) > (this_sample - prev_sample)))
+		H5Aclose(attribute_id);
+
+		/* num_subchannels attribute */
+		attribute_id = H5Aopen(hdf5_file, "num_subchannels", H5P_DEFAULT);
+		if (attribute_id < 0)
 		{
-			snprintf(error_str, BIG_HDF5_STR, "error - indices advancing faster than global index at index %" PRIu64 ", illegal\n", i);
+			snprintf(error_str, sizeof(error_str), "The num_subchannels attribute not found in %s\n", metadata_file);
 			fprintf(stderr, "%s", error_str);
-			*rows_to_write = -1;
-			return(NULL);
+			return(-1);
 		}
-
-		/* see if these indices are needed for this file */
-		if (i > 0)
+		H5Aread(attribute_id, H5T_NATIVE_INT, &int_result);
+		if (int_result != hdf5_data_object->num_subchannels)
 		{
-			if (next_global_sample < prev_sample + (this_index - prev_index) && last_global_sample >= this_sample)
-				row_count++;
+			fprintf(stderr, "Mismatching num_subchannels found\n");
+			return(-1);
 		}
-		else if (!file_exists || hdf5_data_object->needs_chunking)
-			row_count++;
+		H5Aclose(attribute_id);
 
-		/* determine range of data [bottom_index, top_index] that will be written to this file */
-		/* set bottom_index if unset and the global sample for this block is past the next sample to be written */
-		if (this_sample > next_global_sample && bottom_index == -1)
+		/* is_continuous attribute */
+		attribute_id = H5Aopen(hdf5_file, "is_continuous", H5P_DEFAULT);
+		if (attribute_id < 0)
 		{
-			/* calculate bottom index */
-			if (i>0)
-			{
-				if (prev_sample + (this_index-prev_index) < next_global_sample)
-				{
-					/* next_global_sample falls in a gap */
-					bottom_index = this_index;
-				}
-				else
-					bottom_index = prev_index + (next_global_sample - prev_sample);
-			}
-			else
-				bottom_index = 0;
+			snprintf(error_str, sizeof(error_str), "The is_continuous attribute not found in %s\n", metadata_file);
+			fprintf(stderr, "%s", error_str);
+			return(-1);
 		}
-		/* set top_index if unset and the global sample for this block is past the last sample to be in the file */
-		if (this_sample > last_global_sample && top_index == -1)
+		H5Aread(attribute_id, H5T_NATIVE_INT, &int_result);
+		if (int_result != hdf5_data_object->is_continuous)
 		{
-			/* calculate top index */
-			if (last_global_sample > prev_sample + (this_index - prev_index))
-			{
-				/* last sample falls in a gap */
-				top_index = this_index;
-			}
-			else
-				top_index = prev_index + (last_global_sample - prev_sample);
+			fprintf(stderr, "Mismatching is_continuous found\n");
+			return(-1);
 		}
+		H5Aclose(attribute_id);
 
-		prev_index = this_index;
-		prev_sample = this_sample;
+
+		H5Fclose(hdf5_file);
 	}
 
-	/* now handle write data beyond last gap */
-	this_index = vector_len;
-	this_sample = prev_sample + (this_index-prev_index);
+	/* no problems found */
+	return(0);
 
-	/* set bottom_index according to last data block if unset */
-	if (bottom_index == -1)
-		bottom_index = prev_index + (next_global_sample-prev_sample);
+}
 
-	/* set top_index according to last data block if unset */
-	if (top_index == -1)
-	{
-		if (last_global_sample < this_sample)
-			/* file ends before last sample in data block */
-			top_index = prev_index + (last_global_sample - prev_sample);
-		else
-			/* write includes last sample in data block */
-			/* works out to top_index == vector_len */
-			top_index = prev_index + (this_sample - prev_sample);
-	}
-	/* now we know how many samples to write from the data to this file */
-	*samples_to_write = top_index - bottom_index;
 
-	/* if no indices need to be malloced, return now */
-	if (row_count == 0)
+uint64_t digital_rf_get_file_id(char * basename)
+/* digital_rf_get_file_id returns the file id used in the sidecar index, the unix millisecond the file
+ * starts, parsed from a basename of the form [tmp.]rf@<second>.<millisecond>.h5
+ */
+{
+	uint64_t file_sec_part = 0, file_millisec_part = 0;
+
+	sscanf(strstr(basename, "rf@"), "rf@%" SCNu64 ".%" SCNu64, &file_sec_part, &file_millisec_part);
+	return(file_sec_part * 1000 + file_millisec_part);
+}
+
+
+int digital_rf_add_sidecar_rows(Digital_rf_write_object * hdf5_data_object, uint64_t * rf_data_index_arr, int block_index_len)
+/* digital_rf_add_sidecar_rows adds the rows just written to /rf_data_index of the open file to the rows
+ * to be appended to the sidecar index when the file is finalized
+ *
+ * Inputs:
+ *  Digital_rf_write_object *hdf5_data_object - the Digital_rf_write_object created by digital_rf_create_write_hdf5
+ *  uint64_t * rf_data_index_arr - uint64_t array of size (block_index_len * 2) as written to /rf_data_index
+ *  int block_index_len - number of rows in rf_data_index_arr
+ *
+ *  Returns 0 if success
+ */
+{
+	int i;
+	uint64_t * row;
+
+	if (hdf5_data_object->sidecar_num_rows + block_index_len + 1 > hdf5_data_object->sidecar_capacity)
 	{
-		*rows_to_write = 0;
-		return(NULL);
+		/* one extra row always kept free for the end row */
+		hdf5_data_object->sidecar_capacity = 2 * (hdf5_data_object->sidecar_num_rows + block_index_len + 1);
+		if ((hdf5_data_object->sidecar_rows = (uint64_t *)realloc(hdf5_data_object->sidecar_rows,
+				sizeof(uint64_t) * 3 * hdf5_data_object->sidecar_capacity))==0)
+		{
+			fprintf(stderr, "malloc failure - unrecoverable\n");
+			exit(-1);
+		}
 	}
-
-	/* now that we know how many rows to malloc, malloc them */
-	/* allocate overall object */
-	if ((ret_arr = (uint64_t *)malloc(sizeof(uint64_t)*row_count*2))==0)
+	for (i=0; i<block_index_len; i++)
 	{
-		fprintf(stderr, "malloc failure - unrecoverable\n");
-		exit(-1);
+		row = hdf5_data_object->sidecar_rows + 3 * hdf5_data_object->sidecar_num_rows;
+		row[0] = rf_data_index_arr[2*i];
+		row[1] = hdf5_data_object->sidecar_file_id;
+		row[2] = rf_data_index_arr[2*i + 1];
+		hdf5_data_object->sidecar_num_rows++;
 	}
+	return(0);
+}
 
-	/* next pass is to fill out ret_arr */
-	/* ret_arr is [global_sampleN, data_indexN, ...] for blocks in file */
-	for (i=0; i<index_len; i++)
-	{
-		this_index = data_index_arr[i];
-		this_sample = global_index_arr[i];
 
-		/* only thing we do on the first pass is add to ret_arr for start of
-		 * data if it's a new file or the data is written in chunked format */
-		if (i == 0 && (!file_exists || hdf5_data_object->needs_chunking))
-		{
-			ret_arr[0] = next_global_sample + hdf5_data_object->global_start_sample;
-			/* handle the case of the first sample written where it may not be the first sample in the file */
-			/* and we're writing the data in continuous format */
-			if (hdf5_data_object->is_continuous && !hdf5_data_object->needs_chunking)
-				ret_arr[0] -= max_samples_this_file - samples_left;
-			    /* since ret_arr is referenced to first global sample, may actually be negative */
-			/* ret_arr[1] will have hdf5_data_object->dataset_index added later
-			 * upon expansion to account for existing data in file */
-			ret_arr[1] = 0;
-			rows_written++;
-		}
-		/* on subsequent passes, add the block to ret_arr when it falls in the file */
-		if (i > 0)
-		{
-			if (next_global_sample < prev_sample + (this_index - prev_index) && last_global_sample >= this_sample)
-			{
-				ret_arr[2*rows_written] = this_sample + hdf5_data_object->global_start_sample;
-				/* data index for data in file is different from data index of the data in the write call */
-				/* by the number of samples previously written from the data (to previous files) */
-				ret_arr[2*rows_written + 1] = this_index - samples_written;
-				rows_written++;
-			}
-		}
+int digital_rf_end_sidecar_file(Digital_rf_write_object * hdf5_data_object)
+/* digital_rf_end_sidecar_file adds the end row of the open file to the sidecar rows, giving the length
+ * of /rf_data so that readers know where the last block ends.  Called just before /rf_data is closed.
+ *
+ *  Returns 0 if success, -1 if failure
+ */
+{
+	hsize_t dims[2];
+	hid_t space;
+	uint64_t * last_row;
+	uint64_t * row;
 
-		prev_index = this_index;
-		prev_sample = this_sample;
-	}
-	assert(rows_written==row_count);  /* or else there's a bug in my logic */
-	*rows_to_write = rows_written;
+	if (!hdf5_data_object->sidecar_index || hdf5_data_object->sidecar_num_rows == 0 || !hdf5_data_object->dataset)
+		return(0);
 
-	return(ret_arr);
+	space = H5Dget_space(hdf5_data_object->dataset);
+	H5Sget_simple_extent_dims(space, dims, NULL);
+	H5Sclose(space);
 
+	last_row = hdf5_data_object->sidecar_rows + 3 * (hdf5_data_object->sidecar_num_rows - 1);
+	row = last_row + 3;
+	row[0] = last_row[0] + (dims[0] - last_row[2]);
+	row[1] = hdf5_data_object->sidecar_file_id;
+	row[2] = dims[0];
+	hdf5_data_object->sidecar_num_rows++;
+	return(0);
 }
 
 
-int digital_rf_write_rf_data_index(Digital_rf_write_object * hdf5_data_object, uint64_t * rf_data_index_arr, int block_index_len)
-/* digital_rf_write_rf_data_index writes rf_data_index to the open Hdf5 file
+int digital_rf_append_sidecar_index(Digital_rf_write_object * hdf5_data_object)
+/* digital_rf_append_sidecar_index appends the sidecar rows of the file just finalized to the sidecar index,
+ * creating it with its header if needed.  All rows of a file are appended with a single write, and readers
+ * ignore any partial row left by a crash.
  *
- * Inputs:
- *  Digital_rf_write_object *hdf5_data_object - the Digital_rf_write_object created by digital_rf_create_write_hdf5
- *  uint64_t * rf_data_index_arr - uint64_t array of size (block_index_len * 2) to write - all values are already set
+ *  Returns 0 if success, -1 if failure
+ */
+{
+	char fullname[BIG_HDF5_STR] = "";
+	uint64_t byte_order = 1;
+	size_t num_rows = (size_t)hdf5_data_object->sidecar_num_rows;
+	FILE * fp;
+
+	if (!hdf5_data_object->sidecar_index || num_rows == 0)
+		return(0);
+	hdf5_data_object->sidecar_num_rows = 0;
+
+	snprintf(fullname, BIG_HDF5_STR, "%s/%s", hdf5_data_object->directory, DIGITAL_RF_SIDECAR_INDEX);
+	if ((fp = fopen(fullname, "ab")) == NULL)
+	{
+		fprintf(stderr, "Unable to open sidecar index %s\n", fullname);
+		return(-1);
+	}
+	fseek(fp, 0, SEEK_END);
+	if (ftell(fp) == 0)
+	{
+		if (fwrite(DIGITAL_RF_SIDECAR_MAGIC, 1, 8, fp) != 8 || fwrite(&byte_order, sizeof(uint64_t), 1, fp) != 1)
+		{
+			fprintf(stderr, "Unable to write sidecar index %s\n", fullname);
+			fclose(fp);
+			return(-1);
+		}
+	}
+	if (fwrite(hdf5_data_object->sidecar_rows, sizeof(uint64_t) * 3, num_rows, fp) != num_rows)
+	{
+		fprintf(stderr, "Unable to write sidecar index %s\n", fullname);
+		fclose(fp);
+		return(-1);
+	}
+	if (fclose(fp))
+	{
+		fprintf(stderr, "Unable to write sidecar index %s\n", fullname);
+		return(-1);
+	}
+	return(0);
+}
+
+
+#ifndef _WIN32
+int digital_rf_queue_async_write(Digital_rf_write_object *hdf5_data_object, uint64_t * global_index_arr, uint64_t * data_index_arr,
+		uint64_t index_len, void * vector, uint64_t vector_length)
+/* digital_rf_queue_async_write copies a write into the ring of the writer thread, split into pieces of at most
+ * buffer_samples samples, each with its own index arrays.  The write is checked as digital_rf_write_blocks_hdf5
+ * would first, so that only failures to write files are left to the writer thread.
  *
- *  Returns 0 if success, non-zero if error
+ * 	Returns 0 if success, -7 if the ring did not have room for the whole write and it was dropped, the error
+ * 	digital_rf_write_blocks_hdf5 would return for the write, or the result of an earlier write that failed on
+ * 	the writer thread
  */
 {
-	int i;
-	/* variables for /rf_data_index */
-	char index_datasetname[] = "rf_data_index";
-	hsize_t  index_dims[2]  = {0, 2};
-	hsize_t  dimsext[2] = {block_index_len, 2};
-	hsize_t  index_maxdims[2] = {H5S_UNLIMITED, 2};
-	hsize_t  offset[2] = {0, 0};
-	hid_t    index_dataspace, filespace, memspace;
-	herr_t      status;
+	struct drf_async_writer * async = hdf5_data_object->async;
+	drf_async_buffer * buffer;
+	uint64_t piece_start, piece_len, k = 0, n, i;
+	uint64_t num_pieces = (vector_length + async->buffer_samples - 1) / async->buffer_samples;
+	int stalled = 0;
+	int result;
 
-	/* find out if we need to create a new dataset, or expand and existing one */
-	if (hdf5_data_object->index_dataset == 0)
+	if (!vector)
 	{
-		/* create new dataset */
-		index_dims[0] = block_index_len;
-		index_dataspace = H5Screate_simple (2, index_dims, index_maxdims);
-		hdf5_data_object->index_dataset = H5Dcreate2 (hdf5_data_object->hdf5_file, index_datasetname,
-												H5T_NATIVE_ULLONG,
-												index_dataspace, H5P_DEFAULT,
-												hdf5_data_object->index_prop, H5P_DEFAULT);
-		status = H5Dwrite(hdf5_data_object->index_dataset, H5T_NATIVE_ULLONG, H5S_ALL, H5S_ALL, H5P_DEFAULT,
-					rf_data_index_arr);
-		if (status < 0)
-			return(status);
+		fprintf(stderr, "Null data passed in\n");
+		return(-2);
+	}
+	if (index_len < 1 || data_index_arr[0] != 0)
+	{
+		fprintf(stderr, "First value of data_index_arr must be 0\n");
+		return(-6);
+	}
+	if (global_index_arr[0] < async->next_global_index)
+	{
+		fprintf(stderr, "Request index %" PRIu64 " before first expected index %" PRIu64 " in digital_rf_write_hdf5\n",
+				global_index_arr[0], async->next_global_index);
+		return(-3);
+	}
+	if (hdf5_data_object->is_continuous && index_len > 1)
+	{
+		fprintf(stderr, "Gapped data passed in, but is_continuous set\n");
+		return(-4);
+	}
+	for (i=1; i<index_len; i++)
+	{
+		if (data_index_arr[i] <= data_index_arr[i - 1] || data_index_arr[i] >= vector_length
+				|| global_index_arr[i] < global_index_arr[i - 1] + (data_index_arr[i] - data_index_arr[i - 1]))
+		{
+			fprintf(stderr, "Illegal index arrays at index %" PRIu64 ", data_index_arr must increase within "
+					"vector_length and global_index_arr by at least as much\n", i);
+			return(-6);
+		}
+	}
 
-		H5Sclose(index_dataspace);
-		hdf5_data_object->next_index_avail = block_index_len;
+	/* without blocking, room for the whole write is taken now: only this thread queues, so it stays free */
+	pthread_mutex_lock(&async->lock);
+	if (async->error)
+	{
+		result = async->error;
+		pthread_mutex_unlock(&async->lock);
+		return(result);
 	}
-	else
+	if (!async->block && num_pieces > (uint64_t)(async->num_buffers - async->count))
 	{
-		/* expand dataset */
-		/* adjust data index in rf_data_index_arr to account for samples already in file */
-		for (i=0; i<block_index_len; i++)
+		async->overflows++;
+		async->samples_dropped += vector_length;
+		pthread_mutex_unlock(&async->lock);
+		return(-7);
+	}
+	pthread_mutex_unlock(&async->lock);
+
+	for (piece_start = 0; piece_start < vector_length; piece_start += piece_len)
+	{
+		if (vector_length - piece_start < async->buffer_samples)
+			piece_len = vector_length - piece_start;
+		else
+			piece_len = async->buffer_samples;
+
+		/* wait for a free buffer */
+		pthread_mutex_lock(&async->lock);
+		while (async->count == async->num_buffers)
+		{
+			if (!stalled)
+			{
+				async->stalls++;
+				stalled = 1;
+			}
+			pthread_cond_wait(&async->not_full, &async->lock);
+		}
+		buffer = &async->buffers[async->head];
+		pthread_mutex_unlock(&async->lock);
+
+		/* the writer thread only reads queued buffers, so this one is filled without the lock */
+		while (k + 1 < index_len && data_index_arr[k + 1] <= piece_start)
+			k++;
+		n = 1;
+		while (k + n < index_len && data_index_arr[k + n] < piece_start + piece_len)
+			n++;
+		if (n > buffer->index_capacity)
 		{
-			/* data index are odd terms in rf_data_index_arr,
-			 * dataset_index adds number of samples already in file */
-			rf_data_index_arr[2*i + 1] += hdf5_data_object->dataset_index;
+			buffer->global_index_arr = (uint64_t *)realloc(buffer->global_index_arr, n * sizeof(uint64_t));
+			buffer->data_index_arr = (uint64_t *)realloc(buffer->data_index_arr, n * sizeof(uint64_t));
+			if (!buffer->global_index_arr || !buffer->data_index_arr)
+			{
+				fprintf(stderr, "Realloc failure\n");
+				exit(-22);
+			}
+			buffer->index_capacity = n;
+		}
+		/* first block of the piece starts wherever the piece does */
+		buffer->global_index_arr[0] = global_index_arr[k] + (piece_start - data_index_arr[k]);
+		buffer->data_index_arr[0] = 0;
+		for (i=1; i<n; i++)
+		{
+			buffer->global_index_arr[i] = global_index_arr[k + i];
+			buffer->data_index_arr[i] = data_index_arr[k + i] - piece_start;
+		}
+		buffer->index_len = n;
+		memcpy(buffer->vector, (char *)vector + piece_start * async->sample_size, piece_len * async->sample_size);
+		buffer->vector_length = piece_len;
+
+		pthread_mutex_lock(&async->lock);
+		async->head = (async->head + 1) % async->num_buffers;
+		async->count++;
+		if (async->count > async->max_queued)
+			async->max_queued = async->count;
+		pthread_cond_signal(&async->not_empty);
+		pthread_mutex_unlock(&async->lock);
+
+		if (async->hub != NULL)
+		{
+			pthread_mutex_lock(&async->hub->lock);
+			async->hub->queued++;
+			if (async->hub->queued > async->hub->max_queued)
+				async->hub->max_queued = async->hub->queued;
+			pthread_cond_signal(&async->hub->work);
+			pthread_mutex_unlock(&async->hub->lock);
 		}
-		/* write to existing index */
-		index_dims[0] = hdf5_data_object->next_index_avail + block_index_len;
-		status = H5Dset_extent (hdf5_data_object->index_dataset, index_dims);
-		filespace = H5Dget_space (hdf5_data_object->index_dataset);
-		offset[0] = hdf5_data_object->next_index_avail;
-		status = H5Sselect_hyperslab (filespace, H5S_SELECT_SET, offset, NULL,
-				dimsext, NULL);
-		if (status < 0)
-			return(status);
-		memspace = H5Screate_simple (2, dimsext, NULL);
-		status = H5Dwrite (hdf5_data_object->index_dataset, H5T_NATIVE_ULLONG, memspace, filespace,
-		                       H5P_DEFAULT, rf_data_index_arr);
-		if (status < 0)
-			return(status);
-
-		H5Sclose (memspace);
-		H5Sclose (filespace);
-		hdf5_data_object->next_index_avail += block_index_len;
 	}
+	async->next_global_index = global_index_arr[index_len - 1] + (vector_length - data_index_arr[index_len - 1]);
 	return(0);
 }
 
 
-uint64_t digital_rf_get_global_sample(uint64_t samples_written, uint64_t * global_index_arr, uint64_t * data_index_arr,
-		                              uint64_t index_len)
-/* digital_rf_get_global_sample calculates the global_sample given samples_written using global_index_arr and data_index_arr
- *
- *  uint64_t samples_written - the number of samples written to previous files during this particular user write call
- * 	uint64_t * global_index_arr - an array of global indices into the samples being written.  The global
- * 		index is the total number of sample periods since data taking began, including gaps.
- * 	uint64_t * data_index_arr - an array of len = len(global_index_arr), where the indices are related to which
- * 		sample in the vector being passed in by the user, so that the first value is always 0
- * 	uint_64 index_len - the len of both global_index_arr and data_index_arr.  Must be greater than 0.
- *
- * 	This method tells the global index when some samples have already been written.  If samples_written == 0,
- * 	returns global_index_arr[0].  Else returns global_index_arr[i] + (samples_written-data_index_arr[i]) where
- * 	i is the highest row where data_index_arr[i] <= samples_written
+struct drf_async_writer * digital_rf_alloc_async(Digital_rf_write_object *hdf5_data_object, int num_buffers,
+		uint64_t buffer_samples, int block)
+/* digital_rf_alloc_async allocates the ring of an async writer, see digital_rf_set_async for the arguments
  *
+ * 	Returns the ring, with no thread writing it yet, or NULL if the arguments are illegal
  */
 {
-	/* local variables */
-	uint64_t i;
-	uint64_t ret_value;
+	struct drf_async_writer * async;
+	int i;
 
-	ret_value = global_index_arr[0] + (samples_written - data_index_arr[0]);
-	for (i=1; i<index_len; i++)
+	if (num_buffers < 1 || buffer_samples < 1)
 	{
-		if (samples_written < data_index_arr[i])
-			break;
-		ret_value = global_index_arr[i] + (samples_written - data_index_arr[i]);
+		fprintf(stderr, "Illegal num_buffers %i, buffer_samples %" PRIu64 " in digital_rf_set_async\n",
+				num_buffers, buffer_samples);
+		return(NULL);
 	}
-	return(ret_value);
+
+	if ((async = (struct drf_async_writer *)calloc(1, sizeof(struct drf_async_writer))) == NULL
+			|| (async->buffers = (drf_async_buffer *)calloc(num_buffers, sizeof(drf_async_buffer))) == NULL)
+	{
+		fprintf(stderr, "malloc failure - unrecoverable\n");
+		exit(-1);
+	}
+	async->num_buffers = num_buffers;
+	async->buffer_samples = buffer_samples;
+	async->sample_size = hdf5_data_object->sample_size;
+	async->block = block ? 1 : 0;
+	async->next_global_index = hdf5_data_object->global_index;
+	for (i=0; i<num_buffers; i++)
+	{
+		async->buffers[i].index_capacity = 16;
+		if ((async->buffers[i].global_index_arr = (uint64_t *)malloc(16 * sizeof(uint64_t))) == NULL
+				|| (async->buffers[i].data_index_arr = (uint64_t *)malloc(16 * sizeof(uint64_t))) == NULL
+				|| (async->buffers[i].vector = (char *)malloc(buffer_samples * async->sample_size)) == NULL)
+		{
+			fprintf(stderr, "malloc failure - unrecoverable\n");
+			exit(-1);
+		}
+	}
+	pthread_mutex_init(&async->lock, NULL);
+	pthread_cond_init(&async->not_empty, NULL);
+	pthread_cond_init(&async->not_full, NULL);
+	return(async);
 }
 
-int digital_rf_extend_dataset(Digital_rf_write_object * hdf5_data_object, uint64_t samples_to_write)
-/* digital_rf_extend_dataset is a method to extend the dataset of on opened Hdf5 file
- *
- * Digital_rf_write_object *hdf5_data_object - the Digital_rf_write_object created by digital_rf_create_write_hdf5
- * uint64_t - the number of samples to expand existing dataset
- *
+
+int digital_rf_is_async_writer(Digital_rf_write_object *hdf5_data_object)
+/* digital_rf_is_async_writer returns 1 if the calling thread is the one writing the ring of hdf5_data_object, so
+ * its writes go to the files, 0 if its writes must be queued
  */
 {
-	/* local variables */
-	herr_t   status;
-	hsize_t  dims[2]  = {0, hdf5_data_object->num_subchannels};
+	struct drf_async_writer * async = hdf5_data_object->async;
+	int result;
 
-	dims[0] = hdf5_data_object->dataset_index + samples_to_write;
-	status = H5Dset_extent (hdf5_data_object->dataset, dims);
-	return((int)status);
+	if (async->hub == NULL)
+		return(pthread_equal(pthread_self(), async->thread) ? 1 : 0);
+	pthread_mutex_lock(&async->lock);
+	result = (async->writing && pthread_equal(pthread_self(), async->thread)) ? 1 : 0;
+	pthread_mutex_unlock(&async->lock);
+	return(result);
 }
 
-int digital_rf_handle_metadata(Digital_rf_write_object * hdf5_data_object)
-/* digital_rf_handle_metadata is a method that either creates or verifies consistency with <channel>/drf_properties.h5
- *
- * drf_properties.h5 is a simple hdf5 file where the root group has the following attributes:
- * 	1. uint64_t H5Tget_class (result of H5Tget_class(hdf5_data_object->hdf5_data_object)
- * 	2. uint64_t H5Tget_size (result of H5Tget_size(hdf5_data_object->hdf5_data_object)
- * 	3. uint64_t H5Tget_order (result of H5Tget_order(hdf5_data_object->hdf5_data_object)
- * 	4. uint64_t H5Tget_precision (result of H5Tget_precision(hdf5_data_object->hdf5_data_object)
- * 	5. uint64_t H5Tget_offset (result of H5Tget_offset(hdf5_data_object->hdf5_data_object)
- * 	6. uint64_t subdir_cadence_secs,
- * 	7. uint64_t file_cadence_millisecs
- * 	8. uint64_t sample_rate_numerator
- * 	9. uint64_t sample_rate_denominator
- * 	10. int is_complex
- * 	11. int num_subchannels
- * 	12. int is_continuous
- * 	13. char[] epoch
- * 	14. char[] digital_rf_time_description
- * 	15. char[] digital_rf_version
- *
- * 	If drf_properties.h5 does not exist, creates it. Returns 0 if success, 1 if not.
- *
- * 	If drf_properties.h5 does exist, verifies that first 11 attributes match that in init.  If so, returns
- * 	0. If not, returns -1
+
+void * digital_rf_async_writer_thread(void * arg)
+/* digital_rf_async_writer_thread writes queued buffers in order until told to stop with none left.  After a write
+ * fails, the rest are discarded and the failure is kept for the caller.
+ */
+{
+	Digital_rf_write_object * hdf5_data_object = (Digital_rf_write_object *)arg;
+	struct drf_async_writer * async = hdf5_data_object->async;
+	drf_async_buffer * buffer;
+	int failed, result;
+
+	pthread_mutex_lock(&async->lock);
+	for (;;)
+	{
+		while (async->count == 0 && !async->stop)
+			pthread_cond_wait(&async->not_empty, &async->lock);
+		if (async->count == 0)
+			break;
+		buffer = &async->buffers[(async->head + async->num_buffers - async->count) % async->num_buffers];
+		failed = async->error;
+		pthread_mutex_unlock(&async->lock);
+
+		result = 0;
+		if (!failed)
+			result = digital_rf_write_blocks_hdf5(hdf5_data_object, buffer->global_index_arr, buffer->data_index_arr,
+					buffer->index_len, buffer->vector, buffer->vector_length);
+		/* writes were checked as they were queued, so this failed writing files */
+		if (result)
+			hdf5_data_object->has_failure = 1;
+
+		pthread_mutex_lock(&async->lock);
+		if (result && !async->error)
+			async->error = result;
+		async->count--;
+		pthread_cond_broadcast(&async->not_full);
+	}
+	pthread_mutex_unlock(&async->lock);
+	return(NULL);
+}
+
+
+int digital_rf_end_async(Digital_rf_write_object *hdf5_data_object)
+/* digital_rf_end_async waits for the writer thread to write everything queued, stops it (or takes the channel off
+ * its hub) and frees the ring, leaving hdf5_data_object in synchronous mode
  *
+ * 	Returns 0 if success, else the result of the first write that failed on the writer thread
  */
 {
-	/* local variables */
-	char metadata_file[BIG_HDF5_STR] = "";
-	char error_str[2*BIG_HDF5_STR] = "";
-	int metadata_exists = 0;
-	hid_t hdf5_file, str_type, str_attribute;
-	hid_t attribute_id, dataspace_id;  /* identifiers */
-	uint64_t result;
-	int int_result;
+	struct drf_async_writer * async = hdf5_data_object->async;
+	int result;
 
-	/* find out if drf_properties.h5 exists */
-	strcpy(metadata_file, hdf5_data_object->directory);
-	strcat(metadata_file, "/");
-	strcat(metadata_file, "drf_properties.h5");
-	if( access( metadata_file, R_OK ) != -1 )
-	    metadata_exists = 1;
+	result = digital_rf_flush_async(hdf5_data_object);
+	if (async->hub != NULL)
+		digital_rf_hub_remove_channel(hdf5_data_object);
 	else
-		metadata_exists = 0;
+	{
+		pthread_mutex_lock(&async->lock);
+		async->stop = 1;
+		pthread_cond_signal(&async->not_empty);
+		pthread_mutex_unlock(&async->lock);
+		pthread_join(async->thread, NULL);
+	}
 
-	if (metadata_exists == 0)
+	hdf5_data_object->async = NULL;
+	digital_rf_free_async(async);
+	return(result);
+}
+
+
+void digital_rf_free_async(struct drf_async_writer * async)
+/* digital_rf_free_async frees the ring and synchronization objects of a writer thread that is not running */
+{
+	int i;
+
+	for (i=0; i<async->num_buffers; i++)
 	{
-		dataspace_id = H5Screate(H5S_SCALAR);
-		hdf5_file = H5Fcreate (metadata_file, H5F_ACC_EXCL, H5P_DEFAULT, H5P_DEFAULT);
-		if (hdf5_file < 0)
-		{
-			snprintf(error_str, sizeof(error_str), "The following metadata file could not be created: %s\n", metadata_file);
-			fprintf(stderr, "%s", error_str);
-			return(1);
-		}
+		free(async->buffers[i].global_index_arr);
+		free(async->buffers[i].data_index_arr);
+		free(async->buffers[i].vector);
+	}
+	free(async->buffers);
+	pthread_mutex_destroy(&async->lock);
+	pthread_cond_destroy(&async->not_empty);
+	pthread_cond_destroy(&async->not_full);
+	free(async);
+}
+#endif
 
-		/* H5Tget_class */
-		attribute_id = H5Acreate2 (hdf5_file, "H5Tget_class", H5T_NATIVE_ULLONG, dataspace_id,
-								   H5P_DEFAULT, H5P_DEFAULT);
-		result = (uint64_t)H5Tget_class(hdf5_data_object->dtype_id);
-		H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(result));
-		H5Aclose(attribute_id);
 
-		/* H5Tget_size */
-		attribute_id = H5Acreate2 (hdf5_file, "H5Tget_size", H5T_NATIVE_ULLONG, dataspace_id,
-								   H5P_DEFAULT, H5P_DEFAULT);
-		result = (uint64_t)H5Tget_size(hdf5_data_object->dtype_id);
-		H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(result));
-		H5Aclose(attribute_id);
+void digital_rf_request_precreate(Digital_rf_write_object *hdf5_data_object, uint64_t global_sample)
+/* digital_rf_request_precreate asks the precreate thread to prepare the file holding global_sample (relative to
+ * global_start_sample), which will have the sequence number after the open file.  Does nothing if the thread is
+ * still busy with another file.
+ */
+{
+#ifndef _WIN32
+	struct drf_precreate * precreate = hdf5_data_object->precreate;
+	uint64_t samples_left;
+
+	pthread_mutex_lock(&precreate->lock);
+	if (precreate->state == DRF_PRECREATE_IDLE
+			&& !digital_rf_get_subdir_file(hdf5_data_object, global_sample, precreate->file.subdir,
+										   precreate->file.basename, &samples_left,
+										   &precreate->file.max_samples_this_file))
+	{
+		precreate->file.sequence_num = hdf5_data_object->present_seq + 1;
+		precreate->state = DRF_PRECREATE_REQUESTED;
+		pthread_cond_broadcast(&precreate->changed);
+	}
+	pthread_mutex_unlock(&precreate->lock);
+	if (precreate->hub != NULL)
+	{
+		pthread_mutex_lock(&precreate->hub->lock);
+		pthread_cond_signal(&precreate->hub->work);
+		pthread_mutex_unlock(&precreate->hub->lock);
+	}
+#else
+	(void)hdf5_data_object;
+	(void)global_sample;
+#endif
+}
 
-		/* H5Tget_order */
-		attribute_id = H5Acreate2 (hdf5_file, "H5Tget_order", H5T_NATIVE_ULLONG, dataspace_id,
-								   H5P_DEFAULT, H5P_DEFAULT);
-		result = (uint64_t)H5Tget_order(hdf5_data_object->dtype_id);
-		H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(result));
-		H5Aclose(attribute_id);
 
-		/* H5Tget_precision */
-		attribute_id = H5Acreate2 (hdf5_file, "H5Tget_precision", H5T_NATIVE_ULLONG, dataspace_id,
-								   H5P_DEFAULT, H5P_DEFAULT);
-		result = (uint64_t)H5Tget_precision(hdf5_data_object->dtype_id);
-		H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(result));
-		H5Aclose(attribute_id);
+int digital_rf_take_prepared_file(Digital_rf_write_object *hdf5_data_object, char * subdir, char * basename,
+		uint64_t max_samples_this_file, drf_prepared_file * file)
+/* digital_rf_take_prepared_file hands over the file the precreate thread prepared if it is the one needed now,
+ * waiting for the thread to finish it if necessary, and renames it to its tmp. name.  A prepared file that is not
+ * the one needed is removed.
+ *
+ * 	Returns 1 if file was filled in, 0 if the caller must create the file itself
+ */
+{
+#ifndef _WIN32
+	struct drf_precreate * precreate = hdf5_data_object->precreate;
+	char next_fullname[BIG_HDF5_STR] = "";
+	char fullname[BIG_HDF5_STR] = "";
+	int matches, ready = 0;
 
-		/* H5Tget_offset */
-		attribute_id = H5Acreate2 (hdf5_file, "H5Tget_offset", H5T_NATIVE_ULLONG, dataspace_id,
-								   H5P_DEFAULT, H5P_DEFAULT);
-		result = (uint64_t)H5Tget_offset(hdf5_data_object->dtype_id);
-		H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(result));
-		H5Aclose(attribute_id);
+	if (precreate == NULL)
+		return(0);
 
-		/* subdir_cadence_secs */
-		attribute_id = H5Acreate2 (hdf5_file, "subdir_cadence_secs", H5T_NATIVE_ULLONG, dataspace_id,
-								   H5P_DEFAULT, H5P_DEFAULT);
-		H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(hdf5_data_object->subdir_cadence_secs));
-		H5Aclose(attribute_id);
+	pthread_mutex_lock(&precreate->lock);
+	matches = (strcmp(precreate->file.subdir, subdir) == 0 && strcmp(precreate->file.basename, basename) == 0
+			   && precreate->file.max_samples_this_file == max_samples_this_file
+			   && precreate->file.sequence_num == hdf5_data_object->present_seq);
+	/* a hub thread can not start on a file while this channel is being written, so one not started is made here */
+	if (precreate->state == DRF_PRECREATE_REQUESTED && (!matches || precreate->hub != NULL))
+		precreate->state = DRF_PRECREATE_IDLE;
+	while (precreate->state == DRF_PRECREATE_REQUESTED || precreate->state == DRF_PRECREATE_BUSY)
+		pthread_cond_wait(&precreate->changed, &precreate->lock);
+	if (precreate->state == DRF_PRECREATE_READY)
+	{
+		*file = precreate->file;
+		ready = 1;
+	}
+	precreate->state = DRF_PRECREATE_IDLE;
+	pthread_mutex_unlock(&precreate->lock);
+	if (!ready)
+		return(0);
+	if (!matches)
+	{
+		digital_rf_discard_prepared_file(hdf5_data_object, file, "next.");
+		return(0);
+	}
 
-		/* file_cadence_millisecs */
-		attribute_id = H5Acreate2 (hdf5_file, "file_cadence_millisecs", H5T_NATIVE_ULLONG, dataspace_id,
-								   H5P_DEFAULT, H5P_DEFAULT);
-		H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(hdf5_data_object->file_cadence_millisecs));
-		H5Aclose(attribute_id);
+	/* the tmp. name must still be free, as H5Fcreate would have required */
+	strcpy(fullname, hdf5_data_object->directory);
+	strcat(fullname, "/");
+	strcat(fullname, subdir);
+	strcat(fullname, "/");
+	strcpy(next_fullname, fullname);
+	strcat(next_fullname, "next.");
+	strcat(next_fullname, basename);
+	strcat(fullname, basename);
+	if (access(fullname, F_OK) != -1 || (!hdf5_data_object->memory_files && rename(next_fullname, fullname)))
+	{
+		fprintf(stderr, "The following Hdf5 file could not be created, or already exists: %s\n", fullname);
+		digital_rf_discard_prepared_file(hdf5_data_object, file, "next.");
+		return(0);
+	}
+	return(1);
+#else
+	(void)hdf5_data_object;
+	(void)subdir;
+	(void)basename;
+	(void)max_samples_this_file;
+	(void)file;
+	return(0);
+#endif
+}
 
-		/* sample_rate_numerator */
-		attribute_id = H5Acreate2 (hdf5_file, "sample_rate_numerator", H5T_NATIVE_ULLONG, dataspace_id,
-								   H5P_DEFAULT, H5P_DEFAULT);
-		H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(hdf5_data_object->sample_rate_numerator));
-		H5Aclose(attribute_id);
 
-		/* sample_rate_denominator */
-		attribute_id = H5Acreate2 (hdf5_file, "sample_rate_denominator", H5T_NATIVE_ULLONG, dataspace_id,
-								   H5P_DEFAULT, H5P_DEFAULT);
-		H5Awrite(attribute_id, H5T_NATIVE_ULLONG, &(hdf5_data_object->sample_rate_denominator));
-		H5Aclose(attribute_id);
+#ifndef _WIN32
+void * digital_rf_precreate_thread(void * arg)
+/* digital_rf_precreate_thread prepares each file requested by digital_rf_request_precreate until
+ * digital_rf_end_precreate stops it
+ */
+{
+	Digital_rf_write_object * hdf5_data_object = (Digital_rf_write_object *)arg;
+	struct drf_precreate * precreate = hdf5_data_object->precreate;
 
-		/* is_complex */
-		attribute_id = H5Acreate2 (hdf5_file, "is_complex", H5T_NATIVE_INT, dataspace_id,
-								   H5P_DEFAULT, H5P_DEFAULT);
-		H5Awrite(attribute_id, H5T_NATIVE_INT, &(hdf5_data_object->is_complex));
-		H5Aclose(attribute_id);
+	pthread_mutex_lock(&precreate->lock);
+	while (1)
+	{
+		while (!precreate->stop && precreate->state != DRF_PRECREATE_REQUESTED)
+			pthread_cond_wait(&precreate->changed, &precreate->lock);
+		if (precreate->stop)
+			break;
+		pthread_mutex_unlock(&precreate->lock);
+		digital_rf_run_precreate(hdf5_data_object);
+		pthread_mutex_lock(&precreate->lock);
+	}
+	pthread_mutex_unlock(&precreate->lock);
+	return(NULL);
+}
 
-		/* num_subchannels */
-		attribute_id = H5Acreate2 (hdf5_file, "num_subchannels", H5T_NATIVE_INT, dataspace_id,
-								   H5P_DEFAULT, H5P_DEFAULT);
-		H5Awrite(attribute_id, H5T_NATIVE_INT, &(hdf5_data_object->num_subchannels));
-		H5Aclose(attribute_id);
 
-		/* is_continuous */
-		attribute_id = H5Acreate2 (hdf5_file, "is_continuous", H5T_NATIVE_INT, dataspace_id,
-								   H5P_DEFAULT, H5P_DEFAULT);
-		H5Awrite(attribute_id, H5T_NATIVE_INT, &(hdf5_data_object->is_continuous));
-		H5Aclose(attribute_id);
+int digital_rf_run_precreate(Digital_rf_write_object *hdf5_data_object)
+/* digital_rf_run_precreate prepares the requested next file of hdf5_data_object, on the precreate thread or a
+ * hub thread
+ *
+ * 	Returns 1 if a file was requested (whether or not it could be prepared), 0 if there was nothing to do
+ */
+{
+	struct drf_precreate * precreate = hdf5_data_object->precreate;
+	drf_prepared_file file;
+	int result;
 
-		/* epoch */
-		str_type = H5Tcopy(H5T_C_S1);
-		H5Tset_size(str_type, strlen(DIGITAL_RF_EPOCH)+1);
-		str_attribute = H5Acreate2(hdf5_file, "epoch", str_type, dataspace_id, H5P_DEFAULT, H5P_DEFAULT);
-		H5Awrite(str_attribute, str_type, DIGITAL_RF_EPOCH);
-		H5Aclose(str_attribute);
+	pthread_mutex_lock(&precreate->lock);
+	if (precreate->stop || precreate->state != DRF_PRECREATE_REQUESTED)
+	{
+		pthread_mutex_unlock(&precreate->lock);
+		return(0);
+	}
+	precreate->state = DRF_PRECREATE_BUSY;
+	file = precreate->file;
+	pthread_mutex_unlock(&precreate->lock);
+
+	result = digital_rf_prepare_hdf5_file(hdf5_data_object, &file, "next.");
+
+	pthread_mutex_lock(&precreate->lock);
+	precreate->file = file;
+	/* on failure the file is left to be created, and its error reported, at rollover */
+	precreate->state = result ? DRF_PRECREATE_IDLE : DRF_PRECREATE_READY;
+	pthread_cond_broadcast(&precreate->changed);
+	pthread_mutex_unlock(&precreate->lock);
+	return(1);
+}
 
-		/* digital_rf_time_description */
-		H5Tset_size(str_type, strlen(DIGITAL_RF_TIME_DESCRIPTION)+1);
-		str_attribute = H5Acreate2(hdf5_file, "digital_rf_time_description", str_type, dataspace_id, H5P_DEFAULT, H5P_DEFAULT);
-		H5Awrite(str_attribute, str_type, DIGITAL_RF_TIME_DESCRIPTION);
-		H5Aclose(str_attribute);
 
-		/* digital_rf_version */
-		H5Tset_size(str_type, strlen(DIGITAL_RF_VERSION)+1);
-		str_attribute = H5Acreate2(hdf5_file, "digital_rf_version", str_type, dataspace_id, H5P_DEFAULT, H5P_DEFAULT);
-		H5Awrite(str_attribute, str_type, DIGITAL_RF_VERSION);
-		H5Aclose(str_attribute);
+void * digital_rf_hub_thread(void * arg)
+/* digital_rf_hub_thread writes the queued buffers of the channel with the longest backlog that no other thread
+ * is serving, or with nothing queued anywhere prepares a requested next file, until digital_rf_close_write_hub
+ * stops it
+ */
+{
+	Digital_rf_write_hub * hub = (Digital_rf_write_hub *)arg;
+	Digital_rf_write_object * hdf5_data_object;
+	struct drf_async_writer * async;
+	struct drf_precreate * precreate;
+	int i, count, most, requested;
 
-		/* free resources used */
-		H5Tclose(str_type);
-		H5Sclose(dataspace_id);
-		H5Fclose(hdf5_file);
-	}
-	else
+	pthread_mutex_lock(&hub->lock);
+	while (1)
 	{
-		hdf5_file = H5Fopen(metadata_file, H5F_ACC_RDONLY, H5P_DEFAULT);
-		if (hdf5_file < 0)
+		/* writes first, longest backlog first */
+		hdf5_data_object = NULL;
+		most = 0;
+		for (i=0; i<hub->num_channels; i++)
 		{
-			snprintf(error_str, sizeof(error_str), "The following metadata file could not be opened: %s\n", metadata_file);
-			fprintf(stderr, "%s", error_str);
-			return(-1);
+			if (hub->channels[i].busy)
+				continue;
+			async = hub->channels[i].obj->async;
+			pthread_mutex_lock(&async->lock);
+			count = async->count;
+			pthread_mutex_unlock(&async->lock);
+			if (count > most)
+			{
+				most = count;
+				hdf5_data_object = hub->channels[i].obj;
+			}
 		}
 
-		/* read all attributes and compare */
-
-		/* H5Tget_class attribute */
-		attribute_id = H5Aopen(hdf5_file, "H5Tget_class", H5P_DEFAULT);
-		if (attribute_id < 0)
-		{
-			snprintf(error_str, sizeof(error_str), "The H5Tget_class attribute not found in %s\n", metadata_file);
-			fprintf(stderr, "%s", error_str);
-			return(-1);
-		}
-		H5Aread(attribute_id, H5T_NATIVE_ULLONG, &result);
-		if (result != (uint64_t)H5Tget_class(hdf5_data_object->dtype_id))
+		/* then next files, in the order the channels were added */
+		for (i=0; i<hub->num_channels && hdf5_data_object == NULL; i++)
 		{
-			fprintf(stderr, "Mismatching datatype found using H5Tget_class\n");
-			return(-1);
+			precreate = hub->channels[i].obj->precreate;
+			if (hub->channels[i].busy || precreate == NULL)
+				continue;
+			pthread_mutex_lock(&precreate->lock);
+			requested = (precreate->state == DRF_PRECREATE_REQUESTED && !precreate->stop);
+			pthread_mutex_unlock(&precreate->lock);
+			if (requested)
+				hdf5_data_object = hub->channels[i].obj;
 		}
-		H5Aclose(attribute_id);
 
-		/* H5Tget_size attribute */
-		attribute_id = H5Aopen(hdf5_file, "H5Tget_size", H5P_DEFAULT);
-		if (attribute_id < 0)
+		if (hdf5_data_object == NULL)
 		{
-			snprintf(error_str, sizeof(error_str), "The H5Tget_size attribute not found in %s\n", metadata_file);
-			fprintf(stderr, "%s", error_str);
-			return(-1);
+			if (hub->stop)
+				break;
+			pthread_cond_wait(&hub->work, &hub->lock);
+			continue;
 		}
-		H5Aread(attribute_id, H5T_NATIVE_ULLONG, &result);
-		if (result != (uint64_t)H5Tget_size(hdf5_data_object->dtype_id))
+
+		/* the array can be reordered or grown while unlocked, but a busy channel is never removed */
+		for (i=0; hub->channels[i].obj != hdf5_data_object; i++);
+		hub->channels[i].busy = 1;
+		pthread_mutex_unlock(&hub->lock);
+		if (most > 0)
+			digital_rf_hub_drain(hub, hdf5_data_object, most);
+		else
+			digital_rf_run_precreate(hdf5_data_object);
+		pthread_mutex_lock(&hub->lock);
+		for (i=0; hub->channels[i].obj != hdf5_data_object; i++);
+		hub->channels[i].busy = 0;
+		pthread_cond_broadcast(&hub->idle);
+		/* anything queued on the channel meanwhile can now go to any thread */
+		pthread_cond_broadcast(&hub->work);
+	}
+	pthread_mutex_unlock(&hub->lock);
+	return(NULL);
+}
+
+
+void digital_rf_hub_drain(Digital_rf_write_hub * hub, Digital_rf_write_object *hdf5_data_object, int num_buffers)
+/* digital_rf_hub_drain writes the num_buffers oldest queued buffers of hdf5_data_object on the calling hub thread,
+ * counting each in the hub statistics before the channel sees it written.  After a write fails, the rest are
+ * discarded and the failure is kept for the caller, as on a writer thread.
+ */
+{
+	struct drf_async_writer * async = hdf5_data_object->async;
+	drf_async_buffer * buffer;
+	int failed, result, i;
+
+	pthread_mutex_lock(&async->lock);
+	async->thread = pthread_self();
+	async->writing = 1;
+	for (i=0; i<num_buffers; i++)
+	{
+		buffer = &async->buffers[(async->head + async->num_buffers - async->count) % async->num_buffers];
+		failed = async->error;
+		pthread_mutex_unlock(&async->lock);
+
+		result = 0;
+		if (!failed)
+			result = digital_rf_write_blocks_hdf5(hdf5_data_object, buffer->global_index_arr, buffer->data_index_arr,
+					buffer->index_len, buffer->vector, buffer->vector_length);
+		/* writes were checked as they were queued, so this failed writing files */
+		if (result)
+			hdf5_data_object->has_failure = 1;
+
+		pthread_mutex_lock(&hub->lock);
+		hub->queued--;
+		if (!failed && !result)
+			hub->bytes_written += buffer->vector_length * async->sample_size;
+		pthread_mutex_unlock(&hub->lock);
+
+		pthread_mutex_lock(&async->lock);
+		if (result && !async->error)
+			async->error = result;
+		async->count--;
+		pthread_cond_broadcast(&async->not_full);
+	}
+	async->writing = 0;
+	pthread_mutex_unlock(&async->lock);
+}
+
+
+void digital_rf_hub_remove_channel(Digital_rf_write_object *hdf5_data_object)
+/* digital_rf_hub_remove_channel takes hdf5_data_object off its hub, waiting for any hub thread still busy with it */
+{
+	Digital_rf_write_hub * hub = hdf5_data_object->async->hub;
+	int i;
+
+	pthread_mutex_lock(&hub->lock);
+	while (1)
+	{
+		for (i=0; hub->channels[i].obj != hdf5_data_object; i++);
+		if (!hub->channels[i].busy)
+			break;
+		pthread_cond_wait(&hub->idle, &hub->lock);
+	}
+	hub->channels[i] = hub->channels[--hub->num_channels];
+	pthread_mutex_unlock(&hub->lock);
+}
+
+
+void digital_rf_end_precreate(Digital_rf_write_object *hdf5_data_object)
+/* digital_rf_end_precreate stops the precreate thread, removes any file it prepared and frees it */
+{
+	struct drf_precreate * precreate = hdf5_data_object->precreate;
+
+	pthread_mutex_lock(&precreate->lock);
+	precreate->stop = 1;
+	pthread_cond_broadcast(&precreate->changed);
+	pthread_mutex_unlock(&precreate->lock);
+	/* a channel is only closed once off its hub, when no hub thread can be preparing its file */
+	if (precreate->hub == NULL)
+		pthread_join(precreate->thread, NULL);
+
+	if (precreate->state == DRF_PRECREATE_READY)
+		digital_rf_discard_prepared_file(hdf5_data_object, &precreate->file, "next.");
+	hdf5_data_object->precreate = NULL;
+	pthread_mutex_destroy(&precreate->lock);
+	pthread_cond_destroy(&precreate->changed);
+	free(precreate);
+}
+#endif
+
+
+int digital_rf_stage_chunks(Digital_rf_write_object *hdf5_data_object, char * vector, uint64_t samples)
+/* digital_rf_stage_chunks copies samples, to be written to /rf_data at dataset_index, into the chunks of the
+ * chunk pool, queueing each chunk as it is filled.  Buffers are allocated on the first call, once chunk_size is set.
+ *
+ * 	Returns 0 if success, -1 if committing an earlier chunk failed
+ */
+{
+#ifdef DRF_ENCODE_THREADS
+	struct drf_chunk_pool * pool = hdf5_data_object->chunk_pool;
+	drf_chunk_job * job;
+	uint64_t row = hdf5_data_object->dataset_index;
+	uint64_t rows;
+	int i;
+
+	if (pool->chunk_bytes == 0)
+	{
+		pool->chunk_bytes = hdf5_data_object->chunk_size * hdf5_data_object->sample_size;
+		pool->out_capacity = compressBound((uLong)pool->chunk_bytes) + 4;
+		for (i=0; i<pool->num_jobs; i++)
 		{
-			fprintf(stderr, "Mismatching datatype found using H5Tget_size\n");
-			return(-1);
+			if ((pool->jobs[i].raw = (unsigned char *)malloc(pool->chunk_bytes + 4)) == NULL
+					|| (pool->compression_level
+						&& (pool->jobs[i].out = (unsigned char *)malloc(pool->out_capacity)) == NULL))
+			{
+				fprintf(stderr, "malloc failure - unrecoverable\n");
+				exit(-1);
+			}
 		}
-		H5Aclose(attribute_id);
+	}
 
-		/* H5Tget_order attribute */
-		attribute_id = H5Aopen(hdf5_file, "H5Tget_order", H5P_DEFAULT);
-		if (attribute_id < 0)
+	while (samples > 0)
+	{
+		job = &pool->jobs[pool->head];
+		if (pool->stage_rows == 0)
 		{
-			snprintf(error_str, sizeof(error_str), "The H5Tget_order attribute not found in %s\n", metadata_file);
-			fprintf(stderr, "%s", error_str);
-			return(-1);
+			job->offset[0] = row;
+			job->offset[1] = 0;
 		}
-		H5Aread(attribute_id, H5T_NATIVE_ULLONG, &result);
-		if (result != (uint64_t)H5Tget_order(hdf5_data_object->dtype_id))
-		{
-			fprintf(stderr, "Mismatching datatype found using H5Tget_order\n");
+		rows = hdf5_data_object->chunk_size - pool->stage_rows;
+		if (rows > samples)
+			rows = samples;
+		memcpy(job->raw + pool->stage_rows * hdf5_data_object->sample_size, vector, rows * hdf5_data_object->sample_size);
+		pool->stage_rows += rows;
+		vector += rows * hdf5_data_object->sample_size;
+		samples -= rows;
+		row += rows;
+		if (pool->stage_rows == hdf5_data_object->chunk_size && digital_rf_queue_chunk(hdf5_data_object))
 			return(-1);
-		}
-		H5Aclose(attribute_id);
+	}
+	return(0);
+#else
+	(void)hdf5_data_object;
+	(void)vector;
+	(void)samples;
+	return(-1);
+#endif
+}
 
-		/* H5Tget_precision attribute */
-		attribute_id = H5Aopen(hdf5_file, "H5Tget_precision", H5P_DEFAULT);
-		if (attribute_id < 0)
-		{
-			snprintf(error_str, sizeof(error_str), "The H5Tget_precision attribute not found in %s\n", metadata_file);
-			fprintf(stderr, "%s", error_str);
-			return(-1);
-		}
-		H5Aread(attribute_id, H5T_NATIVE_ULLONG, &result);
-		if (result != (uint64_t)H5Tget_precision(hdf5_data_object->dtype_id))
+
+int digital_rf_finish_chunks(Digital_rf_write_object *hdf5_data_object)
+/* digital_rf_finish_chunks pads the chunk being filled with fill values, queues it and commits every queued chunk,
+ * so that /rf_data of the open file is complete.  Does nothing without a chunk pool.
+ *
+ * 	Returns 0 if success, -1 if any chunk could not be committed
+ */
+{
+#ifdef DRF_ENCODE_THREADS
+	struct drf_chunk_pool * pool = hdf5_data_object->chunk_pool;
+	drf_chunk_job * job;
+	int result = 0;
+
+	if (pool == NULL)
+		return(0);
+	if (pool->stage_rows > 0)
+	{
+		job = &pool->jobs[pool->head];
+		while (pool->stage_rows < hdf5_data_object->chunk_size)
+			memcpy(job->raw + pool->stage_rows++ * hdf5_data_object->sample_size, pool->fill,
+				   hdf5_data_object->sample_size);
+		if (digital_rf_queue_chunk(hdf5_data_object))
+			result = -1;
+	}
+	while (pool->pending > 0)
+		if (digital_rf_commit_chunk(hdf5_data_object))
+			result = -1;
+	return(result);
+#else
+	(void)hdf5_data_object;
+	return(0);
+#endif
+}
+
+
+#ifdef DRF_ENCODE_THREADS
+int digital_rf_queue_chunk(Digital_rf_write_object *hdf5_data_object)
+/* digital_rf_queue_chunk hands the full chunk being filled to the threads and moves on to the next one, first
+ * committing the oldest chunk if the ring is full.  Chunks already encoded are committed along the way.
+ *
+ * 	Returns 0 if success, -1 if a commit failed
+ */
+{
+	struct drf_chunk_pool * pool = hdf5_data_object->chunk_pool;
+	int result = 0, done;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->jobs[pool->head].state = DRF_CHUNK_QUEUED;
+	pthread_cond_signal(&pool->work);
+	pthread_mutex_unlock(&pool->lock);
+	pool->head = (pool->head + 1) % pool->num_jobs;
+	pool->stage_rows = 0;
+	pool->pending++;
+
+	while (pool->pending > 0)
+	{
+		if (pool->pending < pool->num_jobs)
 		{
-			fprintf(stderr, "Mismatching datatype found using H5Tget_precision\n");
-			return(-1);
+			pthread_mutex_lock(&pool->lock);
+			done = (pool->jobs[pool->tail].state == DRF_CHUNK_DONE);
+			pthread_mutex_unlock(&pool->lock);
+			if (!done)
+				break;
 		}
-		H5Aclose(attribute_id);
+		if (digital_rf_commit_chunk(hdf5_data_object))
+			result = -1;
+	}
+	return(result);
+}
 
-		/* H5Tget_offset attribute */
-		attribute_id = H5Aopen(hdf5_file, "H5Tget_offset", H5P_DEFAULT);
-		if (attribute_id < 0)
+
+int digital_rf_commit_chunk(Digital_rf_write_object *hdf5_data_object)
+/* digital_rf_commit_chunk waits for the oldest queued chunk to be encoded and writes it to /rf_data with
+ * H5Dwrite_chunk, freeing its job
+ *
+ * 	Returns 0 if success, -1 if the chunk could not be encoded or written
+ */
+{
+	struct drf_chunk_pool * pool = hdf5_data_object->chunk_pool;
+	drf_chunk_job * job = &pool->jobs[pool->tail];
+	herr_t status = 0;
+
+	pthread_mutex_lock(&pool->lock);
+	while (job->state != DRF_CHUNK_DONE)
+		pthread_cond_wait(&pool->done, &pool->lock);
+	pthread_mutex_unlock(&pool->lock);
+
+	if (job->error)
+		fprintf(stderr, "Unable to compress the chunk at rf_data row %" PRIu64 "\n", (uint64_t)job->offset[0]);
+	else if ((status = H5Dwrite_chunk(hdf5_data_object->dataset, H5P_DEFAULT, 0, job->offset, job->data_size,
+									  job->data)) < 0)
+		H5Eprint(H5E_DEFAULT, stderr);
+
+	pthread_mutex_lock(&pool->lock);
+	job->state = DRF_CHUNK_FREE;
+	pthread_mutex_unlock(&pool->lock);
+	pool->tail = (pool->tail + 1) % pool->num_jobs;
+	pool->pending--;
+	return((job->error || status < 0) ? -1 : 0);
+}
+
+
+void * digital_rf_chunk_thread(void * arg)
+/* digital_rf_chunk_thread encodes queued chunks, in the order they were queued, as the deflate and fletcher32
+ * filters of Hdf5 would, until digital_rf_end_chunk_pool stops it
+ */
+{
+	struct drf_chunk_pool * pool = (struct drf_chunk_pool *)arg;
+	drf_chunk_job * job;
+	uLongf size;
+	uint32_t sum;
+
+	pthread_mutex_lock(&pool->lock);
+	while (1)
+	{
+		while (!pool->stop && pool->jobs[pool->next_work].state != DRF_CHUNK_QUEUED)
+			pthread_cond_wait(&pool->work, &pool->lock);
+		if (pool->stop)
+			break;
+		job = &pool->jobs[pool->next_work];
+		pool->next_work = (pool->next_work + 1) % pool->num_jobs;
+		job->state = DRF_CHUNK_WORKING;
+		pthread_mutex_unlock(&pool->lock);
+
+		job->error = 0;
+		job->data = job->raw;
+		size = (uLongf)pool->chunk_bytes;
+		if (pool->compression_level)
 		{
-			snprintf(error_str, sizeof(error_str), "The H5Tget_offset attribute not found in %s\n", metadata_file);
-			fprintf(stderr, "%s", error_str);
-			return(-1);
+			job->data = job->out;
+			size = (uLongf)(pool->out_capacity - 4);
+			if (compress2(job->out, &size, job->raw, (uLong)pool->chunk_bytes, pool->compression_level) != Z_OK)
+				job->error = 1;
 		}
-		H5Aread(attribute_id, H5T_NATIVE_ULLONG, &result);
-		if (result != (uint64_t)H5Tget_offset(hdf5_data_object->dtype_id))
+		if (pool->checksum && !job->error)
 		{
-			fprintf(stderr, "Mismatching datatype found using H5Tget_offset\n");
-			return(-1);
+			/* stored little-endian, as Hdf5 writes it on little-endian machines and reads it on any */
+			sum = digital_rf_fletcher32(job->data, size);
+			job->data[size] = (unsigned char)(sum & 0xff);
+			job->data[size + 1] = (unsigned char)((sum >> 8) & 0xff);
+			job->data[size + 2] = (unsigned char)((sum >> 16) & 0xff);
+			job->data[size + 3] = (unsigned char)(sum >> 24);
+			size += 4;
 		}
-		H5Aclose(attribute_id);
+		job->data_size = size;
 
-		/* subdir_cadence_secs attribute */
-		attribute_id = H5Aopen(hdf5_file, "subdir_cadence_secs", H5P_DEFAULT);
-		if (attribute_id < 0)
-		{
-			snprintf(error_str, sizeof(error_str), "The subdir_cadence_secs attribute not found in %s\n", metadata_file);
-			fprintf(stderr, "%s", error_str);
+		pthread_mutex_lock(&pool->lock);
+		job->state = DRF_CHUNK_DONE;
+		pthread_cond_broadcast(&pool->done);
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return(NULL);
+}
+
+
+void digital_rf_end_chunk_pool(Digital_rf_write_object *hdf5_data_object)
+/* digital_rf_end_chunk_pool stops the threads of the chunk pool and frees it.  Chunks not yet committed are lost. */
+{
+	struct drf_chunk_pool * pool = hdf5_data_object->chunk_pool;
+	int i;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->stop = 1;
+	pthread_cond_broadcast(&pool->work);
+	pthread_mutex_unlock(&pool->lock);
+	for (i=0; i<pool->num_threads; i++)
+		pthread_join(pool->threads[i], NULL);
+
+	for (i=0; i<pool->num_jobs; i++)
+	{
+		free(pool->jobs[i].raw);
+		free(pool->jobs[i].out);
+	}
+	free(pool->jobs);
+	free(pool->threads);
+	free(pool->fill);
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->work);
+	pthread_cond_destroy(&pool->done);
+	free(pool);
+	hdf5_data_object->chunk_pool = NULL;
+}
+#endif
+
+
+void digital_rf_set_file_layout(Digital_rf_write_object *hdf5_data_object, hid_t fapl)
+/* digital_rf_set_file_layout sets the alignment of digital_rf_set_direct_io, if any, on fapl: objects of
+ * file_alignment bytes or more (so /rf_data) start on aligned offsets, and metadata and small raw data such
+ * as /rf_data_index are gathered into aligned blocks of their own
+ */
+{
+	if (hdf5_data_object->file_alignment == 0)
+		return;
+	H5Pset_alignment (fapl, (hsize_t)hdf5_data_object->file_alignment, (hsize_t)hdf5_data_object->file_alignment);
+	H5Pset_meta_block_size (fapl, (hsize_t)hdf5_data_object->file_alignment);
+	H5Pset_small_data_block_size (fapl, (hsize_t)hdf5_data_object->file_alignment);
+}
+
+
+int digital_rf_start_direct_file(Digital_rf_write_object *hdf5_data_object, char * fullname, uint64_t max_samples_this_file)
+/* digital_rf_start_direct_file opens a second descriptor on the new file fullname, through which its contiguous
+ * /rf_data is written by digital_rf_direct_write.  O_DIRECT is used if /rf_data is aligned and the filesystem
+ * accepts it, plain writes otherwise.  Only called when digital_rf_set_direct_io applies to the file.
+ *
+ * 	Returns 0 if success, -1 if failure
+ */
+{
+#ifdef DRF_DIRECT_IO
+	struct drf_direct_io * direct = hdf5_data_object->direct_io;
+	haddr_t offset;
+
+	offset = H5Dget_offset(hdf5_data_object->dataset);
+	if (offset == HADDR_UNDEF)
+	{
+		fprintf(stderr, "/rf_data of %s was not allocated when created\n", fullname);
+		return(-1);
+	}
+	direct->fd = -1;
+	direct->direct = 0;
+	/* /rf_data smaller than the alignment is not aligned, and goes through the page cache */
+	if (offset % direct->alignment == 0)
+	{
+		direct->fd = open(fullname, O_WRONLY | O_DIRECT);
+		direct->direct = (direct->fd != -1);
+	}
+	if (direct->fd == -1)
+		direct->fd = open(fullname, O_WRONLY);
+	if (direct->fd == -1)
+	{
+		fprintf(stderr, "Unable to open %s for direct writes: %s\n", fullname, strerror(errno));
+		return(-1);
+	}
+	direct->next_row = 0;
+	direct->file_rows = max_samples_this_file;
+	direct->stage_used = 0;
+	direct->stage_offset = (uint64_t)offset;
+	return(0);
+#else
+	(void)hdf5_data_object;
+	(void)fullname;
+	(void)max_samples_this_file;
+	return(-1);
+#endif
+}
+
+
+int digital_rf_direct_write(Digital_rf_write_object *hdf5_data_object, uint64_t row, const unsigned char * data,
+						   uint64_t num_rows)
+/* digital_rf_direct_write stages num_rows samples of data for row of /rf_data in the open file, after fill values
+ * for any rows skipped since the last write as Hdf5 would have written them.  Each full stage is written out.
+ *
+ * 	Returns 0 if success, -1 if a write failed
+ */
+{
+#ifdef DRF_DIRECT_IO
+	struct drf_direct_io * direct = hdf5_data_object->direct_io;
+
+	for (; direct->next_row < row; direct->next_row++)
+		if (digital_rf_stage_direct(direct, direct->fill, hdf5_data_object->sample_size))
 			return(-1);
-		}
-		H5Aread(attribute_id, H5T_NATIVE_ULLONG, &result);
-		if (result != hdf5_data_object->subdir_cadence_secs)
-		{
-			fprintf(stderr, "Mismatching subdir_cadence_secs found\n");
+	if (num_rows > 0 && digital_rf_stage_direct(direct, data, num_rows * hdf5_data_object->sample_size))
+		return(-1);
+	direct->next_row = row + num_rows;
+	return(0);
+#else
+	(void)hdf5_data_object;
+	(void)row;
+	(void)data;
+	(void)num_rows;
+	return(-1);
+#endif
+}
+
+
+int digital_rf_end_direct_file(Digital_rf_write_object *hdf5_data_object)
+/* digital_rf_end_direct_file fills the rest of /rf_data of the open file, writes out what is staged and closes
+ * the descriptor of digital_rf_start_direct_file.  After a failure it only closes it.  Does nothing unless the
+ * open file has one.
+ *
+ * 	Returns 0 if success, -1 if a write failed
+ */
+{
+#ifdef DRF_DIRECT_IO
+	struct drf_direct_io * direct = hdf5_data_object->direct_io;
+	int result = 0;
+
+	if (direct == NULL || direct->fd == -1)
+		return(0);
+	if (!hdf5_data_object->has_failure)
+	{
+		if (digital_rf_direct_write(hdf5_data_object, direct->file_rows, NULL, 0)
+				|| (direct->stage_used > 0 && digital_rf_write_direct_stage(direct)))
+			result = -1;
+	}
+	close(direct->fd);
+	direct->fd = -1;
+	return(result);
+#else
+	(void)hdf5_data_object;
+	return(0);
+#endif
+}
+
+
+#ifdef DRF_DIRECT_IO
+int digital_rf_stage_direct(struct drf_direct_io * direct, const unsigned char * data, size_t size)
+/* digital_rf_stage_direct copies size bytes of data into the stage, writing it out each time it fills
+ *
+ * 	Returns 0 if success, -1 if a write failed
+ */
+{
+	size_t n;
+
+	while (size > 0)
+	{
+		n = direct->stage_size - direct->stage_used;
+		if (n > size)
+			n = size;
+		memcpy(direct->stage + direct->stage_used, data, n);
+		direct->stage_used += n;
+		data += n;
+		size -= n;
+		if (direct->stage_used == direct->stage_size && digital_rf_write_direct_stage(direct))
 			return(-1);
-		}
-		H5Aclose(attribute_id);
+	}
+	return(0);
+}
+
+
+int digital_rf_write_direct_stage(struct drf_direct_io * direct)
+/* digital_rf_write_direct_stage writes the stage to the file.  Only the unaligned end of the last stage of a
+ * file is written through the page cache, or everything from the first write O_DIRECT refuses.
+ *
+ * 	Returns 0 if success, -1 if failure
+ */
+{
+	size_t aligned = direct->stage_used - direct->stage_used % direct->alignment;
+	size_t done = 0;
+	ssize_t n;
 
-		/* file_cadence_millisecs attribute */
-		attribute_id = H5Aopen(hdf5_file, "file_cadence_millisecs", H5P_DEFAULT);
-		if (attribute_id < 0)
+	while (done < direct->stage_used)
+	{
+		if (direct->direct && done == aligned)
 		{
-			snprintf(error_str, sizeof(error_str), "The file_cadence_millisecs attribute not found in %s\n", metadata_file);
-			fprintf(stderr, "%s", error_str);
-			return(-1);
+			fcntl(direct->fd, F_SETFL, fcntl(direct->fd, F_GETFL) & ~O_DIRECT);
+			direct->direct = 0;
 		}
-		H5Aread(attribute_id, H5T_NATIVE_ULLONG, &result);
-		if (result != hdf5_data_object->file_cadence_millisecs)
+		n = pwrite(direct->fd, direct->stage + done, (direct->direct ? aligned : direct->stage_used) - done,
+				   (off_t)(direct->stage_offset + done));
+		if (n < 0 && errno == EINVAL && direct->direct)
 		{
-			fprintf(stderr, "Mismatching file_cadence_millisecs found\n");
-			return(-1);
+			fcntl(direct->fd, F_SETFL, fcntl(direct->fd, F_GETFL) & ~O_DIRECT);
+			direct->direct = 0;
+			continue;
 		}
-		H5Aclose(attribute_id);
-
-		/* sample_rate_numerator attribute */
-		attribute_id = H5Aopen(hdf5_file, "sample_rate_numerator", H5P_DEFAULT);
-		if (attribute_id < 0)
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
 		{
-			snprintf(error_str, sizeof(error_str), "The sample_rate_numerator attribute not found in %s\n", metadata_file);
-			fprintf(stderr, "%s", error_str);
+			fprintf(stderr, "Direct write of /rf_data failed: %s\n", n < 0 ? strerror(errno) : "nothing written");
 			return(-1);
 		}
-		H5Aread(attribute_id, H5T_NATIVE_ULLONG, &result);
-		if (result != hdf5_data_object->sample_rate_numerator)
+		done += (size_t)n;
+	}
+	direct->stage_offset += direct->stage_used;
+	direct->stage_used = 0;
+	return(0);
+}
+
+
+void digital_rf_free_direct_io(Digital_rf_write_object *hdf5_data_object)
+/* digital_rf_free_direct_io frees the buffers of digital_rf_set_direct_io, after the file is closed */
+{
+	struct drf_direct_io * direct = hdf5_data_object->direct_io;
+
+	free(direct->stage);
+	free(direct->fill);
+	free(direct);
+	hdf5_data_object->direct_io = NULL;
+}
+#endif
+
+
+int digital_rf_write_memory_file(Digital_rf_write_object *hdf5_data_object)
+/* digital_rf_write_memory_file writes the image of the open file of digital_rf_set_memory_files to its tmp. name
+ * in one write, into space reserved first if memory_preallocate.  The image is copied into memory_image, kept for
+ * the next file.  Does nothing unless files are built in memory, or after a failure.
+ *
+ * 	Returns 0 if success, -1 if failure
+ */
+{
+	char fullname[BIG_HDF5_STR] = "";
+	ssize_t image_size;
+	FILE * fp;
+	int result = 0;
+
+	if (!hdf5_data_object->memory_files || hdf5_data_object->has_failure)
+		return(0);
+
+	if (H5Fflush (hdf5_data_object->hdf5_file, H5F_SCOPE_LOCAL) < 0
+			|| (image_size = H5Fget_file_image (hdf5_data_object->hdf5_file, NULL, 0)) < 0)
+	{
+		H5Eprint(H5E_DEFAULT, stderr);
+		return(-1);
+	}
+	if ((size_t)image_size > hdf5_data_object->memory_image_capacity)
+	{
+		if ((hdf5_data_object->memory_image = realloc(hdf5_data_object->memory_image, (size_t)image_size)) == NULL)
 		{
-			fprintf(stderr, "Mismatching sample_rate_numerator found\n");
-			return(-1);
+			fprintf(stderr, "Realloc failure\n");
+			exit(-22);
 		}
-		H5Aclose(attribute_id);
+		hdf5_data_object->memory_image_capacity = (size_t)image_size;
+	}
+	if (H5Fget_file_image (hdf5_data_object->hdf5_file, hdf5_data_object->memory_image, (size_t)image_size) < 0)
+	{
+		H5Eprint(H5E_DEFAULT, stderr);
+		return(-1);
+	}
 
-		/* sample_rate_denominator attribute */
-		attribute_id = H5Aopen(hdf5_file, "sample_rate_denominator", H5P_DEFAULT);
-		if (attribute_id < 0)
+	snprintf(fullname, BIG_HDF5_STR, "%s/%s/%s", hdf5_data_object->directory, hdf5_data_object->sub_directory,
+			 hdf5_data_object->basename);
+	/* "x" makes this fail like H5Fcreate with H5F_ACC_EXCL if the file exists */
+	if ((fp = fopen(fullname, "wbx")) == NULL)
+	{
+		fprintf(stderr, "The following Hdf5 file could not be created, or already exists: %s\n", fullname);
+		return(-1);
+	}
+	/* unbuffered, so the image goes out in a single write */
+	setvbuf(fp, NULL, _IONBF, 0);
+#ifdef __linux__
+	/* a filesystem without fallocate just loses the reservation */
+	if (hdf5_data_object->memory_preallocate)
+		fallocate(fileno(fp), 0, 0, (off_t)image_size);
+#endif
+	if (fwrite(hdf5_data_object->memory_image, 1, (size_t)image_size, fp) != (size_t)image_size)
+		result = -1;
+	if (fclose(fp))
+		result = -1;
+	if (result)
+		fprintf(stderr, "Unable to write %s: %s\n", fullname, strerror(errno));
+	return(result);
+}
+
+
+#ifndef _WIN32
+int digital_rf_write_staging(Digital_rf_write_object *hdf5_data_object, uint64_t * global_index_arr, uint64_t * data_index_arr,
+		uint64_t index_len, void * vector, uint64_t vector_length)
+/* digital_rf_write_staging appends the blocks of a digital_rf_write_blocks_hdf5 call to staging files, finishing
+ * the open one and starting the next at each file period, see digital_rf_set_staging
+ *
+ * 	Returns 0 if success, -3 if a block is before the next expected index, -6 if the blocks are illegal or the
+ * 	write failed
+ */
+{
+	const unsigned char * data = (const unsigned char *)vector;
+	uint64_t global_sample, data_index, block_len, samples;
+	uint64_t * row;
+	uint64_t i;
+
+	if (index_len < 1 || data_index_arr[0] != 0)
+	{
+		fprintf(stderr, "First value of data_index_arr must be 0\n");
+		return(-6);
+	}
+	for (i=0; i<index_len; i++)
+	{
+		global_sample = global_index_arr[i];
+		data_index = data_index_arr[i];
+		block_len = (i + 1 < index_len) ? data_index_arr[i + 1] : vector_length;
+		if (block_len <= data_index || block_len > vector_length)
 		{
-			snprintf(error_str, sizeof(error_str), "The sample_rate_denominator attribute not found in %s\n", metadata_file);
-			fprintf(stderr, "%s", error_str);
-			return(-1);
+			fprintf(stderr, "Illegal data_index_arr, values must be increasing and less than vector_length\n");
+			return(-6);
 		}
-		H5Aread(attribute_id, H5T_NATIVE_ULLONG, &result);
-		if (result != hdf5_data_object->sample_rate_denominator)
+		block_len -= data_index;
+		if (global_sample < hdf5_data_object->global_index)
 		{
-			fprintf(stderr, "Mismatching sample_rate_denominator found\n");
-			return(-1);
+			fprintf(stderr, "Request index %" PRIu64 " before first expected index %" PRIu64 " in digital_rf_write_hdf5\n",
+					global_sample, hdf5_data_object->global_index);
+			return(-3);
 		}
-		H5Aclose(attribute_id);
 
-		/* is_complex attribute */
-		attribute_id = H5Aopen(hdf5_file, "is_complex", H5P_DEFAULT);
-		if (attribute_id < 0)
-		{
-			snprintf(error_str, sizeof(error_str), "The is_complex attribute not found in %s\n", metadata_file);
-			fprintf(stderr, "%s", error_str);
-			return(-1);
-		}
-		H5Aread(attribute_id, H5T_NATIVE_INT, &int_result);
-		if (int_result != hdf5_data_object->is_complex)
+		while (block_len > 0)
 		{
-			fprintf(stderr, "Mismatching is_complex found\n");
-			return(-1);
+			if (hdf5_data_object->staging_fp == NULL || global_sample >= hdf5_data_object->staging_end)
+			{
+				if (digital_rf_end_staging_file(hdf5_data_object)
+						|| digital_rf_start_staging_file(hdf5_data_object, global_sample))
+				{
+					hdf5_data_object->has_failure = 1;
+					return(-6);
+				}
+			}
+
+			/* a row starts each contiguous block of the file, as in /rf_data_index */
+			if (hdf5_data_object->staging_num_rows == 0 || global_sample != hdf5_data_object->global_index)
+			{
+				if (hdf5_data_object->staging_num_rows == hdf5_data_object->staging_capacity)
+				{
+					hdf5_data_object->staging_capacity = hdf5_data_object->staging_capacity ? 2 * hdf5_data_object->staging_capacity : 16;
+					if ((hdf5_data_object->staging_rows = (uint64_t *)realloc(hdf5_data_object->staging_rows,
+							sizeof(uint64_t) * 2 * hdf5_data_object->staging_capacity)) == NULL)
+					{
+						fprintf(stderr, "Realloc failure\n");
+						exit(-22);
+					}
+				}
+				row = hdf5_data_object->staging_rows + 2 * hdf5_data_object->staging_num_rows;
+				row[0] = global_sample + hdf5_data_object->global_start_sample;
+				row[1] = hdf5_data_object->staging_samples;
+				hdf5_data_object->staging_num_rows++;
+			}
+
+			samples = hdf5_data_object->staging_end - global_sample;
+			if (samples > block_len)
+				samples = block_len;
+			if (fwrite(data + data_index * hdf5_data_object->sample_size, hdf5_data_object->sample_size,
+					(size_t)samples, hdf5_data_object->staging_fp) != (size_t)samples)
+			{
+				fprintf(stderr, "Unable to write staging file %s: %s\n", hdf5_data_object->staging_name, strerror(errno));
+				hdf5_data_object->has_failure = 1;
+				return(-6);
+			}
+			hdf5_data_object->staging_samples += samples;
+			global_sample += samples;
+			data_index += samples;
+			block_len -= samples;
+			hdf5_data_object->global_index = global_sample;
 		}
-		H5Aclose(attribute_id);
+	}
 
-		/* num_subchannels attribute */
-		attribute_id = H5Aopen(hdf5_file, "num_subchannels", H5P_DEFAULT);
-		if (attribute_id < 0)
+	hdf5_data_object->last_utc_timestamp = (uint64_t)time(NULL);
+	return(0);
+}
+
+
+int digital_rf_start_staging_file(Digital_rf_write_object *hdf5_data_object, uint64_t global_sample)
+/* digital_rf_start_staging_file creates the staging file holding global_sample under its tmp. name, and
+ * DIGITAL_RF_STAGING_DIR if needed, with a header of no samples.  The space of a full file is reserved with
+ * fallocate where the system and filesystem support it, without changing the file's size.
+ *
+ * 	Returns 0 if success, -1 if failure
+ */
+{
+	char subdir[BIG_HDF5_STR] = "";
+	char basename[SMALL_HDF5_STR] = "";
+	char fullname[BIG_HDF5_STR] = "";
+	uint64_t samples_left, max_samples_this_file;
+
+	if (digital_rf_get_subdir_file(hdf5_data_object, global_sample, subdir, basename, &samples_left, &max_samples_this_file))
+		return(-1);
+	/* tmp.rf@<second>.<millisecond>.h5 becomes tmp.rf@<second>.<millisecond>.raw */
+	strcpy(strstr(basename, ".h5"), ".raw");
+
+	snprintf(fullname, BIG_HDF5_STR, "%s/%s", hdf5_data_object->directory, DIGITAL_RF_STAGING_DIR);
+	if (mkdir(fullname, S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH) && errno != EEXIST)
+	{
+		fprintf(stderr, "Unable to create directory %s\n", fullname);
+		return(-1);
+	}
+	snprintf(fullname, BIG_HDF5_STR, "%s/%s/%s", hdf5_data_object->directory, DIGITAL_RF_STAGING_DIR, basename);
+	/* "x" makes this fail if the file exists, as H5Fcreate with H5F_ACC_EXCL does */
+	if ((hdf5_data_object->staging_fp = fopen(fullname, "wbx")) == NULL)
+	{
+		fprintf(stderr, "The following staging file could not be created, or already exists: %s\n", fullname);
+		return(-1);
+	}
+#ifdef __linux__
+	/* a filesystem without fallocate just loses the reservation */
+	fallocate(fileno(hdf5_data_object->staging_fp), FALLOC_FL_KEEP_SIZE, 0,
+			(off_t)(DIGITAL_RF_STAGING_HEADER_NBYTES + max_samples_this_file * hdf5_data_object->sample_size));
+#endif
+	if (digital_rf_write_staging_header(hdf5_data_object->staging_fp, hdf5_data_object, 0, 0))
+	{
+		fprintf(stderr, "Unable to write staging file %s: %s\n", fullname, strerror(errno));
+		fclose(hdf5_data_object->staging_fp);
+		hdf5_data_object->staging_fp = NULL;
+		remove(fullname);
+		return(-1);
+	}
+
+	if (hdf5_data_object->marching_dots)
+	{
+		printf(".");
+		fflush(stdout);
+	}
+	strcpy(hdf5_data_object->staging_name, basename);
+	hdf5_data_object->staging_end = global_sample + samples_left;
+	hdf5_data_object->staging_samples = 0;
+	hdf5_data_object->staging_num_rows = 0;
+	hdf5_data_object->present_seq++;
+	return(0);
+}
+
+
+int digital_rf_end_staging_file(Digital_rf_write_object *hdf5_data_object)
+/* digital_rf_end_staging_file finishes the open staging file, if any.  Its rows and final header are written,
+ * the space reserved past its end released, and its data synced to disk before it is renamed from its tmp.
+ * name, so a staging file without the tmp. prefix is always complete.  After a failure the file is removed.
+ *
+ * 	Returns 0 if success, -1 if failure
+ */
+{
+	char fullname[BIG_HDF5_STR] = "";
+	char new_fullname[BIG_HDF5_STR] = "";
+	FILE * fp = hdf5_data_object->staging_fp;
+	size_t num_rows = (size_t)hdf5_data_object->staging_num_rows;
+	off_t end;
+	int dir_fd;
+	int result = 0;
+
+	if (fp == NULL)
+		return(0);
+	hdf5_data_object->staging_fp = NULL;
+	hdf5_data_object->staging_num_rows = 0;
+
+	snprintf(fullname, BIG_HDF5_STR, "%s/%s/%s", hdf5_data_object->directory, DIGITAL_RF_STAGING_DIR,
+			 hdf5_data_object->staging_name);
+	snprintf(new_fullname, BIG_HDF5_STR, "%s/%s/%s", hdf5_data_object->directory, DIGITAL_RF_STAGING_DIR,
+			 strstr(hdf5_data_object->staging_name, "rf@"));
+	if (hdf5_data_object->has_failure)
+	{
+		fclose(fp);
+		remove(fullname);
+		return(-1);
+	}
+
+	if (fwrite(hdf5_data_object->staging_rows, sizeof(uint64_t) * 2, num_rows, fp) != num_rows
+			|| fflush(fp) || (end = ftello(fp)) < 0 || ftruncate(fileno(fp), end)
+			|| fseek(fp, 0, SEEK_SET)
+			|| digital_rf_write_staging_header(fp, hdf5_data_object, hdf5_data_object->staging_samples, num_rows)
+			|| fflush(fp) || fsync(fileno(fp)))
+		result = -1;
+	if (fclose(fp))
+		result = -1;
+	if (!result && rename(fullname, new_fullname))
+		result = -1;
+	if (result)
+	{
+		fprintf(stderr, "Unable to finish staging file %s: %s\n", fullname, strerror(errno));
+		remove(fullname);
+		return(-1);
+	}
+
+	/* sync the directory too, so the rename survives a crash */
+	snprintf(fullname, BIG_HDF5_STR, "%s/%s", hdf5_data_object->directory, DIGITAL_RF_STAGING_DIR);
+	if ((dir_fd = open(fullname, O_RDONLY)) != -1)
+	{
+		fsync(dir_fd);
+		close(dir_fd);
+	}
+	return(0);
+}
+
+
+int digital_rf_write_staging_header(FILE * fp, Digital_rf_write_object *hdf5_data_object, uint64_t num_samples,
+		uint64_t num_rows)
+/* digital_rf_write_staging_header writes the DIGITAL_RF_STAGING_HEADER_NBYTES byte header of a staging file
+ * at the present position of fp
+ *
+ * 	Returns 0 if success, -1 if failure
+ */
+{
+	uint64_t header[7];
+
+	header[0] = 1; /* byte order */
+	header[1] = (uint64_t)hdf5_data_object->sample_size;
+	header[2] = hdf5_data_object->sample_rate_numerator;
+	header[3] = hdf5_data_object->sample_rate_denominator;
+	header[4] = hdf5_data_object->file_cadence_millisecs;
+	header[5] = num_samples;
+	header[6] = num_rows;
+	if (fwrite(DIGITAL_RF_STAGING_MAGIC, 1, 8, fp) != 8 || fwrite(header, sizeof(uint64_t), 7, fp) != 7)
+		return(-1);
+	return(0);
+}
+
+
+int digital_rf_pack_staging_file(Digital_rf_write_object *hdf5_data_object, char * fullname, void ** buffer,
+		size_t * buffer_size)
+/* digital_rf_pack_staging_file writes the samples of the finished staging file fullname to the Hdf5 file of
+ * its period, reading them into *buffer of *buffer_size bytes, grown as needed.  If that Hdf5 file was already
+ * finalized the staging file is removed instead, and if a tmp. Hdf5 file was left by a packer that died it is
+ * removed first.
+ *
+ * 	Returns 0 if packed, 1 if already packed, -1 if failure
+ */
+{
+	char subdir[BIG_HDF5_STR] = "";
+	char basename[SMALL_HDF5_STR] = "";
+	char hdf5_name[2*BIG_HDF5_STR] = "";
+	char magic[8];
+	uint64_t header[7];
+	uint64_t * rows = NULL;
+	uint64_t * global_index_arr = NULL;
+	uint64_t * data_index_arr = NULL;
+	uint64_t samples_left, max_samples_this_file, num_samples, num_rows, i, block_len;
+	size_t data_size;
+	struct stat stat_obj = {0};
+	FILE * fp;
+	int result = 0;
+
+	if ((fp = fopen(fullname, "rb")) == NULL)
+	{
+		fprintf(stderr, "Unable to open staging file %s\n", fullname);
+		return(-1);
+	}
+	num_samples = 0;
+	num_rows = 0;
+	if (fread(magic, 1, 8, fp) == 8 && memcmp(magic, DIGITAL_RF_STAGING_MAGIC, 8) == 0
+			&& fread(header, sizeof(uint64_t), 7, fp) == 7 && header[0] == 1
+			&& header[1] == (uint64_t)hdf5_data_object->sample_size
+			&& header[2] == hdf5_data_object->sample_rate_numerator
+			&& header[3] == hdf5_data_object->sample_rate_denominator
+			&& header[4] == hdf5_data_object->file_cadence_millisecs && !fstat(fileno(fp), &stat_obj))
+	{
+		num_samples = header[5];
+		num_rows = header[6];
+	}
+	data_size = (size_t)(num_samples * hdf5_data_object->sample_size);
+	if (num_rows == 0 || (uint64_t)stat_obj.st_size != DIGITAL_RF_STAGING_HEADER_NBYTES + data_size
+			+ num_rows * 2 * sizeof(uint64_t))
+	{
+		fprintf(stderr, "Staging file %s is damaged or does not match this channel\n", fullname);
+		fclose(fp);
+		return(-1);
+	}
+
+	if (data_size > *buffer_size)
+	{
+		if ((*buffer = realloc(*buffer, data_size)) == NULL)
 		{
-			snprintf(error_str, sizeof(error_str), "The num_subchannels attribute not found in %s\n", metadata_file);
-			fprintf(stderr, "%s", error_str);
-			return(-1);
+			fprintf(stderr, "Realloc failure\n");
+			exit(-22);
 		}
-		H5Aread(attribute_id, H5T_NATIVE_INT, &int_result);
-		if (int_result != hdf5_data_object->num_subchannels)
+		*buffer_size = data_size;
+	}
+	if ((rows = (uint64_t *)malloc(sizeof(uint64_t) * 4 * num_rows)) == NULL)
+	{
+		fprintf(stderr, "malloc failure - unrecoverable\n");
+		exit(-1);
+	}
+	global_index_arr = rows + 2 * num_rows;
+	data_index_arr = rows + 3 * num_rows;
+	if (fread(*buffer, 1, data_size, fp) != data_size
+			|| fread(rows, sizeof(uint64_t) * 2, (size_t)num_rows, fp) != (size_t)num_rows)
+	{
+		fprintf(stderr, "Unable to read staging file %s\n", fullname);
+		fclose(fp);
+		free(rows);
+		return(-1);
+	}
+	fclose(fp);
+	for (i=0; i<num_rows; i++)
+	{
+		global_index_arr[i] = rows[2*i] - hdf5_data_object->global_start_sample;
+		data_index_arr[i] = rows[2*i + 1];
+		if (rows[2*i] < hdf5_data_object->global_start_sample || data_index_arr[i] >= num_samples
+				|| (i == 0 && data_index_arr[i] != 0) || (i > 0 && data_index_arr[i] <= data_index_arr[i - 1]))
 		{
-			fprintf(stderr, "Mismatching num_subchannels found\n");
+			fprintf(stderr, "Staging file %s has an illegal row %" PRIu64 "\n", fullname, i);
+			free(rows);
 			return(-1);
 		}
-		H5Aclose(attribute_id);
+	}
 
-		/* is_continuous attribute */
-		attribute_id = H5Aopen(hdf5_file, "is_continuous", H5P_DEFAULT);
-		if (attribute_id < 0)
+	/* the Hdf5 file of this period, finalized if packed before */
+	if (digital_rf_get_subdir_file(hdf5_data_object, global_index_arr[0], subdir, basename, &samples_left,
+			&max_samples_this_file))
+	{
+		free(rows);
+		return(-1);
+	}
+	snprintf(hdf5_name, 2*BIG_HDF5_STR, "%s/%s/%s", hdf5_data_object->directory, subdir, strstr(basename, "rf@"));
+	if (access(hdf5_name, F_OK) != -1)
+	{
+		free(rows);
+		if (remove(fullname) && errno != ENOENT)
 		{
-			snprintf(error_str, sizeof(error_str), "The is_continuous attribute not found in %s\n", metadata_file);
-			fprintf(stderr, "%s", error_str);
+			fprintf(stderr, "Unable to remove staging file %s\n", fullname);
 			return(-1);
 		}
-		H5Aread(attribute_id, H5T_NATIVE_INT, &int_result);
-		if (int_result != hdf5_data_object->is_continuous)
+		return(1);
+	}
+	snprintf(hdf5_name, 2*BIG_HDF5_STR, "%s/%s/%s", hdf5_data_object->directory, subdir, basename);
+	if (access(hdf5_name, F_OK) != -1 && remove(hdf5_name))
+	{
+		fprintf(stderr, "Unable to remove %s\n", hdf5_name);
+		free(rows);
+		return(-1);
+	}
+
+	if (!hdf5_data_object->is_continuous)
+		result = digital_rf_write_blocks_hdf5(hdf5_data_object, global_index_arr, data_index_arr, num_rows,
+				*buffer, num_samples);
+	else
+	{
+		/* a continuous channel takes one block per write */
+		for (i=0; i<num_rows && result == 0; i++)
 		{
-			fprintf(stderr, "Mismatching is_continuous found\n");
-			return(-1);
+			block_len = ((i + 1 < num_rows) ? data_index_arr[i + 1] : num_samples) - data_index_arr[i];
+			result = digital_rf_write_hdf5(hdf5_data_object, global_index_arr[i],
+					(unsigned char *)*buffer + data_index_arr[i] * hdf5_data_object->sample_size, block_len);
 		}
-		H5Aclose(attribute_id);
+	}
+	/* in async mode the samples must be written before the buffer is reused */
+	if (result == 0)
+		result = digital_rf_flush_async(hdf5_data_object);
+	free(rows);
+	return(result ? -1 : 0);
+}
 
 
-		H5Fclose(hdf5_file);
-	}
+int digital_rf_unlink_packed_staging(Digital_rf_write_object *hdf5_data_object)
+/* digital_rf_unlink_packed_staging removes the staging file last packed by digital_rf_pack_staging, once its
+ * Hdf5 file has been finalized
+ *
+ * 	Returns 0 if success, -1 if failure
+ */
+{
+	char fullname[BIG_HDF5_STR] = "";
 
-	/* no problems found */
+	if (hdf5_data_object->packed_staging[0] == '\0')
+		return(0);
+	snprintf(fullname, BIG_HDF5_STR, "%s/%s/%s", hdf5_data_object->directory, DIGITAL_RF_STAGING_DIR,
+			 hdf5_data_object->packed_staging);
+	hdf5_data_object->packed_staging[0] = '\0';
+	if (remove(fullname) && errno != ENOENT)
+	{
+		fprintf(stderr, "Unable to remove staging file %s\n", fullname);
+		return(-1);
+	}
 	return(0);
+}
+
+
+int digital_rf_compare_staging_names(const void * a, const void * b)
+/* digital_rf_compare_staging_names orders staging file names by the file id in them, for qsort */
+{
+	uint64_t id_a = digital_rf_get_file_id(*(char * const *)a);
+	uint64_t id_b = digital_rf_get_file_id(*(char * const *)b);
+
+	return((id_a > id_b) - (id_a < id_b));
+}
+#endif
+
 
+uint32_t digital_rf_fletcher32(const unsigned char * data, size_t len)
+/* digital_rf_fletcher32 returns the Fletcher32 checksum of len bytes of data, computed as the fletcher32 filter of
+ * Hdf5 does (big-endian 16 bit words, odd last byte padded).  The reader checks the chunks it decodes with it too.
+ */
+{
+	uint32_t sum1 = 0, sum2 = 0;
+	size_t words = len / 2, n;
+
+	while (words > 0)
+	{
+		n = (words > 360) ? 360 : words;
+		words -= n;
+		do
+		{
+			sum1 += (uint32_t)((data[0] << 8) | data[1]);
+			sum2 += sum1;
+			data += 2;
+		} while (--n);
+		sum1 = (sum1 & 0xffff) + (sum1 >> 16);
+		sum2 = (sum2 & 0xffff) + (sum2 >> 16);
+	}
+	if (len % 2)
+	{
+		sum1 += (uint32_t)(data[0] << 8);
+		sum2 += sum1;
+		sum1 = (sum1 & 0xffff) + (sum1 >> 16);
+		sum2 = (sum2 & 0xffff) + (sum2 >> 16);
+	}
+	sum1 = (sum1 & 0xffff) + (sum1 >> 16);
+	sum2 = (sum2 & 0xffff) + (sum2 >> 16);
+	return((sum2 << 16) | sum1);
 }
 
 
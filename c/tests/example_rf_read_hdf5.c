@@ -1,18 +1,66 @@
+/* nftw, see rt_remove_dir */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#  define _GNU_SOURCE
+#endif
+
 #include "digital_rf.h"
+#include <unistd.h>
+#include <sys/stat.h>
+#include <ftw.h>
+
+#ifndef DRF_TEST_DATA_DIR
+#define DRF_TEST_DATA_DIR "../../data"
+#endif
+
+#define RT_DIR "/tmp/hdf5_read"
+#define RT_LEN 100
+#define RT_SUBCHANNELS 2
+
+struct complex_short { short r, i; };
+
+int rt_remove_entry(const char * path, const struct stat * sb, int type, struct FTW * ftwbuf)
+/* rt_remove_entry removes one entry of the tree walked by rt_remove_dir, returning nonzero to stop the walk if
+ * it can not */
+{
+    (void)sb; (void)type; (void)ftwbuf;
+    if (remove(path)) {
+        fprintf(stderr, "failed to remove %s\n", path);
+        return(-1);
+    }
+    return(0);
+}
+
+int rt_remove_dir(const char * dir)
+/* rt_remove_dir removes dir and everything under it, and returns 0 if success or if dir did not exist */
+{
+    struct stat sb;
+    if (stat(dir, &sb))
+        return(0);
+    return(nftw(dir, rt_remove_entry, 16, FTW_DEPTH | FTW_PHYS));
+}
+
+size_t rt_stub_filter(unsigned int flags, size_t cd_nelmts, const unsigned int cd_values[], size_t nbytes,
+        size_t * buf_size, void ** buf)
+/* rt_stub_filter passes chunks through unchanged, standing in for a codec whose plugin is missing */
+{
+    (void)flags; (void)cd_nelmts; (void)cd_values; (void)buf_size; (void)buf;
+    return(nbytes);
+}
 
 int main(int argc, char* argv[])
 {
     Digital_rf_read_object * read_obj = NULL;
+    Digital_rf_write_object * write_obj = NULL;
     uint64_t b = 4000;
     char ** channels = NULL;
     char ** channels2 = NULL;
     int num_channels;
+    int64_t result;
 
-    char dir1[SMALL_HDF5_STR] = "/Users/cariglia/example_digital_rf";
-    char dir2[SMALL_HDF5_STR] = "/Users/cariglia/Desktop/drfexamples/hprec_channels";
-    char dir3[SMALL_HDF5_STR] = "/Users/cariglia/Desktop/drfexamples/hprec_subchannels";
+    char dir1[SMALL_HDF5_STR] = DRF_TEST_DATA_DIR "/example";
+    char dir2[SMALL_HDF5_STR] = DRF_TEST_DATA_DIR "/synthetic";
 
-    printf("Test 2: real data, no subchannels\n");
+    printf("Test 2: synthetic data, no subchannels\n");
     printf("----------------------\n");
     read_obj = digital_rf_create_read_hdf5(dir2, b);
     printf("init success\n");
@@ -41,8 +89,22 @@ int main(int argc, char* argv[])
         exit(-25);
     }
 
-    get_bounds(read_obj, channels[0], bounds2);//"da");
-    printf("got bounds: %ld  %ld\n", bounds2->b1, bounds2->b2);
+    if (get_bounds(read_obj, "sc16_x1_n200_d3_10s_1000ms_c0", bounds2)) {
+        fprintf(stderr, "get_bounds failed\n");
+        exit(-1);
+    }
+    printf("got bounds: %llu  %llu\n", bounds2->b1, bounds2->b2);
+    if (bounds2->b1 != 92957882000ULL || bounds2->b2 != 92957882999ULL) {
+        fprintf(stderr, "get_bounds returned wrong bounds\n");
+        exit(-1);
+    }
+    /* second call is served from the channel's cache and must agree */
+    drf_bounds cached_bounds;
+    if (get_bounds(read_obj, "sc16_x1_n200_d3_10s_1000ms_c0", &cached_bounds)
+        || cached_bounds.b1 != bounds2->b1 || cached_bounds.b2 != bounds2->b2) {
+        fprintf(stderr, "cached get_bounds disagrees\n");
+        exit(-1);
+    }
 
     unsigned long long s0, s1;
     s0 = bounds2->b1;
@@ -50,17 +112,120 @@ int main(int argc, char* argv[])
     printf("(main)s0: %llu  s1: %llu\n", s0, s1);
     printf("got bounds (again): %llu  %llu\n", bounds2->b1, bounds2->b2);
 
-    //long long ** cont_data_arr2 = NULL;
-    //cont_data_arr2 = get_continuous_blocks(read_obj, bounds2[0], bounds2[1], read_obj->channel_names[0]);
+    printf("Test 2.0: continuous blocks from rf_data_index\n");
+    uint64_t * blocks = NULL;
+    uint64_t * blocks_again = NULL;
+    uint64_t total = 0;
+    int64_t num_blocks = get_continuous_blocks(read_obj, s0, s1, "sc16_x1_n200_d3_10s_1000ms_c0", &blocks);
+    for (int64_t i = 0; i < num_blocks; i++) {
+        printf("block %" PRIu64 " %" PRIu64 "\n", blocks[2 * i], blocks[2 * i + 1]);
+        total += blocks[2 * i + 1];
+    }
+    /* four blocks holding the 798 samples, merged across file boundaries */
+    if (num_blocks != 4 || total != 798 || blocks[2] != s0 + 233 || blocks[7] != 538) {
+        fprintf(stderr, "get_continuous_blocks returned wrong blocks\n");
+        exit(-1);
+    }
+    /* overlapping query answered from the channel's interval set, clipped to range */
+    num_blocks = get_continuous_blocks(read_obj, s0 + 100, s0 + 250, "sc16_x1_n200_d3_10s_1000ms_c0", &blocks_again);
+    if (num_blocks != 2 || blocks_again[0] != s0 + 100 || blocks_again[1] != 66
+        || blocks_again[2] != s0 + 233 || blocks_again[3] != 18) {
+        fprintf(stderr, "get_continuous_blocks on subrange returned wrong blocks\n");
+        exit(-1);
+    }
+    free(blocks);
+    free(blocks_again);
+
+    printf("Test 2.1: file list from cadences, no directory scan\n");
+    int num_files;
+    char ** file_list = get_file_list(read_obj, s0, s1, "sc16_x1_n200_d3_10s_1000ms_c0", &num_files);
+    /* 15 one-second files over two subdirectories, including the missing one */
+    if (file_list == NULL || num_files != 15 || file_list[15] != NULL
+        || strstr(file_list[0], "/2014-03-09T12-30-30/rf@1394368230.000.h5") == NULL
+        || strstr(file_list[5], "/rf@1394368235.000.h5") == NULL
+        || strstr(file_list[14], "/2014-03-09T12-30-40/rf@1394368244.000.h5") == NULL) {
+        fprintf(stderr, "get_file_list returned wrong files\n");
+        exit(-1);
+    }
+    free_file_list(file_list);
+
+    printf("Test 2.2: read_vector across files and a missing file\n");
+    if (get_sample_size(read_obj, "sc16_x1_n200_d3_10s_1000ms_c0") != 4) {
+        fprintf(stderr, "wrong sample size\n");
+        exit(-1);
+    }
+    struct complex_short * sc16 = malloc((s1 - s0 + 1) * sizeof(struct complex_short));
+    result = read_vector(read_obj, s0, s1 - s0 + 1, "sc16_x1_n200_d3_10s_1000ms_c0", sc16);
+    printf("read %" PRIi64 " of %llu samples\n", result, s1 - s0 + 1);
+    /* gapped channel: 798 samples present, rf@1394368235.000.h5 missing entirely */
+    if (result != 798) {
+        fprintf(stderr, "read_vector found wrong number of samples\n");
+        exit(-1);
+    }
+    if (sc16[334].r != INT16_MIN || sc16[399].i != INT16_MIN) {
+        fprintf(stderr, "gap not set to fill value\n");
+        exit(-1);
+    }
+    /* chunked rf_data is read through a chunk cache of the caller's size */
+    if (read_obj->handles->chunk_nbytes == 0 || read_obj->handles->rdcc_nbytes != b) {
+        fprintf(stderr, "rdcc_nbytes not applied to rf_data\n");
+        exit(-1);
+    }
+    /* batched ranges, unordered and overlapping, match slices of the single read */
+    uint64_t batch_ranges[8] = {s0 + 150, 100, s0 + 10, 20, s0 + 160, 10, s0 - 1000, 10};
+    struct complex_short batch0[100], batch1[20], batch2[10], batch3[10];
+    void * batch_data[4] = {batch0, batch1, batch2, batch3};
+    int64_t batch_found[4];
+    batch3[0].r = 7;
+    result = digital_rf_read_vectors(read_obj, "sc16_x1_n200_d3_10s_1000ms_c0", 4, batch_ranges, batch_data,
+        batch_found);
+    if (result != batch_found[0] + batch_found[1] + batch_found[2]
+        || batch_found[1] != 20 || batch_found[3] != 0 || batch3[0].r != 7
+        || memcmp(batch0, sc16 + 150, sizeof(batch0)) != 0 || memcmp(batch1, sc16 + 10, sizeof(batch1)) != 0
+        || memcmp(batch2, sc16 + 160, sizeof(batch2)) != 0) {
+        fprintf(stderr, "digital_rf_read_vectors differs from read_vector\n");
+        exit(-1);
+    }
+    /* a cursor streams the same samples block by block, prefetching across files */
+    Digital_rf_read_cursor * cursor = digital_rf_open_read_cursor(read_obj, "sc16_x1_n200_d3_10s_1000ms_c0",
+        s0, 100, 3);
+    void * block;
+    for (int k = 0; k < 10; k++) {
+        result = digital_rf_read_cursor_next(cursor, &block);
+        if (result < 0 || memcmp(block, sc16 + 100 * k, 100 * sizeof(struct complex_short)) != 0) {
+            fprintf(stderr, "cursor block %d differs from read_vector\n", k);
+            exit(-1);
+        }
+    }
+    digital_rf_close_read_cursor(cursor);
+    /* a read entirely before the data finds nothing and fails nothing */
+    result = read_vector(read_obj, s0 - 1000, 10, "sc16_x1_n200_d3_10s_1000ms_c0", sc16);
+    if (result != 0) {
+        fprintf(stderr, "read_vector found data before bounds\n");
+        exit(-1);
+    }
+    /* files stay open in the reader's LRU; a tighter budget closes the oldest */
+    if (read_obj->num_handles < 2 || digital_rf_set_handle_cache(read_obj, 2, 1 << 30)
+        || read_obj->num_handles != 2) {
+        fprintf(stderr, "handle cache not trimmed to budget\n");
+        exit(-1);
+    }
+    result = read_vector(read_obj, s0, s1 - s0 + 1, "sc16_x1_n200_d3_10s_1000ms_c0", sc16);
+    if (result != 798 || read_obj->num_handles != 2 || sc16[334].r != INT16_MIN
+        || strcmp(read_obj->handles->channel->top_level_dir_meta->cachedFilename, read_obj->handles->path) != 0) {
+        fprintf(stderr, "read_vector through small handle cache failed\n");
+        exit(-1);
+    }
+    free(sc16);
 
     free(bounds2);
     digital_rf_close_read_hdf5(read_obj);
     read_obj = NULL;
 
 
-    printf("Test 3: real data, yes subchannels\n");
+    printf("Test 3: synthetic data, yes subchannels\n");
     printf("----------------------\n");
-    read_obj = digital_rf_create_read_hdf5(dir3, b);
+    read_obj = digital_rf_create_read_hdf5(dir2, b);
     printf("init success\n");
 
     //char ** channels = NULL;
@@ -86,11 +251,72 @@ int main(int argc, char* argv[])
         exit(-25);
     }
 
-    get_bounds(read_obj, "adc", bounds3);
-    printf("got bounds: %ld  %ld\n", bounds3->b1, bounds3->b2);
+    get_bounds(read_obj, "fc32_x8_n200_d3_10s_1000ms_c1", bounds3);
+    printf("got bounds: %llu  %llu\n", bounds3->b1, bounds3->b2);
 
-    long long ** cont_data_arr3 = NULL;
-    //cont_data_arr3 = get_continuous_blocks(read_obj, bounds3[0], bounds3[1], read_obj->channel_names[0]);
+    printf("Test 3.1: read_vector of float complex with 8 subchannels\n");
+    if (get_sample_size(read_obj, "fc32_x8_n200_d3_10s_1000ms_c1") != 8 * 2 * sizeof(float)) {
+        fprintf(stderr, "wrong sample size\n");
+        exit(-1);
+    }
+    float * fc32 = malloc(200 * get_sample_size(read_obj, "fc32_x8_n200_d3_10s_1000ms_c1"));
+    result = read_vector(read_obj, bounds3->b1 + 50, 200, "fc32_x8_n200_d3_10s_1000ms_c1", fc32);
+    printf("read %" PRIi64 " of 200 samples\n", result);
+    if (result != 200) {
+        fprintf(stderr, "read_vector found wrong number of samples\n");
+        exit(-1);
+    }
+
+    /* contiguous rf_data is mapped in place, one continuous run per file at a time */
+    uint64_t fc32_size = get_sample_size(read_obj, "fc32_x8_n200_d3_10s_1000ms_c1");
+    uint64_t mapped = 0;
+    void * fc32_map;
+    while (mapped < 200) {
+        result = digital_rf_read_vector_mapped(read_obj, bounds3->b1 + 50 + mapped, 200 - mapped,
+            "fc32_x8_n200_d3_10s_1000ms_c1", &fc32_map);
+        if (result < 1 || memcmp((char *)fc32 + mapped * fc32_size, fc32_map, result * fc32_size) != 0) {
+            fprintf(stderr, "digital_rf_read_vector_mapped differs from read_vector\n");
+            exit(-1);
+        }
+        mapped += result;
+    }
+    /* chunked rf_data cannot be mapped */
+    if (digital_rf_read_vector_mapped(read_obj, bounds3->b1, 1, "sc16_x1_n200_d3_10s_1000ms_c0", &fc32_map) != -2) {
+        fprintf(stderr, "chunked rf_data was mapped\n");
+        exit(-1);
+    }
+
+    uint64_t * cont_blocks3 = NULL;
+    /* continuous within files, only the missing rf@1394368235.000.h5 splits it */
+    if (get_continuous_blocks(read_obj, bounds3->b1, bounds3->b2, "fc32_x8_n200_d3_10s_1000ms_c1", &cont_blocks3) != 2
+        || cont_blocks3[0] != bounds3->b1 || cont_blocks3[1] != 334
+        || cont_blocks3[2] != bounds3->b1 + 400 || cont_blocks3[3] != bounds3->b2 - bounds3->b1 - 399) {
+        fprintf(stderr, "continuous channel has wrong blocks\n");
+        exit(-1);
+    }
+    free(cont_blocks3);
+    digital_rf_close_read_hdf5(read_obj);
+
+    printf("Test 3.2: read_vector with an automatic chunk cache\n");
+    read_obj = digital_rf_create_read_hdf5(dir2, DIGITAL_RF_READ_RDCC_AUTO);
+    float * fc32_auto = malloc(200 * get_sample_size(read_obj, "fc32_x8_n200_d3_10s_1000ms_c1"));
+    result = read_vector(read_obj, bounds3->b1 + 50, 200, "fc32_x8_n200_d3_10s_1000ms_c1", fc32_auto);
+    if (result != 200 || memcmp(fc32, fc32_auto, 200 * get_sample_size(read_obj, "fc32_x8_n200_d3_10s_1000ms_c1")) != 0) {
+        fprintf(stderr, "read_vector with automatic chunk cache differs\n");
+        exit(-1);
+    }
+    /* for chunked rf_data, sized to the 2 chunks a short read can touch, within the memory budget */
+    struct complex_short sc16_auto[10];
+    drf_bounds sc16_bounds;
+    get_bounds(read_obj, "sc16_x1_n200_d3_10s_1000ms_c0", &sc16_bounds);
+    if (read_vector(read_obj, sc16_bounds.b1, 10, "sc16_x1_n200_d3_10s_1000ms_c0", sc16_auto) != 10
+        || read_obj->handles->rdcc_nbytes != 2 * read_obj->handles->chunk_nbytes
+        || read_obj->handle_nbytes > read_obj->max_handle_nbytes) {
+        fprintf(stderr, "automatic chunk cache has wrong size\n");
+        exit(-1);
+    }
+    free(fc32_auto);
+    free(fc32);
 
     free(bounds3);
     digital_rf_close_read_hdf5(read_obj);
@@ -101,14 +327,14 @@ int main(int argc, char* argv[])
     printf("----------------------\n");
     //printf("about to init read obj\n");
 
-    
+
     read_obj = digital_rf_create_read_hdf5(dir1, b);
     printf("init success\n");
 
-    
+
     //printf("about to get channels\n");
     channels = get_channels(read_obj);
-    
+
     channels2 = read_obj->channel_names;
 
     printf("got channels:\n");
@@ -135,18 +361,740 @@ int main(int argc, char* argv[])
     printf("got bounds: %llu  %llu\n", bounds1->b1, bounds1->b2);
     fflush(stdout);
 
-    unsigned long ** cont_data_arr1 = NULL;
    // unsigned long long s0, s1;
     s0 = bounds1->b1;
     s1 = bounds1->b2;
     printf("(main)s0: %llu  s1: %llu\n", s0, s1);
     printf("got bounds (again): %llu  %llu\n", bounds1->b1, bounds1->b2);
-    //cont_data_arr1 = get_continuous_blocks(read_obj, s0, s1, read_obj->channel_names[0]);
     fflush(stdout);
     free(bounds1);
     digital_rf_close_read_hdf5(read_obj);
     read_obj = NULL;
 
+
+    printf("Test 4: write gapped data then read it back\n");
+    printf("----------------------\n");
+    struct complex_short data_out[RT_LEN][RT_SUBCHANNELS];
+    struct complex_short data_in[2 * RT_LEN][RT_SUBCHANNELS];
+    uint64_t global_index_arr[2] = {0, 150};
+    uint64_t data_index_arr[2] = {0, 50};
+    uint64_t start = (uint64_t)1394368230 * 200 / 3;
+
+    for (int i = 0; i < RT_LEN; i++) {
+        for (int j = 0; j < RT_SUBCHANNELS; j++) {
+            data_out[i][j].r = i * RT_SUBCHANNELS + j;
+            data_out[i][j].i = -(i * RT_SUBCHANNELS + j);
+        }
+    }
+    if (rt_remove_dir(RT_DIR) || mkdir(RT_DIR, 0775) || mkdir(RT_DIR "/junk0", 0775)) {
+        fprintf(stderr, "failed to make " RT_DIR "\n");
+        exit(-1);
+    }
+    write_obj = digital_rf_create_write_hdf5(RT_DIR "/junk0", H5T_NATIVE_SHORT, 2, 400, start, 200, 3,
+            "FAKE_UUID_READ", 0, 0, 1, RT_SUBCHANNELS, 0, 0);
+    if (!write_obj || digital_rf_set_sidecar_index(write_obj, 1) || digital_rf_set_file_template(write_obj, 1)
+        || digital_rf_write_blocks_hdf5(write_obj, global_index_arr, data_index_arr, 2, data_out, RT_LEN)
+        || digital_rf_close_write_hdf5(write_obj)) {
+        fprintf(stderr, "gapped write failed\n");
+        exit(-1);
+    }
+    /* the sidecar index holds the /rf_data_index rows of each of the five files, each followed by a row one past
+     * its last block */
+    uint64_t rt_sidecar[33];
+    size_t rt_sidecar_len = 0;
+    FILE * rt_sidecar_file = fopen(RT_DIR "/junk0/" DIGITAL_RF_SIDECAR_INDEX, "rb");
+    if (rt_sidecar_file) {
+        rt_sidecar_len = fread(rt_sidecar, sizeof(uint64_t), 33, rt_sidecar_file);
+        fclose(rt_sidecar_file);
+    }
+    if (rt_sidecar_len != 2 + 10 * 3 || memcmp(rt_sidecar, DIGITAL_RF_SIDECAR_MAGIC, 8) != 0 || rt_sidecar[1] != 1
+        || rt_sidecar[2] != start || rt_sidecar[3] != 1394368230000ULL || rt_sidecar[4] != 0
+        || rt_sidecar[5] != start + 27 || rt_sidecar[6] != 1394368230000ULL || rt_sidecar[7] != 27
+        || rt_sidecar[14] != start + 150 || rt_sidecar[15] != 1394368232000ULL || rt_sidecar[16] != 0
+        || rt_sidecar[29] != start + 200 || rt_sidecar[30] != 1394368232800ULL || rt_sidecar[31] != 13) {
+        fprintf(stderr, "sidecar index rows wrong\n");
+        exit(-1);
+    }
+
+    read_obj = digital_rf_create_read_hdf5(RT_DIR, b);
+    drf_bounds rt_bounds;
+    if (get_bounds(read_obj, "junk0", &rt_bounds) || rt_bounds.b1 != start
+        || rt_bounds.b2 != start + 2 * RT_LEN - 1) {
+        fprintf(stderr, "get_bounds of written data wrong\n");
+        exit(-1);
+    }
+    uint64_t * rt_blocks = NULL;
+    uint64_t * rt_blocks_none = NULL;
+    if (get_continuous_blocks(read_obj, start, start + 2 * RT_LEN - 1, "junk0", &rt_blocks) != 2
+        || rt_blocks[0] != start || rt_blocks[1] != 50 || rt_blocks[2] != start + 150 || rt_blocks[3] != 50) {
+        fprintf(stderr, "get_continuous_blocks of written data wrong\n");
+        exit(-1);
+    }
+    free(rt_blocks);
+    /* an open ended range stops walking file windows after the last file, and its blocks keep their lengths */
+    if (get_continuous_blocks(read_obj, start + 10, UINT64_MAX, "junk0", &rt_blocks) != 2
+        || rt_blocks[0] != start + 10 || rt_blocks[1] != 40 || rt_blocks[2] != start + 150 || rt_blocks[3] != 50
+        || get_continuous_blocks(read_obj, UINT64_MAX, UINT64_MAX, "junk0", &rt_blocks_none) != 0) {
+        fprintf(stderr, "get_continuous_blocks to UINT64_MAX wrong\n");
+        exit(-1);
+    }
+    free(rt_blocks);
+    /* sidecar index written as each file was finalized locates samples without Hdf5 */
+    char rt_path[BIG_HDF5_STR];
+    uint64_t rt_offset;
+    if (digital_rf_locate_sample(read_obj, "junk0", start + 10, rt_path, &rt_offset) != 1
+        || strstr(rt_path, "/rf@1394368230.000.h5") == NULL || rt_offset != 10
+        || digital_rf_locate_sample(read_obj, "junk0", start + 100, rt_path, &rt_offset) != 0
+        || digital_rf_locate_sample(read_obj, "junk0", start + 160, rt_path, &rt_offset) != 1
+        || strstr(rt_path, "/2014-03-09T12-30-32/rf@1394368232.400.h5") == NULL || rt_offset != 0) {
+        fprintf(stderr, "digital_rf_locate_sample failed\n");
+        exit(-1);
+    }
+    result = read_vector(read_obj, start, 2 * RT_LEN, "junk0", data_in);
+    printf("read %" PRIi64 " of %d samples\n", result, 2 * RT_LEN);
+    if (result != RT_LEN) {
+        fprintf(stderr, "read_vector found wrong number of samples\n");
+        exit(-1);
+    }
+    for (int i = 0; i < 2 * RT_LEN; i++) {
+        for (int j = 0; j < RT_SUBCHANNELS; j++) {
+            short r, im;
+            if (i < 50) {
+                r = data_out[i][j].r;
+                im = data_out[i][j].i;
+            } else if (i < 150) {
+                r = INT16_MIN;
+                im = INT16_MIN;
+            } else {
+                r = data_out[i - 100][j].r;
+                im = data_out[i - 100][j].i;
+            }
+            if (data_in[i][j].r != r || data_in[i][j].i != im) {
+                fprintf(stderr, "read_vector mismatch at sample %d subchannel %d\n", i, j);
+                exit(-1);
+            }
+        }
+    }
+    /* short read starting inside the gap and ending in the second block */
+    result = read_vector(read_obj, start + 140, 20, "junk0", data_in);
+    if (result != 10 || data_in[9][0].r != INT16_MIN || data_in[10][1].r != data_out[50][1].r) {
+        fprintf(stderr, "read_vector from inside gap failed\n");
+        exit(-1);
+    }
+    /* a cursor on a channel gone since the reader listed it fails instead of reading through a NULL channel */
+    if (rename(RT_DIR "/junk0", RT_DIR "/gone0")
+        || digital_rf_open_read_cursor(read_obj, "junk0", start, 10, 2) != NULL
+        || rename(RT_DIR "/gone0", RT_DIR "/junk0")) {
+        fprintf(stderr, "cursor on a removed channel not refused\n");
+        exit(-1);
+    }
+    digital_rf_close_read_hdf5(read_obj);
+
+    /* sidecar rows appended out of order, as by a writer restarted on earlier data, here claiming the first file
+     * also holds samples 300-309, drop the sidecar index instead of misleading its searches */
+    if (mkdir(RT_DIR "/junk17", 0775)) {
+        fprintf(stderr, "mkdir junk17 failed\n");
+        exit(-1);
+    }
+    write_obj = digital_rf_create_write_hdf5(RT_DIR "/junk17", H5T_NATIVE_SHORT, 2, 400, start, 200, 3,
+            "FAKE_UUID_READ", 0, 0, 1, RT_SUBCHANNELS, 0, 0);
+    if (!write_obj || digital_rf_set_sidecar_index(write_obj, 1) || digital_rf_write_hdf5(write_obj, 0, data_out, 50)
+        || digital_rf_close_write_hdf5(write_obj)) {
+        fprintf(stderr, "write with sidecar index failed\n");
+        exit(-1);
+    }
+    uint64_t rt_stale_rows[6] = {start + 300, 1394368230000ULL, 0, start + 310, 1394368230000ULL, 10};
+    rt_sidecar_file = fopen(RT_DIR "/junk17/" DIGITAL_RF_SIDECAR_INDEX, "ab");
+    if (!rt_sidecar_file || fwrite(rt_stale_rows, sizeof(uint64_t), 6, rt_sidecar_file) != 6
+        || fclose(rt_sidecar_file)) {
+        fprintf(stderr, "appending to the sidecar index failed\n");
+        exit(-1);
+    }
+    read_obj = digital_rf_create_read_hdf5(RT_DIR, b);
+    if (digital_rf_locate_sample(read_obj, "junk17", start + 305, rt_path, &rt_offset) != -1
+        || digital_rf_locate_sample(read_obj, "junk17", start + 10, rt_path, &rt_offset) != -1
+        || read_vector(read_obj, start, RT_LEN, "junk17", data_in) != 50
+        || memcmp(data_in, data_out, 50 * sizeof(data_out[0])) != 0) {
+        fprintf(stderr, "sidecar index with rows out of order not dropped\n");
+        exit(-1);
+    }
+    digital_rf_close_read_hdf5(read_obj);
+
+    /* deflated and checksummed chunks decoded on the reader's own threads */
+    if (mkdir(RT_DIR "/junk1", 0775)) {
+        fprintf(stderr, "mkdir junk1 failed\n");
+        exit(-1);
+    }
+    write_obj = digital_rf_create_write_hdf5(RT_DIR "/junk1", H5T_NATIVE_SHORT, 2, 400, start, 200, 3,
+            "FAKE_UUID_READ", 6, 1, 1, RT_SUBCHANNELS, 1, 0);
+    if (!write_obj)
+        exit(-1);
+    /* chunks deflated and checksummed on writer threads where available, by Hdf5 otherwise */
+#if !defined(_WIN32) && defined(DIGITAL_RF_HAVE_ZLIB) && H5_VERSION_GE(1, 10, 3)
+    if (digital_rf_set_compress_threads(write_obj, 2) || write_obj->chunk_pool == NULL) {
+#else
+    if (digital_rf_set_compress_threads(write_obj, 2) != -1) {
+#endif
+        fprintf(stderr, "digital_rf_set_compress_threads failed\n");
+        exit(-1);
+    }
+    if (digital_rf_write_hdf5(write_obj, 0, data_out, RT_LEN) || digital_rf_close_write_hdf5(write_obj))
+        exit(-1);
+    read_obj = digital_rf_create_read_hdf5(RT_DIR, b);
+    result = read_vector(read_obj, start, RT_LEN, "junk1", data_in);
+    if (result != RT_LEN || memcmp(data_in, data_out, RT_LEN * sizeof(data_out[0])) != 0) {
+        fprintf(stderr, "read_vector of compressed write failed\n");
+        exit(-1);
+    }
+    if (digital_rf_set_decode_threads(read_obj, 3) == 0) {
+        result = read_vector(read_obj, start + 5, RT_LEN - 5, "junk1", data_in);
+        if (result != RT_LEN - 5 || memcmp(data_in, data_out[5], (RT_LEN - 5) * sizeof(data_out[0])) != 0) {
+            fprintf(stderr, "read_vector with decode threads failed\n");
+            exit(-1);
+        }
+        uint64_t rt_ranges[4] = {start + 60, 20, start + 5, 30};
+        void * rt_data[2] = {data_in, data_in + 20};
+        if (digital_rf_read_vectors(read_obj, "junk1", 2, rt_ranges, rt_data, NULL) != 50
+            || memcmp(data_in, data_out[60], 20 * sizeof(data_out[0])) != 0
+            || memcmp(data_in + 20, data_out[5], 30 * sizeof(data_out[0])) != 0) {
+            fprintf(stderr, "digital_rf_read_vectors with decode threads failed\n");
+            exit(-1);
+        }
+    }
+    /* both channels in one buffer, sample by sample and then channel by channel */
+    char * rt_channels[2] = {"junk0", "junk1"};
+    struct complex_short rt_aligned[RT_LEN][2][RT_SUBCHANNELS];
+    if (digital_rf_read_channels(read_obj, start, RT_LEN, 2, rt_channels, 1, rt_aligned, NULL) != 50 + RT_LEN
+        || memcmp(rt_aligned[10][0], data_out[10], sizeof(data_out[0])) != 0
+        || rt_aligned[60][0][1].i != INT16_MIN
+        || memcmp(rt_aligned[60][1], data_out[60], sizeof(data_out[0])) != 0) {
+        fprintf(stderr, "interleaved digital_rf_read_channels failed\n");
+        exit(-1);
+    }
+    if (digital_rf_read_channels(read_obj, start, RT_LEN, 2, rt_channels, 0, rt_aligned, NULL) != 50 + RT_LEN
+        || memcmp(rt_aligned, data_out, 50 * sizeof(data_out[0])) != 0
+        || memcmp(rt_aligned[RT_LEN / 2], data_out, RT_LEN * sizeof(data_out[0])) != 0) {
+        fprintf(stderr, "planar digital_rf_read_channels failed\n");
+        exit(-1);
+    }
+    digital_rf_close_read_hdf5(read_obj);
+
+    /* the gapped write again through a writer thread, split across small ring buffers, with each next file
+     * prepared ahead of time (the one after sample 50 is skipped by the gap and must be removed) and
+     * /rf_data_index rows held until each file is closed */
+    uint64_t rt_stalls = 0;
+    uint64_t rt_dropped = 1;
+    int rt_max_queued = 0;
+    if (mkdir(RT_DIR "/junk3", 0775)) {
+        fprintf(stderr, "mkdir junk3 failed\n");
+        exit(-1);
+    }
+    write_obj = digital_rf_create_write_hdf5(RT_DIR "/junk3", H5T_NATIVE_SHORT, 2, 400, start, 200, 3,
+            "FAKE_UUID_READ", 0, 0, 1, RT_SUBCHANNELS, 0, 0);
+    if (!write_obj || digital_rf_set_async(write_obj, 2, 16, 1) || digital_rf_set_precreate(write_obj, 1)
+        || digital_rf_set_deferred_index(write_obj, 1, 0)
+        || digital_rf_write_blocks_hdf5(write_obj, global_index_arr, data_index_arr, 2, data_out, RT_LEN)
+        || digital_rf_flush_async(write_obj)
+        || digital_rf_get_async_stats(write_obj, &rt_stalls, NULL, &rt_dropped, &rt_max_queued)
+        || rt_dropped != 0 || rt_max_queued < 1 || rt_max_queued > 2) {
+        fprintf(stderr, "async write failed\n");
+        exit(-1);
+    }
+    /* a blocking write of 100 samples through two 16 sample buffers waits for the writer thread; once drained a
+     * write behind the data is refused before it is queued, and the writer goes on */
+    if (rt_stalls == 0 || digital_rf_write_hdf5(write_obj, 10, data_out, 10) != -3 || write_obj->has_failure
+        || digital_rf_close_write_hdf5(write_obj)) {
+        fprintf(stderr, "async write not drained or its error not reported\n");
+        exit(-1);
+    }
+    if (system("find " RT_DIR "/junk3 -name 'next.*' | grep -q .") == 0) {
+        fprintf(stderr, "prepared file left behind\n");
+        exit(-1);
+    }
+    read_obj = digital_rf_create_read_hdf5(RT_DIR, b);
+    if (read_vector(read_obj, start, 2 * RT_LEN, "junk3", data_in) != RT_LEN
+        || memcmp(data_in, data_out, 50 * sizeof(data_out[0])) != 0
+        || data_in[100][1].i != INT16_MIN
+        || memcmp(data_in[150], data_out[50], 50 * sizeof(data_out[0])) != 0) {
+        fprintf(stderr, "read_vector of async write failed\n");
+        exit(-1);
+    }
+    digital_rf_close_read_hdf5(read_obj);
+
+    /* /rf_data_index rows held until a write finds them flush_interval_secs old, then written and flushed, so a
+     * copy of the open file reads back everything written so far */
+    if (mkdir(RT_DIR "/junk14", 0775)) {
+        fprintf(stderr, "mkdir junk14 failed\n");
+        exit(-1);
+    }
+    write_obj = digital_rf_create_write_hdf5(RT_DIR "/junk14", H5T_NATIVE_SHORT, 2, 2000, start, 200, 3,
+            "FAKE_UUID_READ", 0, 0, 1, RT_SUBCHANNELS, 0, 0);
+    if (!write_obj || digital_rf_set_deferred_index(write_obj, 1, 2)
+        || digital_rf_write_hdf5(write_obj, 0, data_out, 10)
+        || digital_rf_write_hdf5(write_obj, 20, data_out[10], 10)
+        || write_obj->pending_index_rows != 2) {
+        fprintf(stderr, "deferred index write failed\n");
+        exit(-1);
+    }
+    sleep(2);
+    if (digital_rf_write_hdf5(write_obj, 40, data_out[20], 10) || write_obj->pending_index_rows != 0
+        || system("cp -r " RT_DIR "/junk14 " RT_DIR "/junk15 && mv " RT_DIR "/junk15/2014-03-09T12-30-30/tmp.rf@1394368230.000.h5 "
+                  RT_DIR "/junk15/2014-03-09T12-30-30/rf@1394368230.000.h5")) {
+        fprintf(stderr, "deferred index not written at its interval\n");
+        exit(-1);
+    }
+    read_obj = digital_rf_create_read_hdf5(RT_DIR, b);
+    if (read_vector(read_obj, start, RT_LEN, "junk15", data_in) != 30
+        || memcmp(data_in, data_out, 10 * sizeof(data_out[0])) != 0
+        || data_in[10][0].r != INT16_MIN
+        || memcmp(data_in[20], data_out[10], 10 * sizeof(data_out[0])) != 0
+        || memcmp(data_in[40], data_out[20], 10 * sizeof(data_out[0])) != 0) {
+        fprintf(stderr, "read_vector of open file with deferred index failed\n");
+        exit(-1);
+    }
+    digital_rf_close_read_hdf5(read_obj);
+    if (digital_rf_close_write_hdf5(write_obj))
+        exit(-1);
+
+    /* a run of equal sized writes reuses the writer's /rf_data_index scratch rows and both memspaces, and a write
+     * of another size reshapes them without disturbing what was written */
+    if (mkdir(RT_DIR "/junk16", 0775)) {
+        fprintf(stderr, "mkdir junk16 failed\n");
+        exit(-1);
+    }
+    write_obj = digital_rf_create_write_hdf5(RT_DIR "/junk16", H5T_NATIVE_SHORT, 2, 2000, start, 200, 3,
+            "FAKE_UUID_READ", 0, 0, 1, RT_SUBCHANNELS, 0, 0);
+    /* the first write of a file writes its /rf_data_index row as the file is made, the next one sets up the reuse */
+    if (!write_obj || digital_rf_write_hdf5(write_obj, 0, data_out, 10)
+        || digital_rf_write_hdf5(write_obj, 20, data_out[10], 10) || write_obj->index_memspace == 0) {
+        fprintf(stderr, "first of equal sized writes failed\n");
+        exit(-1);
+    }
+    uint64_t * rt_scratch = write_obj->index_scratch;
+    hid_t rt_memspace = write_obj->memspace;
+    hid_t rt_index_memspace = write_obj->index_memspace;
+    for (int k = 2; k < 5; k++) {
+        if (digital_rf_write_hdf5(write_obj, 20 * k, data_out[10 * k], 10) || write_obj->index_scratch != rt_scratch
+            || write_obj->memspace != rt_memspace || write_obj->index_memspace != rt_index_memspace
+            || write_obj->memspace_samples != 10) {
+            fprintf(stderr, "equal sized write %d did not reuse the scratch buffers\n", k);
+            exit(-1);
+        }
+    }
+    if (digital_rf_write_hdf5(write_obj, 100, data_out[50], 25) || write_obj->memspace_samples != 25
+        || digital_rf_close_write_hdf5(write_obj)) {
+        fprintf(stderr, "write of another size failed\n");
+        exit(-1);
+    }
+    read_obj = digital_rf_create_read_hdf5(RT_DIR, b);
+    result = read_vector(read_obj, start, 125, "junk16", data_in);
+    for (int k = 0; k < 5; k++) {
+        if (memcmp(data_in[20 * k], data_out[10 * k], 10 * sizeof(data_out[0])) != 0
+            || data_in[20 * k + 10][0].r != INT16_MIN || data_in[20 * k + 19][1].i != INT16_MIN)
+            result = -1;
+    }
+    if (result != 75 || memcmp(data_in[100], data_out[50], 25 * sizeof(data_out[0])) != 0) {
+        fprintf(stderr, "read_vector of reused scratch writes failed\n");
+        exit(-1);
+    }
+    digital_rf_close_read_hdf5(read_obj);
+
+    /* without blocking a write is queued whole or dropped whole, and a bad write is refused without stopping the
+     * writer thread */
+    rt_dropped = 0;
+    if (mkdir(RT_DIR "/junk13", 0775)) {
+        fprintf(stderr, "mkdir junk13 failed\n");
+        exit(-1);
+    }
+    write_obj = digital_rf_create_write_hdf5(RT_DIR "/junk13", H5T_NATIVE_SHORT, 2, 400, start, 200, 3,
+            "FAKE_UUID_READ", 0, 0, 1, RT_SUBCHANNELS, 0, 0);
+    if (!write_obj || digital_rf_set_async(write_obj, 2, 16, 0)
+        || digital_rf_write_hdf5(write_obj, 0, data_out, RT_LEN) != -7
+        || digital_rf_get_async_stats(write_obj, NULL, NULL, &rt_dropped, NULL) || rt_dropped != RT_LEN
+        || digital_rf_write_hdf5(write_obj, 0, data_out, 30)
+        || digital_rf_flush_async(write_obj)
+        || digital_rf_write_hdf5(write_obj, 10, data_out, 10) != -3
+        || digital_rf_write_blocks_hdf5(write_obj, global_index_arr, data_index_arr, 2, data_out, RT_LEN) != -3
+        || digital_rf_write_hdf5(write_obj, 150, data_out[50], 20)
+        || digital_rf_close_write_hdf5(write_obj)) {
+        fprintf(stderr, "non-blocking async write failed\n");
+        exit(-1);
+    }
+    read_obj = digital_rf_create_read_hdf5(RT_DIR, b);
+    if (read_vector(read_obj, start, 2 * RT_LEN, "junk13", data_in) != 50
+        || memcmp(data_in, data_out, 30 * sizeof(data_out[0])) != 0
+        || data_in[30][0].r != INT16_MIN
+        || memcmp(data_in[150], data_out[50], 20 * sizeof(data_out[0])) != 0) {
+        fprintf(stderr, "read_vector of non-blocking async write failed\n");
+        exit(-1);
+    }
+    digital_rf_close_read_hdf5(read_obj);
+
+    /* the gapped write with each codec whose Hdf5 filter is available, set as a mandatory filter ahead of the
+     * checksum; a codec whose plugin is missing is refused by the writer and reported as skipped */
+    int rt_codecs[4] = {DIGITAL_RF_CODEC_DEFLATE, DIGITAL_RF_CODEC_LZ4, DIGITAL_RF_CODEC_BITSHUFFLE_LZ4,
+                        DIGITAL_RF_CODEC_ZSTD};
+    int rt_levels[4] = {3, 0, 0, 5};
+    int rt_missing_codec = 0;
+    char rt_channel[SMALL_HDF5_STR];
+    char rt_channel_dir[BIG_HDF5_STR];
+    for (int k = 0; k < 4; k++) {
+        snprintf(rt_channel, SMALL_HDF5_STR, "junk4_%d", rt_codecs[k]);
+        snprintf(rt_channel_dir, BIG_HDF5_STR, "%s/%s", RT_DIR, rt_channel);
+        if (mkdir(rt_channel_dir, 0775)) {
+            fprintf(stderr, "mkdir %s failed\n", rt_channel_dir);
+            exit(-1);
+        }
+        write_obj = digital_rf_create_write_hdf5(rt_channel_dir, H5T_NATIVE_SHORT, 2, 400, start, 200, 3,
+                "FAKE_UUID_READ", 0, 1, 1, RT_SUBCHANNELS, 0, 0);
+        if (!write_obj || digital_rf_set_codec(write_obj, 7, 1) == 0) {
+            fprintf(stderr, "unknown codec not refused\n");
+            exit(-1);
+        }
+        if (H5Zfilter_avail((H5Z_filter_t)rt_codecs[k]) <= 0) {
+            if (digital_rf_set_codec(write_obj, rt_codecs[k], rt_levels[k]) != -1
+                || digital_rf_close_write_hdf5(write_obj)) {
+                fprintf(stderr, "codec %d without its filter not refused\n", rt_codecs[k]);
+                exit(-1);
+            }
+            printf("codec %d skipped, its Hdf5 filter is not available\n", rt_codecs[k]);
+            if (!rt_missing_codec)
+                rt_missing_codec = rt_codecs[k];
+            continue;
+        }
+        if (digital_rf_set_codec(write_obj, rt_codecs[k], rt_levels[k])
+            || digital_rf_write_blocks_hdf5(write_obj, global_index_arr, data_index_arr, 2, data_out, RT_LEN)
+            || digital_rf_close_write_hdf5(write_obj)) {
+            fprintf(stderr, "write with codec %d failed\n", rt_codecs[k]);
+            exit(-1);
+        }
+        /* the codec is the first filter and mandatory, the checksum after it */
+        unsigned int rt_flags = H5Z_FLAG_OPTIONAL;
+        H5Z_filter_t rt_filters[2] = {-1, -1};
+        snprintf(rt_channel_dir, BIG_HDF5_STR, "%s/%s/2014-03-09T12-30-30/rf@1394368230.000.h5", RT_DIR, rt_channel);
+        hid_t rt_codec_file = H5Fopen(rt_channel_dir, H5F_ACC_RDONLY, H5P_DEFAULT);
+        if (rt_codec_file >= 0) {
+            hid_t rt_dataset = H5Dopen2(rt_codec_file, "rf_data", H5P_DEFAULT);
+            hid_t rt_plist = H5Dget_create_plist(rt_dataset);
+            if (H5Pget_nfilters(rt_plist) == 2) {
+                rt_filters[0] = H5Pget_filter2(rt_plist, 0, &rt_flags, NULL, NULL, 0, NULL, NULL);
+                rt_filters[1] = H5Pget_filter2(rt_plist, 1, NULL, NULL, NULL, 0, NULL, NULL);
+            }
+            H5Pclose(rt_plist);
+            H5Dclose(rt_dataset);
+            H5Fclose(rt_codec_file);
+        }
+        if (rt_filters[0] != rt_codecs[k] || (rt_flags & H5Z_FLAG_OPTIONAL)
+            || rt_filters[1] != H5Z_FILTER_FLETCHER32) {
+            fprintf(stderr, "filters of codec %d wrong\n", rt_codecs[k]);
+            exit(-1);
+        }
+        read_obj = digital_rf_create_read_hdf5(RT_DIR, b);
+        if (read_vector(read_obj, start, 2 * RT_LEN, rt_channel, data_in) != RT_LEN
+            || memcmp(data_in, data_out, 50 * sizeof(data_out[0])) != 0
+            || data_in[100][0].r != INT16_MIN
+            || memcmp(data_in[150], data_out[50], 50 * sizeof(data_out[0])) != 0) {
+            fprintf(stderr, "read_vector of codec %d write failed\n", rt_codecs[k]);
+            exit(-1);
+        }
+        digital_rf_close_read_hdf5(read_obj);
+    }
+#if H5_VERSION_GE(1, 10, 1)
+    /* a file written with a codec whose plugin is then missing, here a pass through filter registered under the
+     * id of a codec skipped above and unregistered after the write, is refused by the reader with the plugin path
+     * pointed at an empty directory */
+    if (rt_missing_codec) {
+        H5Z_class2_t rt_stub_class = {H5Z_CLASS_T_VERS, (H5Z_filter_t)rt_missing_codec, 1, 1, "stub", NULL, NULL,
+                                      rt_stub_filter};
+        char rt_plugin_paths[8][BIG_HDF5_STR];
+        unsigned int rt_num_paths = 0;
+        if (mkdir(RT_DIR "/junk4_missing", 0775) || mkdir(RT_DIR "/plugins", 0775)
+            || H5Zregister(&rt_stub_class) < 0) {
+            fprintf(stderr, "setting up the missing filter failed\n");
+            exit(-1);
+        }
+        write_obj = digital_rf_create_write_hdf5(RT_DIR "/junk4_missing", H5T_NATIVE_SHORT, 2, 400, start, 200, 3,
+                "FAKE_UUID_READ", 0, 0, 1, RT_SUBCHANNELS, 0, 0);
+        if (!write_obj || digital_rf_set_codec(write_obj, rt_missing_codec, 1)
+            || digital_rf_write_hdf5(write_obj, 0, data_out, RT_LEN) || digital_rf_close_write_hdf5(write_obj)
+            || H5Zunregister((H5Z_filter_t)rt_missing_codec) < 0 || H5PLsize(&rt_num_paths) < 0
+            || rt_num_paths > 8) {
+            fprintf(stderr, "write with the stub filter failed\n");
+            exit(-1);
+        }
+        for (unsigned int i = 0; i < rt_num_paths; i++) {
+            if (H5PLget(0, rt_plugin_paths[i], BIG_HDF5_STR) < 0 || H5PLremove(0) < 0)
+                exit(-1);
+        }
+        if (H5PLappend(RT_DIR "/plugins") < 0)
+            exit(-1);
+        read_obj = digital_rf_create_read_hdf5(RT_DIR, b);
+        if (read_vector(read_obj, start, RT_LEN, "junk4_missing", data_in) >= 0) {
+            fprintf(stderr, "file with a missing filter not refused\n");
+            exit(-1);
+        }
+        digital_rf_close_read_hdf5(read_obj);
+        if (H5PLremove(0) < 0)
+            exit(-1);
+        for (unsigned int i = 0; i < rt_num_paths; i++) {
+            if (H5PLappend(rt_plugin_paths[i]) < 0)
+                exit(-1);
+        }
+    } else {
+        printf("missing filter test skipped, the Hdf5 filter of every codec is available\n");
+    }
+#endif
+
+    /* the gapped write on two channels sharing the threads of a hub, which also prepares their next files */
+    Digital_rf_write_hub * hub = digital_rf_create_write_hub(2, 1);
+    Digital_rf_write_object * hub_objs[2];
+    uint64_t hub_bytes = 0;
+    int hub_backlog = -1;
+    if (mkdir(RT_DIR "/junk5", 0775) || mkdir(RT_DIR "/junk6", 0775)) {
+        fprintf(stderr, "mkdir of hub channels failed\n");
+        exit(-1);
+    }
+    hub_objs[0] = digital_rf_create_write_hdf5(RT_DIR "/junk5", H5T_NATIVE_SHORT, 2, 400, start, 200, 3,
+            "FAKE_UUID_READ", 0, 0, 1, RT_SUBCHANNELS, 0, 0);
+    hub_objs[1] = digital_rf_create_write_hdf5(RT_DIR "/junk6", H5T_NATIVE_SHORT, 2, 400, start, 200, 3,
+            "FAKE_UUID_READ", 0, 0, 1, RT_SUBCHANNELS, 0, 0);
+    if (!hub || !hub_objs[0] || !hub_objs[1] || digital_rf_hub_add_channel(hub, hub_objs[0], 4, 16, 1)
+        || digital_rf_hub_add_channel(hub, hub_objs[1], 4, 16, 1)
+        || digital_rf_write_blocks_hdf5(hub_objs[0], global_index_arr, data_index_arr, 2, data_out, RT_LEN)
+        || digital_rf_write_blocks_hdf5(hub_objs[1], global_index_arr, data_index_arr, 2, data_out, RT_LEN)
+        || digital_rf_flush_async(hub_objs[0]) || digital_rf_flush_async(hub_objs[1])
+        || digital_rf_close_write_hdf5(hub_objs[0])
+        || digital_rf_get_hub_stats(hub, &hub_bytes, NULL, &hub_backlog, NULL, NULL, NULL)
+        || hub_bytes != 2 * sizeof(data_out) || hub_backlog != 0
+        || digital_rf_close_write_hub(hub)) {
+        fprintf(stderr, "write through hub failed\n");
+        exit(-1);
+    }
+    if (system("find " RT_DIR "/junk5 " RT_DIR "/junk6 -name 'next.*' | grep -q .") == 0) {
+        fprintf(stderr, "hub left a prepared file behind\n");
+        exit(-1);
+    }
+    read_obj = digital_rf_create_read_hdf5(RT_DIR, b);
+    if (read_vector(read_obj, start, 2 * RT_LEN, "junk5", data_in) != RT_LEN
+        || memcmp(data_in, data_out, 50 * sizeof(data_out[0])) != 0
+        || memcmp(data_in[150], data_out[50], 50 * sizeof(data_out[0])) != 0
+        || read_vector(read_obj, start, 2 * RT_LEN, "junk6", data_in) != RT_LEN
+        || memcmp(data_in, data_out, 50 * sizeof(data_out[0])) != 0
+        || memcmp(data_in[150], data_out[50], 50 * sizeof(data_out[0])) != 0) {
+        fprintf(stderr, "read_vector of hub write failed\n");
+        exit(-1);
+    }
+    digital_rf_close_read_hdf5(read_obj);
+
+    /* the gapped write with chunks sized from an 80 byte target: 10 samples, evened out to 3 chunks per file */
+    hsize_t rt_chunk[2] = {0, 0};
+    if (mkdir(RT_DIR "/junk7", 0775)) {
+        fprintf(stderr, "mkdir junk7 failed\n");
+        exit(-1);
+    }
+    write_obj = digital_rf_create_write_hdf5(RT_DIR "/junk7", H5T_NATIVE_SHORT, 2, 400, start, 200, 3,
+            "FAKE_UUID_READ", 0, 0, 1, RT_SUBCHANNELS, 0, 0);
+    if (!write_obj || digital_rf_set_chunk_shape(write_obj, 7, RT_SUBCHANNELS + 1, 0) == 0
+        || digital_rf_set_chunk_shape(write_obj, DIGITAL_RF_CHUNK_AUTO, 0, 80)
+        || digital_rf_write_blocks_hdf5(write_obj, global_index_arr, data_index_arr, 2, data_out, RT_LEN)
+        || digital_rf_close_write_hdf5(write_obj)) {
+        fprintf(stderr, "write with chunk shape failed\n");
+        exit(-1);
+    }
+    hid_t rt_file = H5Fopen(RT_DIR "/junk7/2014-03-09T12-30-30/rf@1394368230.000.h5", H5F_ACC_RDONLY, H5P_DEFAULT);
+    if (rt_file >= 0) {
+        hid_t rt_dataset = H5Dopen2(rt_file, "rf_data", H5P_DEFAULT);
+        hid_t rt_plist = H5Dget_create_plist(rt_dataset);
+        H5Pget_chunk(rt_plist, 2, rt_chunk);
+        H5Pclose(rt_plist);
+        H5Dclose(rt_dataset);
+        H5Fclose(rt_file);
+    }
+    read_obj = digital_rf_create_read_hdf5(RT_DIR, b);
+    if (rt_chunk[0] != 9 || rt_chunk[1] != RT_SUBCHANNELS
+        || read_vector(read_obj, start, 2 * RT_LEN, "junk7", data_in) != RT_LEN
+        || memcmp(data_in, data_out, 50 * sizeof(data_out[0])) != 0
+        || memcmp(data_in[150], data_out[50], 50 * sizeof(data_out[0])) != 0) {
+        fprintf(stderr, "read_vector of chunk shape write failed\n");
+        exit(-1);
+    }
+    digital_rf_close_read_hdf5(read_obj);
+
+    /* contiguous 2 second files written by Hdf5 and with direct io, across a skip and a file boundary */
+    struct complex_short (*direct_in)[RT_SUBCHANNELS] = malloc(2 * RT_LEN * sizeof(data_out[0]));
+    if (mkdir(RT_DIR "/junk8", 0775) || mkdir(RT_DIR "/junk9", 0775)) {
+        fprintf(stderr, "mkdir of contiguous channels failed\n");
+        exit(-1);
+    }
+    for (int k = 0; k < 2; k++) {
+        write_obj = digital_rf_create_write_hdf5(k ? RT_DIR "/junk9" : RT_DIR "/junk8", H5T_NATIVE_SHORT, 2, 2000,
+                start, 200, 3, "FAKE_UUID_READ", 0, 0, 1, RT_SUBCHANNELS, 1, 0);
+        /* SWMR turned on and back off must leave rf_data contiguous for direct io */
+        if (!write_obj || digital_rf_set_swmr(write_obj, 1) || digital_rf_set_swmr(write_obj, 0)
+            || write_obj->needs_chunking
+            || digital_rf_set_direct_io(write_obj, k, 1000) == 0
+            || digital_rf_set_direct_io(write_obj, k, 512)
+            || digital_rf_write_hdf5(write_obj, 0, data_out, RT_LEN)
+            || digital_rf_write_hdf5(write_obj, 150, data_out[50], 50)
+            || digital_rf_close_write_hdf5(write_obj)) {
+            fprintf(stderr, "contiguous write failed\n");
+            exit(-1);
+        }
+    }
+    read_obj = digital_rf_create_read_hdf5(RT_DIR, b);
+    result = read_vector(read_obj, start, 2 * RT_LEN, "junk8", data_in);
+    if (result < 150 || read_vector(read_obj, start, 2 * RT_LEN, "junk9", direct_in) != result
+        || memcmp(direct_in, data_in, 2 * RT_LEN * sizeof(data_out[0])) != 0
+        || memcmp(direct_in, data_out, RT_LEN * sizeof(data_out[0])) != 0
+        || direct_in[120][1].r != INT16_MIN
+        || memcmp(direct_in[150], data_out[50], 50 * sizeof(data_out[0])) != 0) {
+        fprintf(stderr, "read_vector of direct io write failed\n");
+        exit(-1);
+    }
+    digital_rf_close_read_hdf5(read_obj);
+    free(direct_in);
+
+    /* the gapped write with files built in memory, from a template on the precreate thread, written out at close */
+    if (mkdir(RT_DIR "/junk10", 0775)) {
+        fprintf(stderr, "mkdir junk10 failed\n");
+        exit(-1);
+    }
+    write_obj = digital_rf_create_write_hdf5(RT_DIR "/junk10", H5T_NATIVE_SHORT, 2, 400, start, 200, 3,
+            "FAKE_UUID_READ", 1, 1, 1, RT_SUBCHANNELS, 0, 0);
+    if (!write_obj || digital_rf_set_memory_files(write_obj, 1, 1) || digital_rf_set_swmr(write_obj, 1) == 0
+        || digital_rf_set_file_template(write_obj, 1) || digital_rf_set_precreate(write_obj, 1)
+        || digital_rf_write_hdf5(write_obj, 0, data_out, 20)
+        || system("ls " RT_DIR "/junk10/*/*.h5 > /dev/null 2>&1") == 0
+        || digital_rf_write_hdf5(write_obj, 20, data_out[20], 30)
+        || digital_rf_write_hdf5(write_obj, 150, data_out[50], 50)
+        || digital_rf_close_write_hdf5(write_obj)) {
+        fprintf(stderr, "write of memory files failed\n");
+        exit(-1);
+    }
+    read_obj = digital_rf_create_read_hdf5(RT_DIR, b);
+    if (read_vector(read_obj, start, 2 * RT_LEN, "junk10", data_in) != RT_LEN
+        || memcmp(data_in, data_out, 50 * sizeof(data_out[0])) != 0
+        || memcmp(data_in[150], data_out[50], 50 * sizeof(data_out[0])) != 0) {
+        fprintf(stderr, "read_vector of memory files failed\n");
+        exit(-1);
+    }
+    digital_rf_close_read_hdf5(read_obj);
+
+    /* the gapped write captured to staging files, packed into compressed files while capture goes on */
+    if (mkdir(RT_DIR "/junk11", 0775)) {
+        fprintf(stderr, "mkdir junk11 failed\n");
+        exit(-1);
+    }
+    write_obj = digital_rf_create_write_hdf5(RT_DIR "/junk11", H5T_NATIVE_SHORT, 2, 400, start, 200, 3,
+            "FAKE_UUID_READ", 0, 0, 1, RT_SUBCHANNELS, 0, 0);
+    Digital_rf_write_object *pack_obj = digital_rf_create_write_hdf5(RT_DIR "/junk11", H5T_NATIVE_SHORT, 2, 400,
+            start, 200, 3, "FAKE_UUID_READ", 1, 1, 1, RT_SUBCHANNELS, 0, 0);
+    if (!write_obj || !pack_obj || digital_rf_set_staging(write_obj, 1)
+        || digital_rf_write_hdf5(write_obj, 0, data_out, 50)
+        || digital_rf_pack_staging(pack_obj) != 1
+        || digital_rf_write_hdf5(write_obj, 150, data_out[50], 50)
+        || digital_rf_close_write_hdf5(write_obj)
+        || system("ls " RT_DIR "/junk11/staging/tmp.* > /dev/null 2>&1") == 0
+        || digital_rf_pack_staging(pack_obj) != 4
+        || digital_rf_close_write_hdf5(pack_obj)
+        || system("ls " RT_DIR "/junk11/staging/* > /dev/null 2>&1") == 0) {
+        fprintf(stderr, "staging write and pack failed\n");
+        exit(-1);
+    }
+    read_obj = digital_rf_create_read_hdf5(RT_DIR, b);
+    if (read_vector(read_obj, start, 2 * RT_LEN, "junk11", data_in) != RT_LEN
+        || memcmp(data_in, data_out, 50 * sizeof(data_out[0])) != 0
+        || memcmp(data_in[150], data_out[50], 50 * sizeof(data_out[0])) != 0) {
+        fprintf(stderr, "read_vector of packed staging files failed\n");
+        exit(-1);
+    }
+    digital_rf_close_read_hdf5(read_obj);
+
+    /* a rollover of the packer that can not write out the file it finishes keeps that file's staging file */
+    if (mkdir(RT_DIR "/junk12", 0775)) {
+        fprintf(stderr, "mkdir junk12 failed\n");
+        exit(-1);
+    }
+    write_obj = digital_rf_create_write_hdf5(RT_DIR "/junk12", H5T_NATIVE_SHORT, 2, 400, start, 200, 3,
+            "FAKE_UUID_READ", 0, 0, 1, RT_SUBCHANNELS, 0, 0);
+    pack_obj = digital_rf_create_write_hdf5(RT_DIR "/junk12", H5T_NATIVE_SHORT, 2, 400, start, 200, 3,
+            "FAKE_UUID_READ", 0, 0, 1, RT_SUBCHANNELS, 0, 0);
+    if (!write_obj || !pack_obj || digital_rf_set_staging(write_obj, 1) || digital_rf_set_memory_files(pack_obj, 1, 0)
+        || digital_rf_write_hdf5(write_obj, 0, data_out, 20)
+        || digital_rf_write_hdf5(write_obj, 30, data_out[20], 10)
+        || digital_rf_pack_staging(pack_obj) != 1
+        /* the first file is in memory, and taking its name on disk makes writing it out fail */
+        || system("touch " RT_DIR "/junk12/2014-03-09T12-30-30/tmp.rf@1394368230.000.h5")
+        || digital_rf_write_hdf5(write_obj, 150, data_out[50], 10)
+        || digital_rf_pack_staging(pack_obj) != -1
+        || digital_rf_close_write_hdf5(pack_obj) != 0
+        || system("ls " RT_DIR "/junk12/staging/rf@1394368230.000.raw > /dev/null 2>&1") != 0
+        || system("ls " RT_DIR "/junk12/*/*.h5 > /dev/null 2>&1") == 0) {
+        fprintf(stderr, "failed rollover of packer lost its staging file\n");
+        exit(-1);
+    }
+    /* a new packer packs it again */
+    pack_obj = digital_rf_create_write_hdf5(RT_DIR "/junk12", H5T_NATIVE_SHORT, 2, 400, start, 200, 3,
+            "FAKE_UUID_READ", 0, 0, 1, RT_SUBCHANNELS, 0, 0);
+    if (!pack_obj || digital_rf_close_write_hdf5(write_obj) || digital_rf_pack_staging(pack_obj) != 3
+        || digital_rf_close_write_hdf5(pack_obj)) {
+        fprintf(stderr, "pack after failed rollover failed\n");
+        exit(-1);
+    }
+    read_obj = digital_rf_create_read_hdf5(RT_DIR, b);
+    if (read_vector(read_obj, start, 2 * RT_LEN, "junk12", data_in) != 40
+        || memcmp(data_in, data_out, 20 * sizeof(data_out[0])) != 0
+        || memcmp(data_in[30], data_out[20], 10 * sizeof(data_out[0])) != 0
+        || memcmp(data_in[150], data_out[50], 10 * sizeof(data_out[0])) != 0) {
+        fprintf(stderr, "read_vector after failed rollover failed\n");
+        exit(-1);
+    }
+    digital_rf_close_read_hdf5(read_obj);
+
+    /* tail samples out of the tmp.rf@ file while the SWMR writer still has it open */
+    /* the SWMR file template is built in memory, so whatever sits where it was once built on disk is left alone */
+    if (mkdir(RT_DIR "/junk2", 0775) || mkdir(RT_DIR "/junk2/tmp.drf_template.h5", 0775)
+        || mkdir(RT_DIR "/junk2/tmp.drf_template.h5/keep", 0775)) {
+        fprintf(stderr, "mkdir junk2 failed\n");
+        exit(-1);
+    }
+    write_obj = digital_rf_create_write_hdf5(RT_DIR "/junk2", H5T_NATIVE_SHORT, 2, 400, start, 200, 3,
+            "FAKE_UUID_READ", 0, 0, 1, RT_SUBCHANNELS, 0, 0);
+    if (!write_obj || digital_rf_set_swmr(write_obj, 1) || digital_rf_set_file_template(write_obj, 1)
+        || digital_rf_write_hdf5(write_obj, 0, data_out, 30)
+        || write_obj->file_templates == NULL
+        || rt_remove_dir(RT_DIR "/junk2/tmp.drf_template.h5")) {
+        fprintf(stderr, "write from an in-memory SWMR template failed\n");
+        exit(-1);
+    }
+    read_obj = digital_rf_create_read_hdf5(RT_DIR, b);
+    if (digital_rf_read_tail(read_obj, "junk2", start, RT_LEN, data_in, 0) != 30
+        || memcmp(data_in, data_out, 30 * sizeof(data_out[0])) != 0
+        || digital_rf_read_tail(read_obj, "junk2", start + 30, RT_LEN, data_in, 20) != 0) {
+        fprintf(stderr, "digital_rf_read_tail of open file failed\n");
+        exit(-1);
+    }
+    if (digital_rf_write_hdf5(write_obj, 40, data_out[30], 30)
+        || digital_rf_read_tail(read_obj, "junk2", start + 25, RT_LEN, data_in, -1) != 45
+        || memcmp(data_in, data_out[25], 5 * sizeof(data_out[0])) != 0
+        || data_in[5][0].r != INT16_MIN
+        || memcmp(data_in[15], data_out[30], 30 * sizeof(data_out[0])) != 0) {
+        fprintf(stderr, "digital_rf_read_tail across a gap failed\n");
+        exit(-1);
+    }
+    digital_rf_close_write_hdf5(write_obj);
+    if (digital_rf_read_tail(read_obj, "junk2", start + 60, RT_LEN, data_in, 0) != 10
+        || memcmp(data_in, data_out[50], 10 * sizeof(data_out[0])) != 0) {
+        fprintf(stderr, "digital_rf_read_tail of finalized file failed\n");
+        exit(-1);
+    }
+    digital_rf_close_read_hdf5(read_obj);
+    read_obj = NULL;
+    if (rt_remove_dir(RT_DIR)) {
+        fprintf(stderr, "failed to remove " RT_DIR "\n");
+        exit(-1);
+    }
+
     printf("passed tests if we get here\n");
     return(0);
-}
\ No newline at end of file
+}